@@ -0,0 +1,401 @@
+// Archive.cpp
+// Implementation of the binary archive: position packing, the memory map, the writer, the reader and the
+// --archive-build / --archive-read tools.
+#include <chrono> // Include chrono for timing the lookups
+#include <cstdlib> // Include cstdlib for atoll
+#include <cstring> // Include cstring for memcmp and memset
+#include <iomanip> // Include iomanip for formatting the report
+#include "Archive.h" // Archive declarations
+#include "Pgn.h" // PGN reader for building archives
+#ifdef _WIN32
+#define NOMINMAX // Keep windows.h from defining min and max
+#include <windows.h> // Include windows.h for the file mapping
+#else
+#include <fcntl.h> // Include fcntl.h for open
+#include <sys/mman.h> // Include sys/mman.h for mmap
+#include <sys/stat.h> // Include sys/stat.h for the file size
+#include <unistd.h> // Include unistd.h for close
+#endif
+using namespace std;
+
+static_assert(sizeof(PackedPosition) == 32, "A packed position must be 32 bytes");
+static_assert(sizeof(ArchiveGame) == 40, "A game record header must be 40 bytes");
+static_assert(sizeof(ArchiveHeader) == 64, "The archive header must be 64 bytes");
+
+const size_t ARCHIVE_ALIGNMENT = 8; // Every section and game record starts on a multiple of this
+
+bool packPosition(const Position& pos, PackedPosition& packed) {
+    memset(&packed, 0, sizeof(packed)); // Unused nibbles and padding are written as zero
+    if (popCount(pos.occupied) > 32) return false;
+    packed.occupied = pos.occupied;
+    Bitboard b = pos.occupied;
+    for (int i = 0; b; i++) { // One code per occupied square, lowest square first
+        int sq = popLsb(b);
+        packed.pieces[i >> 1] |= uint8_t((pos.colorOn(sq) * PIECE_TYPE_NB + pos.pieceTypeOn(sq)) << ((i & 1) * 4));
+    }
+    packed.castlingRights = pos.castlingRights;
+    packed.enPassantSquare = pos.enPassantSquare;
+    packed.sideToMove = pos.sideToMove;
+    packed.halfMoveClock = pos.halfMoveClock;
+    packed.fullMoveNumber = pos.fullMoveNumber;
+    return true;
+}
+
+void unpackPosition(const PackedPosition& packed, Position& pos) {
+    pos.clear();
+    Bitboard b = packed.occupied;
+    for (int i = 0; b && i < 32; i++) {
+        int sq = popLsb(b);
+        int code = (packed.pieces[i >> 1] >> ((i & 1) * 4)) & 15;
+        if (code < COLOR_NB * PIECE_TYPE_NB) pos.putPiece(sq, code / PIECE_TYPE_NB, code % PIECE_TYPE_NB); // Damaged codes are skipped
+    }
+    pos.castlingRights = packed.castlingRights & ALL_CASTLING;
+    pos.enPassantSquare = packed.enPassantSquare >= 0 && packed.enPassantSquare < SQUARE_NB ? packed.enPassantSquare : NO_SQUARE;
+    pos.sideToMove = packed.sideToMove == BLACK ? BLACK : WHITE;
+    pos.halfMoveClock = packed.halfMoveClock;
+    pos.fullMoveNumber = packed.fullMoveNumber;
+    // putPiece already keyed the pieces; only the state fields are added
+    pos.key ^= ZOBRIST_CASTLING[pos.castlingRights];
+    if (pos.enPassantSquare != NO_SQUARE) pos.key ^= ZOBRIST_EN_PASSANT[colOf(pos.enPassantSquare)];
+    if (pos.sideToMove == BLACK) pos.key ^= ZOBRIST_SIDE;
+}
+
+#ifdef _WIN32
+MappedFile::MappedFile() : bytes(nullptr), length(0), fileHandle(nullptr), mappingHandle(nullptr) {}
+#else
+MappedFile::MappedFile() : bytes(nullptr), length(0) {}
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const string& filename) {
+    close();
+#ifdef _WIN32
+    HANDLE f = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (f == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(f, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(f);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(f);
+        return false;
+    }
+    fileHandle = f;
+    mappingHandle = mapping;
+    bytes = static_cast<const uint8_t*>(view);
+    length = size_t(fileSize.QuadPart);
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps the file open
+    if (view == MAP_FAILED) return false;
+#if defined(MADV_RANDOM)
+    madvise(view, size_t(info.st_size), MADV_RANDOM); // Lookups jump around: no point reading ahead
+#endif
+    bytes = static_cast<const uint8_t*>(view);
+    length = size_t(info.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+    if (!bytes) return;
+#ifdef _WIN32
+    UnmapViewOfFile(bytes);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+    fileHandle = mappingHandle = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+    bytes = nullptr;
+    length = 0;
+}
+
+ArchiveWriter::ArchiveWriter() : file(nullptr), positionFile(nullptr), offset(0), positionCount(0) {}
+
+ArchiveWriter::~ArchiveWriter() {
+    if (!file) return; // Finished (or never opened)
+    fclose(file);
+    fclose(positionFile);
+    remove(filename.c_str()); // An archive without its index is useless
+    remove((filename + ".positions").c_str());
+}
+
+bool ArchiveWriter::write(const void* data, size_t size) {
+    if (fwrite(data, 1, size, file) != size) return false;
+    offset += size;
+    return true;
+}
+
+bool ArchiveWriter::open(const string& name) {
+    filename = name;
+    file = fopen(name.c_str(), "wb");
+    positionFile = file ? fopen((name + ".positions").c_str(), "w+b") : nullptr;
+    if (!positionFile) {
+        if (file) fclose(file);
+        file = nullptr;
+        return false;
+    }
+    gameOffsets.clear();
+    offset = positionCount = 0;
+    ArchiveHeader blank; // Placeholder, rewritten by finish() once the counts are known
+    memset(&blank, 0, sizeof(blank));
+    return write(&blank, sizeof(blank));
+}
+
+bool ArchiveWriter::addGame(const Position& start, const Move* moves, uint32_t plies, uint8_t result, int whiteChecks, int blackChecks) {
+    ArchiveGame record;
+    memset(&record, 0, sizeof(record));
+    if (!file || !packPosition(start, record.start)) return false;
+    record.plies = plies;
+    record.result = result;
+    record.checks[WHITE] = uint8_t(whiteChecks < 255 ? whiteChecks : 255);
+    record.checks[BLACK] = uint8_t(blackChecks < 255 ? blackChecks : 255);
+    gameOffsets.push_back(offset);
+    static const uint8_t padding[ARCHIVE_ALIGNMENT] = {}; // Zero bytes to realign after the moves
+    size_t movesSize = plies * sizeof(Move);
+    return write(&record, sizeof(record)) && (plies == 0 || write(moves, movesSize)) &&
+           write(padding, (ARCHIVE_ALIGNMENT - movesSize % ARCHIVE_ALIGNMENT) % ARCHIVE_ALIGNMENT);
+}
+
+bool ArchiveWriter::addPosition(const Position& pos) {
+    PackedPosition packed;
+    if (!positionFile || !packPosition(pos, packed)) return false;
+    if (fwrite(&packed, sizeof(packed), 1, positionFile) != 1) return false;
+    positionCount++;
+    return true;
+}
+
+bool ArchiveWriter::finish() {
+    if (!file) return false;
+    ArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+    header.version = ARCHIVE_VERSION;
+    header.headerSize = sizeof(ArchiveHeader);
+    header.gameCount = gameOffsets.size();
+    header.gameIndexOffset = offset;
+    gameOffsets.push_back(offset); // End of the last game record
+    bool ok = write(gameOffsets.data(), gameOffsets.size() * sizeof(uint64_t));
+    header.positionCount = positionCount;
+    header.positionsOffset = offset;
+
+    vector<char> block(1 << 20); // Copying the side file across in 1 MB blocks
+    rewind(positionFile);
+    size_t got;
+    while (ok && (got = fread(block.data(), 1, block.size(), positionFile)) > 0) ok = write(block.data(), got);
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1; // Header last: a crash leaves no valid archive
+    ok = fclose(file) == 0 && ok;
+    fclose(positionFile);
+    file = positionFile = nullptr;
+    remove((filename + ".positions").c_str());
+    if (!ok) remove(filename.c_str());
+    return ok;
+}
+
+bool ArchiveReader::open(const string& filename) {
+    header = nullptr;
+    if (!map.open(filename) || map.size() < sizeof(ArchiveHeader)) return false;
+    const ArchiveHeader* h = reinterpret_cast<const ArchiveHeader*>(map.data());
+    uint64_t size = map.size();
+    if (memcmp(h->magic, ARCHIVE_MAGIC, sizeof(h->magic)) != 0 || h->version != ARCHIVE_VERSION || h->headerSize < sizeof(ArchiveHeader)) return false;
+    // The sections must lie inside the file and be aligned; the counts are checked against the size first so the
+    // products below cannot overflow.
+    if (h->gameCount >= size / sizeof(uint64_t) || h->positionCount > size / sizeof(PackedPosition)) return false;
+    if (h->gameIndexOffset % ARCHIVE_ALIGNMENT || h->positionsOffset % ARCHIVE_ALIGNMENT) return false;
+    if (h->gameIndexOffset > size || (h->gameCount + 1) * sizeof(uint64_t) > size - h->gameIndexOffset) return false;
+    if (h->positionsOffset > size || h->positionCount * sizeof(PackedPosition) > size - h->positionsOffset) return false;
+    header = h;
+    gameIndex = reinterpret_cast<const uint64_t*>(map.data() + h->gameIndexOffset);
+    positions = reinterpret_cast<const PackedPosition*>(map.data() + h->positionsOffset);
+    return true;
+}
+
+const PackedPosition* ArchiveReader::position(uint64_t n) const {
+    return n < positionCount() ? positions + n : nullptr;
+}
+
+const ArchiveGame* ArchiveReader::game(uint64_t n) const {
+    if (n >= gameCount()) return nullptr;
+    uint64_t begin = gameIndex[n], end = gameIndex[n + 1]; // The next record's offset bounds this one
+    if (begin % ARCHIVE_ALIGNMENT || begin < sizeof(ArchiveHeader) || end > header->gameIndexOffset || end < begin + sizeof(ArchiveGame)) return nullptr;
+    const ArchiveGame* record = reinterpret_cast<const ArchiveGame*>(map.data() + begin);
+    if (record->plies > (end - begin - sizeof(ArchiveGame)) / sizeof(Move)) return nullptr; // Moves run past the record
+    return record;
+}
+
+bool hasArchiveExtension(const string& filename) {
+    return filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".cgb") == 0;
+}
+
+static uint8_t archiveResult(const string& result) {
+    if (result == "1-0") return ARCHIVE_RESULT_WHITE_WINS;
+    if (result == "0-1") return ARCHIVE_RESULT_BLACK_WINS;
+    if (result == "1/2-1/2") return ARCHIVE_RESULT_DRAW;
+    return ARCHIVE_RESULT_UNKNOWN;
+}
+
+// ChessGame --archive-build <in.pgn | -> <out.cgb> [--moves] [--positions]
+// Every legal game becomes a record; with --positions every position reached in the games is stored as well.
+static int buildArchive(int argc, char* argv[]) {
+    string input, output;
+    bool moveList = false, withPositions = false;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--moves") moveList = true;
+        else if (arg == "--positions") withPositions = true;
+        else if (input.empty()) input = arg;
+        else if (output.empty()) output = arg;
+    }
+    if (input.empty() || output.empty()) {
+        cerr << "Usage: --archive-build <in.pgn | -> <out.cgb> [--moves] [--positions]\n";
+        return 2;
+    }
+    PgnReader reader(input, moveList);
+    ArchiveWriter writer;
+    if (!reader.isOpen() || !writer.open(output)) {
+        cerr << "Cannot open " << (reader.isOpen() ? output : input) << "\n";
+        return 2;
+    }
+    ChessBoard board, walker; // Replay board, and a second one walking the positions of a checked game
+    PgnGame game;
+    ReplayResult replay;
+    uint64_t games = 0, skipped = 0;
+    auto start = chrono::steady_clock::now();
+    while (reader.nextGame(game)) {
+        if (!replayGame(game, board, replay)) { // Only legal games go into the archive
+            skipped++;
+            continue;
+        }
+        bool ok = writer.addGame(replay.start, replay.moves.data(), uint32_t(replay.moves.size()), archiveResult(replay.result),
+                                 replay.checks[WHITE], replay.checks[BLACK]);
+        if (ok && withPositions) {
+            walker.setPosition(replay.start);
+            ok = writer.addPosition(walker.position());
+            for (size_t i = 0; ok && i < replay.moves.size(); i++) {
+                walker.playMove(replay.moves[i]);
+                ok = writer.addPosition(walker.position());
+            }
+        }
+        if (!ok) {
+            cerr << "Write error on " << output << "\n";
+            return 2;
+        }
+        games++;
+    }
+    if (!writer.finish()) {
+        cerr << "Write error on " << output << "\n";
+        return 2;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    ArchiveReader check;
+    check.open(output);
+    cout << games << " games" << (skipped ? " (" + to_string(skipped) + " with errors skipped)" : string()) << ", "
+         << check.positionCount() << " positions written to " << output << " in " << fixed << setprecision(3) << seconds << "s\n";
+    cout.unsetf(ios::fixed);
+    return 0;
+}
+
+// ChessGame --archive-read <file.cgb> [--game N] [--position N] [--bench K]
+// Prints the counts and the time the open took, then the requested game or position; --bench times K random lookups.
+static int readArchive(int argc, char* argv[]) {
+    string filename;
+    long long gameNumber = -1, positionNumber = -1, lookups = 0;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--game" && i + 1 < argc) gameNumber = atoll(argv[++i]);
+        else if (arg == "--position" && i + 1 < argc) positionNumber = atoll(argv[++i]);
+        else if (arg == "--bench" && i + 1 < argc) lookups = atoll(argv[++i]);
+        else if (filename.empty()) filename = arg;
+    }
+    if (filename.empty()) {
+        cerr << "Usage: --archive-read <file.cgb> [--game N] [--position N] [--bench K]\n";
+        return 2;
+    }
+    initAttackTables(); // Replaying needs the move tables, unpacking needs the keys
+    initZobristKeys();
+    auto start = chrono::steady_clock::now();
+    ArchiveReader archive;
+    if (!archive.open(filename)) {
+        cerr << "Cannot open " << filename << " (missing or not an archive)\n";
+        return 2;
+    }
+    Position pos;
+    const PackedPosition* first = archive.position(0); // First touch of the data: the cold-start cost
+    if (first) unpackPosition(*first, pos);
+    double openUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    cout << filename << ": " << archive.gameCount() << " games, " << archive.positionCount() << " positions, opened in "
+         << fixed << setprecision(1) << openUs << " us\n";
+    cout.unsetf(ios::fixed);
+
+    if (gameNumber >= 0) {
+        const ArchiveGame* game = archive.game(uint64_t(gameNumber));
+        if (!game) {
+            cerr << "No game " << gameNumber << "\n";
+            return 2;
+        }
+        ChessBoard board;
+        unpackPosition(game->start, pos);
+        board.setPosition(pos);
+        cout << "Game " << gameNumber << " from " << board.toFen() << "\n";
+        const char* results[] = {"*", "1-0", "0-1", "1/2-1/2"};
+        const Move* moves = archive.gameMoves(game);
+        for (uint32_t i = 0; i < game->plies; i++) {
+            MoveList legal; // A damaged record must not be able to corrupt the board
+            board.generateMoves(legal);
+            if (!legal.contains(moves[i])) {
+                cout << "\n(illegal move in record)";
+                break;
+            }
+            cout << moveToString(moves[i]) << " ";
+            board.playMove(moves[i]);
+        }
+        cout << (game->result <= ARCHIVE_RESULT_DRAW ? results[game->result] : "?") << "\nChecks " << int(game->checks[WHITE])
+             << "/" << int(game->checks[BLACK]) << ", final position " << board.toFen() << "\n";
+    }
+    if (positionNumber >= 0) {
+        const PackedPosition* packed = archive.position(uint64_t(positionNumber));
+        if (!packed) {
+            cerr << "No position " << positionNumber << "\n";
+            return 2;
+        }
+        unpackPosition(*packed, pos);
+        cout << "Position " << positionNumber << ": " << pos.toFen() << "\n";
+    }
+    if (lookups > 0 && (archive.positionCount() || archive.gameCount())) {
+        uint64_t seed = 20240601, checksum = 0; // The checksum keeps the compiler from dropping the lookups
+        auto t0 = chrono::steady_clock::now();
+        for (long long i = 0; i < lookups && archive.positionCount(); i++) {
+            unpackPosition(*archive.position(nextRandom(seed) % archive.positionCount()), pos);
+            checksum ^= pos.key;
+        }
+        auto t1 = chrono::steady_clock::now();
+        for (long long i = 0; i < lookups && archive.gameCount(); i++) {
+            const ArchiveGame* game = archive.game(nextRandom(seed) % archive.gameCount());
+            if (game && game->plies) checksum ^= archive.gameMoves(game)[0];
+        }
+        auto t2 = chrono::steady_clock::now();
+        cout << "Random position lookup + unpack: " << fixed << setprecision(1) << chrono::duration<double, nano>(t1 - t0).count() / lookups
+             << " ns, random game lookup: " << chrono::duration<double, nano>(t2 - t1).count() / lookups << " ns  (checksum " << checksum % 1000 << ")\n";
+        cout.unsetf(ios::fixed);
+    }
+    return 0;
+}
+
+int archiveMain(int argc, char* argv[]) {
+    return string(argv[1]) == "--archive-build" ? buildArchive(argc, argv) : readArchive(argc, argv);
+}
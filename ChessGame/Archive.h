@@ -0,0 +1,127 @@
+// Archive.h
+// Binary game and position archive (.cgb): fixed 32-byte positions and 16-bit move lists behind a header and an
+// offset index, read through a memory map so any game or position is reached without copying or parsing the file.
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <cstdint> // Include cstdint for the fixed-width file fields
+#include <cstdio> // Include cstdio for the writer's files
+#include <string> // Include string for file names
+#include <vector> // Include vector for the writer's game index
+#include "Move.h" // Include the 16-bit move type stored in the move lists
+
+// A position in 32 bytes: the occupied squares, then one 4-bit piece code (color * 6 + type) per occupied square in
+// square order, then the state fields. Legal positions have at most 32 pieces, so the codes fit in 16 bytes.
+struct PackedPosition {
+    uint64_t occupied; // Occupied squares
+    uint8_t pieces[16]; // Two piece codes per byte, low nibble first
+    uint8_t castlingRights; // Castling flags as in Position
+    int8_t enPassantSquare; // En passant square or NO_SQUARE
+    uint8_t sideToMove; // WHITE or BLACK
+    uint8_t reserved; // Zero
+    uint16_t halfMoveClock; // Half-moves since the last capture or pawn move
+    uint16_t fullMoveNumber; // Move counter
+};
+
+bool packPosition(const Position& pos, PackedPosition& packed); // Packing a position (false if it has more than 32 pieces)
+void unpackPosition(const PackedPosition& packed, Position& pos); // Rebuilding the position, key included
+
+// Game results as stored in the archive.
+const uint8_t ARCHIVE_RESULT_UNKNOWN = 0; // Unfinished or not recorded
+const uint8_t ARCHIVE_RESULT_WHITE_WINS = 1;
+const uint8_t ARCHIVE_RESULT_BLACK_WINS = 2;
+const uint8_t ARCHIVE_RESULT_DRAW = 3;
+
+// Start of every game record; the record's moves follow it directly as 'plies' 16-bit moves.
+struct ArchiveGame {
+    PackedPosition start; // Position before the first move
+    uint32_t plies; // Number of moves
+    uint8_t result; // ARCHIVE_RESULT_*
+    uint8_t checks[COLOR_NB]; // Checks given by White and by Black
+    uint8_t reserved; // Zero
+};
+
+// File layout (all fields little-endian, every section 8-byte aligned):
+//   header | game records | game index (gameCount + 1 offsets, the last one marks the end) | positions
+struct ArchiveHeader {
+    char magic[8]; // ARCHIVE_MAGIC
+    uint32_t version; // ARCHIVE_VERSION
+    uint32_t headerSize; // sizeof(ArchiveHeader), for later versions that add fields
+    uint64_t gameCount; // Game records
+    uint64_t gameIndexOffset; // File offset of the game index
+    uint64_t positionCount; // Positions in the position section
+    uint64_t positionsOffset; // File offset of the first position
+    uint64_t reserved[2]; // Zero
+};
+
+const char ARCHIVE_MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'C', 'G', 'B'}; // First bytes of every archive
+const uint32_t ARCHIVE_VERSION = 1; // Format version written by this program
+
+// Read-only memory map of a whole file (mmap, or a file mapping on Windows). Pages are read from disk when first
+// touched, so opening a large file costs the same as opening a small one.
+class MappedFile {
+private:
+    const uint8_t* bytes; // Start of the file contents, or nullptr
+    size_t length; // File size in bytes
+#ifdef _WIN32
+    void* fileHandle; // Windows file and mapping handles
+    void* mappingHandle;
+#endif
+
+    MappedFile(const MappedFile&); // Not copyable: the mapping has one owner
+    MappedFile& operator=(const MappedFile&);
+
+public:
+    MappedFile();
+    ~MappedFile();
+    bool open(const std::string& filename); // Mapping a file (false if it cannot be opened or is empty)
+    void close(); // Unmapping
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// Writes an archive front to back: game records go straight to the file, positions to a side file that is appended
+// when the archive is finished, so neither has to be held in memory.
+class ArchiveWriter {
+private:
+    FILE* file; // Archive being written
+    FILE* positionFile; // Side file collecting the positions
+    std::string filename; // Archive name (the side file is this name plus ".positions")
+    std::vector<uint64_t> gameOffsets; // File offset of each game record
+    uint64_t offset; // Bytes written to 'file' so far
+    uint64_t positionCount; // Positions written to the side file
+
+    bool write(const void* data, size_t size); // Appending to the archive file
+
+public:
+    ArchiveWriter();
+    ~ArchiveWriter(); // Abandons an unfinished archive
+    bool open(const std::string& name); // Starting a new archive (replacing any file of that name)
+    bool addGame(const Position& start, const Move* moves, uint32_t plies, uint8_t result, int whiteChecks, int blackChecks);
+    bool addPosition(const Position& pos); // Appending a position (false if it cannot be packed)
+    bool finish(); // Writing the index and positions and the final header (the archive is complete only after this)
+};
+
+// Random access to a finished archive. Everything returned points into the mapped file and stays valid until the
+// reader is closed or destroyed.
+class ArchiveReader {
+private:
+    MappedFile map; // The whole archive
+    const ArchiveHeader* header; // Start of the map
+    const uint64_t* gameIndex; // gameCount + 1 record offsets
+    const PackedPosition* positions; // Position section
+
+public:
+    ArchiveReader() : header(nullptr), gameIndex(nullptr), positions(nullptr) {}
+    bool open(const std::string& filename); // Mapping and checking an archive (false if it is missing or not an archive)
+    uint64_t gameCount() const { return header ? header->gameCount : 0; }
+    uint64_t positionCount() const { return header ? header->positionCount : 0; }
+    const PackedPosition* position(uint64_t n) const; // Position n, or nullptr if out of range
+    const ArchiveGame* game(uint64_t n) const; // Game record n, or nullptr if out of range or damaged
+    const Move* gameMoves(const ArchiveGame* game) const { return reinterpret_cast<const Move*>(game + 1); } // The record's moves
+};
+
+bool hasArchiveExtension(const std::string& filename); // Checking for the ".cgb" file name ending
+int archiveMain(int argc, char* argv[]); // Command-line entry for --archive-build and --archive-read
+
+#endif
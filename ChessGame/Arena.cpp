@@ -0,0 +1,128 @@
+// Arena.cpp
+// The bump allocator, the counting replacements of the global operator new/delete and --alloc-check.
+#include <atomic> // Include atomic for the allocation counter
+#include <cstdlib> // Include cstdlib for malloc, free and atoi
+#include <iostream> // Include iostream for the report
+#include "Arena.h" // Arena declarations
+#include "Perft.h" // Reference positions and perft
+#include "Search.h" // The engine searched under the counter
+using namespace std;
+
+Arena::Arena(size_t bytes) : base(static_cast<char*>(malloc(bytes))), capacity(base ? bytes : 0), used(0) {}
+
+Arena::~Arena() {
+    free(base);
+}
+
+void* Arena::allocate(size_t bytes, size_t alignment) {
+    size_t start = (used + alignment - 1) & ~(alignment - 1); // Rounding up to the alignment (always a power of two)
+    if (start > capacity || bytes > capacity - start) return nullptr;
+    used = start + bytes;
+    return base + start;
+}
+
+static atomic<bool> COUNTING_ALLOCATIONS(false); // Constant-initialized, so usable by allocations before main
+static atomic<uint64_t> HEAP_ALLOCATIONS(0);
+
+void countHeapAllocations(bool on) {
+    COUNTING_ALLOCATIONS.store(on, memory_order_relaxed);
+}
+
+uint64_t heapAllocations() {
+    return HEAP_ALLOCATIONS.load(memory_order_relaxed);
+}
+
+// Replacing the global operator new and delete (the array and nothrow forms go through these as well) lets every
+// allocation of the program be counted, including the ones made inside the standard library.
+void* operator new(size_t bytes) {
+    if (COUNTING_ALLOCATIONS.load(memory_order_relaxed)) HEAP_ALLOCATIONS.fetch_add(1, memory_order_relaxed);
+    if (bytes == 0) bytes = 1; // Every allocation needs a distinct address
+    for (;;) {
+        void* block = malloc(bytes);
+        if (block) return block;
+        new_handler handler = get_new_handler(); // The standard behaviour when memory runs out
+        if (!handler) throw bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](size_t bytes) {
+    return operator new(bytes);
+}
+
+void* operator new(size_t bytes, const nothrow_t&) noexcept {
+    try {
+        return operator new(bytes);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t bytes, const nothrow_t&) noexcept {
+    return operator new(bytes, nothrow);
+}
+
+void operator delete(void* block) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block) noexcept {
+    free(block);
+}
+
+void operator delete(void* block, size_t) noexcept { // Sized forms: the size is not needed by free
+    free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    free(block);
+}
+
+void operator delete(void* block, const nothrow_t&) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block, const nothrow_t&) noexcept {
+    free(block);
+}
+
+// Usage: ChessGame --alloc-check [perftDepth] [searchDepth]
+// Counts heap allocations while perft and a single-threaded search run over the reference positions. Both visit
+// hundreds of thousands of nodes, so anything allocated per node (or per search) shows up in the count; the check
+// passes only when it is zero. One search runs before counting starts, so the engine's arena is already in place,
+// as it is for every search of a game after the first.
+int allocCheckMain(int argc, char* argv[]) {
+    int perftDepth = argc > 2 ? atoi(argv[2]) : 4;
+    int searchDepth = argc > 3 ? atoi(argv[3]) : 7;
+    if (perftDepth < 1) perftDepth = 1;
+    if (searchDepth < 1) searchDepth = 1;
+    ENGINE.setThreads(1); // Starting helper threads allocates; one thread is the case that must allocate nothing
+    ChessBoard warmUp;
+    SearchLimits warmUpLimits;
+    warmUpLimits.depth = 1;
+    ENGINE.search(warmUp, 0, warmUpLimits, false);
+
+    bool clean = true;
+    for (int i = 0; i < PERFT_SUITE_SIZE; i++) {
+        ChessBoard board; // Set up before counting: loading a FEN builds strings
+        board.loadFen(PERFT_SUITE[i].fen);
+        TT.clear();
+        SearchLimits limits;
+        limits.depth = searchDepth;
+
+        countHeapAllocations(true);
+        uint64_t before = heapAllocations();
+        uint64_t perftNodes = perft(board, perftDepth);
+        uint64_t perftAllocations = heapAllocations() - before;
+        before = heapAllocations();
+        SearchResult result = ENGINE.search(board, 0, limits, false);
+        uint64_t searchAllocations = heapAllocations() - before;
+        countHeapAllocations(false);
+
+        cout << PERFT_SUITE[i].name << ": perft " << perftDepth << " " << perftNodes << " nodes, " << perftAllocations
+             << " allocations; search " << searchDepth << " " << result.nodes << " nodes, " << searchAllocations << " allocations\n";
+        if (perftAllocations || searchAllocations) clean = false;
+    }
+    cout << (clean ? "No heap allocations during perft or search\n" : "FAILED: heap allocations during perft or search\n");
+    return clean ? 0 : 1;
+}
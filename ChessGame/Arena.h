@@ -0,0 +1,43 @@
+// Arena.h
+// Per-thread memory for the search: one block taken from the heap once and handed out by bumping an offset, so the
+// per-ply data of a search (move lists, principal variations, killers) and the search object itself need no
+// allocation per search or per node. Also counts every heap allocation of the program, for --alloc-check.
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef> // Include cstddef for size_t
+#include <cstdint> // Include cstdint for the allocation counter
+#include <new> // Include new for placement new
+
+class Arena {
+private:
+    char* base; // The block
+    size_t capacity; // Its size in bytes
+    size_t used; // Bytes handed out since the last reset
+
+    Arena(const Arena&); // Not copyable: the block has one owner
+    Arena& operator=(const Arena&);
+
+public:
+    explicit Arena(size_t bytes); // Taking the whole block from the heap now
+    ~Arena();
+    void* allocate(size_t bytes, size_t alignment); // Next free bytes (nullptr when the block is full)
+    void reset() { used = 0; } // Everything handed out becomes free again; destructors are the caller's job
+    size_t size() const { return capacity; }
+    size_t bytesUsed() const { return used; }
+
+    template <typename T>
+    T* createArray(size_t count) { // 'count' default-constructed objects, or nullptr when the block is full
+        T* items = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        if (items) for (size_t i = 0; i < count; i++) new (items + i) T();
+        return items;
+    }
+};
+
+// Counting heap allocations (every operator new of every thread). Off by default, so the program's own allocations
+// do not all update one shared counter.
+void countHeapAllocations(bool on);
+uint64_t heapAllocations(); // Allocations made while counting was on
+int allocCheckMain(int argc, char* argv[]); // Command-line entry for --alloc-check: allocations during perft and search
+
+#endif
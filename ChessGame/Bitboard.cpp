@@ -0,0 +1,152 @@
+// Bitboard.cpp
+// Implementation of the set-wise attack generators and the attack lookup tables.
+#include <mutex> // Include mutex for call_once (boards are built on several threads at once)
+#include "Bitboard.h" // Bitboard type, shift helpers and table declarations
+
+Bitboard KNIGHT_ATTACKS[SQUARE_NB]; // Knight jumps from each square
+Bitboard KING_ATTACKS[SQUARE_NB]; // King steps from each square
+Bitboard PAWN_ATTACKS[COLOR_NB][SQUARE_NB]; // Pawn captures from each square, per color
+Bitboard BETWEEN_BB[SQUARE_NB][SQUARE_NB]; // Squares strictly between two aligned squares
+Bitboard LINE_BB[SQUARE_NB][SQUARE_NB]; // Whole line through two aligned squares
+
+Magic ROOK_MAGICS[SQUARE_NB]; // Rook lookup data for each square
+Magic BISHOP_MAGICS[SQUARE_NB]; // Bishop lookup data for each square
+
+static Bitboard ROOK_TABLE[0x19000]; // All rook attack sets (102400 entries, 4096 for a corner square down to 1024 in the centre)
+static Bitboard BISHOP_TABLE[0x1480]; // All bishop attack sets (5248 entries)
+
+// Flooding a set of sliders along one direction until the first blocker (dumb7fill).
+// 'step' is a function that moves the whole set one square in the direction, masking off wrapped bits.
+template <Bitboard (*step)(Bitboard)>
+static Bitboard slideAttacks(Bitboard sliders, Bitboard empty) {
+    Bitboard flood = sliders; // Squares reached so far (starting with the sliders themselves)
+    for (int i = 0; i < 6; i++) { // A ray is at most 7 squares long, the last step is taken after the loop
+        sliders = step(sliders) & empty; // Moving one square further, but only through empty squares
+        flood |= sliders; // Adding the newly reached squares
+    }
+    return step(flood); // One more step so the first blocker (a possible capture) is included
+}
+
+static Bitboard stepUpRight(Bitboard b) { return shiftRight(shiftUp(b)); } // Diagonal step towards h8
+static Bitboard stepUpLeft(Bitboard b) { return shiftLeft(shiftUp(b)); } // Diagonal step towards a8
+static Bitboard stepDownRight(Bitboard b) { return shiftRight(shiftDown(b)); } // Diagonal step towards h1
+static Bitboard stepDownLeft(Bitboard b) { return shiftLeft(shiftDown(b)); } // Diagonal step towards a1
+
+// Slow ray walkers used only to fill the lookup tables.
+static Bitboard slidingRookAttacks(int sq, Bitboard occupied) {
+    Bitboard from = squareBit(sq), empty = ~occupied; // The rook square and the squares a ray may pass through
+    return slideAttacks<shiftUp>(from, empty) | slideAttacks<shiftDown>(from, empty) |
+           slideAttacks<shiftLeft>(from, empty) | slideAttacks<shiftRight>(from, empty); // Combining the four straight rays
+}
+
+static Bitboard slidingBishopAttacks(int sq, Bitboard occupied) {
+    Bitboard from = squareBit(sq), empty = ~occupied; // The bishop square and the squares a ray may pass through
+    return slideAttacks<stepUpRight>(from, empty) | slideAttacks<stepUpLeft>(from, empty) |
+           slideAttacks<stepDownRight>(from, empty) | slideAttacks<stepDownLeft>(from, empty); // Combining the four diagonal rays
+}
+
+Bitboard knightAttacks(Bitboard b) {
+    Bitboard one = shiftLeft(b) | shiftRight(b); // Squares one column away
+    Bitboard two = shiftLeft(shiftLeft(b)) | shiftRight(shiftRight(b)); // Squares two columns away
+    return (one << 16) | (one >> 16) | (two << 8) | (two >> 8); // Two rows up/down for one column, one row for two columns
+}
+
+Bitboard kingAttacks(Bitboard b) {
+    Bitboard row = b | shiftLeft(b) | shiftRight(b); // The king's square and its horizontal neighbours
+    return (row | shiftUp(row) | shiftDown(row)) & ~b; // Extending one row up and down, excluding the king itself
+}
+
+Bitboard pawnAttacks(int color, Bitboard b) {
+    Bitboard forward = color == WHITE ? shiftUp(b) : shiftDown(b); // White pawns capture towards rank 8, black towards rank 1
+    return shiftLeft(forward) | shiftRight(forward); // One column to either side
+}
+
+// Small xorshift64* generator with fixed seeds, so the magic numbers (and start-up time) are the same on every run.
+uint64_t nextRandom(uint64_t& state) {
+    state ^= state >> 12; state ^= state << 25; state ^= state >> 27; // Scrambling the state
+    return state * 2685821657736338717ULL; // Multiplying spreads the bits over the whole word
+}
+
+// Filling the attack table of one slider kind: for every square, every subset of the relevant blockers gets its attack set.
+static void initMagics(Magic magics[], Bitboard table[], Bitboard (*slow)(int, Bitboard)) {
+    static Bitboard occupancy[4096], reference[4096]; // Every blocker subset of one square and its attack set
+    static int epoch[4096]; // Marks which table slots were written in the current magic attempt
+    static int attempt = 0;
+    // Seeds picked offline so every row finds its multipliers quickly; the search itself still runs at start-up.
+    const uint64_t MAGIC_SEEDS[8] = {1776, 376, 250, 380, 159, 210, 204, 30};
+    uint64_t seed = 0; // State of the random generator, reset at the start of each row
+    Bitboard* next = table; // Next free slot in the shared table
+
+    for (int sq = 0; sq < SQUARE_NB; sq++) {
+        // Blockers on the board edge never change the attack set, unless the piece itself stands on that edge line.
+        Bitboard edges = ((rowBB(0) | rowBB(7)) & ~rowBB(rowOf(sq))) | ((FILE_A_BB | FILE_H_BB) & ~(FILE_A_BB << colOf(sq)));
+        Magic& m = magics[sq];
+        if (colOf(sq) == 0) seed = MAGIC_SEEDS[rowOf(sq)]; // New row, new seed
+        m.mask = slow(sq, 0) & ~edges; // Relevant occupancy squares
+        m.shift = 64 - popCount(m.mask); // Index width is the number of relevant squares
+        m.attacks = next; // This square's slice starts here
+        int size = 0;
+        Bitboard b = 0;
+        do { // Enumerating all subsets of the mask (Carry-Rippler trick)
+            occupancy[size] = b;
+            reference[size] = slow(sq, b);
+#ifdef __BMI2__
+            m.attacks[_pext_u64(b, m.mask)] = reference[size]; // With PEXT the index is the gathered bits, no search needed
+#endif
+            size++;
+            b = (b - m.mask) & m.mask;
+        } while (b);
+        next += size; // Advancing past this square's slice
+
+#ifndef __BMI2__
+        // Trying sparse random multipliers until every subset maps to a slot that holds the right attack set.
+        for (int i = 0; i < size; ) {
+            m.magic = 0;
+            while (popCount((m.magic * m.mask) >> 56) < 6) { // Rejecting multipliers that put too few bits at the top
+                m.magic = nextRandom(seed) & nextRandom(seed) & nextRandom(seed);
+            }
+            for (++attempt, i = 0; i < size; i++) { // Filling the slice, stopping at the first destructive collision
+                unsigned idx = m.index(occupancy[i]);
+                if (epoch[idx] < attempt) { // Slot not used yet in this attempt
+                    epoch[idx] = attempt;
+                    m.attacks[idx] = reference[i];
+                } else if (m.attacks[idx] != reference[i]) { // Two different attack sets would share a slot
+                    break;
+                }
+            }
+        }
+#endif
+    }
+}
+
+static void buildAttackTables() {
+    for (int sq = 0; sq < SQUARE_NB; sq++) { // Leaper tables come straight from the set-wise generators
+        KNIGHT_ATTACKS[sq] = knightAttacks(squareBit(sq));
+        KING_ATTACKS[sq] = kingAttacks(squareBit(sq));
+        PAWN_ATTACKS[WHITE][sq] = pawnAttacks(WHITE, squareBit(sq));
+        PAWN_ATTACKS[BLACK][sq] = pawnAttacks(BLACK, squareBit(sq));
+    }
+
+    initMagics(ROOK_MAGICS, ROOK_TABLE, slidingRookAttacks); // Rook rays
+    initMagics(BISHOP_MAGICS, BISHOP_TABLE, slidingBishopAttacks); // Bishop rays
+
+    for (int from = 0; from < SQUARE_NB; from++) { // Lines and in-between squares for every aligned pair
+        for (int to = 0; to < SQUARE_NB; to++) {
+            BETWEEN_BB[from][to] = LINE_BB[from][to] = 0;
+            if (from == to) continue;
+            Bitboard ends = squareBit(from) | squareBit(to); // The two squares themselves belong to the line
+            if (rookAttacks(from, 0) & squareBit(to)) { // Same row or column
+                BETWEEN_BB[from][to] = rookAttacks(from, squareBit(to)) & rookAttacks(to, squareBit(from));
+                LINE_BB[from][to] = (rookAttacks(from, 0) & rookAttacks(to, 0)) | ends;
+            } else if (bishopAttacks(from, 0) & squareBit(to)) { // Same diagonal
+                BETWEEN_BB[from][to] = bishopAttacks(from, squareBit(to)) & bishopAttacks(to, squareBit(from));
+                LINE_BB[from][to] = (bishopAttacks(from, 0) & bishopAttacks(to, 0)) | ends;
+            }
+        }
+    }
+}
+
+void initAttackTables() {
+    static std::once_flag built; // The tables only need to be built once per run; other callers wait until they are
+    std::call_once(built, buildAttackTables);
+}
@@ -0,0 +1,101 @@
+// Bitboard.h
+// 64-bit bitboard helpers shared by the position core and the move logic.
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint> // Include cstdint for fixed-width 64-bit integers
+#ifdef __BMI2__
+#include <immintrin.h> // Include the PEXT intrinsic when the target CPU supports BMI2
+#endif
+
+typedef uint64_t Bitboard; // One bit per square: bit (row * 8 + col) is set when the square is part of the set
+
+enum Color { WHITE, BLACK, COLOR_NB = 2 }; // Side identifiers used to index per-color tables
+enum PieceType { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING, NO_PIECE_TYPE, PIECE_TYPE_NB = 6 }; // Piece kinds used to index per-type tables
+
+const int SQUARE_NB = 64; // Number of squares on the board
+const int NO_SQUARE = -1; // Marker for "no square" (e.g. no en passant target)
+
+// Squares are numbered the same way as the board rows and columns: a8 = 0, h8 = 7, a1 = 56, h1 = 63.
+inline int squareOf(int row, int col) { return row * 8 + col; } // Converting a (row, col) pair to a square index
+inline int rowOf(int sq) { return sq >> 3; } // Getting the row (0 = rank 8) of a square
+inline int colOf(int sq) { return sq & 7; } // Getting the column (0 = file a) of a square
+inline Bitboard squareBit(int sq) { return 1ULL << sq; } // Getting the single-bit bitboard of a square
+
+const Bitboard FILE_A_BB = 0x0101010101010101ULL; // All squares on file a (column 0)
+const Bitboard FILE_B_BB = FILE_A_BB << 1; // All squares on file b
+const Bitboard FILE_G_BB = FILE_A_BB << 6; // All squares on file g
+const Bitboard FILE_H_BB = FILE_A_BB << 7; // All squares on file h (column 7)
+inline Bitboard rowBB(int row) { return 0xFFULL << (8 * row); } // All squares on the given row
+
+inline int popCount(Bitboard b) { return __builtin_popcountll(b); } // Counting the set bits
+inline int lsb(Bitboard b) { return __builtin_ctzll(b); } // Index of the lowest set bit (b must not be empty)
+inline int popLsb(Bitboard& b) { int sq = lsb(b); b &= b - 1; return sq; } // Removing and returning the lowest set bit
+inline bool moreThanOne(Bitboard b) { return (b & (b - 1)) != 0; } // Checking if more than one bit is set
+
+// Shifting a whole set one step towards rank 8 (up), rank 1 (down), file h (right) or file a (left).
+inline Bitboard shiftUp(Bitboard b) { return b >> 8; }
+inline Bitboard shiftDown(Bitboard b) { return b << 8; }
+inline Bitboard shiftRight(Bitboard b) { return (b << 1) & ~FILE_A_BB; } // Masking off bits that wrapped to file a
+inline Bitboard shiftLeft(Bitboard b) { return (b >> 1) & ~FILE_H_BB; } // Masking off bits that wrapped to file h
+
+// Rules that differ between the colors, as compile-time constants: code templated on the color uses these instead
+// of testing the color at run time. Squares are numbered from rank 8, so White's pawns move towards lower squares.
+template <int Us> struct SideTraits {
+    static constexpr int THEM = Us ^ 1; // The opponent
+    static constexpr int FORWARD = Us == WHITE ? -8 : 8; // Square step of a pawn push
+    static constexpr int HOME_ROW = Us == WHITE ? 7 : 0; // Row of the king and rooks at the start
+    static constexpr int DOUBLE_PUSH_ROW = Us == WHITE ? 5 : 2; // Row a pawn reaches with its first step from the start
+    static constexpr int LAST_ROW = Us == WHITE ? 0 : 7; // Promotion row
+};
+template <int Us> inline Bitboard pawnPush(Bitboard b) { return Us == WHITE ? shiftUp(b) : shiftDown(b); } // A whole set one step forward
+
+// Set-wise attack generators: every square attacked by any piece in 'b'.
+// They are used to fill the lookup tables below and wherever a whole set of pieces is handled at once.
+Bitboard knightAttacks(Bitboard b); // Knight jumps from all squares in the set
+Bitboard kingAttacks(Bitboard b); // King steps from all squares in the set
+Bitboard pawnAttacks(int color, Bitboard b); // Diagonal pawn captures for the given color
+
+// Lookup tables filled once by initAttackTables(), indexed by square.
+extern Bitboard KNIGHT_ATTACKS[SQUARE_NB]; // Knight jumps from each square
+extern Bitboard KING_ATTACKS[SQUARE_NB]; // King steps from each square
+extern Bitboard PAWN_ATTACKS[COLOR_NB][SQUARE_NB]; // Pawn captures from each square, per color
+extern Bitboard BETWEEN_BB[SQUARE_NB][SQUARE_NB]; // Squares strictly between two aligned squares (empty if not aligned)
+extern Bitboard LINE_BB[SQUARE_NB][SQUARE_NB]; // Whole line (edge to edge) through two aligned squares (empty if not aligned)
+
+// Sliding piece attacks are looked up from the relevant blockers only: the occupancy bits on the piece's rays
+// (without the board edge) are turned into a dense index, either with a magic multiply or with the BMI2 PEXT
+// instruction when the compiler targets a CPU that has it (-mbmi2 or -march=native).
+struct Magic {
+    Bitboard mask; // Squares whose occupancy can change the attack set
+    Bitboard magic; // Multiplier that maps every relevant occupancy to a distinct index (unused with PEXT)
+    Bitboard* attacks; // Start of this square's slice of the attack table
+    unsigned shift; // 64 minus the number of index bits
+
+    unsigned index(Bitboard occupied) const { // Turning an occupancy into a table index
+#ifdef __BMI2__
+        return (unsigned)_pext_u64(occupied, mask); // Gathering the relevant bits directly
+#else
+        return (unsigned)(((occupied & mask) * magic) >> shift); // Scattering the relevant bits into the top of the product
+#endif
+    }
+};
+
+extern Magic ROOK_MAGICS[SQUARE_NB]; // Rook lookup data for each square
+extern Magic BISHOP_MAGICS[SQUARE_NB]; // Bishop lookup data for each square
+
+uint64_t nextRandom(uint64_t& state); // Pseudo-random 64-bit number (xorshift64*), reproducible from a fixed seed
+void initAttackTables(); // Filling all tables (safe to call more than once and from any thread, only the first call does the work)
+
+inline Bitboard rookAttacks(int sq, Bitboard occupied) { // Rook rays from a square, stopping at the first blocker
+    const Magic& m = ROOK_MAGICS[sq];
+    return m.attacks[m.index(occupied)];
+}
+inline Bitboard bishopAttacks(int sq, Bitboard occupied) { // Bishop rays from a square, stopping at the first blocker
+    const Magic& m = BISHOP_MAGICS[sq];
+    return m.attacks[m.index(occupied)];
+}
+inline Bitboard queenAttacks(int sq, Bitboard occupied) { return rookAttacks(sq, occupied) | bishopAttacks(sq, occupied); } // Both ray kinds
+inline Bitboard betweenBB(int from, int to) { return BETWEEN_BB[from][to]; } // Squares strictly between two aligned squares
+
+#endif
@@ -0,0 +1,266 @@
+// Book.cpp
+// Implementation of the opening book: building from game collections, the memory-mapped lookup, and the
+// --book-build / --book-probe tools.
+#include <algorithm> // Include algorithm for sorting and lower_bound
+#include <chrono> // Include chrono for seeding and timing
+#include <cstdlib> // Include cstdlib for atoi
+#include <cstring> // Include cstring for memcmp and memset
+#include <iomanip> // Include iomanip for formatting the report
+#include <vector> // Include vector for collecting entries
+#include "Book.h" // Book declarations
+#include "Pgn.h" // PGN reader for building books
+using namespace std;
+
+static_assert(sizeof(BookEntry) == 24, "A book entry must be 24 bytes");
+static_assert(sizeof(BookHeader) == 32, "The book header must be 32 bytes");
+
+OpeningBook BOOK; // The book the engine consults before searching
+
+OpeningBook::OpeningBook() : entries(nullptr), count(0) {
+    randomState = uint64_t(chrono::steady_clock::now().time_since_epoch().count()) | 1; // Different games on every run
+}
+
+bool OpeningBook::open(const string& filename) {
+    close();
+    if (!map.open(filename) || map.size() < sizeof(BookHeader)) return false;
+    const BookHeader* header = reinterpret_cast<const BookHeader*>(map.data());
+    if (memcmp(header->magic, BOOK_MAGIC, sizeof(header->magic)) != 0 || header->version != BOOK_VERSION ||
+        header->entrySize != sizeof(BookEntry) || header->entryCount > (map.size() - sizeof(BookHeader)) / sizeof(BookEntry)) {
+        map.close();
+        return false;
+    }
+    entries = reinterpret_cast<const BookEntry*>(map.data() + sizeof(BookHeader));
+    count = header->entryCount;
+    name = filename;
+    return true;
+}
+
+void OpeningBook::close() {
+    map.close();
+    entries = nullptr;
+    count = 0;
+    name.clear();
+}
+
+int OpeningBook::probe(const Position& pos, BookEntry* found, int maxEntries) const {
+    if (!entries) return 0;
+    const BookEntry* end = entries + count;
+    const BookEntry* e = lower_bound(entries, end, pos.key, [](const BookEntry& entry, uint64_t key) { return entry.key < key; });
+    MoveList legal; // Generated only on a hit; also guards against a key collision suggesting an impossible move
+    int n = 0;
+    for (; e != end && e->key == pos.key && n < maxEntries; e++) {
+        if (legal.size() == 0) generateLegalMoves(pos, legal);
+        if (legal.contains(e->move)) found[n++] = *e;
+    }
+    return n;
+}
+
+Move OpeningBook::pick(const Position& pos) {
+    BookEntry found[MAX_BOOK_MOVES];
+    int n = probe(pos, found, MAX_BOOK_MOVES);
+    uint32_t total = 0;
+    for (int i = 0; i < n; i++) total += found[i].weight;
+    if (total == 0) return MOVE_NONE;
+    uint32_t r = uint32_t(nextRandom(randomState) % total); // Each move's share of the total weight is its chance
+    for (int i = 0; i < n; i++) {
+        if (r < found[i].weight) return found[i].move;
+        r -= found[i].weight;
+    }
+    return MOVE_NONE; // Not reachable
+}
+
+// Collects one entry per (position, move) seen. Entries are appended as they come and merged by sorting whenever
+// the unmerged part has grown as large as the merged part, so memory stays proportional to the distinct pairs
+// (openings repeat a lot) rather than to the number of games.
+struct BookCollector {
+    vector<BookEntry> entries; // Merged prefix, then new entries
+    size_t merged; // Length of the merged prefix
+
+    BookCollector() : merged(0) {}
+
+    void add(uint64_t key, Move move, int outcome) { // outcome: 1 the mover won, 0 draw, -1 the mover lost
+        BookEntry e;
+        memset(&e, 0, sizeof(e));
+        e.key = key;
+        e.move = move;
+        (outcome > 0 ? e.wins : outcome < 0 ? e.losses : e.draws) = 1;
+        entries.push_back(e);
+        if (entries.size() - merged > merged + (1 << 20)) merge();
+    }
+
+    void merge() {
+        sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) {
+            return a.key != b.key ? a.key < b.key : a.move < b.move;
+        });
+        size_t out = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (out > 0 && entries[out - 1].key == entries[i].key && entries[out - 1].move == entries[i].move) {
+                entries[out - 1].wins += entries[i].wins;
+                entries[out - 1].draws += entries[i].draws;
+                entries[out - 1].losses += entries[i].losses;
+            } else {
+                entries[out++] = entries[i];
+            }
+        }
+        entries.resize(out);
+        merged = out;
+    }
+};
+
+// Adds the first 'maxPlies' moves of one finished game (result: 1 White won, -1 Black won, 0 draw).
+static bool addBookGame(BookCollector& collector, ChessBoard& board, const Position& start, const Move* moves, size_t plies,
+                        int result, int maxPlies) {
+    board.setPosition(start);
+    for (size_t i = 0; i < plies && int(i) < maxPlies; i++) {
+        MoveList legal; // Archive records are checked here; PGN games were checked by the replay already
+        board.generateMoves(legal);
+        if (!legal.contains(moves[i])) return false;
+        collector.add(board.positionKey(), moves[i], board.isWhiteToMove() ? result : -result);
+        board.playMove(moves[i]);
+    }
+    return true;
+}
+
+// Result of a game without a recorded one that ended under the N-check rule: 1 White won, -1 Black won, 2 unknown.
+static int checkLimitResult(ChessBoard& board, const Position& start, const Move* moves, size_t plies) {
+    board.setPosition(start);
+    int checks = 0;
+    for (size_t i = 0; i < plies; i++) {
+        MoveList legal;
+        board.generateMoves(legal);
+        if (!legal.contains(moves[i])) return 2;
+        bool whiteMoved = board.isWhiteToMove();
+        board.playMove(moves[i]);
+        if (board.isKingInCheck(!whiteMoved) && ++checks >= CHECK_LIMIT) return whiteMoved ? 1 : -1;
+    }
+    return 2;
+}
+
+bool buildBook(const string& input, bool moveList, const string& output, int maxPlies, int minGames) {
+    BookCollector collector;
+    ChessBoard board;
+    uint64_t games = 0, skipped = 0;
+    if (hasArchiveExtension(input)) { // Binary archive: the games are already checked and packed
+        ArchiveReader archive;
+        if (!archive.open(input)) return false;
+        for (uint64_t n = 0; n < archive.gameCount(); n++) {
+            const ArchiveGame* game = archive.game(n);
+            Position start;
+            if (game) unpackPosition(game->start, start);
+            int result = !game ? 2 : game->result == ARCHIVE_RESULT_WHITE_WINS ? 1 : game->result == ARCHIVE_RESULT_BLACK_WINS ? -1 :
+                         game->result == ARCHIVE_RESULT_DRAW ? 0 : 2;
+            if (result == 2 && game) result = checkLimitResult(board, start, archive.gameMoves(game), game->plies);
+            if (result == 2 || !addBookGame(collector, board, start, archive.gameMoves(game), game->plies, result, maxPlies)) skipped++;
+            else games++;
+        }
+    } else {
+        PgnReader reader(input, moveList);
+        if (!reader.isOpen()) return false;
+        PgnGame game;
+        ReplayResult replay;
+        ChessBoard replayBoard;
+        while (reader.nextGame(game)) {
+            bool ok = replayGame(game, replayBoard, replay);
+            int result = replay.result == "1-0" ? 1 : replay.result == "0-1" ? -1 : replay.result == "1/2-1/2" ? 0 : 2;
+            if (result == 2 && replay.checkLimitWinner != COLOR_NB) result = replay.checkLimitWinner == WHITE ? 1 : -1; // Decided by checks
+            if (!ok || result == 2 || !addBookGame(collector, board, replay.start, replay.moves.data(), replay.moves.size(), result, maxPlies)) skipped++;
+            else games++;
+        }
+    }
+    collector.merge();
+
+    vector<BookEntry>& entries = collector.entries; // Dropping rare moves, then weighting and ordering the rest
+    size_t kept = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        BookEntry& e = entries[i];
+        if (e.wins + e.draws + e.losses < uint32_t(minGames)) continue;
+        uint32_t points = 2 * e.wins + e.draws;
+        e.weight = uint16_t(points < 65535 ? points : 65535);
+        entries[kept++] = e;
+    }
+    entries.resize(kept);
+    sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) {
+        return a.key != b.key ? a.key < b.key : a.weight > b.weight;
+    });
+
+    FILE* file = fopen(output.c_str(), "wb");
+    if (!file) return false;
+    BookHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BOOK_MAGIC, sizeof(header.magic));
+    header.version = BOOK_VERSION;
+    header.entrySize = sizeof(BookEntry);
+    header.entryCount = entries.size();
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              (entries.empty() || fwrite(entries.data(), sizeof(BookEntry), entries.size(), file) == entries.size());
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        remove(output.c_str());
+        return false;
+    }
+    cout << games << " games used" << (skipped ? " (" + to_string(skipped) + " unfinished or illegal skipped)" : string()) << ", "
+         << entries.size() << " book moves written to " << output << "\n";
+    return true;
+}
+
+// Prints the book moves of a position with their statistics, plus the lookup time.
+static void printBookMoves(const OpeningBook& book, const ChessBoard& board) {
+    BookEntry found[MAX_BOOK_MOVES];
+    auto start = chrono::steady_clock::now();
+    int n = book.probe(board.position(), found, MAX_BOOK_MOVES);
+    double us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    if (n == 0) cout << "Not in the book";
+    for (int i = 0; i < n; i++) {
+        uint32_t games = found[i].wins + found[i].draws + found[i].losses;
+        cout << moveToString(found[i].move) << "  weight " << found[i].weight << "  games " << games << "  +" << found[i].wins
+             << " =" << found[i].draws << " -" << found[i].losses << "\n";
+    }
+    cout << (n == 0 ? " " : "") << "(lookup " << fixed << setprecision(1) << us << " us)\n";
+    cout.unsetf(ios::fixed);
+}
+
+// Usage:
+//   ChessGame --book-build <games.pgn | games.cgb | -> <book.bin> [--moves] [--plies N] [--min-games N]
+//   ChessGame --book-probe <book.bin> [--fen <FEN>]
+int bookMain(int argc, char* argv[]) {
+    string mode = argv[1];
+    string input, output, fen = START_FEN;
+    bool moveList = false;
+    int maxPlies = 20, minGames = 2; // The first ten moves of each side; a move needs two games to count
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--moves") moveList = true;
+        else if (arg == "--plies" && i + 1 < argc) maxPlies = atoi(argv[++i]);
+        else if (arg == "--min-games" && i + 1 < argc) minGames = atoi(argv[++i]);
+        else if (arg == "--fen") { // One quoted argument or the six fields
+            fen.clear();
+            while (i + 1 < argc && string(argv[i + 1]).compare(0, 2, "--") != 0) fen += string(fen.empty() ? "" : " ") + argv[++i];
+        }
+        else if (input.empty()) input = arg;
+        else if (output.empty()) output = arg;
+    }
+    if (mode == "--book-build") {
+        if (input.empty() || output.empty()) {
+            cerr << "Usage: --book-build <games.pgn | games.cgb | -> <book.bin> [--moves] [--plies N] [--min-games N]\n";
+            return 2;
+        }
+        if (!buildBook(input, moveList, output, maxPlies, minGames < 1 ? 1 : minGames)) {
+            cerr << "Cannot read " << input << " or write " << output << "\n";
+            return 2;
+        }
+        return 0;
+    }
+    OpeningBook book;
+    ChessBoard board;
+    if (input.empty() || !book.open(input)) {
+        cerr << "Usage: --book-probe <book.bin> [--fen <FEN>] (the book must exist)\n";
+        return 2;
+    }
+    if (!board.loadFen(fen)) {
+        cerr << "Invalid FEN: " << fen << "\n";
+        return 2;
+    }
+    cout << input << ": " << book.size() << " entries\n";
+    printBookMoves(book, board);
+    return 0;
+}
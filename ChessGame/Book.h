@@ -0,0 +1,63 @@
+// Book.h
+// Opening book: moves played from known positions in a game collection, with how they scored. The book is a file of
+// fixed-size entries sorted by position key, memory-mapped and searched by bisection, so a lookup touches a handful
+// of pages and needs no loading step.
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <cstdint> // Include cstdint for the fixed-width file fields
+#include <string> // Include string for file names
+#include "Archive.h" // Include MappedFile
+#include "Move.h" // Include the 16-bit move type
+
+// One move from one position. Counts are from the point of view of the side making the move.
+struct BookEntry {
+    uint64_t key; // Zobrist key of the position (Position::key)
+    Move move; // Move played from it
+    uint16_t weight; // How often to pick the move: 2 points per win, 1 per draw (capped), 0 = never pick
+    uint32_t wins; // Games the mover went on to win
+    uint32_t draws; // Games drawn
+    uint32_t losses; // Games the mover lost
+};
+
+// File layout: header, then entries sorted by key and, within one key, by weight from high to low.
+struct BookHeader {
+    char magic[8]; // BOOK_MAGIC
+    uint32_t version; // BOOK_VERSION
+    uint32_t entrySize; // sizeof(BookEntry)
+    uint64_t entryCount; // Number of entries
+    uint64_t reserved; // Zero
+};
+
+const char BOOK_MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'B', 'O', 'K'}; // First bytes of every book file
+const uint32_t BOOK_VERSION = 1; // Format version written by this program
+const char BOOK_DEFAULT_FILE[] = "book.bin"; // Book opened at start-up if it exists
+const int MAX_BOOK_MOVES = 64; // Most moves returned for one position
+
+class OpeningBook {
+private:
+    MappedFile map; // The whole book file
+    const BookEntry* entries; // Sorted entries inside the map
+    uint64_t count; // Number of entries
+    std::string name; // File the book was opened from
+    uint64_t randomState; // Picks among the weighted moves
+
+public:
+    OpeningBook();
+    bool open(const std::string& filename); // Opening a book file (false and closed if it is missing or not a book)
+    void close(); // No book: every probe misses
+    bool isOpen() const { return entries != nullptr; }
+    const std::string& fileName() const { return name; }
+    uint64_t size() const { return count; }
+    int probe(const Position& pos, BookEntry* found, int maxEntries) const; // Legal book moves of a position, best weight first
+    Move pick(const Position& pos); // A book move chosen at random in proportion to its weight, or MOVE_NONE
+};
+
+extern OpeningBook BOOK; // The book the engine consults before searching
+
+// Building: every finished game of a PGN file, move list or .cgb archive adds its first 'maxPlies' moves (a game without
+// a result counts if it was decided by the N-check rule); moves seen in fewer than 'minGames' games are dropped. Returns false if the input cannot be read or the book cannot be written.
+bool buildBook(const std::string& input, bool moveList, const std::string& output, int maxPlies, int minGames);
+int bookMain(int argc, char* argv[]); // Command-line entry for --book-build and --book-probe
+
+#endif
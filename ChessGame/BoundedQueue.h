@@ -0,0 +1,60 @@
+// BoundedQueue.h
+// Fixed-capacity queue for handing work between threads: a full queue blocks the producer (backpressure) or, with
+// tryPush(), turns the item away, an empty one blocks the consumer, and close() lets every waiting thread finish.
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable> // Include condition_variable for blocking on a full or empty queue
+#include <cstddef> // Include cstddef for size_t
+#include <deque> // Include deque for the queued items
+#include <mutex> // Include mutex to guard the queue
+
+template <typename T>
+class BoundedQueue {
+private:
+    std::mutex lock; // Guards everything below
+    std::condition_variable notEmpty; // Signalled when an item arrives or the queue closes
+    std::condition_variable notFull; // Signalled when an item leaves or the queue closes
+    std::deque<T> items; // Queued items, oldest first
+    size_t capacity; // Most items the queue holds before push() blocks
+    bool closed; // No more items will be pushed
+
+public:
+    explicit BoundedQueue(size_t maxItems) : capacity(maxItems > 0 ? maxItems : 1), closed(false) {}
+
+    bool push(const T& item) { // Waiting for room; false if the queue was closed
+        std::unique_lock<std::mutex> guard(lock);
+        notFull.wait(guard, [this]() { return items.size() < capacity || closed; });
+        if (closed) return false;
+        items.push_back(item);
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool tryPush(const T& item) { // Not waiting: false if the queue is full or closed
+        std::lock_guard<std::mutex> guard(lock);
+        if (items.size() >= capacity || closed) return false;
+        items.push_back(item);
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) { // Waiting for an item; false once the queue is closed and empty
+        std::unique_lock<std::mutex> guard(lock);
+        notEmpty.wait(guard, [this]() { return !items.empty() || closed; });
+        if (items.empty()) return false;
+        item = items.front();
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() { // Items already queued can still be popped
+        std::lock_guard<std::mutex> guard(lock);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+};
+
+#endif
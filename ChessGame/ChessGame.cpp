@@ -1,36 +1,46 @@
 #include "ChessGame.h"      // Header file for the chess game, defining pieces, board, and game classes.
+#include "Arena.h" // Allocation counting for --alloc-check
+#include "Archive.h" // Binary .cgb saves and the archive tools
+#include "Book.h" // Opening book consulted before searching
+#include "Eval.h" // Evaluation tables and the --eval breakdown
+#include "Match.h" // Engine-versus-engine matches
+#include "Perft.h" // Perft command-line mode (move generator checks and speed)
+#include "Pgn.h" // PGN replay mode
+#include "Profile.h" // Optional hot-path counters and the stats command
+#include "Search.h" // Engine for the computer opponent and the --bench mode
+#include "Server.h" // Game server and its load generator
+#include "Simd.h" // Mailbox kernels and --bench-simd
+#include "Tablebase.h" // Endgame tablebases
+#include "TT.h" // Transposition table size settings
+#include "Uci.h" // Headless UCI mode
+#include "Validate.h" // Parallel archive validation
 using namespace std;  // Allowing the use of standard library features without prefixing 'std::'.
 
-ChessPiece::ChessPiece(char s, bool color) : symbol(s), isWhite(color), hasMoved(false) {}  // Initializing a piece with its symbol, color, and unmoved status.
+ChessPiece::ChessPiece(char s, bool color) : symbol(s), isWhite(color) {}  // Initializing a piece with its symbol and color.
 
-ChessBoard::ChessBoard() { // Constructor for ChessBoard, initializing the board to an 8x8 grid and calling resetBoard to set up the initial state.
-    board.resize(BOARD_SIZE, vector<ChessPiece>(BOARD_SIZE, ChessPiece(EMPTY))); // Resizing the board to 8x8 and filling it with empty ChessPiece objects.
+ChessBoard::ChessBoard() { // Constructor for ChessBoard, building the attack tables and calling resetBoard to set up the initial state.
+    initAttackTables(); // Building the knight, king, pawn and sliding-piece lookup tables (only done on the first call).
+    initZobristKeys(); // Filling the random numbers behind the position keys (only done on the first call).
+    initEvalTables(); // Filling the piece-square values the position keeps its score with (only done on the first call).
     resetBoard(); // Calling resetBoard function to set up the initial state of the board.
 }
 
 void ChessBoard::resetBoard() { // Setting up the initial configuration of pieces on the chessboard.
-    lastMoveFrom = lastMoveTo = {-1, -1}; // Resetting last move positions, castle rights, and move clocks.
+    pos.clear(); // Emptying the board and resetting en passant, side to move and the move clocks (half-move 0, full move 1).
+    undoCount = 0; // No moves to take back in a new game
 
     // Setting up the castling rights for both white and black.
-    whiteCanCastleKingside = whiteCanCastleQueenside = true;
-    blackCanCastleKingside = blackCanCastleQueenside = true;
-
-    // Initializing the half-move clock and full-move number to 0 and 1 respectively.
-    halfMoveClock = 0;
-    fullMoveNumber = 1;
-
-    // Placing the black pieces on the board, setting row 0.
-    board[0] = {ChessPiece(BLACK_ROOK, false), ChessPiece(BLACK_KNIGHT, false), ChessPiece(BLACK_BISHOP, false),
-               ChessPiece(BLACK_QUEEN, false), ChessPiece(BLACK_KING, false), ChessPiece(BLACK_BISHOP, false),
-               ChessPiece(BLACK_KNIGHT, false), ChessPiece(BLACK_ROOK, false)};
-    for (int i = 0; i < BOARD_SIZE; i++) board[1][i] = ChessPiece(BLACK_PAWN, false); // Placing the black pawns on row 1.
-    for (int row = 2; row < 6; row++) fill(board[row].begin(), board[row].end(), ChessPiece(EMPTY)); // Filling rows 2 to 5 with empty chess pieces, indicating empty squares.
-
-    // Placing the white pieces on the last row (row 7).
-    board[7] = {ChessPiece(WHITE_ROOK, true), ChessPiece(WHITE_KNIGHT, true), ChessPiece(WHITE_BISHOP, true),
-               ChessPiece(WHITE_QUEEN, true), ChessPiece(WHITE_KING, true), ChessPiece(WHITE_BISHOP, true),
-               ChessPiece(WHITE_KNIGHT, true), ChessPiece(WHITE_ROOK, true)};
-    for (int i = 0; i < BOARD_SIZE; i++) board[6][i] = ChessPiece(WHITE_PAWN, true);  // Placing the white pawns on row 6.
+    pos.castlingRights = ALL_CASTLING;
+
+    // Placing the pieces on the back ranks (row 0 for black, row 7 for white) and the pawns in front of them.
+    const char backRank[BOARD_SIZE] = {WHITE_ROOK, WHITE_KNIGHT, WHITE_BISHOP, WHITE_QUEEN, WHITE_KING, WHITE_BISHOP, WHITE_KNIGHT, WHITE_ROOK};
+    for (int col = 0; col < BOARD_SIZE; col++) {
+        pos.putPiece(squareOf(0, col), BLACK, pieceTypeOf(backRank[col])); // Black pieces on row 0.
+        pos.putPiece(squareOf(1, col), BLACK, PAWN); // Black pawns on row 1.
+        pos.putPiece(squareOf(6, col), WHITE, PAWN); // White pawns on row 6.
+        pos.putPiece(squareOf(7, col), WHITE, pieceTypeOf(backRank[col])); // White pieces on row 7.
+    }
+    pos.key = pos.computeKey(); // The castling rights were set directly, so the key is built once here.
 }
 
 // Function to check if the given position (row, col) is valid on the chessboard.
@@ -38,337 +48,203 @@ bool ChessBoard::isValidPosition(int row, int col) const {
     return row >= 0 && row < BOARD_SIZE && col >= 0 && col < BOARD_SIZE;// Checking if the row and column values are within the bounds of the 8x8 board.
 }
 
-pair<int, int> ChessBoard::findKing(bool isWhite) const { // Function to find the position of the king for the specified color (white or black).
-    for (int row = 0; row < BOARD_SIZE; row++) { // Looping through the entire board to find the king.
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            if (board[row][col].symbol == (isWhite ? WHITE_KING : BLACK_KING)) { // If the piece is the king of the specified color, return its position.
-                return {row, col}; // Returning the position (row, col) of the king
-            }
-        }
-    }
-    return {-1, -1}; // If no king is found, return an invalid position (-1, -1).
-}
-
-// Function to check if the path between two positions is clear (i.e., no pieces are blocking the path).
-bool ChessBoard::isPathClear(int fromRow, int fromCol, int toRow, int toCol) const {
-
- // Calculating the steps required to move row-wise and column-wise towards the target position.
-    int rowStep = (toRow > fromRow) ? 1 : (toRow < fromRow) ? -1 : 0;
-    int colStep = (toCol > fromCol) ? 1 : (toCol < fromCol) ? -1 : 0;
-
-    // Starting the check from the square next to the starting position.
-    int row = fromRow + rowStep;
-    int col = fromCol + colStep;
-
-    while (row != toRow || col != toCol) { // Checking each square along the path towards the target position.
-        if (!isValidPosition(row, col) || board[row][col].symbol != EMPTY) return false; // If the square is outside the board or occupied by another piece, return false (path is blocked).
-        row += rowStep; // Moving to the next row along the path.
-        col += colStep; // Moving to the next column along the path.
-    }
-    return true;  // If no obstacles are found, the path is clear, return true.
-}
-
-// Function to check if a piece can attack a square at the given destination position.
-bool ChessBoard::canPieceAttack(const ChessPiece& piece, int fromRow, int fromCol, int toRow, int toCol) const {
-
-    // Calculating the difference in row and column between the start and end positions.
-    int rowDiff = toRow - fromRow;
-    int colDiff = toCol - fromCol;
-    int absRowDiff = abs(rowDiff); // Getting the absolute difference in rows.
-    int absColDiff = abs(colDiff); // Getting the absolute difference in columns.
-
-    switch (piece.symbol) {  // Using a switch statement to handle different types of chess pieces.
-        case WHITE_PAWN:
-             // White pawns attack one square diagonally forward.
-            return rowDiff == -1 && absColDiff == 1 && board[toRow][toCol].symbol != EMPTY && !board[toRow][toCol].isWhite;
-        case BLACK_PAWN:
-            // Black pawns attack one square diagonally forward.
-            return rowDiff == 1 && absColDiff == 1 && board[toRow][toCol].symbol != EMPTY && board[toRow][toCol].isWhite;
-        case WHITE_KING: case BLACK_KING:
-            // Kings can attack one square in any direction (vertically, horizontally, or diagonally).
-            return absRowDiff <= 1 && absColDiff <= 1;
-        case WHITE_QUEEN: case BLACK_QUEEN:
-            // Queens can attack like both a rook and a bishop.
-            return (absRowDiff == absColDiff || fromRow == toRow || fromCol == toCol) &&
-                   isPathClear(fromRow, fromCol, toRow, toCol);
-        case WHITE_ROOK: case BLACK_ROOK:
-            // Rooks can attack in straight lines (either rows or columns).
-            return (fromRow == toRow || fromCol == toCol) &&
-                   isPathClear(fromRow, fromCol, toRow, toCol);
-        case WHITE_BISHOP: case BLACK_BISHOP:
-            // Bishops can attack diagonally.
-            return absRowDiff == absColDiff &&
-                   isPathClear(fromRow, fromCol, toRow, toCol);
-        case WHITE_KNIGHT: case BLACK_KNIGHT:
-            // Knights attack in an "L" shape: either two squares in one direction and one square in another direction, or vice versa.
-            return (absRowDiff == 2 && absColDiff == 1) || (absRowDiff == 1 && absColDiff == 2);
-        default:
-            return false; // If the piece type is not recognized, it cannot attack.
-    }
-}
-
-// Function to determine whether a specific move is valid for a given chess piece.
-// Returns 'true' if the move is valid according to chess rules, otherwise 'false'.
-bool ChessBoard::isValidMove(const ChessPiece& piece, int fromRow, int fromCol, int toRow, int toCol) {
-    if (!isValidPosition(fromRow, fromCol) || !isValidPosition(toRow, toCol)) return false; // Checking if the source and destination positions are within the bounds of the chessboard.
-    if (fromRow == toRow && fromCol == toCol) return false; // Returning false if the piece is trying to move to the same square it's already on.
-
-    int rowDiff = toRow - fromRow; // Calculating the vertical movement (row difference).
-    int colDiff = toCol - fromCol;  // Calculating the horizontal movement (column difference).
-    int absRowDiff = abs(rowDiff); // Getting the absolute value of row difference.
-    int absColDiff = abs(colDiff); // Getting the absolute value of column difference.
-
-    // If the destination square is occupied by a piece of the same color, the move is invalid.
-    if (board[toRow][toCol].symbol != EMPTY && board[toRow][toCol].isWhite == piece.isWhite) {
-        return false;
-    }
-
-    switch (piece.symbol) { // Switch block to handle different types of pieces and their movement rules
-        case WHITE_PAWN:
-            // White pawn: forward move (one or two squares) if path is clear.
-            if (fromCol == toCol && rowDiff < 0 && board[toRow][toCol].symbol == EMPTY) {
-                if (rowDiff == -1) return true; // Move one square forward.
-                if (rowDiff == -2 && fromRow == 6 && board[fromRow - 1][fromCol].symbol == EMPTY) return true; // Initial two-square move.
-            }
-             // White pawn: capturing diagonally or en passant.
-            if (rowDiff == -1 && absColDiff == 1) {
-                if (board[toRow][toCol].symbol != EMPTY && !board[toRow][toCol].isWhite) return true; // Normal diagonal capture.
-                // En passant capture condition.
-                if (toRow == 5 && lastMoveTo == make_pair(6, toCol) &&
-                    lastMoveFrom == make_pair(4, toCol) &&
-                    board[6][toCol].symbol == BLACK_PAWN) return true;
-            }
-            return false; // If none of the valid pawn conditions are met.
-        case BLACK_PAWN:
-            // If none of the valid pawn conditions are met.
-            if (fromCol == toCol && rowDiff > 0 && board[toRow][toCol].symbol == EMPTY) {
-                if (rowDiff == 1) return true; // Move one square forward.
-                if (rowDiff == 2 && fromRow == 1 && board[fromRow + 1][fromCol].symbol == EMPTY) return true; // Initial two-square move.
-            }
-            // Black pawn: capturing diagonally or en passant.
-            if (rowDiff == 1 && absColDiff == 1) {
-                if (board[toRow][toCol].symbol != EMPTY && board[toRow][toCol].isWhite) return true; // Normal diagonal capture.
-                // En passant capture condition.
-                if (toRow == 2 && lastMoveTo == make_pair(1, toCol) &&
-                    lastMoveFrom == make_pair(3, toCol) &&
-                    board[1][toCol].symbol == WHITE_PAWN) return true;
-            }
-            return false; // If none of the valid pawn conditions are met.
-        case WHITE_KING: case BLACK_KING:
-             // Standard king move: one square in any direction.
-            if (absRowDiff <= 1 && absColDiff <= 1) return true;
-
-            // Checking for castling: king has not moved and moves two squares horizontally.
-            if (!piece.hasMoved && fromRow == toRow && absColDiff == 2) {
-                    // Determine if it's kingside (right) or queenside (left) castling.
-                bool kingside = colDiff > 0;
-                int rookCol = kingside ? 7 : 0;
-             // References to the castling availability flags.
-                bool& canCastleKingside = piece.isWhite ? whiteCanCastleKingside : blackCanCastleKingside;
-                bool& canCastleQueenside = piece.isWhite ? whiteCanCastleQueenside : blackCanCastleQueenside;
-
-                if ((kingside && !canCastleKingside) || (!kingside && !canCastleQueenside)) return false;   // Check if castling is allowed for the king's side.
-                  // Check if castling is allowed for the king's side.
-                if (board[fromRow][rookCol].symbol != (piece.isWhite ? WHITE_ROOK : BLACK_ROOK) ||
-                    board[fromRow][rookCol].hasMoved || isKingInCheck(piece.isWhite)) return false;
-
-                      // Check that all squares between king and rook are empty
-                int step = kingside ? 1 : -1;
-                for (int col = fromCol + step; col != rookCol; col += step) {
-                    if (board[fromRow][col].symbol != EMPTY) return false;
-                }
-
-             // Temporarily simulate the king's move across the squares to ensure it does not pass through check.
-                ChessPiece tempKing = board[fromRow][fromCol];
-                for (int i = 1; i <= 2; i++) {
-                    board[fromRow][fromCol] = ChessPiece(EMPTY);  // Remove king from current position.
-                    board[fromRow][fromCol + i * step] = tempKing; // Place king in new position.
-                    if (isKingInCheck(piece.isWhite)) { // If king is in check, castling is invalid.
-                        board[fromRow][fromCol] = tempKing;  // Revert position.
-                        board[fromRow][fromCol + i * step] = ChessPiece(EMPTY);
-                        return false;
-                    }
-                    board[fromRow][fromCol + i * step] = ChessPiece(EMPTY); // Clean up simulated move.
-                }
-                board[fromRow][fromCol] = tempKing; // Restore king to original position.
-                return true; // Castling is a valid move.
-            }
-            return false;  // King move is invalid.
-             // For other pieces like queen, rook, bishop, knight  use the generic attack logic.
-        default:
-            return canPieceAttack(piece, fromRow, fromCol, toRow, toCol); // Delegate to piece-specific attack logic.
-    }
+// Castling rights that survive a move touching each square: moving from or capturing on a king or rook home square clears them.
+static uint8_t castlingMaskFor(int sq) {
+    uint8_t mask = ALL_CASTLING;
+    if (sq == squareOf(0, 0)) mask &= ~BLACK_QUEENSIDE; // a8 rook
+    if (sq == squareOf(0, 7)) mask &= ~BLACK_KINGSIDE; // h8 rook
+    if (sq == squareOf(0, 4)) mask &= ~(BLACK_KINGSIDE | BLACK_QUEENSIDE); // e8 king
+    if (sq == squareOf(7, 0)) mask &= ~WHITE_QUEENSIDE; // a1 rook
+    if (sq == squareOf(7, 7)) mask &= ~WHITE_KINGSIDE; // h1 rook
+    if (sq == squareOf(7, 4)) mask &= ~(WHITE_KINGSIDE | WHITE_QUEENSIDE); // e1 king
+    return mask;
 }
 
-void ChessBoard::displayBoard(const vector<char>& whiteCaptures, const vector<char>& blackCaptures) const {
-    cout << "\033[38;5;117m+-----------------+\033[0m\n"; // Print top border with columns.
-    cout << "\033[38;5;117m|  a b c d e f g h|\033[0m\n"; // Show column labels (a-h).
-    cout << "\033[38;5;117m+-----------------+\033[0m\n"; // Print top border.
-    for (int row = 0; row < BOARD_SIZE; row++) { // Loop through rows.
-        cout << 8 - row << "|"; // Print row number (8 to 1).
-        for (int col = 0; col < BOARD_SIZE; col++) { // Loop through columns.
-            cout << " " << board[row][col].symbol; // Print piece symbol.
-        }
-        cout << " |" << 8 - row << "\n"; // Close row with number.
+// Plays a legal move on the position: captures, castling rook, en passant, promotion, rights, clocks and side to move.
+// The state that cannot be recomputed is pushed on the undo stack first. Returns the symbol of the captured piece, or EMPTY.
+char ChessBoard::makeMove(Move move) {
+    PROFILE_SCOPE(PROFILE_MAKE_MOVE);
+    int from = moveFrom(move), to = moveTo(move); // Source and destination squares
+    int us = pos.sideToMove, them = us ^ 1; // Colors of the mover and the opponent
+    int type = pos.pieceTypeOn(from); // Type of the moving piece
+    int capturedSquare = moveKind(move) == EN_PASSANT ? to + (us == WHITE ? 8 : -8) : to; // En passant captures behind the destination
+    int capturedType = moveKind(move) == EN_PASSANT ? PAWN : pos.pieceTypeOn(to); // NO_PIECE_TYPE if nothing is captured
+
+    UndoInfo& undo = undoStack[undoCount++]; // Saving what the move is about to overwrite
+    undo.move = move;
+    undo.capturedType = capturedType;
+    undo.castlingRights = pos.castlingRights;
+    undo.enPassantSquare = pos.enPassantSquare;
+    undo.halfMoveClock = pos.halfMoveClock;
+    undo.key = pos.key;
+
+    if (capturedType != NO_PIECE_TYPE) pos.removePiece(capturedSquare, them, capturedType); // Remove the captured piece
+    if (moveKind(move) == PROMOTION) { // The pawn disappears and the chosen piece appears on the last row
+        pos.removePiece(from, us, PAWN);
+        pos.putPiece(to, us, promotionType(move));
+    } else {
+        pos.relocatePiece(from, to, us, type); // Move the piece to the target square
     }
-    cout << "\033[38;5;216m+-----------------+\033[0m\n"; // Print bottom border.
-    cout << "\033[38;5;216m|  a b c d e f g h|\033[0m\n"; // Show column labels again.
-    cout << "\033[38;5;216m+-----------------+\033[0m\n"; // Print bottom border.
-    cout << "\nHalf-moves: " << halfMoveClock << " Full moves: " << fullMoveNumber << "\n"; // Show move counters.
-    cout << "\033[38;5;216mWhite captured: \033[0m";  // Label white captures.
-    if (whiteCaptures.empty()) cout << "None"; // Show "None" if no captures.
-    else for (char piece : whiteCaptures) cout << piece << " ";  // List white captures.
-    cout << "\n\033[38;5;117mBlack captured: \033[0m"; // Label black captures.
-    if (blackCaptures.empty()) cout << "None"; // Show "None" if no captures.
-    else for (char piece : blackCaptures) cout << piece << " "; // List black captures.
-    cout << "\n\n";
-}
-
-bool ChessBoard::isKingInCheck(bool isWhite) const { // Function to check if the current player's king is under attack (in check).
-    pair<int, int> kingPos = findKing(isWhite); // Find the position of the king for the specified color.
-    if (kingPos.first == -1) return false; // If the king is not found (should not happen in a valid game), return false.
-
-    for (int row = 0; row < BOARD_SIZE; row++) { // Check all squares for opponent pieces.
-        for (int col = 0; col < BOARD_SIZE; col++) { // Loop through columns.
-            ChessPiece piece = board[row][col]; // Get the piece at the current square.
-            if (piece.symbol != EMPTY && piece.isWhite != isWhite) { // Skip empty or friendly pieces.
-                if (canPieceAttack(piece, row, col, kingPos.first, kingPos.second)) { // Check if piece can attack king.
-                    return true; // If any opposing piece can attack the king, it's in check.
-                }
-            }
-        }
+    if (moveKind(move) == CASTLING) { // If move is a castling, move the rook as well
+        int rookFrom = squareOf(rowOf(from), to > from ? 7 : 0); // Rook's original square
+        pos.relocatePiece(rookFrom, (from + to) / 2, us, ROOK); // The rook lands on the square the king passed over
     }
-    return false; // If no enemy piece can attack the king, it's not in check.
-}
-
-// Executes a move on the chessboard, handling captures, castling, en passant, and pawn promotion.
-bool ChessBoard::movePiece(string move, bool isWhiteTurn, char promotion, vector<char>& whiteCaptures, vector<char>& blackCaptures) {
-    if (move.length() != 5 || move[2] != ' ') return false; // Check if move string is exactly 5 characters and has a space in the middle (e.g., "e2 e4")
-
-    int fromCol = move[0] - 'a'; // Convert column letter to 0-based index (e.g., 'a' = 0, 'b' = 1)
-    int fromRow = 8 - (move[1] - '0'); // Convert row number to 0-based index (e.g., '1' = row 7, '8' = row 0)
-    int toCol = move[3] - 'a'; // Convert destination column letter to index
-    int toRow = 8 - (move[4] - '0'); // Convert destination row number to index
-
-    if (!isValidPosition(fromRow, fromCol) || !isValidPosition(toRow, toCol)) return false;  // Check if source and destination positions are valid board coordinates
 
-    ChessPiece piece = board[fromRow][fromCol]; // Retrieve the piece located at the source square
-    if (piece.symbol == EMPTY || piece.isWhite != isWhiteTurn) return false;  // Check if there is a piece and if it belongs to the player whose turn it is
-
-    if (!isValidMove(piece, fromRow, fromCol, toRow, toCol)) return false; // Check if the move is valid for the selected piece
-
-    bool isCapture = board[toRow][toCol].symbol != EMPTY; // Check if destination square has a piece (normal capture)
-    bool isPawnMove = piece.symbol == WHITE_PAWN || piece.symbol == BLACK_PAWN; // Check if the piece being moved is a pawn
-    bool isCastling = (piece.symbol == WHITE_KING || piece.symbol == BLACK_KING) && abs(toCol - fromCol) == 2; // Detect castling by checking if a king is moving two columns
-    bool isEnPassant = isPawnMove && abs(toCol - fromCol) == 1 && board[toRow][toCol].symbol == EMPTY &&
-                      ((piece.isWhite && toRow == 5) || (!piece.isWhite && toRow == 2)); // Check for en passant: pawn moves diagonally to an empty square on the correct rank
-
-    ChessPiece originalPiece = board[fromRow][fromCol]; // Save the original pieces and positions in case we need to undo the move
-    ChessPiece originalToPiece = board[toRow][toCol]; // Store the piece at the destination position (could be EMPTY or opponent's).
-    pair<int, int> originalLastMoveFrom = lastMoveFrom; // Save the previous move's starting position.
-    pair<int, int> originalLastMoveTo = lastMoveTo; // Save the previous move's ending position.
-    ChessPiece originalRook;  // For castling: track the rook and its movement
-    ChessPiece enPassantCaptured; // For en passant: store the captured pawn
-    int rookFromCol = 0, rookToCol = 0; // Initialize rook columns for castling logic
-
-
-    bool kingInCheckBefore = isKingInCheck(isWhiteTurn); // Check if king is in check before the move
+    // The piece moves above already updated the key; the state fields are XORed out and in here.
+    pos.key ^= ZOBRIST_CASTLING[pos.castlingRights];
+    pos.castlingRights &= castlingMaskFor(from) & castlingMaskFor(to); // Update castling rights
+    pos.key ^= ZOBRIST_CASTLING[pos.castlingRights];
+    if (pos.enPassantSquare != NO_SQUARE) pos.key ^= ZOBRIST_EN_PASSANT[colOf(pos.enPassantSquare)];
+    pos.enPassantSquare = NO_SQUARE;
+    if (type == PAWN && abs(to - from) == 16 && (PAWN_ATTACKS[us][(from + to) / 2] & pos.pieces(them, PAWN))) {
+        // A double pawn push only sets the en passant square when an enemy pawn can take it, so positions that only
+        // differ by an unusable en passant square get the same key and count as repetitions.
+        pos.enPassantSquare = (from + to) / 2;
+        pos.key ^= ZOBRIST_EN_PASSANT[colOf(pos.enPassantSquare)];
+    }
+    pos.halfMoveClock = (capturedType != NO_PIECE_TYPE || type == PAWN) ? 0 : pos.halfMoveClock + 1; // Reset or increment half-move clock
+    if (us == BLACK) pos.fullMoveNumber++; // Increment full move number after Black's move
+    pos.sideToMove = them; // Switch the side to move
+    pos.key ^= ZOBRIST_SIDE;
 
-    board[fromRow][fromCol] = ChessPiece(EMPTY); // Temporarily remove piece from original position
-    board[toRow][toCol] = ChessPiece(piece.symbol, piece.isWhite); // Place the moving piece on the target square
-    board[toRow][toCol].hasMoved = true; // Mark piece as moved (affects castling/pawn logic)
-    lastMoveFrom = {fromRow, fromCol}; // Record last move's starting position
-    lastMoveTo = {toRow, toCol}; // Record last move's ending position
+    return capturedType == NO_PIECE_TYPE ? EMPTY : PIECE_SYMBOLS[them][capturedType];
+}
 
-    if (isCastling) { // If move is a castling
-        rookFromCol = (toCol > fromCol) ? 7 : 0; // Determine rook's original column
-        rookToCol = (toCol > fromCol) ? fromCol + 1 : fromCol - 1; // Determine rook's new column
-        originalRook = board[fromRow][rookFromCol]; // Save the rook's original state
-        board[fromRow][rookToCol] = board[fromRow][rookFromCol];  // Move the rook
-        board[fromRow][rookFromCol] = ChessPiece(EMPTY);  // Clear original rook position
-        board[fromRow][rookToCol].hasMoved = true; // Mark rook as moved
+// Takes back the last move: the pieces are moved back and the saved state is restored from the undo record.
+void ChessBoard::unmakeMove() {
+    PROFILE_SCOPE(PROFILE_UNMAKE_MOVE);
+    const UndoInfo& undo = undoStack[--undoCount]; // Record pushed by the matching makeMove
+    Move move = undo.move;
+    int from = moveFrom(move), to = moveTo(move);
+    int them = pos.sideToMove, us = them ^ 1; // The mover is the side that is not to move now
+
+    if (moveKind(move) == PROMOTION) { // The promoted piece turns back into a pawn
+        pos.removePiece(to, us, promotionType(move));
+        pos.putPiece(from, us, PAWN);
+    } else {
+        pos.relocatePiece(to, from, us, pos.pieceTypeOn(to)); // Move the piece back
     }
-
-    if (isEnPassant) { // If move is an en passant capture
-        int capturedRow = toRow + (piece.isWhite ? 1 : -1);  // Calculate captured pawn's row
-        enPassantCaptured = board[capturedRow][toCol]; // Save the captured pawn
-        board[capturedRow][toCol] = ChessPiece(EMPTY); // Remove the pawn
-        isCapture = true; // Mark as a capture
+    if (moveKind(move) == CASTLING) { // Put the rook back in its corner
+        pos.relocatePiece((from + to) / 2, squareOf(rowOf(from), to > from ? 7 : 0), us, ROOK);
     }
-
-    if (isPawnMove && (toRow == 0 || toRow == 7)) { // If pawn reaches last rank
-        char promoted = piece.isWhite ? toupper(promotion) : tolower(promotion); // Convert promotion piece case
-        if (promoted != 'Q' && promoted != 'R' && promoted != 'B' && promoted != 'N') promoted = 'Q'; // Default to Queen
-        board[toRow][toCol].symbol = promoted; // Promote pawn
+    if (undo.capturedType != NO_PIECE_TYPE) { // Put the captured piece back
+        pos.putPiece(moveKind(move) == EN_PASSANT ? to + (us == WHITE ? 8 : -8) : to, them, undo.capturedType);
     }
 
-    bool kingInCheckAfter = isKingInCheck(isWhiteTurn); // Check if king is in check after move
-    bool invalidMove = (kingInCheckBefore && kingInCheckAfter) || (!kingInCheckBefore && kingInCheckAfter);  // Determine if move is invalid
+    pos.castlingRights = undo.castlingRights; // Restore the saved state
+    pos.enPassantSquare = undo.enPassantSquare;
+    pos.halfMoveClock = undo.halfMoveClock;
+    pos.key = undo.key; // Cheaper than XORing the state changes out again
+    if (us == BLACK) pos.fullMoveNumber--; // Black's move had advanced the move counter
+    pos.sideToMove = us;
+}
 
-    board[fromRow][fromCol] = originalPiece; // Undo move: restore source piece
-    board[toRow][toCol] = originalToPiece; // Undo move: restore destination piece
-    lastMoveFrom = originalLastMoveFrom; // Restore last move from
-    lastMoveTo = originalLastMoveTo; // Restore last move to
+// A null move only flips the side to move; the undo record keeps the en passant square it clears.
+void ChessBoard::makeNullMove() {
+    UndoInfo& undo = undoStack[undoCount++];
+    undo.move = MOVE_NONE;
+    undo.capturedType = NO_PIECE_TYPE;
+    undo.castlingRights = pos.castlingRights;
+    undo.enPassantSquare = pos.enPassantSquare;
+    undo.halfMoveClock = pos.halfMoveClock;
+    undo.key = pos.key;
+    if (pos.enPassantSquare != NO_SQUARE) pos.key ^= ZOBRIST_EN_PASSANT[colOf(pos.enPassantSquare)];
+    pos.enPassantSquare = NO_SQUARE;
+    pos.halfMoveClock = 0; // Stops repetition checks from matching positions on the other side of the null move
+    pos.sideToMove ^= 1;
+    pos.key ^= ZOBRIST_SIDE;
+}
 
-    if (isCastling) { // Undo castling if simulated
-        board[fromRow][rookFromCol] = originalRook;  // Restore rook
-        board[fromRow][rookToCol] = ChessPiece(EMPTY); // Clear moved rook position
-    }
-    if (isEnPassant) {  // Undo en passant if simulated
-        int capturedRow = toRow + (piece.isWhite ? 1 : -1); // Calculate captured pawn row
-        board[capturedRow][toCol] = enPassantCaptured; // Restore captured pawn
-    }
+void ChessBoard::unmakeNullMove() {
+    const UndoInfo& undo = undoStack[--undoCount];
+    pos.enPassantSquare = undo.enPassantSquare;
+    pos.halfMoveClock = undo.halfMoveClock;
+    pos.key = undo.key;
+    pos.sideToMove ^= 1;
+}
 
-    if (invalidMove) return false;  // If move leaves king in check, it's invalid
+ChessPiece ChessBoard::pieceAt(int row, int col) const { // Function to read one square of the position as a ChessPiece.
+    int sq = squareOf(row, col); // Square index of the requested position.
+    return ChessPiece(pos.symbolOn(sq), pos.colorOn(sq) == WHITE); // Symbol and color of whatever stands there.
+}
 
-    if (isCapture) { // Record the capture
-        (isWhiteTurn ? whiteCaptures : blackCaptures).push_back(originalToPiece.symbol);
-    }
+bool ChessBoard::isWhiteToMove() const {
+    return pos.sideToMove == WHITE; // The position records whose turn it is.
+}
 
-    board[fromRow][fromCol] = ChessPiece(EMPTY); // Apply final move: clear source
-    board[toRow][toCol] = ChessPiece(piece.symbol, piece.isWhite); // Apply final move: move piece
-    board[toRow][toCol].hasMoved = true; // Mark moved
-    lastMoveFrom = {fromRow, fromCol};  // Update move tracking
-    lastMoveTo = {toRow, toCol};
+bool ChessBoard::isKingInCheck(bool isWhite) const { // Function to check if the current player's king is under attack (in check).
+    // Looking outwards from the king square for every kind of attacker at once instead of testing all 64 squares.
+    return pos.inCheck(isWhite ? WHITE : BLACK);
+}
 
-    if (isCastling) { // Finalize castling
-        rookFromCol = (toCol > fromCol) ? 7 : 0;  // Determine rook's original column
-        rookToCol = (toCol > fromCol) ? fromCol + 1 : fromCol - 1; // Determine rook's new column
-        board[fromRow][rookToCol] = board[fromRow][rookFromCol]; // Move rook
-        board[fromRow][rookFromCol] = ChessPiece(EMPTY); // Clear rook's original square
-        board[fromRow][rookToCol].hasMoved = true; // Mark rook as moved
-        if (piece.isWhite) {  // Disable castling rights for White
-            whiteCanCastleKingside = whiteCanCastleQueenside = false;
-        } else { // Disable castling rights for Black
-            blackCanCastleKingside = blackCanCastleQueenside = false;
-        }
-    }
+void ChessBoard::generateMoves(MoveList& list) const {
+    generateLegalMoves(pos, list); // Only the real candidate moves, filtered with pin and check masks
+}
 
-    if (isEnPassant) {  // Remove pawn if en passant capture was valid
-        int capturedRow = toRow + (piece.isWhite ? 1 : -1); // Get captured pawn's row.
-        board[capturedRow][toCol] = ChessPiece(EMPTY); // Remove captured pawn.
-    }
+void ChessBoard::generatePseudoLegalMoves(MoveList& list) const {
+    ::generatePseudoLegalMoves(pos, list); // Moves that follow the piece rules, king safety not checked
+}
 
-    if (isPawnMove && (toRow == 0 || toRow == 7)) { // Promote pawn again in final board state
-        char promoted = piece.isWhite ? toupper(promotion) : tolower(promotion);  // Get promotion piece.
-        if (promoted != 'Q' && promoted != 'R' && promoted != 'B' && promoted != 'N') promoted = 'Q'; // Default to queen if invalid.
-        board[toRow][toCol].symbol = promoted; // Set promoted piece.
+// Finds the legal move a piece of text names. Accepted forms are long algebraic as used by UCI ("e2e4", "e7e8q") and
+// the game's own input ("e2 e4", "e7 e8=Q"); the promotion letter may be either case and defaults to
+// 'defaultPromotion'. Returns MOVE_NONE if the text is malformed or the move is not legal here.
+Move ChessBoard::parseMove(const string& text, int defaultPromotion) const {
+    PROFILE_SCOPE(PROFILE_PARSE_MOVE);
+    string s; // The text without the optional separators
+    for (char c : text) if (c != ' ' && c != '=') s += c;
+    if (s.length() != 4 && s.length() != 5) return MOVE_NONE; // Two squares and maybe a promotion letter
+
+    int fromCol = s[0] - 'a'; // Convert column letter to 0-based index (e.g., 'a' = 0, 'b' = 1)
+    int fromRow = 8 - (s[1] - '0'); // Convert row number to 0-based index (e.g., '1' = row 7, '8' = row 0)
+    int toCol = s[2] - 'a'; // Convert destination column letter to index
+    int toRow = 8 - (s[3] - '0'); // Convert destination row number to index
+    if (!isValidPosition(fromRow, fromCol) || !isValidPosition(toRow, toCol)) return MOVE_NONE; // Check if source and destination positions are valid board coordinates
+
+    int promotedType = s.length() == 5 ? pieceTypeOf(s[4]) : defaultPromotion; // Piece a pawn on the last row turns into
+    if (promotedType == NO_PIECE_TYPE || promotedType == PAWN || promotedType == KING) promotedType = QUEEN; // Default to Queen
+    int from = squareOf(fromRow, fromCol), to = squareOf(toRow, toCol); // Square indexes of the move
+
+    MoveList legalMoves; // Every legal move of the side to move (stack buffer, no allocation)
+    generateMoves(legalMoves);
+    for (Move candidate : legalMoves) { // Looking for the move the text names
+        if (moveFrom(candidate) != from || moveTo(candidate) != to) continue;
+        if (moveKind(candidate) == PROMOTION && promotionType(candidate) != promotedType) continue; // Pick the chosen promotion
+        return candidate;
     }
+    return MOVE_NONE; // Not a legal move in this position
+}
 
-    if (piece.symbol == WHITE_ROOK && !piece.hasMoved) { // Update castling rights if white rook moved
-        if (fromCol == 0) whiteCanCastleQueenside = false; // Disable queenside castling.
-        else if (fromCol == 7) whiteCanCastleKingside = false; // Disable kingside castling.
-    }
-    if (piece.symbol == BLACK_ROOK && !piece.hasMoved) { // Update castling rights if white rook moved
-        if (fromCol == 0) blackCanCastleQueenside = false; // Disable queenside castling.
-        else if (fromCol == 7) blackCanCastleKingside = false; // Disable kingside castling.
+// Executes a move on the chessboard, handling captures, castling, en passant, and pawn promotion.
+bool ChessBoard::movePiece(const string& move, bool isWhiteTurn, char promotion, CaptureList& whiteCaptures, CaptureList& blackCaptures) {
+    PROFILE_SCOPE(PROFILE_MOVE_PIECE);
+    if (isWhiteTurn != isWhiteToMove()) return false; // Check if it is this player's turn in the position
+    Move legal = parseMove(move, pieceTypeOf(promotion)); // Any accepted notation; 'promotion' is used when the text names no piece
+    if (legal == MOVE_NONE) return false; // Malformed or not a legal move in this position
+    playMove(legal, whiteCaptures, blackCaptures); // Play the move
+    return true; // Move was successfully completed
+}
+
+// Makes a legal move as part of the game (typed by a player, chosen by the engine or replayed from a file).
+char ChessBoard::playMove(Move move) {
+    char captured = makeMove(move);
+    // Positions from before a capture or pawn move can never come back, so their undo records are dropped;
+    // otherwise only the oldest record is dropped once the game part of the stack is full.
+    if (pos.halfMoveClock == 0) undoCount = 0;
+    else if (undoCount > MAX_GAME_HISTORY) {
+        for (int i = 1; i < undoCount; i++) undoStack[i - 1] = undoStack[i];
+        undoCount--;
     }
-    if (piece.symbol == WHITE_KING) whiteCanCastleKingside = whiteCanCastleQueenside = false; // Disable white king's castling rights
-    if (piece.symbol == BLACK_KING) blackCanCastleKingside = blackCanCastleQueenside = false; // Disable black king's castling rights
+    return captured;
+}
 
-    halfMoveClock = (isCapture || isPawnMove) ? 0 : halfMoveClock + 1; // Reset or increment half-move clock
-    if (!isWhiteTurn) fullMoveNumber++; // Increment full move number after Blacks move
-    return true; // Move was successfully completed
+// The same, also recording the captured piece for the side that moved.
+char ChessBoard::playMove(Move move, CaptureList& whiteCaptures, CaptureList& blackCaptures) {
+    bool whiteMoved = isWhiteToMove(); // The side making the move collects the capture
+    char captured = playMove(move);
+    if (captured != EMPTY) { // Record the capture
+        (whiteMoved ? whiteCaptures : blackCaptures).add(captured);
+    }
+    return captured;
 }
 
 bool ChessBoard::isCheckmate(bool isWhite) {
@@ -382,83 +258,110 @@ bool ChessBoard::isStalemate(bool isWhite) {
 }
 
 bool ChessBoard::isDraw() const {
-    return halfMoveClock >= 50; // Draw if 50 half-moves passed with no pawn move or capture
+    return pos.halfMoveClock >= FIFTY_MOVE_PLIES || repetitionCount() >= 2; // 50 moves each with no pawn move or capture, or threefold repetition
+}
+
+// Walks back over the undo records two plies at a time (same side to move), stopping at the last capture or pawn move:
+// nothing before it can repeat, so the cost is bounded by the half-move clock, not by the length of the game.
+int ChessBoard::repetitionCount() const {
+    int limit = pos.halfMoveClock < undoCount ? pos.halfMoveClock : undoCount; // Plies that can still hold a repetition
+    int count = 0;
+    for (int back = 4; back <= limit; back += 2) { // A position can first repeat four plies later
+        if (undoStack[undoCount - back].key == pos.key) count++; // The record 'back' plies ago holds that position's key
+    }
+    return count;
+}
+
+uint64_t ChessBoard::positionKey() const {
+    return pos.key;
 }
 
 bool ChessBoard::hasLegalMoves(bool isWhite) {
-    for (int fromRow = 0; fromRow < BOARD_SIZE; fromRow++) { // Loop through all rows
-        for (int fromCol = 0; fromCol < BOARD_SIZE; fromCol++) { // Loop through all columns
-            ChessPiece piece = board[fromRow][fromCol]; // Get the piece at current position
-            if (piece.symbol != EMPTY && piece.isWhite == isWhite) { // Check if piece belongs to current player
-                for (int toRow = 0; toRow < BOARD_SIZE; toRow++) { // Try moving to all rows
-                    for (int toCol = 0; toCol < BOARD_SIZE; toCol++) {  // Try moving to all columns
-                        if (isValidMove(piece, fromRow, fromCol, toRow, toCol)) { // Check if move is valid
-                            ChessPiece originalPiece = board[fromRow][fromCol]; // Save original piece
-                            ChessPiece originalToPiece = board[toRow][toCol];  // Save target square piece
-                            pair<int, int> originalLastMoveFrom = lastMoveFrom; // Save last move from
-                            pair<int, int> originalLastMoveTo = lastMoveTo; // Save last move to
-
-                            board[toRow][toCol] = ChessPiece(piece.symbol, piece.isWhite); // Simulate move to target
-                            board[toRow][toCol].hasMoved = true; // Mark as moved
-                            board[fromRow][fromCol] = ChessPiece(EMPTY); // Clear source square
-                            lastMoveFrom = {fromRow, fromCol}; // Update move from
-                            lastMoveTo = {toRow, toCol}; // Update move to
-
-                            bool stillInCheck = isKingInCheck(isWhite); // Check if king is still in check
-
-                            board[fromRow][fromCol] = originalPiece; // Undo move: restore source
-                            board[toRow][toCol] = originalToPiece; // Undo move: restore target
-                            lastMoveFrom = originalLastMoveFrom; // Restore last move from
-                            lastMoveTo = originalLastMoveTo; // Restore last move to
-
-                            if (!stillInCheck) return true; // If king is safe after move, legal move exists
-                        }
-                    }
-                }
-            }
-        }
+    PROFILE_SCOPE(PROFILE_HAS_LEGAL_MOVES);
+    Position side = pos; // Asking about the side to move, or about the other side as if it were its turn
+    if (side.sideToMove != (isWhite ? WHITE : BLACK)) {
+        side.sideToMove = isWhite ? WHITE : BLACK;
+        side.enPassantSquare = NO_SQUARE; // An en passant capture only exists for the side to move
     }
-    return false; // No legal move found, return false
+    MoveList moves; // Generating the real moves instead of probing every from/to pair
+    generateLegalMoves(side, moves);
+    return moves.size() > 0; // Any legal move at all
 }
 
-void ChessBoard::saveGame(const string& filename) {
+// Saves the position as one FEN line, which keeps the side to move, castling rights, en passant square and clocks.
+bool ChessBoard::saveGame(const string& filename) const {
     ofstream file(filename); // Open file for writing
-    if (file.is_open()) {  // Check if file is open
-        file << (whiteCanCastleKingside ? "1" : "0") << " " // Save white kingside castling right
-             << (whiteCanCastleQueenside ? "1" : "0") << " " // Save white queenside castling right
-             << (blackCanCastleKingside ? "1" : "0") << " " // Save black kingside castling right
-             << (blackCanCastleQueenside ? "1" : "0") << " " // Save black queenside castling right
-             << halfMoveClock << " " << fullMoveNumber << endl; // Save move clocks
-        for (int row = 0; row < BOARD_SIZE; row++) { // Loop through all rows
-            for (int col = 0; col < BOARD_SIZE; col++) { // Loop through all columns
-                file << board[row][col].symbol;  // Write piece symbol to file
-            }
-            file << endl; // Newline after each row
+    if (!file.is_open()) return false;
+    file << pos.toFen() << endl; // Write the whole position on one line
+    return bool(file);
+}
+
+// Reading the board layout used by older saves: four castling flags and the two clocks, then eight rows of eight
+// symbols. The side to move and en passant square were never stored, so White moves and there is no en passant.
+static bool readLegacySave(istream& file, Position& parsed) {
+    int castling[4], halfMoveClock, fullMoveNumber; // Castling rights: white kingside, white queenside, black kingside, black queenside
+    if (!(file >> castling[0] >> castling[1] >> castling[2] >> castling[3] >> halfMoveClock >> fullMoveNumber)) return false;
+    parsed.clear();
+    parsed.castlingRights = (castling[0] ? WHITE_KINGSIDE : 0) | (castling[1] ? WHITE_QUEENSIDE : 0) |
+                            (castling[2] ? BLACK_KINGSIDE : 0) | (castling[3] ? BLACK_QUEENSIDE : 0);
+    parsed.halfMoveClock = halfMoveClock;
+    parsed.fullMoveNumber = fullMoveNumber;
+    string line;
+    getline(file, line); // Rest of the first line (the newline, and a '\r' in saves written on Windows)
+    uint8_t board[SQUARE_NB]; // The eight rows one after the other, in square order
+    for (int row = 0; row < BOARD_SIZE; row++) { // Loop through rows
+        if (!getline(file, line)) return false; // A missing row would leave the old pieces on it
+        if (!line.empty() && line.back() == '\r') line.pop_back(); // Saves written on Windows
+        if (line.length() != BOARD_SIZE) return false;
+        for (int col = 0; col < BOARD_SIZE; col++) board[squareOf(row, col)] = uint8_t(line[col]);
+    }
+    Bitboard known = squaresMatching(board, uint8_t(EMPTY)); // Each symbol is found on all 64 squares at once
+    for (int color = 0; color < COLOR_NB; color++) {
+        for (int type = 0; type < PIECE_TYPE_NB; type++) {
+            Bitboard b = squaresMatching(board, uint8_t(PIECE_SYMBOLS[color][type]));
+            known |= b;
+            while (b) parsed.putPiece(popLsb(b), color, type);
         }
-        file.close(); // Close the file
     }
+    if (known != ~Bitboard(0)) return false; // Unknown symbol
+    parsed.key = parsed.computeKey(); // Rebuild the position key from the loaded board and rights
+    return true;
 }
 
-void ChessBoard::loadGame(const string& filename) {
+// Loads a FEN save or an older board-layout save, telling them apart by the '/' separators of the FEN placement.
+// On any error the current game is left as it was.
+bool ChessBoard::loadGame(const string& filename) {
     ifstream file(filename); // Open file for reading
-    if (file.is_open()) { // Check if file opened successfully
-        file >> whiteCanCastleKingside >> whiteCanCastleQueenside // Load castling rights
-             >> blackCanCastleKingside >> blackCanCastleQueenside
-             >> halfMoveClock >> fullMoveNumber; // Load move clocks
-        file.ignore(); // Ignore the newline character after last integer
-        for (int row = 0; row < BOARD_SIZE; row++) { // Loop through rows
-            string line;
-            if (getline(file, line) && line.length() >= BOARD_SIZE) { // Read line of piece symbols
-                for (int col = 0; col < BOARD_SIZE; col++) { // Loop through columns
-                    board[row][col] = ChessPiece(line[col], line[col] >= 'A' && line[col] <= 'Z'); // Rebuild board with correct piece and color
-                }
-            }
-        }
-        file.close(); // Close the file
-    }
+    if (!file.is_open()) return false;
+    string first; // First line of the file
+    getline(file, first);
+    if (first.find('/') != string::npos) return loadFen(first); // FEN save
+    file.clear();
+    file.seekg(0); // Older format: parse from the start again
+    Position parsed;
+    if (!readLegacySave(file, parsed)) return false;
+    pos = parsed;
+    undoCount = 0; // Moves made before loading cannot be taken back
+    return true;
 }
 
-ChessGame::ChessGame() : whiteTurn(true), checkCount(0) { // Initialize game: white's turn and check count 0
+void ChessBoard::setPosition(const Position& position) {
+    pos = position;
+    undoCount = 0; // Moves made before loading cannot be taken back
+}
+
+string ChessBoard::toFen() const {
+    return pos.toFen();
+}
+
+bool ChessBoard::loadFen(const string& fen) {
+    if (!pos.setFromFen(fen)) return false; // Keep the current position if the FEN does not parse
+    undoCount = 0; // Moves made before loading cannot be taken back
+    return true;
+}
+
+ChessGame::ChessGame() : whiteTurn(true), checkCount(0), computerColor(COLOR_NB), engineMoveTimeMs(1000), pliesSinceSnapshot(0) { // Initialize game: white's turn, check count 0, two human players
+    startPosition = board.position(); // The game starts from the normal start position
     whiteCaptures.clear(); // Clear white's capture list
     blackCaptures.clear(); // Clear black's capture list
 }
@@ -487,7 +390,7 @@ void ChessGame::displayRules() {
     cout << "\033[38;5;30m*--------------------------------------------*\033[0m\n";  // Decorative line
     cout << "\033[38;5;30m|                1. White moves first        |\033[0m\n"; // Rule 1
     cout << "\033[38;5;30m|                                            |\033[0m\n";  // Spacer
-    cout << "\033[38;5;30m|            2. Game ends after 8 checks     |\033[0m\n"; // Rule 2
+    cout << "\033[38;5;30m|            2. Game ends after " << CHECK_LIMIT << " checks     |\033[0m\n"; // Rule 2
     cout << "\033[38;5;30m|                                            |\033[0m\n"; // Spacer
     cout << "\033[38;5;30m|----------3. Pieces move as follows:--------|\033[0m\n"; // Rule 3 header
     cout << "\033[38;5;30m|         *   King: 1 square any dir         |\033[0m\n"; // King move
@@ -510,60 +413,311 @@ void ChessGame::displayRules() {
 }
 
 void ChessGame::start() {
+    computerColor = COLOR_NB; // Two human players
+    playGame();
+}
+
+void ChessGame::startVsComputer() {
+    string color; // Color the player wants
+    cout << "Play as White or Black? (w/b): ";
+    getline(cin, color);
+    computerColor = (!color.empty() && (color[0] == 'b' || color[0] == 'B')) ? WHITE : BLACK; // The engine takes the other side
+    playGame();
+}
+
+void ChessGame::playGame() {
     displayWelcomeMessage(); // Show welcome message
     string move; // User input for move
+    renderer.invalidate(); // The welcome message used the screen: the first frame is drawn in full
+    notice = "\033[38;5;30mEnter moves as 'e2 e4', 'exit' ends the game\033[0m";
+    bool keepOutput = false; // Leave the last command's output on screen (the stats table)
+    startJournal(); // Autosave from here on
     while (true) {
-        board.displayBoard(whiteCaptures, blackCaptures);  // Display board with captured pieces
-        cout << (whiteTurn ? "\033[38;5;216m White" : "\033[38;5;117mBlack") << "'s turn. Enter move: \033[0m"; // Show whose turn
-        getline(cin, move);  // Get move from user
-
-        if (move == "exit") {  // If user types exit
-            cout << "\033[31m                +-----------------+\033[0m\n";
-            cout << "\033[31m                |    Game Over!   |\033[0m\n";
-            cout << "\033[31m                +-----------------+\033[0m\n";
-            break;  // End loop
+        renderer.draw(board.position(), whiteCaptures, blackCaptures, notice.c_str(), !keepOutput); // Only what changed is redrawn
+        notice.clear();
+        keepOutput = false;
+        TablebaseHit hit; // Known endings show who wins with best play
+        if (TABLEBASES.probe(board.position(), checkCount, hit) && hit.result != 0) {
+            bool whiteWins = (hit.result > 0) == whiteTurn;
+            cout << "\033[38;5;183mTablebase: " << (whiteWins ? "White" : "Black") << " wins in " << (hit.plies + 1) / 2 << " move(s) with best play\033[0m\n";
         }
+        if ((whiteTurn ? WHITE : BLACK) == computerColor) { // Engine's turn
+            cout << "\033[38;5;183mComputer is thinking...\033[0m\n";
+            SearchLimits limits; // Time limit only, as deep as it gets
+            limits.moveTimeMs = engineMoveTimeMs;
+            Move best = board.bestMove(limits, checkCount);
+            if (best == MOVE_NONE) break; // No legal move (the game-over checks below normally catch this first)
+            board.playMove(best, whiteCaptures, blackCaptures);
+            moveHistory.push_back(best);
+            notice = "\033[38;5;183mComputer plays " + squareName(moveFrom(best)) + " " + squareName(moveTo(best)) + "\033[0m";
+        } else {
+            cout << (whiteTurn ? "\033[38;5;216m White" : "\033[38;5;117mBlack") << "'s turn. Enter move: \033[0m"; // Show whose turn
+            getline(cin, move);  // Get move from user
+
+            if (move == "exit" || !cin) {  // If user types exit (or the input ends)
+                cout << "\033[31m                +-----------------+\033[0m\n";
+                cout << "\033[31m                |    Game Over!   |\033[0m\n";
+                cout << "\033[31m                +-----------------+\033[0m\n";
+                break;  // End loop
+            }
 
-        char promotion = 'Q'; // Default promotion piece
-        if (move.length() == 7 && move[5] == '=') { // Check for promotion input
-            promotion = move[6]; // Get promoted piece
-            move = move.substr(0, 5); // Trim move string
-        }
+            if (move == "stats") { // Hot-path counters so far (builds with -DCHESS_PROFILE)
+                printProfile(cout);
+                keepOutput = true;
+                continue;
+            }
 
-        if (board.movePiece(move, whiteTurn, promotion, whiteCaptures, blackCaptures)) { // If move is valid
-            bool opponentInCheck = board.isKingInCheck(!whiteTurn); // Check if opponent is in check
-            if (opponentInCheck) {
-                checkCount++; // Increment check count
-                board.displayBoard(whiteCaptures, blackCaptures); // Show board
-                cout << "\033[31m+-----------------------------------------------------+\033[0m\n";
-                cout << "\033[31m|****************          Check!       **************|\033[0m\n";
-                cout << "\033[31m+-----------------------------------------------------+\033[0m\n";
-
-                if (checkCount >= 4) { // If 4 checks occurred
-                    cout << "\033[38;5;30m\n####################################################################+\033[0m\n";
-                    cout << "\033[38;5;30m|                       Game Over!                                   |\033[0m\n";
-                    cout << "\033[38;5;30m|                    " << (whiteTurn ? "Black" : "White") << "\033[38;5;30m wins after second check!                  |\033[0m\n";
-                    cout << "\033[38;5;30m+####################################################################+\033[0m\n";
-                    break; // End game
-                }
+            // "e2 e4", "e7 e8=Q", "e2e4" and "e7e8q" are all understood; a promotion without a piece becomes a queen.
+            Move played = board.parseMove(move, QUEEN);
+            if (played == MOVE_NONE) { // If move is not valid
+                notice = "\033[31m|*******************  Invalid move!  **********************|"; // Shown on the next frame, the board is unchanged
+                continue;
             }
-            whiteTurn = !whiteTurn; // Switch turn
-        } else {
-            board.displayBoard(whiteCaptures, blackCaptures); // Re-display board
-            cout << "\033[31m|*******************  Invalid move!  **********************|\033[0m\n"; // Invalid move message
+            board.playMove(played, whiteCaptures, blackCaptures);
+            moveHistory.push_back(played); // Kept for the binary save
         }
+        bool over = isGameOver(); // Checks counted first: the journal's snapshots include them
+        journalMove(moveHistory.back(), over);
+        if (over) break; // End game
+        whiteTurn = !whiteTurn; // Switch turn
+    }
+    if (journal.isOpen()) journal.sync(); // Everything played is on disk before returning to the menu
+}
+
+// Called after every move, with whiteTurn still naming the side that just moved.
+bool ChessGame::isGameOver() {
+    const char* mover = whiteTurn ? "White" : "Black"; // Side that just moved
+    string result; // Text of the game-ending message, if any
+    if (board.isKingInCheck(!whiteTurn)) { // Check if opponent is in check
+        checkCount++; // Increment check count
+        notice += (notice.empty() ? "" : "  ") + string("\033[31m|****  Check!  ****|\033[0m"); // On the status line of the next frame
+        if (checkCount >= CHECK_LIMIT) result = string(mover) + " wins by giving check number " + to_string(CHECK_LIMIT) + "!"; // Custom N-check rule
+        else if (board.isCheckmate(!whiteTurn)) result = string(mover) + " wins by checkmate!";
+    } else if (board.isStalemate(!whiteTurn)) {
+        result = "Draw by stalemate.";
+    }
+    if (result.empty() && board.isDraw()) {
+        result = board.repetitionCount() >= 2 ? "Draw by threefold repetition." : "Draw by the 50-move rule.";
+    }
+    if (result.empty()) return false;
+
+    renderer.draw(board.position(), whiteCaptures, blackCaptures, notice.c_str()); // Final position
+    notice.clear();
+    cout << "\033[38;5;30m\n####################################################################+\033[0m\n";
+    cout << "\033[38;5;30m|                       Game Over!                                   |\033[0m\n";
+    cout << "\033[38;5;30m|  " << result << string(66 - result.length(), ' ') << "|\033[0m\n";
+    cout << "\033[38;5;30m+####################################################################+\033[0m\n";
+    return true;
+}
+
+// Lets the player change the transposition table size (and huge page backing), the number of search threads, the
+// opening book file and the tablebase directory; an empty answer keeps the current value.
+void ChessGame::engineSetup() {
+    string answer;
+    cout << "\033[38;5;183mHash table size in MB (now " << TT.sizeInMb() << "): \033[0m";
+    getline(cin, answer);
+    int hashMb = answer.empty() ? (int)TT.sizeInMb() : atoi(answer.c_str());
+    cout << "\033[38;5;183mUse huge pages? (y/n, now " << (TT.usesHugePages() ? "y" : "n") << "): \033[0m";
+    getline(cin, answer);
+    bool hugePages = answer.empty() ? TT.usesHugePages() : (answer[0] == 'y' || answer[0] == 'Y');
+    cout << "\033[38;5;183mSearch threads (now " << ENGINE.threads() << ", this machine has " << thread::hardware_concurrency() << "): \033[0m";
+    getline(cin, answer);
+    if (!answer.empty()) ENGINE.setThreads(atoi(answer.c_str()));
+    cout << "\033[38;5;183mOpening book file, or 'none' (now " << (BOOK.isOpen() ? BOOK.fileName() : string("none")) << "): \033[0m";
+    getline(cin, answer);
+    if (answer == "none") BOOK.close();
+    else if (!answer.empty() && !BOOK.open(answer)) cout << "\033[38;5;30m    | Cannot open the book " << answer << "! |\033[0m\n";
+    cout << "\033[38;5;183mTablebase directory (now " << (TABLEBASES.size() ? TABLEBASES.directory() : string("none")) << ", "
+         << TABLEBASES.size() << " tables): \033[0m";
+    getline(cin, answer);
+    if (!answer.empty()) cout << "\033[38;5;183m" << TABLEBASES.open(answer) << " tables found in " << answer << "\033[0m\n";
+    if (hashMb < 1 || !TT.resize(hashMb, hugePages)) { // Keeping the old table on a bad size or failed allocation
+        cout << "\033[38;5;30m    | Invalid size or not enough memory! |\033[0m\n";
+        return;
     }
+    cout << "\033[38;5;183mHash table: " << TT.sizeInMb() << " MB" << (hugePages ? " (huge pages)" : "")
+         << ", " << ENGINE.threads() << " search thread(s)\033[0m\n";
+}
+
+// Endings in the tablebases get the exact verdict and the best move; book moves are listed with how they scored for
+// the side playing them; otherwise the engine thinks for the usual move time.
+void ChessGame::suggestMove() {
+    TablebaseHit hit;
+    Move tableMove = TABLEBASES.bestMove(board.position(), checkCount, &hit);
+    if (tableMove != MOVE_NONE) {
+        cout << "\033[38;5;183mTablebase: " << (hit.result > 0 ? "win" : hit.result < 0 ? "loss" : "draw");
+        if (hit.result) cout << " in " << (hit.plies + 1) / 2 << " move(s)";
+        cout << ", best move " << squareName(moveFrom(tableMove)) << " " << squareName(moveTo(tableMove)) << "\033[0m\n";
+        return;
+    }
+    BookEntry found[MAX_BOOK_MOVES];
+    int n = BOOK.probe(board.position(), found, MAX_BOOK_MOVES);
+    if (n > 0) {
+        cout << "\033[38;5;183mBook moves (wins/draws/losses for the mover):\033[0m\n";
+        for (int i = 0; i < n; i++) {
+            cout << "  " << squareName(moveFrom(found[i].move)) << " " << squareName(moveTo(found[i].move)) << "   +" << found[i].wins
+                 << " =" << found[i].draws << " -" << found[i].losses << "\n";
+        }
+        return;
+    }
+    cout << "\033[38;5;183m" << (BOOK.isOpen() ? "Not in the book, thinking..." : "No opening book, thinking...") << "\033[0m\n";
+    SearchLimits limits;
+    limits.moveTimeMs = engineMoveTimeMs;
+    Move best = ENGINE.search(board, checkCount, limits, false).bestMove;
+    if (best == MOVE_NONE) cout << "\033[38;5;30m    | No legal moves! |\033[0m\n";
+    else cout << "\033[38;5;183mSuggested move: " << squareName(moveFrom(best)) << " " << squareName(moveTo(best)) << "\033[0m\n";
+}
+
+// The binary save keeps the whole game: the start position and every move, so loading it replays the game and gets
+// the captures, check count and repetition history back as well. Position 0 of the archive is the current position.
+bool ChessGame::saveArchive(const string& filename) const {
+    ArchiveWriter writer;
+    if (!writer.open(filename)) return false;
+    ChessBoard replay; // Counting the checks each side gave
+    replay.setPosition(startPosition);
+    int checks[COLOR_NB] = {0, 0};
+    for (Move m : moveHistory) {
+        int mover = replay.isWhiteToMove() ? WHITE : BLACK;
+        replay.playMove(m);
+        if (replay.isKingInCheck(mover == BLACK)) checks[mover]++;
+    }
+    return writer.addGame(startPosition, moveHistory.data(), uint32_t(moveHistory.size()), ARCHIVE_RESULT_UNKNOWN, checks[WHITE], checks[BLACK]) &&
+           writer.addPosition(board.position()) && writer.finish();
+}
+
+bool ChessGame::loadArchive(const string& filename) {
+    ArchiveReader archive;
+    if (!archive.open(filename)) return false;
+    const ArchiveGame* game = archive.game(0);
+    if (!game) return false;
+    Position start;
+    unpackPosition(game->start, start);
+    ChessBoard loaded; // Replayed on the side so a damaged file leaves the current game alone
+    loaded.setPosition(start);
+    CaptureList loadedWhiteCaptures, loadedBlackCaptures;
+    int checks = 0;
+    const Move* moves = archive.gameMoves(game);
+    for (uint32_t i = 0; i < game->plies; i++) {
+        MoveList legal;
+        loaded.generateMoves(legal);
+        if (!legal.contains(moves[i])) return false;
+        loaded.playMove(moves[i], loadedWhiteCaptures, loadedBlackCaptures);
+        if (loaded.isKingInCheck(loaded.isWhiteToMove())) checks++;
+    }
+    board = loaded;
+    startPosition = start;
+    moveHistory.assign(moves, moves + game->plies);
+    whiteCaptures = loadedWhiteCaptures;
+    blackCaptures = loadedBlackCaptures;
+    checkCount = checks;
+    return true;
+}
+
+bool ChessGame::journalState(JournalSnapshotRecord& state) const {
+    state = JournalSnapshotRecord();
+    state.checkCount = uint8_t(checkCount < 255 ? checkCount : 255);
+    state.plies = uint32_t(moveHistory.size());
+    const CaptureList* captures[COLOR_NB] = {&whiteCaptures, &blackCaptures};
+    for (int color = WHITE; color <= BLACK; color++) {
+        for (char piece : *captures[color]) {
+            if (state.captureCounts[color] < sizeof(state.captures[color])) state.captures[color][state.captureCounts[color]++] = piece;
+        }
+    }
+    return packPosition(board.position(), state.position);
+}
+
+void ChessGame::startJournal() {
+    JournalSnapshotRecord state;
+    if (journalFile.empty() || (journalState(state) && journal.create(journalFile, startPosition, moveHistory, state))) {
+        pliesSinceSnapshot = 0;
+        return;
+    }
+    cout << "\033[38;5;30m    | Cannot write the journal " << journalFile << ": this game is not autosaved! |\033[0m\n";
+}
+
+// One 16-byte record per move. A snapshot is added at the first capture or pawn move once JOURNAL_SNAPSHOT_PLIES
+// moves have gone by: no position before such a move can occur again, so recovering from the snapshot loses nothing
+// the repetition rule needs, and at most JOURNAL_SNAPSHOT_PLIES + 100 moves are replayed (the 50-move rule ends longer stretches).
+void ChessGame::journalMove(Move move, bool gameOver) {
+    if (!journal.isOpen()) return;
+    journal.addMove(move);
+    JournalSnapshotRecord state;
+    if (++pliesSinceSnapshot >= JOURNAL_SNAPSHOT_PLIES && board.position().halfMoveClock == 0 && journalState(state)) {
+        journal.addSnapshot(state);
+        pliesSinceSnapshot = 0;
+    }
+    if (gameOver) journal.addEnd(); // Nothing to recover from a finished game
+}
+
+void ChessGame::setJournal(const string& filename) {
+    journal.close();
+    journalFile = filename == "none" ? string() : filename;
+    if (!journalFile.empty()) recoverJournal();
+}
+
+bool ChessGame::recoverJournal() {
+    JournalContents contents;
+    if (journalFile.empty() || !readJournal(journalFile, contents) || contents.finished) return false;
+    ChessBoard recovered; // Rebuilt on the side so a damaged journal leaves the current game alone
+    CaptureList recoveredWhiteCaptures, recoveredBlackCaptures;
+    int checks = 0;
+    size_t first = 0; // First move to replay
+    if (contents.hasSnapshot) {
+        const JournalSnapshotRecord& snapshot = contents.snapshot;
+        Position pos;
+        unpackPosition(snapshot.position, pos);
+        recovered.setPosition(pos);
+        for (int i = 0; i < snapshot.captureCounts[WHITE] && i < 15; i++) recoveredWhiteCaptures.add(snapshot.captures[WHITE][i]);
+        for (int i = 0; i < snapshot.captureCounts[BLACK] && i < 15; i++) recoveredBlackCaptures.add(snapshot.captures[BLACK][i]);
+        checks = snapshot.checkCount;
+        first = snapshot.plies;
+    } else {
+        recovered.setPosition(contents.start);
+    }
+    size_t replayed = first;
+    for (; replayed < contents.moves.size(); replayed++) { // Stopping at a move that does not fit (a damaged record)
+        MoveList legal;
+        recovered.generateMoves(legal);
+        if (!legal.contains(contents.moves[replayed])) break;
+        recovered.playMove(contents.moves[replayed], recoveredWhiteCaptures, recoveredBlackCaptures);
+        if (recovered.isKingInCheck(recovered.isWhiteToMove())) checks++;
+    }
+    board = recovered;
+    startPosition = contents.start;
+    moveHistory.assign(contents.moves.begin(), contents.moves.begin() + replayed);
+    whiteCaptures = recoveredWhiteCaptures;
+    blackCaptures = recoveredBlackCaptures;
+    checkCount = checks;
+    whiteTurn = board.isWhiteToMove();
+    cout << "\033[38;5;183mRecovered an unfinished game from " << journalFile << ": " << moveHistory.size() << " moves ("
+         << replayed - first << " replayed after the last snapshot). Choose 1 or 2 to go on with it.\033[0m\n";
+    return true;
 }
 
 void ChessGame::saveGame(const string& filename) {
-    board.saveGame(filename); // Save board state
+    if (!(hasArchiveExtension(filename) ? saveArchive(filename) : board.saveGame(filename))) { // Binary or FEN save
+        cout << "\033[38;5;30m    | Cannot write " << filename << "! |\033[0m\n";
+        return;
+    }
     cout << "\033[38;5;183m+-----------------+\033[0m\n";
     cout << "\033[45m|   Game saved!   \033[0m|\n";
     cout << "\033[38;5;183m+-----------------+\033[0m\n";
 }
 
 void ChessGame::loadGame(const string& filename) {
-    board.loadGame(filename);  // Load board state
+    if (hasArchiveExtension(filename)) { // Binary save: the whole game is replayed
+        if (!loadArchive(filename)) {
+            cout << "\033[38;5;30m    | Cannot load " << filename << ": missing file or damaged archive! |\033[0m\n";
+            return;
+        }
+    } else if (board.loadGame(filename)) { // Text save: only the position is known
+        startPosition = board.position();
+        moveHistory.clear();
+    } else { // Unchanged on error
+        cout << "\033[38;5;30m    | Cannot load " << filename << ": missing file or not a saved game! |\033[0m\n";
+        return;
+    }
+    whiteTurn = board.isWhiteToMove(); // Continue with the side to move stored in the position
     cout << "\033[38;5;183m+-----------------+\033[0m\n";
     cout << "\033[45m|   Game loaded!  |\033[0m\n";
     cout << "\033[38;5;183m+-----------------+\033[0m\n";
@@ -574,39 +728,100 @@ void displayMenu() {
     cout << "\033[38;5;183m|      Chess Master       |\033[0m\n"; // Title
     cout << "\033[38;5;183m*-------------------------*\033[0m\n"; // Border
     cout << "\033[45m|     1. Start Game      |\033[0m\n"; // Option 1
-    cout << "\033[45m|     2. Save Game       |\033[0m\n"; // Option 2
-    cout << "\033[45m|     3. Load Game       |\033[0m\n"; // Option 3
-    cout << "\033[45m|     4. View Rules      |\033[0m\n"; // Option 4
-    cout << "\033[45m|     5. Exit            |\033[0m\n"; // Option 5
+    cout << "\033[45m|     2. Vs Computer     |\033[0m\n"; // Option 2
+    cout << "\033[45m|     3. Save Game       |\033[0m\n"; // Option 3
+    cout << "\033[45m|     4. Load Game       |\033[0m\n"; // Option 4
+    cout << "\033[45m|     5. View Rules      |\033[0m\n"; // Option 5
+    cout << "\033[45m|     6. Engine Setup    |\033[0m\n"; // Option 6
+    cout << "\033[45m|     7. Suggest Move    |\033[0m\n"; // Option 7
+    cout << "\033[45m|     8. Exit            |\033[0m\n"; // Option 8
     cout << "\n\033[38;5;183mEnter choice: \033[0m"; // Prompt
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Engine options work with every mode (--hash <MB>, --huge-pages, --threads N, --book <file>, --tb <dir> and
+    // --profile-json <file>); all but --threads are taken out of the argument list so each mode only sees its own options.
+    // --spectate <terminal> (repeatable) mirrors the board of interactive games to other terminals, and --journal
+    // <file|none> names their autosave journal.
+    vector<char*> args; // Remaining arguments
+    string bookFile; // Opening book named on the command line
+    string tableDir = TB_DEFAULT_DIR; // Endgame tables (used if the directory has any)
+    int hashMb = TT_DEFAULT_MB; // Transposition table size
+    bool hugePages = false; // Ask the OS to back the table with huge pages
+    string profileFile = PROFILE_DEFAULT_FILE; // Hot-path counters written at exit (profiling builds only)
+    vector<string> spectators; // Terminals showing the board as well
+    string journalFile = JOURNAL_DEFAULT_FILE; // Autosave of interactive games ("none" turns it off)
+    for (int i = 0; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) ENGINE.setThreads(atoi(argv[i + 1])); // Left in place: perft has its own --threads
+        if (arg == "--hash" && i + 1 < argc) hashMb = atoi(argv[++i]);
+        else if (arg == "--huge-pages") hugePages = true;
+        else if (arg == "--book" && i + 1 < argc) bookFile = argv[++i];
+        else if (arg == "--tb" && i + 1 < argc) tableDir = argv[++i];
+        else if (arg == "--profile-json" && i + 1 < argc) profileFile = argv[++i];
+        else if (arg == "--spectate" && i + 1 < argc) spectators.push_back(argv[++i]);
+        else if (arg == "--journal" && i + 1 < argc) journalFile = argv[++i];
+        else args.push_back(argv[i]);
+    }
+    if (!bookFile.empty() && !BOOK.open(bookFile)) cerr << "Cannot open the opening book " << bookFile << "\n";
+    else if (bookFile.empty()) BOOK.open(BOOK_DEFAULT_FILE); // Used if present, no book otherwise
+    TABLEBASES.open(tableDir);
+    profileJsonAtExit(profileFile);
+    if ((hashMb != TT_DEFAULT_MB || hugePages) && !TT.resize(hashMb > 0 ? hashMb : 1, hugePages)) {
+        cerr << "Not enough memory for a " << hashMb << " MB hash table, keeping " << TT.sizeInMb() << " MB\n";
+    }
+    argc = (int)args.size();
+    args.push_back(nullptr); // argv is null-terminated
+    argv = args.data();
+
+    if (argc > 1 && string(argv[1]).compare(0, 7, "--perft") == 0) return perftMain(argc, argv); // Perft mode instead of the menu
+    if (argc > 1 && string(argv[1]) == "--bench") return benchMain(argc, argv); // Engine speed check instead of the menu
+    if (argc > 1 && string(argv[1]) == "--bench-smp") return smpBenchMain(argc, argv); // Thread scaling check
+    if (argc > 1 && string(argv[1]) == "--eval") return evalMain(argc, argv); // Evaluation terms of a position
+    if (argc > 1 && string(argv[1]) == "--bench-simd") return simdBenchMain(argc, argv); // Vector kernels against scalar ones
+    if (argc > 1 && string(argv[1]) == "--alloc-check") return allocCheckMain(argc, argv); // Heap allocations during perft and search
+    if (argc > 1 && string(argv[1]) == "--pgn") return pgnMain(argc, argv); // Replaying and checking a game collection
+    if (argc > 1 && string(argv[1]) == "--validate") return validateMain(argc, argv); // Checking an archive on all cores
+    if (argc > 1 && string(argv[1]).compare(0, 9, "--archive") == 0) return archiveMain(argc, argv); // Binary archive tools
+    if (argc > 1 && string(argv[1]).compare(0, 6, "--book") == 0) return bookMain(argc, argv); // Opening book tools
+    if (argc > 1 && string(argv[1]).compare(0, 5, "--tb-") == 0) return tablebaseMain(argc, argv); // Endgame table tools
+    if (argc > 1 && string(argv[1]) == "--uci") return uciMain(); // Driven by another program over stdin/stdout
+    if (argc > 1 && string(argv[1]) == "--serve") return serverMain(argc, argv); // Many games over a socket
+    if (argc > 1 && string(argv[1]) == "--load-gen") return loadGenMain(argc, argv); // Load test of the game server
+    if (argc > 1 && string(argv[1]) == "--match") return matchMain(argc, argv); // Two engines playing many games at once
     ChessGame game; // Create game object
+    for (const string& path : spectators) {
+        if (!game.addSpectator(path)) cerr << "Cannot open the spectator terminal " << path << "\n";
+    }
+    game.setJournal(journalFile); // Picks up a game a crash interrupted
     int choice; // Store menu choice
     while (true) { // Main loop
         displayMenu(); // Show menu
         cin >> choice; // Get choice
+        if (cin.eof()) return 0; // Input closed (e.g. piped moves ran out)
         cin.ignore(); // Ignore leftover newline
 
         switch (choice) { // Check user input for selected menu option
             case 1: game.start(); break;  // Start game // Exit the case
-            case 2: {  // Save game
+            case 2: game.startVsComputer(); break; // Play against the engine
+            case 3: {  // Save game
                 string filename; // Variable to store the filename
-                cout << "Enter filename to save: ";  // Prompt the user for filename
+                cout << "Enter filename to save (.cgb for the binary format): ";  // Prompt the user for filename
                 getline(cin, filename);  // Get the filename input
                 game.saveGame(filename); // Call the save function with the provided filename
                 break; // Exit the case
             }
-            case 3: { // Load game
+            case 4: { // Load game
                 string filename; // Variable to store the filename
                 cout << "Enter filename to load: "; // Prompt the user for the filename
                 getline(cin, filename);  // Get the filename input
                 game.loadGame(filename);  // Call the load function with the provided filename
                 break;   // Exit the case
             }
-            case 4: game.displayRules(); break; // Show the chess rules   // Exit the case
-            case 5: // Exit the game
+            case 5: game.displayRules(); break; // Show the chess rules   // Exit the case
+            case 6: game.engineSetup(); break; // Change the engine settings
+            case 7: game.suggestMove(); break; // Book moves or an engine hint for the current position
+            case 8: // Exit the game
                 cout << "\n\033[38;5;183m*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++*\033[0m\n";  // Display exit message
                 cout << "\033[45m|     Thank you for playing the Chess! HAVE A NICE DAY      |\033[0m\n"; // Thank the player for playing
                 cout << "\033[38;5;183m*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++*\033[0m\n"; // End of the exit message
@@ -1,80 +1,131 @@
+#ifndef CHESSGAME_H
+#define CHESSGAME_H
+
 #include <iostream> // Include standard input/output stream for console I/O
-#include <vector> // Include vector for dynamic array handling (used for the board and captures)
+#include <vector> // Include vector for dynamic array handling (used for the move history)
 #include <string> // Include string for handling text-based input and data
 #include <fstream> // Include fstream for file input/output (used to save/load game state)
 #include <thread> // Include thread for adding delay
 #include <chrono> // Include chrono to specify duration of delay
+#include "Position.h" // Include the bitboard position core (piece constants, Position struct)
+#include "Move.h" // Include the 16-bit move encoding, MoveList and the move generator
+#include "Render.h" // Include the terminal renderer that draws the board
+#include "Journal.h" // Include the autosave journal
 
-const int BOARD_SIZE = 8;  // Setting the board size to 8x8 for a standard chess game
-const char EMPTY = '.'; // Constants for representing an empty square on the chessboard
-
-// Constants for representing white chess pieces(which is used to define the constant value: once the value is assigned it cannot be changed during the execution)
-const char WHITE_KING = 'K';  // 'K' stands for the white king
-const char WHITE_QUEEN = 'Q'; // 'Q' stands for the white queen
-const char WHITE_ROOK = 'R'; // 'R' stands for the white rook
-const char WHITE_BISHOP = 'B'; // 'B' stands for the white bishop
-const char WHITE_KNIGHT = 'N';// 'N' stands for the white knight
-const char WHITE_PAWN = 'P'; // 'P' stands for the white pawn
-
-// Constants for representing black chess pieces
-const char BLACK_KING = 'k'; // 'k' stands for the black king
-const char BLACK_QUEEN = 'q'; // 'q' stands for the black queen
-const char BLACK_ROOK = 'r'; // 'r' stands for the black rook
-const char BLACK_BISHOP = 'b'; // 'b' stands for the black bishop
-const char BLACK_KNIGHT = 'n'; // 'n' stands for the black knight
-const char BLACK_PAWN = 'p'; // 'p' stands for the black pawn
-
-// Struct to represent a chess piece with its symbol, color, and movement status
+// Struct to represent a chess piece with its symbol and color (a view of one square of the Position)
 struct ChessPiece {
     char symbol; // Character representing the piece (e.g., 'K' for white king)
     bool isWhite; // Storing if the piece is white (true) or black (false)
-    bool hasMoved; // Used to track if a piece has moved (important for castling, etc.)
     ChessPiece(char s = EMPTY, bool color = true); // Constructor to initialize a ChessPiece with a symbol and color  // Default piece is empty, white color
 };
 
+const int MAX_SEARCH_PLY = 128; // Deepest line a lookahead may play on top of the game
+const int MAX_UNDO = 1024; // Capacity of the undo stack (game history plus lookahead)
+const int MAX_GAME_HISTORY = MAX_UNDO - MAX_SEARCH_PLY; // Game moves kept for taking back and repetition checks
+const int FIFTY_MOVE_PLIES = 100; // Half-moves without a capture or pawn move after which the game is drawn (50 moves each)
+const int CHECK_LIMIT = 4; // Custom rule: the game ends when this many checks have been given, the side giving the last one wins
+
+struct SearchLimits; // Search budget (Search.h)
+
+// Symbols of the pieces one side has captured, in a fixed buffer (a side loses at most 15 pieces, its king never).
+struct CaptureList {
+    char pieces[16];
+    int count;
+    CaptureList() : count(0) {}
+    void add(char symbol) { if (count < 16) pieces[count++] = symbol; }
+    void clear() { count = 0; }
+    bool empty() const { return count == 0; }
+    int size() const { return count; }
+    const char* begin() const { return pieces; }
+    const char* end() const { return pieces + count; }
+};
+
+// Everything makeMove overwrites that cannot be worked out again when the move is taken back.
+struct UndoInfo {
+    Move move; // The move that was made
+    uint8_t capturedType; // Type of the captured piece, or NO_PIECE_TYPE
+    uint8_t castlingRights; // Castling rights before the move
+    int8_t enPassantSquare; // En passant square before the move
+    uint16_t halfMoveClock; // Half-move clock before the move
+    uint64_t key; // Zobrist key before the move (also the repetition history)
+};
+
 class ChessBoard { // Defining the ChessBoard class to manage the board and game logic
 private:
-    std::vector<std::vector<ChessPiece>> board; // 2D vector representing the board
-    std::pair<int, int> lastMoveFrom, lastMoveTo; // Stores last move positions
-    bool whiteCanCastleKingside, whiteCanCastleQueenside; // Castling flags for white
-    bool blackCanCastleKingside, blackCanCastleQueenside; // Castling flags for black
-    int halfMoveClock; // For draw rules like 50-move rule
-    int fullMoveNumber; // Move counter (used in PGN and game state)
+    Position pos; // Bitboard position: pieces, castling rights, en passant square, side to move and clocks
+    UndoInfo undoStack[MAX_UNDO]; // One record per move made and not yet taken back
+    int undoCount; // Number of records on the undo stack
 
     bool isValidPosition(int row, int col) const; // Helper functions for move validation and other game rules
-    std::pair<int, int> findKing(bool isWhite) const;  // Checking if a position is on the board
-    bool isPathClear(int fromRow, int fromCol, int toRow, int toCol) const; // Checking if a path is clear for sliding pieces
-    bool canPieceAttack(const ChessPiece& piece, int fromRow, int fromCol, int toRow, int toCol) const; // Checking if a piece can attack a square
-    bool isValidMove(const ChessPiece& piece, int fromRow, int fromCol, int toRow, int toCol); // Checking if a move is valid
 
 public:
     ChessBoard(); // Constructor for initializing the board
     void resetBoard();  // Function to reset the board to the starting position
-    void displayBoard(const std::vector<char>& whiteCaptures, const std::vector<char>& blackCaptures) const;   // Function to display the board on the console, including captured pieces
+    ChessPiece pieceAt(int row, int col) const; // Getting the piece standing on a square
+    bool isWhiteToMove() const; // Checking whose turn it is in the current position
     bool isKingInCheck(bool isWhite) const; // Checking if a king is in check
-    bool movePiece(std::string move, bool isWhiteTurn, char promotion,
-                  std::vector<char>& whiteCaptures, std::vector<char>& blackCaptures); // Moving a piece on the board, including special moves like promotions and castling
+    void generateMoves(MoveList& list) const; // Writing all legal moves for the side to move into a stack buffer
+    void generatePseudoLegalMoves(MoveList& list) const; // Writing all moves that follow the piece rules, ignoring pins and checks
+    char makeMove(Move move); // Playing a legal move and pushing its undo record, returning the captured symbol
+    void unmakeMove(); // Taking back the last move made with makeMove
+    void makeNullMove(); // Passing the turn without moving (search only, never legal in a game)
+    void unmakeNullMove(); // Taking back makeNullMove
+    char playMove(Move move); // Making a legal game move (keeps the undo history bounded however long the game runs)
+    char playMove(Move move, CaptureList& whiteCaptures, CaptureList& blackCaptures); // Making a legal game move and recording its capture
+    Move parseMove(const std::string& text, int defaultPromotion = QUEEN) const; // Legal move named by "e2e4", "e7e8q", "e2 e4" or "e7 e8=Q" (MOVE_NONE if none)
+    bool movePiece(const std::string& move, bool isWhiteTurn, char promotion,
+                  CaptureList& whiteCaptures, CaptureList& blackCaptures); // Moving a piece on the board, including special moves like promotions and castling
     bool isCheckmate(bool isWhite); // Checking if the current game state is checkmate
     bool isStalemate(bool isWhite); // Checking if the current game state is stalemate
-    bool isDraw() const; // Checking if the game is a draw (including stalemate and 50-move rule)
+    bool isDraw() const; // Checking if the game is a draw (50-move rule or threefold repetition)
+    int repetitionCount() const; // Number of earlier occurrences of the current position since the last capture or pawn move
+    uint64_t positionKey() const; // Zobrist key of the current position
+    const Position& position() const { return pos; } // Read-only view of the position (for the search and evaluation)
+    Move bestMove(const SearchLimits& limits, int checkCount) const; // Asking the engine for a move ('checkCount' checks already given)
     bool hasLegalMoves(bool isWhite);  // Checking if the current player has any legal moves left
-    void saveGame(const std::string& filename); // Saving the current game state to a file
-    void loadGame(const std::string& filename);  // Loading a previously saved game from a file
+    bool saveGame(const std::string& filename) const; // Saving the current position to a file as FEN (false if it cannot be written)
+    bool loadGame(const std::string& filename);  // Loading a FEN or older board-layout save (false and unchanged on error)
+    bool loadFen(const std::string& fen); // Setting up a position from FEN (false and unchanged if the FEN is malformed)
+    void setPosition(const Position& position); // Setting up a position directly (e.g. one unpacked from an archive)
+    std::string toFen() const; // Current position in Forsyth-Edwards Notation
 };
 
 class ChessGame { // Defining the ChessGame class to manage the game flow (turns, rules, etc.)
 private:
     ChessBoard board; // A ChessBoard object to manage the board state
     bool whiteTurn; // Boolean to keep track of whose turn it is (true for white, false for black)
-    std::vector<char> whiteCaptures; // Vector to store white's captured pieces
-    std::vector<char> blackCaptures; // Vector to store black's captured pieces
+    CaptureList whiteCaptures; // White's captured pieces
+    CaptureList blackCaptures; // Black's captured pieces
     int checkCount;  // Counter for how many times a player has been in check
+    int computerColor; // Color the engine plays, or COLOR_NB when two humans play
+    int engineMoveTimeMs; // Thinking time per engine move
+    Position startPosition; // Position the current game started from (start position or the loaded one)
+    std::vector<Move> moveHistory; // Every move played since then, for the binary save
+    BoardRenderer renderer; // Draws the board, redrawing only what changed
+    std::string notice; // Status line of the next frame (the last move, check, invalid input)
+    Journal journal; // Autosave: every move of the game being played
+    std::string journalFile; // Where the journal is kept (empty: no autosave)
+    int pliesSinceSnapshot; // Moves journaled since the last snapshot
+
+    void playGame(); // Game loop shared by both modes: one move per turn from the player or the engine
+    bool saveArchive(const std::string& filename) const; // Writing the game (start, moves and current position) as a .cgb archive
+    bool loadArchive(const std::string& filename); // Replaying the first game of a .cgb archive (false and unchanged on error)
+    bool isGameOver(); // Announcing check, the N-check win, checkmate, stalemate or a draw after a move (true if the game ended)
+    bool journalState(JournalSnapshotRecord& state) const; // The whole game state as a journal snapshot (false if it cannot be packed)
+    void startJournal(); // Writing the game so far to a fresh journal when play starts
+    void journalMove(Move move, bool gameOver); // Appending a move (and a snapshot when one is due) to the journal
 
 public:
     ChessGame();  // Constructor to initialize the game
     void displayWelcomeMessage(); // Displaying the welcome message when starting the game
     void displayRules(); // Displaying the game rules for the player
+    bool addSpectator(const std::string& path) { return renderer.addSpectator(path); } // Mirroring the board to another terminal
+    void setJournal(const std::string& filename); // Autosaving to this journal ("none": off), first recovering an unfinished game from it
+    bool recoverJournal(); // Rebuilding an unfinished game from the journal (false and unchanged if there is none)
     void start();  // Starting and managing the game loop
+    void startVsComputer(); // Starting a game against the engine
+    void engineSetup(); // Changing the engine's hash table size, thread count and opening book
+    void suggestMove(); // Showing the book moves for the current position, or the engine's choice out of book
     void saveGame(const std::string& filename); // Saving the current game state
     void loadGame(const std::string& filename); // Loading a saved game state
 };
@@ -82,5 +133,7 @@ public:
 // Defining a global function to display the main menu options
 void displayMenu(); // Function prototype for the menu, definition to be provided elsewhere
 
+#endif
+
 // ChessGame.cpp
 // Implementation of the chess game logic.
@@ -0,0 +1,272 @@
+// Eval.cpp
+// Implementation of the tapered evaluation, the pawn-structure cache and the --eval breakdown.
+#include <chrono> // Include chrono for timing evaluations
+#include <iomanip> // Include iomanip for the breakdown table
+#include <iostream> // Include iostream for the breakdown
+#include <memory> // Include memory for the heap-allocated cache
+#include <mutex> // Include mutex for call_once
+#include "Eval.h" // Evaluation declarations
+#include "ChessGame.h" // ChessBoard for setting up FEN positions
+#include "Profile.h" // Optional timing of evaluate
+using namespace std;
+
+int16_t PIECE_SQUARE[PHASE_NB][COLOR_NB][PIECE_TYPE_NB][SQUARE_NB]; // Material plus square bonus, positive for White
+
+// Square bonuses from White's side, laid out as the board is printed: the first row is rank 8 (squares a8..h8),
+// which is also how squares are numbered, so White reads entry 'sq' and Black the mirrored entry 'sq ^ 56'.
+static const int8_t PAWN_MG[SQUARE_NB] = {
+     0,   0,   0,   0,   0,   0,   0,   0,
+    50,  50,  50,  50,  50,  50,  50,  50,
+    10,  10,  20,  30,  30,  20,  10,  10,
+     5,   5,  10,  25,  25,  10,   5,   5,
+     0,   0,   0,  20,  20,   0,   0,   0,
+     5,  -5, -10,   0,   0, -10,  -5,   5,
+     5,  10,  10, -20, -20,  10,  10,   5,
+     0,   0,   0,   0,   0,   0,   0,   0};
+static const int8_t PAWN_EG[SQUARE_NB] = { // Advancing matters more than the file once the pieces are gone
+     0,   0,   0,   0,   0,   0,   0,   0,
+    70,  70,  70,  70,  70,  70,  70,  70,
+    45,  45,  45,  45,  45,  45,  45,  45,
+    25,  25,  25,  25,  25,  25,  25,  25,
+    12,  12,  12,  12,  12,  12,  12,  12,
+     4,   4,   4,   4,   4,   4,   4,   4,
+     0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0};
+static const int8_t KNIGHT_PSQ[SQUARE_NB] = {
+   -50, -40, -30, -30, -30, -30, -40, -50,
+   -40, -20,   0,   0,   0,   0, -20, -40,
+   -30,   0,  10,  15,  15,  10,   0, -30,
+   -30,   5,  15,  20,  20,  15,   5, -30,
+   -30,   0,  15,  20,  20,  15,   0, -30,
+   -30,   5,  10,  15,  15,  10,   5, -30,
+   -40, -20,   0,   5,   5,   0, -20, -40,
+   -50, -40, -30, -30, -30, -30, -40, -50};
+static const int8_t BISHOP_PSQ[SQUARE_NB] = {
+   -20, -10, -10, -10, -10, -10, -10, -20,
+   -10,   0,   0,   0,   0,   0,   0, -10,
+   -10,   0,   5,  10,  10,   5,   0, -10,
+   -10,   5,   5,  10,  10,   5,   5, -10,
+   -10,   0,  10,  10,  10,  10,   0, -10,
+   -10,  10,  10,  10,  10,  10,  10, -10,
+   -10,   5,   0,   0,   0,   0,   5, -10,
+   -20, -10, -10, -10, -10, -10, -10, -20};
+static const int8_t ROOK_MG[SQUARE_NB] = {
+     0,   0,   0,   0,   0,   0,   0,   0,
+     5,  10,  10,  10,  10,  10,  10,   5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+     0,   0,   0,   5,   5,   0,   0,   0};
+static const int8_t ROOK_EG[SQUARE_NB] = { // Only the seventh rank still counts
+     0,   0,   0,   0,   0,   0,   0,   0,
+    10,  10,  10,  10,  10,  10,  10,  10,
+     0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0};
+static const int8_t QUEEN_PSQ[SQUARE_NB] = {
+   -20, -10, -10,  -5,  -5, -10, -10, -20,
+   -10,   0,   0,   0,   0,   0,   0, -10,
+   -10,   0,   5,   5,   5,   5,   0, -10,
+    -5,   0,   5,   5,   5,   5,   0,  -5,
+     0,   0,   5,   5,   5,   5,   0,  -5,
+   -10,   5,   5,   5,   5,   5,   0, -10,
+   -10,   0,   5,   0,   0,   0,   0, -10,
+   -20, -10, -10,  -5,  -5, -10, -10, -20};
+static const int8_t KING_MG[SQUARE_NB] = { // Sheltered behind the pawns while there is material to attack it
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -20, -30, -30, -40, -40, -30, -30, -20,
+   -10, -20, -20, -20, -20, -20, -20, -10,
+    20,  20,   0,   0,   0,   0,  20,  20,
+    20,  30,  10,   0,   0,  10,  30,  20};
+static const int8_t KING_EG[SQUARE_NB] = { // Active in the centre once it is safe
+   -50, -40, -30, -20, -20, -30, -40, -50,
+   -30, -20, -10,   0,   0, -10, -20, -30,
+   -30, -10,  20,  30,  30,  20, -10, -30,
+   -30, -10,  30,  40,  40,  30, -10, -30,
+   -30, -10,  30,  40,  40,  30, -10, -30,
+   -30, -10,  20,  30,  30,  20, -10, -30,
+   -30, -30,   0,   0,   0,   0, -30, -30,
+   -50, -30, -30, -30, -30, -30, -30, -50};
+
+static const int8_t* const SQUARE_BONUS[PHASE_NB][PIECE_TYPE_NB] = {
+    {PAWN_MG, KNIGHT_PSQ, BISHOP_PSQ, ROOK_MG, QUEEN_PSQ, KING_MG},
+    {PAWN_EG, KNIGHT_PSQ, BISHOP_PSQ, ROOK_EG, QUEEN_PSQ, KING_EG}};
+
+// Pawn structure, per pawn: a second pawn on a file, no friendly pawn on the files next to it, and no enemy pawn
+// in front of it on its own or the neighbouring files (by how far it has come, counted from its first rank).
+const int DOUBLED_PAWN[PHASE_NB] = {-10, -25};
+const int ISOLATED_PAWN[PHASE_NB] = {-12, -18};
+const int PASSED_PAWN[PHASE_NB][BOARD_SIZE] = {
+    {0, 2, 5, 10, 20, 35, 55, 0},
+    {0, 8, 12, 25, 45, 75, 110, 0}};
+
+static Bitboard ADJACENT_FILES[BOARD_SIZE]; // Files next to each file
+static Bitboard PASSED_SPAN[COLOR_NB][SQUARE_NB]; // Squares in front of a pawn on its own and the adjacent files
+
+static void buildEvalTables() {
+    for (int phase = 0; phase < PHASE_NB; phase++)
+        for (int type = 0; type < PIECE_TYPE_NB; type++)
+            for (int sq = 0; sq < SQUARE_NB; sq++) {
+                int value = MATERIAL_VALUES[phase][type];
+                PIECE_SQUARE[phase][WHITE][type][sq] = int16_t(value + SQUARE_BONUS[phase][type][sq]);
+                PIECE_SQUARE[phase][BLACK][type][sq] = int16_t(-(value + SQUARE_BONUS[phase][type][sq ^ 56])); // Mirrored rank
+            }
+    for (int col = 0; col < BOARD_SIZE; col++) {
+        ADJACENT_FILES[col] = (col > 0 ? FILE_A_BB << (col - 1) : 0) | (col < BOARD_SIZE - 1 ? FILE_A_BB << (col + 1) : 0);
+    }
+    for (int sq = 0; sq < SQUARE_NB; sq++) {
+        Bitboard files = ADJACENT_FILES[colOf(sq)] | (FILE_A_BB << colOf(sq));
+        Bitboard above = 0, below = 0; // Rows towards rank 8 (White's way) and towards rank 1 (Black's way)
+        for (int row = 0; row < rowOf(sq); row++) above |= rowBB(row);
+        for (int row = rowOf(sq) + 1; row < BOARD_SIZE; row++) below |= rowBB(row);
+        PASSED_SPAN[WHITE][sq] = files & above;
+        PASSED_SPAN[BLACK][sq] = files & below;
+    }
+}
+
+void initEvalTables() {
+    static once_flag built; // The tables only need to be built once per run, whichever thread gets here first
+    call_once(built, buildEvalTables);
+}
+
+// Pawn-structure score of one color (positive is good for that color).
+static void pawnTerms(const Position& pos, int color, int score[PHASE_NB]) {
+    Bitboard ours = pos.pieces(color, PAWN), theirs = pos.pieces(color ^ 1, PAWN);
+    score[MIDDLEGAME] = score[ENDGAME] = 0;
+    for (int col = 0; col < BOARD_SIZE; col++) { // Doubled and isolated pawns go file by file
+        int onFile = popCount(ours & (FILE_A_BB << col));
+        if (onFile == 0) continue;
+        bool isolated = !(ours & ADJACENT_FILES[col]);
+        for (int phase = 0; phase < PHASE_NB; phase++) {
+            score[phase] += (onFile - 1) * DOUBLED_PAWN[phase];
+            if (isolated) score[phase] += onFile * ISOLATED_PAWN[phase];
+        }
+    }
+    for (Bitboard b = ours; b; ) { // Passed pawns one by one
+        int sq = popLsb(b);
+        if (PASSED_SPAN[color][sq] & theirs) continue;
+        Bitboard ahead = PASSED_SPAN[color][sq] & (FILE_A_BB << colOf(sq));
+        if (ahead & ours) continue; // The rear pawn of a doubled pair is not passed itself
+        int advance = color == WHITE ? BOARD_SIZE - 1 - rowOf(sq) : rowOf(sq); // 1 on the starting rank, 6 one step from promoting
+        for (int phase = 0; phase < PHASE_NB; phase++) score[phase] += PASSED_PAWN[phase][advance];
+    }
+}
+
+void PawnTable::clear() {
+    for (int i = 0; i < PAWN_TABLE_SIZE; i++) entries[i] = PawnEntry{0, {0, 0}}; // Key 0 with score 0 is also right for "no pawns"
+}
+
+const PawnEntry& PawnTable::probe(const Position& pos) {
+    PawnEntry& e = entries[pos.pawnKey & (PAWN_TABLE_SIZE - 1)];
+    if (e.key == pos.pawnKey) return e;
+    int white[PHASE_NB], black[PHASE_NB];
+    pawnTerms(pos, WHITE, white);
+    pawnTerms(pos, BLACK, black);
+    e.key = pos.pawnKey;
+    for (int phase = 0; phase < PHASE_NB; phase++) e.score[phase] = int16_t(white[phase] - black[phase]);
+    return e;
+}
+
+// Blending the two sums: all middlegame with the full set of pieces, all endgame with only kings and pawns left.
+static int taper(int mg, int eg, int phase) {
+    if (phase > MAX_PHASE) phase = MAX_PHASE;
+    return (mg * phase + eg * (MAX_PHASE - phase)) / MAX_PHASE;
+}
+
+int evaluate(const Position& pos, PawnTable& pawns) {
+    PROFILE_SCOPE(PROFILE_EVALUATE);
+    const PawnEntry& pawn = pawns.probe(pos);
+    int score = taper(pos.psqScore[MIDDLEGAME] + pawn.score[MIDDLEGAME], pos.psqScore[ENDGAME] + pawn.score[ENDGAME], pos.phase);
+    return pos.sideToMove == WHITE ? score : -score;
+}
+
+void evaluateTerms(const Position& pos, EvalTerms& terms) {
+    terms.phase = 0;
+    for (int color = 0; color < COLOR_NB; color++) {
+        for (int phase = 0; phase < PHASE_NB; phase++) terms.material[color][phase] = terms.pieceSquare[color][phase] = 0;
+        for (int type = 0; type < PIECE_TYPE_NB; type++) {
+            for (Bitboard b = pos.pieces(color, type); b; ) {
+                int sq = popLsb(b);
+                for (int phase = 0; phase < PHASE_NB; phase++) {
+                    terms.material[color][phase] += MATERIAL_VALUES[phase][type];
+                    terms.pieceSquare[color][phase] += SQUARE_BONUS[phase][type][color == WHITE ? sq : sq ^ 56];
+                }
+                terms.phase += PHASE_WEIGHTS[type];
+            }
+        }
+        pawnTerms(pos, color, terms.pawns[color]);
+    }
+    int total[PHASE_NB];
+    for (int phase = 0; phase < PHASE_NB; phase++) {
+        total[phase] = 0;
+        for (int color = 0; color < COLOR_NB; color++) {
+            int sign = color == WHITE ? 1 : -1;
+            total[phase] += sign * (terms.material[color][phase] + terms.pieceSquare[color][phase] + terms.pawns[color][phase]);
+        }
+    }
+    terms.score = taper(total[MIDDLEGAME], total[ENDGAME], terms.phase);
+}
+
+// One row of the breakdown: both colors and the difference, middlegame and endgame.
+static void printTermRow(const char* name, const int values[COLOR_NB][PHASE_NB]) {
+    cout << left << setw(16) << name << right;
+    for (int color = 0; color < COLOR_NB; color++) cout << setw(7) << values[color][MIDDLEGAME] << setw(6) << values[color][ENDGAME];
+    cout << setw(7) << values[WHITE][MIDDLEGAME] - values[BLACK][MIDDLEGAME] << setw(6) << values[WHITE][ENDGAME] - values[BLACK][ENDGAME] << "\n";
+}
+
+// Usage: ChessGame --eval [--fen <FEN>]
+int evalMain(int argc, char* argv[]) {
+    string fen = START_FEN;
+    for (int i = 2; i < argc; i++) {
+        if (string(argv[i]) == "--fen") { // One quoted argument or the six fields
+            fen.clear();
+            while (i + 1 < argc && string(argv[i + 1]).compare(0, 2, "--") != 0) fen += string(fen.empty() ? "" : " ") + argv[++i];
+        }
+    }
+    ChessBoard board;
+    if (!board.loadFen(fen)) {
+        cerr << "Invalid FEN: " << fen << "\n";
+        return 2;
+    }
+    const Position& pos = board.position();
+    EvalTerms terms;
+    evaluateTerms(pos, terms);
+
+    cout << "Position: " << pos.toFen() << "\n";
+    cout << "Phase: " << terms.phase << " of " << MAX_PHASE << " (" << (terms.phase < MAX_PHASE ? terms.phase : MAX_PHASE) * 100 / MAX_PHASE
+         << "% middlegame)\n\n";
+    cout << left << setw(16) << "Term" << right << setw(13) << "White mg/eg" << setw(13) << "Black mg/eg" << setw(13) << "Total mg/eg" << "\n";
+    printTermRow("Material", terms.material);
+    printTermRow("Piece squares", terms.pieceSquare);
+    printTermRow("Pawn structure", terms.pawns);
+    cout << "\nScore: " << showpos << terms.score << " for White, " << (pos.sideToMove == WHITE ? terms.score : -terms.score)
+         << " for the side to move" << noshowpos << "\n";
+
+    // The incremental sums must match the scratch computation, or make/unmake is losing track of a piece.
+    int mg = 0, eg = 0;
+    for (int color = 0; color < COLOR_NB; color++) {
+        int sign = color == WHITE ? 1 : -1;
+        mg += sign * (terms.material[color][MIDDLEGAME] + terms.pieceSquare[color][MIDDLEGAME]);
+        eg += sign * (terms.material[color][ENDGAME] + terms.pieceSquare[color][ENDGAME]);
+    }
+    bool match = mg == pos.psqScore[MIDDLEGAME] && eg == pos.psqScore[ENDGAME] && terms.phase == pos.phase;
+    cout << "Incremental sums: " << (match ? "match" : "MISMATCH") << "\n";
+
+    unique_ptr<PawnTable> pawns(new PawnTable()); // Warm cache, as in a search
+    const int REPEATS = 1000000;
+    volatile int sink = 0; // Keeps the calls from being optimised away
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < REPEATS; i++) sink += evaluate(pos, *pawns);
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / REPEATS;
+    cout << "Evaluation time: " << fixed << setprecision(1) << ns << " ns (pawn cache warm)\n";
+    cout.unsetf(ios::fixed);
+    return match ? 0 : 1;
+}
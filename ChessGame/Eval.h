@@ -0,0 +1,59 @@
+// Eval.h
+// Static evaluation: material and piece-square tables with separate middlegame and endgame values, blended by how
+// much material is left (a tapered evaluation), plus a pawn-structure term. The material and piece-square sums are
+// kept up to date by Position::putPiece/removePiece/relocatePiece, and the pawn term is cached by the pawn-only key,
+// so evaluating a leaf is a blend and one cache lookup instead of a pass over the board.
+#ifndef EVAL_H
+#define EVAL_H
+
+#include <cstdint> // Include cstdint for the cache entries
+#include "Position.h" // Include the position and its incremental score fields
+
+enum GamePhase { MIDDLEGAME, ENDGAME, PHASE_NB }; // The two sets of values a tapered evaluation blends
+
+const int PHASE_WEIGHTS[PIECE_TYPE_NB] = {0, 1, 1, 2, 4, 0}; // How much each piece counts towards the middlegame
+const int MAX_PHASE = 24; // Phase of the full set of pieces (more, after promotions, counts as the full set)
+
+const int MATERIAL_VALUES[PHASE_NB][PIECE_TYPE_NB] = { // Centipawns; pawns gain and minor pieces lose in the endgame
+    {82, 337, 365, 477, 1025, 0},
+    {94, 281, 297, 512, 936, 0}};
+
+// Material plus square bonus of a piece, positive for White and negative for Black, so a position's sums are the
+// plain total over its pieces. Filled once by initEvalTables().
+extern int16_t PIECE_SQUARE[PHASE_NB][COLOR_NB][PIECE_TYPE_NB][SQUARE_NB];
+
+void initEvalTables(); // Filling the tables above (safe to call more than once and from any thread)
+
+// Pawn-structure cache: pawn structures repeat far more than whole positions, so nearly every lookup is a hit.
+// Each search thread has its own table, so there is no locking.
+struct PawnEntry {
+    uint64_t key; // Position::pawnKey of the structure (0 = unused slot)
+    int16_t score[PHASE_NB]; // Pawn-structure score, White minus Black
+};
+
+const int PAWN_TABLE_SIZE = 8192; // Entries per table (a power of two), 128 KB
+
+class PawnTable {
+private:
+    PawnEntry entries[PAWN_TABLE_SIZE];
+
+public:
+    PawnTable() { clear(); }
+    void clear(); // Emptying every slot
+    const PawnEntry& probe(const Position& pos); // Entry of the position's pawn structure, computed on a miss
+};
+
+// Every term from scratch, per color and phase, for --eval and for checking the incremental sums.
+struct EvalTerms {
+    int material[COLOR_NB][PHASE_NB];
+    int pieceSquare[COLOR_NB][PHASE_NB]; // Square bonuses without the material
+    int pawns[COLOR_NB][PHASE_NB]; // Pawn structure
+    int phase; // 0 (bare kings and pawns) to MAX_PHASE
+    int score; // Blended total from White's point of view
+};
+
+int evaluate(const Position& pos, PawnTable& pawns); // Score for the side to move, in centipawns
+void evaluateTerms(const Position& pos, EvalTerms& terms); // The same score term by term, without the incremental sums
+int evalMain(int argc, char* argv[]); // Command-line entry for --eval: the term breakdown of a position
+
+#endif
@@ -0,0 +1,243 @@
+// Journal.cpp
+// Implementation of the game journal:
+//
+//   game thread --(records into the buffer, O(1) per move)--> writer thread --(one write and one fsync per batch)--> file
+//
+// The writer waits JOURNAL_COMMIT_MS after the first record of a batch so that records arriving close together (a
+// move, the engine's reply, a snapshot) reach the disk with a single sync.
+#include <cerrno> // Include cerrno for EINTR
+#include <chrono> // Include chrono for the group commit window
+#include <cstring> // Include cstring for memcpy and memcmp
+#include <fstream> // Include fstream for reading a journal back
+#include <iterator> // Include iterator for reading the whole file
+#include "Journal.h" // Journal declarations
+using namespace std;
+
+static_assert(sizeof(JournalHeader) == 64, "journal header layout");
+static_assert(sizeof(JournalMoveRecord) == 16, "journal move record layout");
+static_assert(sizeof(JournalSnapshotRecord) == 80, "journal snapshot record layout");
+
+#ifdef _WIN32
+#include <fcntl.h> // Include fcntl.h for the open flags
+#include <io.h> // Include io.h for _open, _write and _commit
+#include <cstdio> // Include cstdio for remove and rename
+
+static int createFile(const string& name) { return _open(name.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644); }
+static long writeSome(int fd, const char* data, size_t count) { return _write(fd, data, (unsigned)count); }
+static bool syncFile(int fd) { return _commit(fd) == 0; }
+static void closeFile(int fd) { _close(fd); }
+static bool replaceFile(const string& from, const string& to) { // rename does not replace an existing file on Windows
+    remove(to.c_str());
+    return rename(from.c_str(), to.c_str()) == 0;
+}
+#else
+#include <cstdio> // Include cstdio for rename
+#include <fcntl.h> // Include fcntl.h for open
+#include <unistd.h> // Include unistd.h for write, fsync and close
+
+static int createFile(const string& name) { return open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); }
+static long writeSome(int fd, const char* data, size_t count) { return (long)write(fd, data, count); }
+static bool syncFile(int fd) {
+#ifdef __linux__
+    return fdatasync(fd) == 0; // The data and the file size, not the timestamps
+#else
+    return fsync(fd) == 0;
+#endif
+}
+static void closeFile(int fd) { close(fd); }
+static bool replaceFile(const string& from, const string& to) {
+    if (rename(from.c_str(), to.c_str()) != 0) return false;
+    size_t slash = to.rfind('/'); // Syncing the directory makes the new name itself survive a crash
+    int directory = open(slash == string::npos ? "." : to.substr(0, slash + 1).c_str(), O_RDONLY | O_CLOEXEC);
+    if (directory >= 0) {
+        fsync(directory);
+        close(directory);
+    }
+    return true;
+}
+#endif
+
+static bool writeAll(int fd, const char* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        long wrote = writeSome(fd, data + done, size - done);
+        if (wrote < 0 && errno == EINTR) continue;
+        if (wrote <= 0) return false;
+        done += size_t(wrote);
+    }
+    return true;
+}
+
+static uint32_t recordChecksum(const void* record, size_t size) { // FNV-1a over everything after the checksum field
+    const uint8_t* bytes = (const uint8_t*)record;
+    uint32_t hash = 2166136261u;
+    for (size_t i = sizeof(uint32_t); i < size; i++) hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+static void seal(void* record, size_t size, uint32_t sequence) { // Numbering a record and setting its checksum
+    memcpy((char*)record + sizeof(uint32_t), &sequence, sizeof(sequence));
+    uint32_t checksum = recordChecksum(record, size);
+    memcpy(record, &checksum, sizeof(checksum));
+}
+
+static size_t recordSize(uint8_t type) { // 0 for an unknown type
+    return type == JOURNAL_SNAPSHOT ? sizeof(JournalSnapshotRecord) : type == JOURNAL_MOVE || type == JOURNAL_END ? sizeof(JournalMoveRecord) : 0;
+}
+
+bool readJournal(const string& filename, JournalContents& contents) {
+    ifstream file(filename.c_str(), ios::binary);
+    if (!file) return false;
+    vector<char> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    JournalHeader header;
+    if (data.size() < sizeof(header)) return false;
+    memcpy(&header, data.data(), sizeof(header));
+    if (memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0 || header.version != JOURNAL_VERSION || header.headerSize != sizeof(header)) return false;
+    unpackPosition(header.start, contents.start);
+    contents.moves.clear();
+    contents.hasSnapshot = false;
+    contents.finished = false;
+    size_t offset = sizeof(header);
+    for (uint32_t sequence = 0; offset < data.size() && !contents.finished; sequence++) { // Up to the first damaged or cut-off record
+        size_t size = offset + 8 < data.size() ? recordSize(uint8_t(data[offset + 8])) : 0; // The type byte follows checksum and number
+        if (!size || data.size() - offset < size) break;
+        uint32_t checksum, number;
+        memcpy(&checksum, &data[offset], sizeof(checksum));
+        memcpy(&number, &data[offset + 4], sizeof(number));
+        if (checksum != recordChecksum(&data[offset], size) || number != sequence) break;
+        uint8_t type = uint8_t(data[offset + 8]);
+        if (type == JOURNAL_SNAPSHOT) {
+            JournalSnapshotRecord snapshot;
+            memcpy(&snapshot, &data[offset], size);
+            if (snapshot.plies != contents.moves.size()) break; // Written after exactly the moves before it
+            contents.snapshot = snapshot;
+            contents.hasSnapshot = true;
+        } else {
+            JournalMoveRecord record;
+            memcpy(&record, &data[offset], size);
+            if (type == JOURNAL_END) contents.finished = true;
+            else contents.moves.push_back(record.move);
+        }
+        offset += size;
+    }
+    contents.validBytes = offset;
+    return true;
+}
+
+Journal::Journal() : fd(-1), sequence(0), buffered(0), added(0), committed(0), stopping(false), failed(false) {}
+
+Journal::~Journal() {
+    close();
+}
+
+bool Journal::create(const string& filename, const Position& start, const vector<Move>& moves, const JournalSnapshotRecord& state) {
+    close();
+    JournalHeader header = JournalHeader();
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    header.headerSize = sizeof(header);
+    if (!packPosition(start, header.start)) return false;
+    vector<char> data((const char*)&header, (const char*)&header + sizeof(header)); // Written in one go, before the game goes on
+    uint32_t number = 0;
+    for (Move move : moves) {
+        JournalMoveRecord record = JournalMoveRecord();
+        record.type = JOURNAL_MOVE;
+        record.move = move;
+        seal(&record, sizeof(record), number++);
+        data.insert(data.end(), (const char*)&record, (const char*)&record + sizeof(record));
+    }
+    JournalSnapshotRecord snapshot = state;
+    snapshot.type = JOURNAL_SNAPSHOT;
+    seal(&snapshot, sizeof(snapshot), number++);
+    data.insert(data.end(), (const char*)&snapshot, (const char*)&snapshot + sizeof(snapshot));
+
+    string temporary = filename + ".new";
+    int file = createFile(temporary);
+    if (file < 0) return false;
+    if (!writeAll(file, data.data(), data.size()) || !syncFile(file) || !replaceFile(temporary, filename)) {
+        closeFile(file);
+        remove(temporary.c_str());
+        return false;
+    }
+    fd = file; // Still open after the rename: appends go to the journal under its real name
+    sequence = number;
+    writer = thread(&Journal::writeBatches, this);
+    return true;
+}
+
+void Journal::append(void* record, size_t size) {
+    if (fd < 0) return;
+    seal(record, size, sequence++);
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [&]() { return buffered + size <= JOURNAL_BUFFER_BYTES || failed; }); // Full only if the disk is far behind
+    if (failed) return;
+    memcpy(buffer + buffered, record, size);
+    buffered += size;
+    added++;
+    work.notify_one();
+}
+
+void Journal::addMove(Move move) {
+    JournalMoveRecord record = JournalMoveRecord();
+    record.type = JOURNAL_MOVE;
+    record.move = move;
+    append(&record, sizeof(record));
+}
+
+void Journal::addSnapshot(const JournalSnapshotRecord& state) {
+    JournalSnapshotRecord record = state;
+    record.type = JOURNAL_SNAPSHOT;
+    append(&record, sizeof(record));
+}
+
+void Journal::addEnd() {
+    JournalMoveRecord record = JournalMoveRecord();
+    record.type = JOURNAL_END;
+    append(&record, sizeof(record));
+}
+
+void Journal::writeBatches() {
+    char batch[JOURNAL_BUFFER_BYTES];
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        work.wait(guard, [&]() { return buffered > 0 || stopping; });
+        if (!buffered) break; // Stopping with nothing left to write
+        if (!stopping) { // Group commit: whatever else arrives in the window shares this sync
+            work.wait_for(guard, chrono::milliseconds(JOURNAL_COMMIT_MS), [&]() { return stopping || buffered > JOURNAL_BUFFER_BYTES / 2; });
+        }
+        size_t size = buffered;
+        uint64_t upTo = added;
+        memcpy(batch, buffer, size);
+        buffered = 0;
+        done.notify_all(); // Room in the buffer again
+        guard.unlock();
+        bool written = !failed && writeAll(fd, batch, size) && syncFile(fd);
+        guard.lock();
+        if (written) committed = upTo;
+        else failed = true;
+        done.notify_all();
+    }
+}
+
+bool Journal::sync() {
+    if (fd < 0) return false;
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [&]() { return committed == added || failed; });
+    return !failed;
+}
+
+void Journal::close() {
+    if (fd < 0) return;
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    work.notify_all();
+    writer.join(); // Writes what is left first
+    closeFile(fd);
+    fd = -1;
+    sequence = 0;
+    buffered = 0;
+    added = committed = 0;
+    stopping = failed = false;
+}
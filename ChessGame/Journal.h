@@ -0,0 +1,109 @@
+// Journal.h
+// Autosave of the game being played: an append-only file of fixed-size binary records, one per move, with a
+// snapshot of the whole game state (position, checks given, captured pieces) every so often. Saving a move costs the
+// same however long the game is: the record is copied into a buffer and a background thread writes and syncs
+// whatever has gathered, so moves arriving together share one fsync (group commit) and the game never waits for
+// the disk. After a crash the game is rebuilt from the last snapshot plus the moves after it; a record cut off by
+// the crash fails its checksum and is ignored.
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <condition_variable> // Include condition_variable for waking the writer thread
+#include <cstdint> // Include cstdint for the fixed-width record fields
+#include <mutex> // Include mutex for the record buffer
+#include <string> // Include string for file names
+#include <thread> // Include thread for the writer thread
+#include <vector> // Include vector for the moves read back
+#include "Archive.h" // Include the 32-byte packed position used by snapshots
+
+const char JOURNAL_MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'J', 'N', 'L'}; // First bytes of every journal
+const uint32_t JOURNAL_VERSION = 1;
+const char* const JOURNAL_DEFAULT_FILE = "ChessGame.journal"; // Written next to the program unless --journal names another file
+const int JOURNAL_SNAPSHOT_PLIES = 32; // Moves between snapshots (taken at the next capture or pawn move after this many)
+const int JOURNAL_COMMIT_MS = 5; // How long the writer waits for more records before syncing a batch
+const int JOURNAL_BUFFER_BYTES = 4096; // Records waiting to be written; appending waits only when this is full
+
+const uint8_t JOURNAL_MOVE = 1; // A move was played
+const uint8_t JOURNAL_SNAPSHOT = 2; // The whole game state after the moves so far
+const uint8_t JOURNAL_END = 3; // The game is over: nothing to recover
+
+// File layout (little-endian): header | records. Every record starts with its checksum (FNV-1a of the rest of the
+// record), its number (0, 1, 2... so a stale record from an older journal is not mistaken for a new one) and its type.
+struct JournalHeader {
+    char magic[8]; // JOURNAL_MAGIC
+    uint32_t version; // JOURNAL_VERSION
+    uint32_t headerSize; // sizeof(JournalHeader)
+    PackedPosition start; // Position before the first move
+    uint64_t reserved[2]; // Zero
+};
+
+struct JournalMoveRecord { // JOURNAL_MOVE and JOURNAL_END (16 bytes)
+    uint32_t checksum;
+    uint32_t sequence;
+    uint8_t type;
+    uint8_t reserved; // Zero
+    uint16_t move; // The move (zero for JOURNAL_END)
+    uint32_t reserved2; // Zero
+};
+
+struct JournalSnapshotRecord { // JOURNAL_SNAPSHOT (80 bytes)
+    uint32_t checksum;
+    uint32_t sequence;
+    uint8_t type;
+    uint8_t checkCount; // Checks given so far by both sides
+    uint8_t captureCounts[COLOR_NB]; // Pieces captured by White and by Black
+    uint32_t plies; // Moves recorded before this snapshot
+    PackedPosition position; // Position after those moves
+    char captures[COLOR_NB][15]; // Symbols of the captured pieces, in the order they were taken
+    uint8_t reserved[2]; // Zero
+};
+
+// What a journal holds, as read back.
+struct JournalContents {
+    Position start; // Position before the first move
+    std::vector<Move> moves; // Every move recorded
+    bool hasSnapshot;
+    JournalSnapshotRecord snapshot; // The last snapshot
+    bool finished; // The game ended (nothing to recover)
+    uint64_t validBytes; // Length of the intact part of the file
+};
+
+bool readJournal(const std::string& filename, JournalContents& contents); // False if missing or not a journal
+
+class Journal {
+private:
+    int fd; // Journal file, or -1 (set while the writer thread is not running)
+    uint32_t sequence; // Number of the next record (game thread only)
+    char buffer[JOURNAL_BUFFER_BYTES]; // Records not yet handed to the writer thread
+    size_t buffered;
+    uint64_t added; // Records added so far
+    uint64_t committed; // Records known to be on disk
+    bool stopping; // close() asks the writer thread to finish
+    bool failed; // A write or sync failed: the journal stops saving
+    std::mutex lock; // Guards the buffer, the counters and the flags
+    std::condition_variable work; // Records are waiting, or stopping
+    std::condition_variable done; // A batch is on disk
+    std::thread writer;
+
+    Journal(const Journal&); // Owns a file and a thread: not copyable
+    Journal& operator=(const Journal&);
+
+    void append(void* record, size_t size); // Numbering, checksumming and buffering a record
+    void writeBatches(); // Body of the writer thread
+
+public:
+    Journal();
+    ~Journal(); // Closes the journal (what was added is written first)
+    // Starting the journal of a game: the header and the moves played so far, followed by a snapshot of the current
+    // state, are written to a new file that then replaces any old journal of that name, so a crash during this
+    // leaves the old journal whole. Returns false if the file cannot be written.
+    bool create(const std::string& filename, const Position& start, const std::vector<Move>& moves, const JournalSnapshotRecord& state);
+    bool isOpen() const { return fd >= 0; }
+    void addMove(Move move);
+    void addSnapshot(const JournalSnapshotRecord& state); // Fields other than the numbering are the caller's
+    void addEnd();
+    bool sync(); // Waiting until every record added is on disk (false if the journal failed)
+    void close();
+};
+
+#endif
@@ -0,0 +1,626 @@
+// Match.cpp
+// Implementation of the match runner:
+//
+//   worker threads (each with its own pair of engine processes) --take the next game number--> play it to the end
+//   --(results under one lock)--> totals, Elo, SPRT, progress lines, the log and the archive
+//
+// The referee is a ChessBoard in the worker: it checks every move an engine sends and ends the game by the rules of
+// the game itself (four checks, checkmate, stalemate, repetition, fifty moves), so a broken engine cannot score by
+// claiming anything. Games start from an opening suite; game 2k and 2k+1 play opening k with the colors swapped, which
+// cancels out most of the opening's own bias.
+#include <atomic> // Include atomic for the next game number and the stop flag
+#include <chrono> // Include chrono for timeouts and games per hour
+#include <cerrno> // Include cerrno for EINTR
+#include <cmath> // Include cmath for log and the Elo formula
+#include <cstdlib> // Include cstdlib for atoi and atof
+#include <cstring> // Include cstring for strcmp
+#include <fstream> // Include fstream for the openings file and the log
+#include <iomanip> // Include iomanip for the reports
+#include <iostream> // Include iostream for progress and the summary
+#include <memory> // Include memory for the referee boards
+#include <mutex> // Include mutex for the totals, the log and the archive
+#include <sstream> // Include sstream for splitting move lists
+#include <string> // Include string for engine commands and protocol lines
+#include <thread> // Include thread for the workers
+#include <vector> // Include vector for the openings and the moves of a game
+#include "Match.h" // Match declarations
+#include "Archive.h" // Optional .cgb archive of the games
+#include "ChessGame.h" // Boards for the referee
+using namespace std;
+
+double Sprt::lowerBound() const {
+    return log(beta / (1 - alpha));
+}
+
+double Sprt::upperBound() const {
+    return log((1 - beta) / alpha);
+}
+
+static double scoreOfElo(double elo) { // Expected score of the stronger side
+    return 1 / (1 + pow(10.0, -elo / 400));
+}
+
+static double eloOfScore(double score) {
+    if (score <= 0) score = 1e-6; // All games lost (or won): the estimate has no finite value, so it stops at +/- 2400
+    if (score >= 1) score = 1 - 1e-6;
+    return -400 * log10(1 / score - 1) + 0.0; // Adding zero turns -0 into 0
+}
+
+// Mean score per game and the variance of one game's score (0, 1/2 or 1).
+static void scoreStats(int wins, int draws, int losses, double& mean, double& variance) {
+    double n = wins + draws + losses;
+    mean = n > 0 ? (wins + 0.5 * draws) / n : 0.5;
+    variance = n > 0 ? (wins * (1 - mean) * (1 - mean) + draws * (0.5 - mean) * (0.5 - mean) + losses * mean * mean) / n : 0;
+}
+
+double Sprt::llr(int wins, int draws, int losses) const {
+    double mean, variance;
+    scoreStats(wins, draws, losses, mean, variance);
+    if (variance <= 0) return 0; // Every game scored the same so far: nothing to tell the hypotheses apart yet
+    double s0 = scoreOfElo(elo0), s1 = scoreOfElo(elo1);
+    return (s1 - s0) * (2 * mean - s0 - s1) * (wins + draws + losses) / (2 * variance); // Normal approximation of the score
+}
+
+void eloEstimate(int wins, int draws, int losses, double& elo, double& margin) {
+    double mean, variance;
+    scoreStats(wins, draws, losses, mean, variance);
+    int n = wins + draws + losses;
+    double deviation = n > 0 ? sqrt(variance / n) : 0; // Standard error of the mean score
+    elo = eloOfScore(mean);
+    margin = (eloOfScore(mean + 1.96 * deviation) - eloOfScore(mean - 1.96 * deviation)) / 2;
+}
+
+#ifndef _WIN32
+#include <fcntl.h> // Include fcntl.h for close-on-exec pipes
+#include <poll.h> // Include poll.h for reading with a timeout
+#include <signal.h> // Include signal.h for ignoring SIGPIPE and killing hung engines
+#include <sys/wait.h> // Include sys/wait.h for reaping engines
+#include <unistd.h> // Include unistd.h for fork, exec, read and write
+
+// One engine process spoken to over its standard input and output.
+class UciEngine {
+private:
+    pid_t pid; // Running process, or -1
+    int toEngine; // Its standard input
+    int fromEngine; // Its standard output
+    string buffer; // Output read but not yet returned as lines
+    bool closed; // The engine closed its output (it exited or crashed)
+
+    UciEngine(const UciEngine&); // Owns a process: not copyable
+    UciEngine& operator=(const UciEngine&);
+
+public:
+    UciEngine() : pid(-1), toEngine(-1), fromEngine(-1), closed(false) {}
+    ~UciEngine() { stop(); }
+
+    bool running() const { return pid > 0 && !closed; }
+    bool hasExited() const { return closed; } // Whether the last failed read was the engine going away, not a timeout
+
+    // Starting the command (split on spaces, looked up on PATH) and doing the UCI handshake; false if it does not
+    // start or does not answer within the timeout.
+    bool start(const string& command, int timeoutMs) {
+        stop();
+        vector<string> words;
+        istringstream in(command);
+        for (string word; in >> word;) words.push_back(word);
+        if (words.empty()) return false;
+        vector<char*> args; // Built before forking: the child of a threaded program may only call exec-safe functions
+        for (string& word : words) args.push_back(&word[0]);
+        args.push_back(nullptr);
+        int input[2], output[2];
+        if (pipe2(input, O_CLOEXEC) != 0) return false; // Close-on-exec: other workers' engines must not inherit these
+        if (pipe2(output, O_CLOEXEC) != 0) {
+            close(input[0]);
+            close(input[1]);
+            return false;
+        }
+        pid = fork();
+        if (pid == 0) { // Child: the pipes become stdin and stdout (dup2 clears close-on-exec on the copies)
+            dup2(input[0], 0);
+            dup2(output[1], 1);
+            execvp(args[0], args.data());
+            _exit(127);
+        }
+        close(input[0]);
+        close(output[1]);
+        if (pid < 0) {
+            close(input[1]);
+            close(output[0]);
+            return false;
+        }
+        toEngine = input[1];
+        fromEngine = output[0];
+        closed = false;
+        buffer.clear();
+        string line;
+        if (!send("uci") || !waitFor("uciok", line, timeoutMs)) return false;
+        if (!send("setoption name OwnBook value false")) return false; // The openings come from the suite, not the engine
+        return send("isready") && waitFor("readyok", line, timeoutMs);
+    }
+
+    bool send(const string& line) {
+        string text = line + "\n";
+        size_t done = 0;
+        while (done < text.size()) {
+            ssize_t wrote = write(toEngine, text.data() + done, text.size() - done);
+            if (wrote < 0 && errno == EINTR) continue;
+            if (wrote <= 0) return false; // The engine is gone (SIGPIPE is ignored, so this is EPIPE)
+            done += size_t(wrote);
+        }
+        return true;
+    }
+
+    // Next line of output, waiting at most the timeout (false on timeout or when the engine closes its output).
+    bool readLine(string& line, int timeoutMs) {
+        chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+        while (true) {
+            size_t end = buffer.find('\n');
+            if (end != string::npos) {
+                line.assign(buffer, 0, end);
+                buffer.erase(0, end + 1);
+                if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+                return true;
+            }
+            if (closed) return false;
+            long left = (long)chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+            if (left <= 0) return false;
+            pollfd ready = {fromEngine, POLLIN, 0};
+            int events = poll(&ready, 1, (int)left);
+            if (events < 0 && errno == EINTR) continue;
+            if (events <= 0) return false;
+            char chunk[4096];
+            ssize_t got = read(fromEngine, chunk, sizeof(chunk));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) {
+                closed = true;
+                return false;
+            }
+            buffer.append(chunk, size_t(got));
+        }
+    }
+
+    // Skipping output until a line starting with the word (e.g. "bestmove"), which is returned.
+    bool waitFor(const string& word, string& line, int timeoutMs) {
+        chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+        while (true) {
+            long left = (long)chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+            if (!readLine(line, left > 0 ? (int)left : 0)) return false;
+            if (line.compare(0, word.size(), word) == 0 && (line.size() == word.size() || line[word.size()] == ' ')) return true;
+        }
+    }
+
+    // Asking the engine to quit, then killing it if it has not within a second.
+    void stop() {
+        if (pid <= 0) return;
+        if (!closed) send("quit");
+        close(toEngine);
+        close(fromEngine);
+        int status;
+        bool reaped = false;
+        for (int wait = 0; wait < 100 && !reaped; wait++) {
+            reaped = waitpid(pid, &status, WNOHANG) == pid;
+            if (!reaped) this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        if (!reaped) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+        }
+        pid = -1;
+        toEngine = fromEngine = -1;
+        closed = false;
+    }
+};
+
+// A start position of the suite: a FEN (empty for the standard start) and the moves played from it.
+struct Opening {
+    string fen;
+    vector<Move> moves;
+};
+
+// Six plies of common openings, so the engines meet a range of pawn structures instead of replaying one game.
+static const char* const DEFAULT_OPENINGS[] = {
+    "e2e4 e7e5 g1f3 b8c6 f1b5 a7a6", // Ruy Lopez
+    "e2e4 e7e5 g1f3 b8c6 f1c4 f8c5", // Italian
+    "e2e4 e7e5 g1f3 b8c6 d2d4 e5d4", // Scotch
+    "e2e4 e7e5 g1f3 g8f6 f3e5 d7d6", // Petroff
+    "e2e4 e7e5 b1c3 g8f6 f2f4 d7d5", // Vienna
+    "e2e4 c7c5 g1f3 d7d6 d2d4 c5d4", // Sicilian, 2...d6
+    "e2e4 c7c5 g1f3 b8c6 d2d4 c5d4", // Sicilian, 2...Nc6
+    "e2e4 e7e6 d2d4 d7d5 b1c3 g8f6", // French
+    "e2e4 c7c6 d2d4 d7d5 b1c3 d5e4", // Caro-Kann
+    "e2e4 d7d5 e4d5 d8d5 b1c3 d5a5", // Scandinavian
+    "e2e4 g7g6 d2d4 f8g7 b1c3 d7d6", // Modern
+    "e2e4 d7d6 d2d4 g8f6 b1c3 g7g6", // Pirc
+    "d2d4 d7d5 c2c4 e7e6 b1c3 g8f6", // Queen's Gambit Declined
+    "d2d4 d7d5 c2c4 c7c6 g1f3 g8f6", // Slav
+    "d2d4 d7d5 c2c4 d5c4 g1f3 g8f6", // Queen's Gambit Accepted
+    "d2d4 d7d5 g1f3 g8f6 c1f4 c7c5", // London
+    "d2d4 g8f6 c2c4 e7e6 b1c3 f8b4", // Nimzo-Indian
+    "d2d4 g8f6 c2c4 e7e6 g1f3 b7b6", // Queen's Indian
+    "d2d4 g8f6 c2c4 g7g6 b1c3 f8g7", // King's Indian
+    "d2d4 g8f6 c2c4 c7c5 d4d5 e7e6", // Benoni
+    "d2d4 f7f5 g2g3 g8f6 f1g2 e7e6", // Dutch
+    "c2c4 e7e5 b1c3 g8f6 g1f3 b8c6", // English, 1...e5
+    "c2c4 c7c5 g1f3 g8f6 b1c3 b8c6", // English, symmetrical
+    "g1f3 d7d5 c2c4 e7e6 g2g3 g8f6", // Reti
+};
+
+// Setting up an opening on a board, counting the checks its moves give (false if a move is illegal or the game is
+// already over when the engines take over).
+static bool setUpOpening(const Opening& opening, ChessBoard& board, int checks[COLOR_NB]) {
+    checks[WHITE] = checks[BLACK] = 0;
+    if (opening.fen.empty()) board.resetBoard();
+    else if (!board.loadFen(opening.fen)) return false;
+    for (Move move : opening.moves) {
+        int mover = board.isWhiteToMove() ? WHITE : BLACK;
+        board.playMove(move);
+        if (board.isKingInCheck(board.isWhiteToMove())) checks[mover]++;
+    }
+    MoveList moves;
+    board.generateMoves(moves);
+    return moves.count > 0 && checks[WHITE] + checks[BLACK] < CHECK_LIMIT && !board.isDraw();
+}
+
+// Reading an opening line: a FEN, or moves from the start position. False if it is neither.
+static bool parseOpening(const string& line, Opening& opening) {
+    ChessBoard board;
+    opening = Opening();
+    if (board.loadFen(line)) {
+        opening.fen = line;
+    } else {
+        istringstream in(line);
+        for (string word; in >> word;) {
+            Move move = board.parseMove(word);
+            if (move == MOVE_NONE) return false;
+            opening.moves.push_back(move);
+            board.playMove(move);
+        }
+    }
+    int checks[COLOR_NB];
+    return setUpOpening(opening, board, checks);
+}
+
+// Loading the suite: one opening per line, blank lines and lines starting with '#' skipped.
+static bool loadOpenings(const string& filename, vector<Opening>& openings) {
+    ifstream file(filename.c_str());
+    if (!file) {
+        cerr << "Cannot open the openings file " << filename << "\n";
+        return false;
+    }
+    string line;
+    for (int number = 1; getline(file, line); number++) {
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        if (line.find_first_not_of(" \t") == string::npos || line[0] == '#') continue;
+        Opening opening;
+        if (parseOpening(line, opening)) openings.push_back(opening);
+        else cerr << filename << ":" << number << ": not a FEN, illegal moves or a finished game, skipped\n";
+    }
+    return !openings.empty();
+}
+
+// How a game ended. The first ones are the game's own rules, the last three are an engine failing.
+enum MatchEnding { END_CHECKS, END_MATE, END_STALEMATE, END_REPETITION, END_FIFTY, END_LENGTH, END_ILLEGAL, END_TIMEOUT, END_CRASH, END_NB };
+static const char* const ENDING_NAMES[END_NB] = {"checks", "mate", "stalemate", "repetition", "fifty", "length", "illegal", "timeout", "crash"};
+
+struct MatchOptions {
+    string engines[2]; // Command lines of engine 1 and engine 2
+    string go; // The "go" command sent for every move
+    int timeoutMs; // Longest wait for a move before the engine loses on time
+    int games;
+    int concurrency; // Games played at once
+    bool sprt; // Stopping early on the SPRT
+    Sprt test;
+    string logFile;
+    string archiveFile;
+};
+
+// One finished game.
+struct GameRecord {
+    int game; // Game number from 0
+    int opening; // Index in the suite
+    bool engine1White;
+    uint8_t result; // ARCHIVE_RESULT_* (from White's side)
+    MatchEnding ending;
+    vector<Move> moves; // Opening and game moves
+    int checks[COLOR_NB]; // Checks given by each side
+    Position start; // Position before the opening moves
+};
+
+// Playing one game between the two engines (engines[0] is engine 1) on the worker's referee board. An engine that
+// fails loses the game and is stopped, so its worker starts a fresh copy for the next one.
+static void playGame(UciEngine engines[2], const MatchOptions& options, const Opening& opening, ChessBoard& board, GameRecord& record) {
+    if (opening.fen.empty()) board.resetBoard();
+    else board.loadFen(opening.fen);
+    record.start = board.position();
+    setUpOpening(opening, board, record.checks); // Checked when the suite was loaded
+    record.moves = opening.moves;
+    string position = "position " + (opening.fen.empty() ? string("startpos") : "fen " + opening.fen) + " moves"; // The whole game every time: the engine counts checks from it
+    for (Move move : opening.moves) position += " " + moveToString(move);
+
+    while (true) {
+        if ((int)record.moves.size() - (int)opening.moves.size() >= MATCH_MAX_PLIES) {
+            record.result = ARCHIVE_RESULT_DRAW;
+            record.ending = END_LENGTH;
+            return;
+        }
+        int mover = board.isWhiteToMove() ? WHITE : BLACK;
+        UciEngine& engine = engines[(mover == WHITE) == record.engine1White ? 0 : 1];
+        uint8_t loss = mover == WHITE ? ARCHIVE_RESULT_BLACK_WINS : ARCHIVE_RESULT_WHITE_WINS;
+        uint8_t win = mover == WHITE ? ARCHIVE_RESULT_WHITE_WINS : ARCHIVE_RESULT_BLACK_WINS;
+        string reply;
+        if (!engine.send(position) || !engine.send(options.go) || !engine.waitFor("bestmove", reply, options.timeoutMs)) {
+            record.result = loss;
+            record.ending = engine.hasExited() ? END_CRASH : END_TIMEOUT;
+            engine.stop();
+            return;
+        }
+        istringstream words(reply);
+        string word, text;
+        words >> word >> text;
+        Move move = board.parseMove(text);
+        if (move == MOVE_NONE || text.size() < 4) { // Only coordinate moves, as UCI sends them
+            record.result = loss;
+            record.ending = END_ILLEGAL;
+            return;
+        }
+        board.playMove(move);
+        record.moves.push_back(move);
+        position += " " + moveToString(move);
+
+        bool inCheck = board.isKingInCheck(board.isWhiteToMove()); // The same rules as ChessGame::isGameOver
+        MoveList replies;
+        board.generateMoves(replies);
+        if (inCheck) {
+            record.checks[mover]++;
+            if (record.checks[WHITE] + record.checks[BLACK] >= CHECK_LIMIT) {
+                record.result = win;
+                record.ending = END_CHECKS;
+                return;
+            }
+            if (replies.count == 0) {
+                record.result = win;
+                record.ending = END_MATE;
+                return;
+            }
+        } else if (replies.count == 0) {
+            record.result = ARCHIVE_RESULT_DRAW;
+            record.ending = END_STALEMATE;
+            return;
+        }
+        if (board.isDraw()) {
+            record.result = ARCHIVE_RESULT_DRAW;
+            record.ending = board.repetitionCount() >= 2 ? END_REPETITION : END_FIFTY;
+            return;
+        }
+    }
+}
+
+// Everything the workers report to, behind one lock (taken once per game).
+struct MatchState {
+    mutex lock;
+    int wins, draws, losses; // From engine 1's side
+    int endings[END_NB];
+    int finished;
+    long long plies;
+    bool decided; // The SPRT crossed a bound
+    bool failed; // An engine could not be started
+    ofstream log;
+    ArchiveWriter archive;
+    bool archiving;
+    chrono::steady_clock::time_point started;
+    MatchState() : wins(0), draws(0), losses(0), endings(), finished(0), plies(0), decided(false), failed(false), archiving(false) {}
+};
+
+static double hoursSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count() / 3600;
+}
+
+static void printScore(ostream& out, const MatchState& state, const MatchOptions& options) {
+    double elo, margin;
+    eloEstimate(state.wins, state.draws, state.losses, elo, margin);
+    out << "+" << state.wins << " =" << state.draws << " -" << state.losses << fixed << setprecision(1) << ", Elo " << showpos << elo
+        << noshowpos << " +/- " << margin;
+    if (options.sprt) out << setprecision(2) << ", LLR " << options.test.llr(state.wins, state.draws, state.losses);
+    double hours = hoursSince(state.started);
+    out << setprecision(0) << ", " << (hours > 0 ? state.finished / hours : 0.0) << " games/h";
+    out.unsetf(ios::fixed);
+}
+
+// Adding a finished game to the totals, the log and the archive, and checking the SPRT.
+static void recordGame(MatchState& state, const MatchOptions& options, const GameRecord& record) {
+    lock_guard<mutex> lock(state.lock);
+    bool whiteWon = record.result == ARCHIVE_RESULT_WHITE_WINS, blackWon = record.result == ARCHIVE_RESULT_BLACK_WINS;
+    if (whiteWon || blackWon) {
+        if (whiteWon == record.engine1White) state.wins++;
+        else state.losses++;
+    } else {
+        state.draws++;
+    }
+    state.endings[record.ending]++;
+    state.finished++;
+    state.plies += (long long)record.moves.size();
+    if (state.log) {
+        state.log << record.game << " " << record.opening << " " << (record.engine1White ? 1 : 2) << " "
+                  << (whiteWon ? "1-0" : blackWon ? "0-1" : "1/2-1/2") << " " << ENDING_NAMES[record.ending] << " " << record.moves.size() << "\n";
+    }
+    if (state.archiving && !state.archive.addGame(record.start, record.moves.data(), (uint32_t)record.moves.size(), record.result,
+                                                  record.checks[WHITE], record.checks[BLACK])) {
+        cerr << "Cannot write to the archive " << options.archiveFile << ", no more games are archived\n";
+        state.archiving = false;
+    }
+    if (options.sprt && !state.decided) {
+        double llr = options.test.llr(state.wins, state.draws, state.losses);
+        state.decided = llr <= options.test.lowerBound() || llr >= options.test.upperBound();
+    }
+    if (state.finished % 10 == 0 || state.decided) {
+        cout << "Games " << state.finished << ": ";
+        printScore(cout, state, options);
+        cout << endl;
+    }
+}
+
+static void matchUsage() {
+    cerr << "Usage: ChessGame --match [--engine1 \"command\"] [--engine2 \"command\"] [--games N] [--concurrency N]\n"
+         << "                         [--nodes N | --movetime MS | --depth N] [--timeout MS] [--openings FILE]\n"
+         << "                         [--sprt ELO0 ELO1 [ALPHA BETA]] [--log FILE] [--archive FILE.cgb]\n";
+}
+
+int matchMain(int argc, char* argv[]) {
+    signal(SIGPIPE, SIG_IGN); // Writing to an engine that died must fail, not end the match
+    char self[4096];
+    ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    string program = length > 0 ? string(self, size_t(length)) : string(argv[0]);
+    MatchOptions options;
+    options.engines[0] = options.engines[1] = program + " --uci --threads 1 --hash 16"; // This build against itself by default
+    options.games = 100;
+    options.concurrency = (int)thread::hardware_concurrency();
+    options.timeoutMs = 0;
+    options.sprt = false;
+    options.test.alpha = options.test.beta = 0.05;
+    int nodes = 0, moveTimeMs = 0, depth = 0;
+    string openingsFile;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--engine1") == 0 && i + 1 < argc) options.engines[0] = argv[++i];
+        else if (strcmp(argv[i], "--engine2") == 0 && i + 1 < argc) options.engines[1] = argv[++i];
+        else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) options.games = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) options.concurrency = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) nodes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--movetime") == 0 && i + 1 < argc) moveTimeMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) options.timeoutMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--openings") == 0 && i + 1 < argc) openingsFile = argv[++i];
+        else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) options.logFile = argv[++i];
+        else if (strcmp(argv[i], "--archive") == 0 && i + 1 < argc) options.archiveFile = argv[++i];
+        else if (strcmp(argv[i], "--sprt") == 0 && i + 2 < argc) {
+            options.sprt = true;
+            options.test.elo0 = atof(argv[++i]);
+            options.test.elo1 = atof(argv[++i]);
+            if (i + 2 < argc && argv[i + 1][0] != '-') { // Error rates are optional
+                options.test.alpha = atof(argv[++i]);
+                options.test.beta = atof(argv[++i]);
+            }
+        } else {
+            matchUsage();
+            return 1;
+        }
+    }
+    if (options.games < 1 || options.concurrency < 1 || (options.sprt && (options.test.elo1 <= options.test.elo0 || options.test.alpha <= 0 ||
+        options.test.alpha >= 1 || options.test.beta <= 0 || options.test.beta >= 1))) {
+        matchUsage();
+        return 1;
+    }
+    if (!nodes && !moveTimeMs && !depth) nodes = 20000; // A fraction of a second per move: many games, still real search
+    options.go = "go";
+    if (depth) options.go += " depth " + to_string(depth);
+    if (moveTimeMs) options.go += " movetime " + to_string(moveTimeMs);
+    if (nodes) options.go += " nodes " + to_string(nodes);
+    if (!options.timeoutMs) options.timeoutMs = moveTimeMs ? moveTimeMs * 5 + 1000 : depth ? 60000 : 30000; // Generous: a loaded machine is slow
+    if (options.concurrency > options.games) options.concurrency = options.games;
+
+    vector<Opening> openings;
+    if (!openingsFile.empty()) {
+        if (!loadOpenings(openingsFile, openings)) return 1;
+    } else {
+        for (const char* line : DEFAULT_OPENINGS) {
+            Opening opening;
+            if (parseOpening(line, opening)) openings.push_back(opening);
+        }
+    }
+
+    MatchState state;
+    if (!options.logFile.empty()) {
+        state.log.open(options.logFile.c_str());
+        if (!state.log) {
+            cerr << "Cannot write the log " << options.logFile << "\n";
+            return 1;
+        }
+        state.log << "# engine1 " << options.engines[0] << "\n# engine2 " << options.engines[1] << "\n# " << options.go << "\n"
+                  << "# game opening white result ending plies\n";
+    }
+    if (!options.archiveFile.empty()) {
+        state.archiving = state.archive.open(options.archiveFile);
+        if (!state.archiving) {
+            cerr << "Cannot write the archive " << options.archiveFile << "\n";
+            return 1;
+        }
+    }
+
+    cout << "Match of " << options.games << " games, " << options.concurrency << " at once, " << openings.size() << " openings, "
+         << options.go << "\n  engine1: " << options.engines[0] << "\n  engine2: " << options.engines[1] << "\n";
+    if (options.sprt) {
+        cout << "  SPRT elo0 " << options.test.elo0 << " elo1 " << options.test.elo1 << " alpha " << options.test.alpha << " beta "
+             << options.test.beta << fixed << setprecision(2) << " (bounds " << options.test.lowerBound() << ", " << options.test.upperBound() << ")\n";
+        cout.unsetf(ios::fixed);
+    }
+    cout << flush;
+
+    atomic<int> nextGame(0);
+    state.started = chrono::steady_clock::now();
+    // One referee board per worker, built here rather than on the worker threads, as the validator does.
+    vector<unique_ptr<ChessBoard> > referees;
+    for (int w = 0; w < options.concurrency; w++) referees.push_back(unique_ptr<ChessBoard>(new ChessBoard()));
+    vector<thread> workers;
+    for (int w = 0; w < options.concurrency; w++) {
+        workers.push_back(thread([&, w]() {
+            UciEngine engines[2]; // Kept across games; a failed one is restarted before the next game
+            while (true) {
+                {
+                    lock_guard<mutex> lock(state.lock);
+                    if (state.decided || state.failed) break;
+                }
+                int game = nextGame.fetch_add(1);
+                if (game >= options.games) break;
+                bool ready = false;
+                for (int attempt = 0; attempt < 3 && !ready; attempt++) { // A fresh copy of an engine that failed the last game
+                    ready = true;
+                    for (int e = 0; e < 2 && ready; e++) {
+                        string line;
+                        if (!engines[e].running() && !engines[e].start(options.engines[e], 10000)) ready = false;
+                        else if (!engines[e].send("ucinewgame") || !engines[e].send("isready") || !engines[e].waitFor("readyok", line, 10000)) ready = false;
+                        if (!ready) engines[e].stop();
+                    }
+                }
+                if (!ready) {
+                    lock_guard<mutex> lock(state.lock);
+                    if (!state.failed) cerr << "Cannot start the engines (" << options.engines[0] << ", " << options.engines[1] << ")\n";
+                    state.failed = true;
+                    break;
+                }
+                GameRecord record;
+                record.game = game;
+                record.opening = (game / 2) % (int)openings.size();
+                record.engine1White = game % 2 == 0;
+                playGame(engines, options, openings[record.opening], *referees[w], record);
+                recordGame(state, options, record);
+            }
+        }));
+    }
+    for (thread& worker : workers) worker.join();
+
+    if (state.archiving && !state.archive.finish()) cerr << "Cannot finish the archive " << options.archiveFile << "\n";
+    if (state.failed && !state.finished) return 1;
+    cout << "\nFinished " << state.finished << " games in " << fixed << setprecision(1) << hoursSince(state.started) * 3600 << " s, "
+         << (state.finished ? (double)state.plies / state.finished : 0.0) << " plies per game\n";
+    cout.unsetf(ios::fixed);
+    cout << "Engine 1 against engine 2: ";
+    printScore(cout, state, options);
+    cout << "\nEndings:";
+    for (int e = 0; e < END_NB; e++) if (state.endings[e]) cout << " " << ENDING_NAMES[e] << " " << state.endings[e];
+    cout << "\n";
+    if (options.sprt) {
+        double llr = options.test.llr(state.wins, state.draws, state.losses);
+        if (llr >= options.test.upperBound()) cout << "SPRT: H1 accepted (engine 1 is at least " << options.test.elo1 << " Elo stronger)\n";
+        else if (llr <= options.test.lowerBound()) cout << "SPRT: H0 accepted (engine 1 is at most " << options.test.elo0 << " Elo stronger)\n";
+        else cout << "SPRT: no decision yet, play more games\n";
+    }
+    return state.failed ? 1 : 0;
+}
+
+#else // Engine processes are started with fork and exec
+
+int matchMain(int, char*[]) {
+    cerr << "Engine matches need a POSIX system (fork, exec and pipes)\n";
+    return 1;
+}
+
+#endif
@@ -0,0 +1,26 @@
+// Match.h
+// Engine-versus-engine matches for accepting changes: two UCI engines (two builds, or one build with different
+// options) play many games at once from a suite of openings, each opening once with each color, under the game's own
+// rules (the N-check ending, checkmate, stalemate, threefold repetition and the 50-move rule). Wins, draws and losses
+// are added up as games finish, with an Elo estimate and an optional SPRT that stops the match once the result is clear.
+#ifndef MATCH_H
+#define MATCH_H
+
+const int MATCH_MAX_PLIES = 600; // Games still running after this many plies are scored as draws
+
+// Sequential probability ratio test of "engine 1 is elo1 stronger" against "engine 1 is elo0 stronger", on the
+// game scores with draws counted as half a point (the generalized SPRT used by engine testing frameworks).
+struct Sprt {
+    double elo0, elo1; // The two hypotheses, in Elo
+    double alpha, beta; // Accepted error rates
+    double lowerBound() const; // Log-likelihood ratio at which elo0 is accepted
+    double upperBound() const; // Log-likelihood ratio at which elo1 is accepted
+    double llr(int wins, int draws, int losses) const; // Current log-likelihood ratio
+};
+
+// Elo difference of a score (wins plus half the draws, per game) and the half width of its 95% interval.
+void eloEstimate(int wins, int draws, int losses, double& elo, double& margin);
+
+int matchMain(int argc, char* argv[]); // Command-line entry for --match
+
+#endif
@@ -0,0 +1,62 @@
+// Move.h
+// Compact 16-bit move encoding and a fixed-capacity move list that lives on the stack.
+#ifndef MOVE_H
+#define MOVE_H
+
+#include <string> // Include string for converting moves to text
+#include "Position.h" // Include the position core (square numbering and piece types)
+
+// A move packs into 16 bits:
+//   bits 0-5   from square
+//   bits 6-11  to square
+//   bits 12-13 promotion piece (0 = knight, 1 = bishop, 2 = rook, 3 = queen)
+//   bits 14-15 move kind (normal, promotion, en passant, castling)
+typedef uint16_t Move;
+
+const Move MOVE_NONE = 0; // "No move" (a8 to a8 can never be a real move)
+const int NORMAL_MOVE = 0; // Ordinary move or capture
+const int PROMOTION = 1 << 14; // Pawn reaching the last row
+const int EN_PASSANT = 2 << 14; // Pawn capturing en passant
+const int CASTLING = 3 << 14; // King moving two squares (the rook move is implied)
+
+const int MAX_MOVES = 256; // No legal chess position has more than 218 moves
+
+inline Move encodeMove(int from, int to, int kind = NORMAL_MOVE, int promotion = KNIGHT) { // Packing a move
+    return Move(from | (to << 6) | ((promotion - KNIGHT) << 12) | kind);
+}
+inline int moveFrom(Move m) { return m & 63; } // Source square
+inline int moveTo(Move m) { return (m >> 6) & 63; } // Destination square
+inline int moveKind(Move m) { return m & (3 << 14); } // NORMAL_MOVE, PROMOTION, EN_PASSANT or CASTLING
+inline int promotionType(Move m) { return ((m >> 12) & 3) + KNIGHT; } // Piece type a pawn promotes to
+
+std::string squareName(int sq); // Square in algebraic notation, e.g. "e4"
+std::string moveToString(Move m); // Move in long algebraic notation, e.g. "e2e4" or "e7e8q"
+
+// Fixed-size list of moves filled by the generator; it never allocates.
+struct MoveList {
+    Move moves[MAX_MOVES]; // Generated moves
+    int count; // Number of moves in the list
+
+    MoveList() : count(0) {} // Starting empty
+    void add(Move m) { moves[count++] = m; } // Appending a move
+    int size() const { return count; } // Number of moves
+    Move operator[](int i) const { return moves[i]; } // Reading a move by index
+    const Move* begin() const { return moves; } // Range-for support
+    const Move* end() const { return moves + count; }
+    bool contains(Move m) const { // Checking if a move was generated
+        for (int i = 0; i < count; i++) if (moves[i] == m) return true;
+        return false;
+    }
+};
+
+// Stages of the staged move picker: captures and promotions first (cut-offs often come from them, before the quiet
+// moves are even generated), then the other moves.
+enum GenStage { GEN_ALL, GEN_NOISY, GEN_QUIETS };
+
+void generateLegalMoves(const Position& pos, MoveList& list); // All legal moves for the side to move
+void generateLegalMoves(const Position& pos, MoveList& list, GenStage stage); // The legal moves of one stage
+void generatePseudoLegalMoves(const Position& pos, MoveList& list); // All moves that follow the piece rules, ignoring pins and checks
+bool isLegalMove(const Position& pos, Move m); // Checking a pseudo-legal move against pins and checks
+bool isPseudoLegalMove(const Position& pos, Move m); // Checking that a move from elsewhere follows the piece rules here
+
+#endif
@@ -0,0 +1,241 @@
+// MoveGen.cpp
+// Implementation of the move generator: pseudo-legal moves from the attack tables, legal moves filtered with pin and check masks.
+#include "Move.h" // Move encoding, MoveList and generator declarations
+#include "Profile.h" // Optional timing of the generator
+
+std::string squareName(int sq) {
+    std::string name(2, ' '); // Two characters: file letter and rank digit
+    name[0] = char('a' + colOf(sq)); // Column 0 is file a
+    name[1] = char('8' - rowOf(sq)); // Row 0 is rank 8
+    return name;
+}
+
+std::string moveToString(Move m) {
+    if (m == MOVE_NONE) return "0000"; // Conventional text for "no move"
+    std::string text = squareName(moveFrom(m)) + squareName(moveTo(m)); // e.g. "e2e4"
+    if (moveKind(m) == PROMOTION) text += PIECE_SYMBOLS[BLACK][promotionType(m)]; // Lower-case promotion piece, e.g. "e7e8q"
+    return text;
+}
+
+// Everything the legal filter needs to know about the king of the side to move.
+struct KingSafety {
+    int king; // King square of the side to move
+    Bitboard checkers; // Opponent pieces giving check
+    Bitboard pinned; // Own pieces that may only move along the line to the king
+    Bitboard evasionMask; // Destinations that resolve a single check (all squares when not in check)
+};
+
+// The generator is written once for both colors: 'Us' is a template parameter, so every color-dependent step,
+// row and castling flag below is a compile-time constant and each color gets its own branch-free copy.
+template <int Us>
+static KingSafety computeKingSafety(const Position& pos) {
+    const int Them = SideTraits<Us>::THEM;
+    KingSafety ks;
+    ks.king = pos.kingSquare(Us);
+    ks.checkers = ks.pinned = 0;
+    ks.evasionMask = ~0ULL; // Not in check: every destination is fine
+    if (ks.king == NO_SQUARE) return ks; // A hand-edited board without a king has nothing to protect
+    ks.checkers = pos.attackersTo(ks.king, pos.occupied) & pos.byColor[Them]; // Attackers of the king square
+    if (ks.checkers) ks.evasionMask = betweenBB(ks.king, lsb(ks.checkers)) | ks.checkers; // Capture the checker or block the ray
+
+    // Sliders lined up with the king with exactly one piece in between pin that piece if it is ours.
+    Bitboard queens = pos.pieces(Them, QUEEN);
+    Bitboard snipers = (rookAttacks(ks.king, 0) & (pos.pieces(Them, ROOK) | queens)) |
+                       (bishopAttacks(ks.king, 0) & (pos.pieces(Them, BISHOP) | queens)); // Opponent sliders on the king's lines
+    while (snipers) {
+        int sniper = popLsb(snipers);
+        Bitboard blockers = betweenBB(ks.king, sniper) & pos.occupied; // Pieces between the king and the slider
+        if (blockers && !moreThanOne(blockers) && (blockers & pos.byColor[Us])) ks.pinned |= blockers;
+    }
+    return ks;
+}
+
+// En passant removes two pieces from one row, so it is checked by looking at the sliders again with the new occupancy.
+template <int Us>
+static bool isEnPassantLegal(const Position& pos, int from, int to, int king) {
+    const int Them = SideTraits<Us>::THEM;
+    int captured = to - SideTraits<Us>::FORWARD; // The captured pawn stands behind the destination square
+    Bitboard occ = (pos.occupied ^ squareBit(from) ^ squareBit(captured)) | squareBit(to); // Board after the capture
+    Bitboard queens = pos.pieces(Them, QUEEN);
+    return !(rookAttacks(king, occ) & (pos.pieces(Them, ROOK) | queens)) &&
+           !(bishopAttacks(king, occ) & (pos.pieces(Them, BISHOP) | queens)) &&
+           !(KNIGHT_ATTACKS[king] & pos.pieces(Them, KNIGHT)) &&
+           !(PAWN_ATTACKS[Us][king] & pos.pieces(Them, PAWN) & ~squareBit(captured)); // Any other checker survives the capture
+}
+
+// Attacks of one piece type from a square, picked at compile time.
+template <int Type> Bitboard pieceAttacks(int sq, Bitboard occupied);
+template <> Bitboard pieceAttacks<KNIGHT>(int sq, Bitboard) { return KNIGHT_ATTACKS[sq]; }
+template <> Bitboard pieceAttacks<BISHOP>(int sq, Bitboard occupied) { return bishopAttacks(sq, occupied); }
+template <> Bitboard pieceAttacks<ROOK>(int sq, Bitboard occupied) { return rookAttacks(sq, occupied); }
+template <> Bitboard pieceAttacks<QUEEN>(int sq, Bitboard occupied) { return queenAttacks(sq, occupied); }
+
+// Knight, bishop, rook or queen moves of one color to the squares in 'targetMask'.
+template <int Us, int Type, bool LegalOnly>
+static void addPieceMoves(const Position& pos, MoveList& list, const KingSafety& ks, Bitboard targetMask) {
+    Bitboard pieces = pos.pieces(Us, Type);
+    while (pieces) {
+        int from = popLsb(pieces);
+        Bitboard targets = pieceAttacks<Type>(from, pos.occupied) & targetMask;
+        if (LegalOnly && (ks.pinned & squareBit(from))) targets &= LINE_BB[ks.king][from]; // A pinned piece stays on the pin line
+        while (targets) list.add(encodeMove(from, popLsb(targets)));
+    }
+}
+
+// Adding the pawn moves of a whole set of destinations reached with the same step; moves onto the last row are
+// expanded into the four promotions.
+template <int Us, bool LegalOnly>
+static void addPawnMoves(MoveList& list, const KingSafety& ks, Bitboard targets, int step) {
+    while (targets) {
+        int to = popLsb(targets), from = to - step;
+        if (LegalOnly && (ks.pinned & squareBit(from)) && !(LINE_BB[ks.king][from] & squareBit(to))) continue; // Off the pin line
+        if (rowOf(to) == SideTraits<Us>::LAST_ROW) {
+            for (int type = QUEEN; type >= KNIGHT; type--) list.add(encodeMove(from, to, PROMOTION, type)); // Queen first
+        } else {
+            list.add(encodeMove(from, to));
+        }
+    }
+}
+
+// Pawns, all of them at once: the destinations of every push and capture are computed set-wise with shifts. Pushes
+// onto the last row are promotions and belong to the noisy stage with the captures; the other pushes are quiet.
+template <int Us, bool LegalOnly, int Stage>
+static void addAllPawnMoves(const Position& pos, MoveList& list, const KingSafety& ks, Bitboard targetMask) {
+    typedef SideTraits<Us> Side;
+    Bitboard pawns = pos.pieces(Us, PAWN), empty = ~pos.occupied, theirs = pos.byColor[Side::THEM];
+    Bitboard single = pawnPush<Us>(pawns) & empty;
+    Bitboard pushMask = Stage == GEN_NOISY ? rowBB(Side::LAST_ROW) : Stage == GEN_QUIETS ? ~rowBB(Side::LAST_ROW) : ~0ULL;
+    addPawnMoves<Us, LegalOnly>(list, ks, single & targetMask & pushMask, Side::FORWARD);
+    if (Stage != GEN_NOISY) {
+        Bitboard twice = pawnPush<Us>(single & rowBB(Side::DOUBLE_PUSH_ROW)) & empty; // Second step from the starting row
+        addPawnMoves<Us, LegalOnly>(list, ks, twice & targetMask, 2 * Side::FORWARD);
+    }
+    if (Stage == GEN_QUIETS) return;
+    addPawnMoves<Us, LegalOnly>(list, ks, pawnPush<Us>(shiftLeft(pawns)) & theirs & targetMask, Side::FORWARD - 1); // Towards file a
+    addPawnMoves<Us, LegalOnly>(list, ks, pawnPush<Us>(shiftRight(pawns)) & theirs & targetMask, Side::FORWARD + 1); // Towards file h
+
+    if (pos.enPassantSquare != NO_SQUARE) {
+        Bitboard takers = PAWN_ATTACKS[Side::THEM][pos.enPassantSquare] & pawns; // Our pawns a capture away from the target
+        while (takers) {
+            int from = popLsb(takers);
+            if (!LegalOnly || ks.king == NO_SQUARE || isEnPassantLegal<Us>(pos, from, pos.enPassantSquare, ks.king))
+                list.add(encodeMove(from, pos.enPassantSquare, EN_PASSANT));
+        }
+    }
+}
+
+// Adding castling moves whose rights, empty squares and safe squares all check out.
+template <int Us>
+static void addCastlingMoves(const Position& pos, MoveList& list) {
+    typedef SideTraits<Us> Side;
+    const int king = squareOf(Side::HOME_ROW, 4); // King's home square
+    if (!(pos.pieces(Us, KING) & squareBit(king))) return; // The king has left its home square
+    const int rights[2] = {WHITE_KINGSIDE << (2 * Us), WHITE_QUEENSIDE << (2 * Us)}; // Black's flags are White's shifted by two
+    for (int side = 0; side < 2; side++) { // Kingside, then queenside
+        if (!(pos.castlingRights & rights[side])) continue; // Right already lost
+        int rook = squareOf(Side::HOME_ROW, side == 0 ? 7 : 0), step = side == 0 ? 1 : -1;
+        if (!(pos.pieces(Us, ROOK) & squareBit(rook))) continue; // No rook in the corner
+        if (betweenBB(king, rook) & pos.occupied) continue; // Squares between king and rook must be empty
+        if (pos.isSquareAttacked(king, Side::THEM) || pos.isSquareAttacked(king + step, Side::THEM) ||
+            pos.isSquareAttacked(king + 2 * step, Side::THEM)) continue; // Not out of, through or into check
+        list.add(encodeMove(king, king + 2 * step, CASTLING));
+    }
+}
+
+// Shared generator: with 'LegalOnly' the destinations of every piece are masked by the pin and check information,
+// and 'Stage' (a GenStage) keeps only captures and promotions, only the other moves, or everything.
+template <int Us, bool LegalOnly, int Stage>
+static void generateMoves(const Position& pos, MoveList& list) {
+    Bitboard ours = pos.byColor[Us], theirs = pos.byColor[SideTraits<Us>::THEM];
+    Bitboard stageMask = Stage == GEN_NOISY ? theirs : Stage == GEN_QUIETS ? ~pos.occupied : ~0ULL; // Destinations of this stage
+    KingSafety ks = computeKingSafety<Us>(pos);
+
+    // King moves: with the king lifted off the board, its destination must not be attacked.
+    Bitboard kingTargets = ks.king == NO_SQUARE ? 0 : KING_ATTACKS[ks.king] & ~ours & stageMask;
+    while (kingTargets) {
+        int to = popLsb(kingTargets);
+        if (LegalOnly && (pos.attackersTo(to, pos.occupied ^ squareBit(ks.king)) & theirs)) continue;
+        list.add(encodeMove(ks.king, to));
+    }
+    if (LegalOnly && moreThanOne(ks.checkers)) return; // Double check: only the king can move
+    if (!ks.checkers && Stage != GEN_NOISY) addCastlingMoves<Us>(pos, list); // Castling is never allowed out of check
+
+    Bitboard targetMask = ~ours & (LegalOnly ? ks.evasionMask : ~0ULL); // Destinations allowed by the check situation
+    addPieceMoves<Us, KNIGHT, LegalOnly>(pos, list, ks, targetMask & stageMask);
+    addPieceMoves<Us, BISHOP, LegalOnly>(pos, list, ks, targetMask & stageMask);
+    addPieceMoves<Us, ROOK, LegalOnly>(pos, list, ks, targetMask & stageMask);
+    addPieceMoves<Us, QUEEN, LegalOnly>(pos, list, ks, targetMask & stageMask);
+    addAllPawnMoves<Us, LegalOnly, Stage>(pos, list, ks, targetMask);
+}
+
+void generateLegalMoves(const Position& pos, MoveList& list) {
+    PROFILE_SCOPE(PROFILE_LEGAL_MOVES);
+    if (pos.sideToMove == WHITE) generateMoves<WHITE, true, GEN_ALL>(pos, list); // The only color test: picking the copy
+    else generateMoves<BLACK, true, GEN_ALL>(pos, list);
+}
+
+void generateLegalMoves(const Position& pos, MoveList& list, GenStage stage) {
+    PROFILE_SCOPE(PROFILE_LEGAL_MOVES);
+    bool white = pos.sideToMove == WHITE;
+    if (stage == GEN_NOISY) white ? generateMoves<WHITE, true, GEN_NOISY>(pos, list) : generateMoves<BLACK, true, GEN_NOISY>(pos, list);
+    else if (stage == GEN_QUIETS) white ? generateMoves<WHITE, true, GEN_QUIETS>(pos, list) : generateMoves<BLACK, true, GEN_QUIETS>(pos, list);
+    else white ? generateMoves<WHITE, true, GEN_ALL>(pos, list) : generateMoves<BLACK, true, GEN_ALL>(pos, list);
+}
+
+void generatePseudoLegalMoves(const Position& pos, MoveList& list) {
+    if (pos.sideToMove == WHITE) generateMoves<WHITE, false, GEN_ALL>(pos, list);
+    else generateMoves<BLACK, false, GEN_ALL>(pos, list);
+}
+
+template <int Us>
+static bool isLegalMove(const Position& pos, Move m) {
+    int from = moveFrom(m), to = moveTo(m);
+    KingSafety ks = computeKingSafety<Us>(pos);
+    if (ks.king == NO_SQUARE) return true; // Nothing to protect on a board without a king
+    if (from == ks.king) { // King moves are legal when the destination is safe (castling was checked when generated)
+        return moveKind(m) == CASTLING || !(pos.attackersTo(to, pos.occupied ^ squareBit(from)) & pos.byColor[SideTraits<Us>::THEM]);
+    }
+    if (moveKind(m) == EN_PASSANT) return isEnPassantLegal<Us>(pos, from, to, ks.king); // Checks and pins both covered
+    if (moreThanOne(ks.checkers)) return false; // Double check needs a king move
+    if (!(ks.evasionMask & squareBit(to))) return false; // Does not deal with the check
+    return !(ks.pinned & squareBit(from)) || (LINE_BB[ks.king][from] & squareBit(to)); // Pinned pieces stay on the line
+}
+
+bool isLegalMove(const Position& pos, Move m) {
+    PROFILE_SCOPE(PROFILE_IS_LEGAL_MOVE);
+    return pos.sideToMove == WHITE ? isLegalMove<WHITE>(pos, m) : isLegalMove<BLACK>(pos, m);
+}
+
+// Whether the piece on the source square moves that way here, ignoring pins and checks. Moves remembered from other
+// positions (a hash table entry, a killer from a sibling node) are tested with this and isLegalMove before they are
+// played without generating the whole list.
+template <int Us>
+static bool isPseudoLegalMove(const Position& pos, Move m) {
+    typedef SideTraits<Us> Side;
+    int from = moveFrom(m), to = moveTo(m), kind = moveKind(m);
+    if (from == to || !(pos.byColor[Us] & squareBit(from)) || (pos.byColor[Us] & squareBit(to))) return false;
+    if (kind != PROMOTION && promotionType(m) != KNIGHT) return false; // Unused promotion bits are always zero
+    int type = pos.pieceTypeOn(from);
+    if (kind == CASTLING) {
+        MoveList castles;
+        if (type == KING) addCastlingMoves<Us>(pos, castles);
+        return castles.contains(m);
+    }
+    if (type == PAWN) {
+        Bitboard target = squareBit(to);
+        if ((kind == PROMOTION) != (rowOf(to) == Side::LAST_ROW)) return false; // Promoting exactly on the last row
+        if (kind == EN_PASSANT) return to == pos.enPassantSquare && (PAWN_ATTACKS[Us][from] & target);
+        if (PAWN_ATTACKS[Us][from] & target) return (pos.byColor[Side::THEM] & target) != 0;
+        if (pos.occupied & target) return false; // Pushes go to empty squares only
+        if (to == from + Side::FORWARD) return true;
+        return to == from + 2 * Side::FORWARD && rowOf(from + Side::FORWARD) == Side::DOUBLE_PUSH_ROW && !(pos.occupied & squareBit(from + Side::FORWARD));
+    }
+    if (kind != NORMAL_MOVE) return false;
+    Bitboard attacks = type == KNIGHT ? KNIGHT_ATTACKS[from] : type == BISHOP ? bishopAttacks(from, pos.occupied) :
+                       type == ROOK ? rookAttacks(from, pos.occupied) : type == QUEEN ? queenAttacks(from, pos.occupied) : KING_ATTACKS[from];
+    return (attacks & squareBit(to)) != 0;
+}
+
+bool isPseudoLegalMove(const Position& pos, Move m) {
+    return pos.sideToMove == WHITE ? isPseudoLegalMove<WHITE>(pos, m) : isPseudoLegalMove<BLACK>(pos, m);
+}
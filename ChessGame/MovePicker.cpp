@@ -0,0 +1,206 @@
+// MovePicker.cpp
+// Implementation of the staged move picker, the static exchange evaluation and the history table.
+#include <algorithm> // Include algorithm for max, min and swap
+#include <cstdlib> // Include cstdlib for abs
+#include <cstring> // Include cstring for memset
+#include "MovePicker.h" // Picker declarations
+using namespace std;
+
+static const int SEE_VALUES[PIECE_TYPE_NB] = {100, 320, 330, 500, 900, 20000}; // The king "costs" more than any exchange can win
+
+// Swap-list algorithm: gains[d] is what the side making capture d has won so far if the exchange ended there.
+// Walking the list backwards, each side picks between stopping and going on, whichever is better for it.
+int staticExchange(const Position& pos, Move m) {
+    int from = moveFrom(m), to = moveTo(m), kind = moveKind(m);
+    if (kind == CASTLING) return 0;
+    int gains[32]; // At most 32 pieces can take part
+    Bitboard occupied = pos.occupied ^ squareBit(from);
+    int onSquare = pos.pieceTypeOn(from); // Piece standing on the square after the last capture
+    if (kind == EN_PASSANT) {
+        occupied ^= squareBit(to + (pos.sideToMove == WHITE ? 8 : -8)); // The captured pawn is beside the mover, not on 'to'
+        gains[0] = SEE_VALUES[PAWN];
+    } else {
+        gains[0] = (pos.occupied & squareBit(to)) ? SEE_VALUES[pos.pieceTypeOn(to)] : 0;
+    }
+    if (kind == PROMOTION) {
+        onSquare = promotionType(m);
+        gains[0] += SEE_VALUES[onSquare] - SEE_VALUES[PAWN];
+    }
+    int side = pos.sideToMove ^ 1, depth = 1;
+    Bitboard attackers = pos.attackersTo(to, occupied) & occupied;
+    for (; depth < 32; depth++, side ^= 1) {
+        Bitboard ours = attackers & pos.byColor[side];
+        if (!ours) break;
+        int type = PAWN;
+        while (!(ours & pos.byType[type])) type++; // Least valuable attacker first
+        if (type == KING && (attackers & pos.byColor[side ^ 1])) break; // The king cannot capture onto a defended square
+        gains[depth] = SEE_VALUES[onSquare] - gains[depth - 1];
+        occupied ^= squareBit(lsb(ours & pos.byType[type]));
+        attackers = pos.attackersTo(to, occupied) & occupied; // Sliders behind the capturer now see the square
+        onSquare = type;
+    }
+    while (--depth > 0) gains[depth - 1] = -max(-gains[depth - 1], gains[depth]); // Stopping is always an option
+    return gains[0];
+}
+
+// Cheap filter for moves that can give check: the piece attacks the king from its new square, or it leaves a line
+// between the king and one of our sliders (discovered check). A promotion checks with the new piece, and en passant
+// also uncovers the square of the pawn it takes. Castling is always let through. Exact test is done by making the move.
+bool mayGiveCheck(const Position& pos, Move m, int king) {
+    if (king == NO_SQUARE) return false;
+    int from = moveFrom(m), to = moveTo(m), us = pos.sideToMove, kind = moveKind(m);
+    if (kind == CASTLING) return true;
+    Bitboard occ = (pos.occupied ^ squareBit(from)) | squareBit(to);
+    int type = kind == PROMOTION ? promotionType(m) : pos.pieceTypeOn(from);
+    Bitboard direct = type == PAWN ? PAWN_ATTACKS[us][to] : type == KNIGHT ? KNIGHT_ATTACKS[to] :
+                      type == BISHOP ? bishopAttacks(to, occ) : type == ROOK ? rookAttacks(to, occ) :
+                      type == QUEEN ? queenAttacks(to, occ) : 0;
+    if (direct & squareBit(king)) return true;
+    Bitboard sliders = pos.byColor[us] & (pos.byType[BISHOP] | pos.byType[ROOK] | pos.byType[QUEEN]);
+    if (kind == EN_PASSANT && (LINE_BB[king][to + (us == WHITE ? 8 : -8)] & sliders)) return true; // Behind the captured pawn
+    return (LINE_BB[king][from] & sliders) != 0; // Something of ours behind the moving piece on the king's line
+}
+
+void HistoryTable::clear() {
+    memset(table, 0, sizeof(table));
+}
+
+void HistoryTable::update(int color, Move m, int bonus) {
+    int16_t& entry = table[color][moveFrom(m)][moveTo(m)];
+    bonus = max(-HISTORY_MAX, min(HISTORY_MAX, bonus));
+    entry = int16_t(entry + bonus - entry * abs(bonus) / HISTORY_MAX); // Large scores move less: stays within +-HISTORY_MAX
+}
+
+void MovePicker::start(const Position& position, Move hash, const Move killerMoves[2], const HistoryTable& table) {
+    pos = &position;
+    history = &table;
+    moves.count = current = badCount = 0;
+    skipLosing = false;
+    killers[0] = killerMoves[0];
+    killers[1] = killerMoves[1];
+    hashMove = isUsable(hash) ? hash : MOVE_NONE;
+    stage = hashMove != MOVE_NONE ? HASH_MOVE : GENERATE_NOISY;
+}
+
+void MovePicker::startQuiescence(const Position& position, bool inCheck) {
+    pos = &position;
+    history = nullptr;
+    moves.count = current = badCount = 0;
+    skipLosing = !inCheck;
+    hashMove = killers[0] = killers[1] = MOVE_NONE;
+    stage = QS_GENERATE;
+}
+
+// Moves remembered from other nodes are checked against this position before being played.
+bool MovePicker::isUsable(Move m) const {
+    return m != MOVE_NONE && isPseudoLegalMove(*pos, m) && isLegalMove(*pos, m);
+}
+
+// Most valuable victim first, the cheapest attacker among equal victims; queen promotions go with capturing a queen.
+void MovePicker::scoreNoisy(int from) {
+    for (int i = from; i < moves.count; i++) {
+        Move m = moves.moves[i];
+        int to = moveTo(m);
+        int victim = moveKind(m) == EN_PASSANT ? PAWN : (pos->occupied & squareBit(to)) ? pos->pieceTypeOn(to) : NO_PIECE_TYPE;
+        int score = victim != NO_PIECE_TYPE ? 10000 + PIECE_VALUES[victim] * 8 - pos->pieceTypeOn(moveFrom(m)) : 0;
+        if (moveKind(m) == PROMOTION) score += PIECE_VALUES[promotionType(m)] * 8;
+        scores[i] = score;
+    }
+}
+
+void MovePicker::scoreQuiets(int from) {
+    for (int i = from; i < moves.count; i++) scores[i] = history->score(pos->sideToMove, moves.moves[i]);
+}
+
+// Selection instead of sorting: a node that cuts off after a move or two pays for a move or two.
+int MovePicker::selectBest() {
+    int best = current;
+    for (int i = current + 1; i < moves.count; i++) if (scores[i] > scores[best]) best = i;
+    swap(moves.moves[best], moves.moves[current]);
+    swap(scores[best], scores[current]);
+    return current++;
+}
+
+Move MovePicker::next() {
+    while (true) {
+        switch (stage) {
+        case HASH_MOVE:
+            stage = GENERATE_NOISY;
+            return hashMove;
+
+        case GENERATE_NOISY:
+            generateLegalMoves(*pos, moves, GEN_NOISY);
+            scoreNoisy(0);
+            stage = GOOD_NOISY;
+            break;
+
+        case GOOD_NOISY:
+            while (current < moves.count) {
+                Move m = moves.moves[selectBest()];
+                if (m == hashMove) continue;
+                int victim = (pos->occupied & squareBit(moveTo(m))) ? pos->pieceTypeOn(moveTo(m)) : PAWN; // En passant takes a pawn
+                if (PIECE_VALUES[pos->pieceTypeOn(moveFrom(m))] > PIECE_VALUES[victim] && staticExchange(*pos, m) < 0) {
+                    moves.moves[badCount++] = m; // Behind 'current': that slot was already handed out
+                    continue;
+                }
+                return m;
+            }
+            stage = KILLER_1;
+            break;
+
+        case KILLER_1:
+        case KILLER_2: {
+            Move killer = killers[stage - KILLER_1];
+            if (stage++ == KILLER_2 && killer == killers[0]) break;
+            if (killer != hashMove && !(pos->occupied & squareBit(moveTo(killer))) && (moveKind(killer) == NORMAL_MOVE || moveKind(killer) == CASTLING) &&
+                isUsable(killer)) {
+                return killer; // Still quiet here (a capture was already tried above)
+            }
+            break;
+        }
+
+        case GENERATE_QUIETS:
+            moves.count = current = badCount; // Quiet moves go after the losing captures
+            generateLegalMoves(*pos, moves, GEN_QUIETS);
+            scoreQuiets(current);
+            stage = QUIETS;
+            break;
+
+        case QUIETS:
+            while (current < moves.count) {
+                Move m = moves.moves[selectBest()];
+                if (m != hashMove && m != killers[0] && m != killers[1]) return m;
+            }
+            current = 0;
+            stage = BAD_NOISY;
+            break;
+
+        case BAD_NOISY:
+            if (current < badCount) return moves.moves[current++]; // Kept in MVV-LVA order
+            stage = DONE;
+            break;
+
+        case QS_GENERATE:
+            generateLegalMoves(*pos, moves, skipLosing ? GEN_NOISY : GEN_ALL); // In check: every evasion
+            scoreNoisy(0);
+            stage = QS_NOISY;
+            break;
+
+        case QS_NOISY:
+            while (current < moves.count) {
+                Move m = moves.moves[selectBest()];
+                if (skipLosing && moveKind(m) != PROMOTION && (pos->occupied & squareBit(moveTo(m))) &&
+                    PIECE_VALUES[pos->pieceTypeOn(moveFrom(m))] > PIECE_VALUES[pos->pieceTypeOn(moveTo(m))] && staticExchange(*pos, m) < 0 &&
+                    !mayGiveCheck(*pos, m, pos->kingSquare(pos->sideToMove ^ 1))) {
+                    continue; // A losing capture cannot raise the stand-pat score, unless the check it gives counts
+                }
+                return m;
+            }
+            stage = DONE;
+            break;
+
+        default:
+            return MOVE_NONE;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+// MovePicker.h
+// Move ordering for the search. Instead of generating every move and sorting the list, a node asks the picker for
+// one move at a time and the picker produces them in stages, doing only the work the node actually uses:
+//
+//   hash move -> good captures (MVV-LVA, SEE >= 0) -> killers -> quiet moves (by history) -> losing captures
+//
+// A cut-off on the hash move or a capture, the common case, never generates the quiet moves at all. Losing captures
+// (SEE < 0) are kept back until after the quiet moves, and the quiescence search skips them unless they may give
+// check (under the N-check rule a check is often worth more than the piece).
+#ifndef MOVEPICKER_H
+#define MOVEPICKER_H
+
+#include <cstdint> // Include cstdint for the history entries
+#include "Move.h" // Include the move list and the staged generator
+
+const int PIECE_VALUES[PIECE_TYPE_NB] = {100, 320, 330, 500, 900, 0}; // Rough material for move ordering (the king is never captured)
+const int HISTORY_MAX = 16384; // History scores stay within +-HISTORY_MAX
+
+// Material the side to move wins (negative: loses) with the capture 'm' if both sides then keep recapturing on the
+// destination square with their least valuable piece, each side free to stop when going on would lose more. Pieces
+// behind the capturers (x-rays) join in; pins are ignored. Zero for a quiet move.
+int staticExchange(const Position& pos, Move m);
+bool mayGiveCheck(const Position& pos, Move m, int king); // False only if 'm' surely does not check the king on 'king'
+
+// Butterfly history: for each color, source and destination square, how often the quiet move caused a beta cut-off,
+// weighted by depth. Good moves gain, the quiet moves searched before the one that cut off lose; every update pulls the
+// score back towards zero in proportion to its size ("gravity"), so old results fade and no entry overflows.
+class HistoryTable {
+private:
+    int16_t table[COLOR_NB][SQUARE_NB][SQUARE_NB];
+
+public:
+    HistoryTable() { clear(); }
+    void clear();
+    int score(int color, Move m) const { return table[color][moveFrom(m)][moveTo(m)]; }
+    void update(int color, Move m, int bonus); // Adding 'bonus' (negative for a malus) with gravity
+};
+
+// Produces the legal moves of one node, best-looking first. Lives in the per-ply search stack and is restarted at
+// every node, so picking moves never allocates.
+class MovePicker {
+private:
+    enum Stage { HASH_MOVE, GENERATE_NOISY, GOOD_NOISY, KILLER_1, KILLER_2, GENERATE_QUIETS, QUIETS, BAD_NOISY,
+                 QS_GENERATE, QS_NOISY, DONE };
+
+    const Position* pos;
+    const HistoryTable* history; // Null in the quiescence search
+    MoveList moves; // Losing captures at the front, then the moves of the current stage
+    int scores[MAX_MOVES]; // Ordering score of each move in 'moves'
+    int stage;
+    int current; // Next move of the current stage
+    int badCount; // Losing captures kept back in moves[0, badCount)
+    bool skipLosing; // Quiescence: losing captures are dropped, not kept back
+    Move hashMove;
+    Move killers[2];
+
+    void scoreNoisy(int from); // MVV-LVA scores for moves[from, count)
+    void scoreQuiets(int from); // History scores for moves[from, count)
+    int selectBest(); // Swapping the best remaining move of the stage to 'current' and returning its index
+    bool isUsable(Move m) const; // A hash move or killer that is legal in this position
+
+public:
+    MovePicker() : pos(nullptr), history(nullptr), stage(DONE), current(0), badCount(0), skipLosing(false), hashMove(MOVE_NONE) {}
+    // Main search: 'hash' (the transposition table or previous iteration's move, may be MOVE_NONE or stale) comes first.
+    void start(const Position& position, Move hash, const Move killerMoves[2], const HistoryTable& table);
+    // Quiescence search: captures and promotions that do not lose material, or every evasion when in check.
+    void startQuiescence(const Position& position, bool inCheck);
+    Move next(); // The next move to search, or MOVE_NONE when there are no more
+};
+
+#endif
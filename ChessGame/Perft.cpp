@@ -0,0 +1,202 @@
+// Perft.cpp
+// Implementation of perft, the threaded root split and the reference suite used as the move generator regression gate.
+#include <atomic> // Include atomic for handing out root moves to the worker threads
+#include <cctype> // Include cctype for isdigit
+#include <chrono> // Include chrono for timing the runs
+#include <cstdlib> // Include cstdlib for atoi
+#include <iomanip> // Include iomanip for formatting the report
+#include "MovePicker.h" // Include the staged picker and the check filter checked against the generator
+#include "Perft.h" // Perft declarations and reference positions
+using namespace std;
+
+// Published counts (chessprogramming.org "Perft Results"); positions 3 to 6 cover en passant, promotion and castling corner cases.
+const PerftCase PERFT_SUITE[] = {
+    {"start", START_FEN,
+     {20ULL, 400ULL, 8902ULL, 197281ULL, 4865609ULL, 119060324ULL}},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+     {48ULL, 2039ULL, 97862ULL, 4085603ULL, 193690690ULL, 0}},
+    {"en passant pins", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+     {14ULL, 191ULL, 2812ULL, 43238ULL, 674624ULL, 11030083ULL}},
+    {"promotions", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+     {6ULL, 264ULL, 9467ULL, 422333ULL, 15833292ULL, 0}},
+    {"castling rights", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+     {44ULL, 1486ULL, 62379ULL, 2103487ULL, 89941194ULL, 0}},
+    {"middlegame", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+     {46ULL, 2079ULL, 89890ULL, 3894594ULL, 0, 0}},
+};
+const int PERFT_SUITE_SIZE = sizeof(PERFT_SUITE) / sizeof(PERFT_SUITE[0]);
+
+uint64_t perft(ChessBoard& board, int depth) {
+    if (depth <= 0) return 1; // The position itself is the only leaf
+    MoveList moves; // Legal moves on the stack, no allocation per node
+    board.generateMoves(moves);
+    if (depth == 1) return moves.size(); // Bulk counting: every legal move is a leaf, no need to play them
+    uint64_t nodes = 0;
+    for (Move m : moves) {
+        board.makeMove(m);
+        nodes += perft(board, depth - 1);
+        board.unmakeMove();
+    }
+    return nodes;
+}
+
+uint64_t perftDivide(const ChessBoard& board, int depth, int threads, bool printDivide) {
+    if (depth <= 0) return 1;
+    MoveList rootMoves; // Root moves are shared out between the threads
+    board.generateMoves(rootMoves);
+    uint64_t counts[MAX_MOVES] = {}; // Leaf count below each root move, filled by whichever thread took it
+    atomic<int> nextRoot(0); // Index of the next root move nobody has taken yet
+
+    auto worker = [&]() { // Each thread walks the tree on its own copy of the board
+        ChessBoard local = board;
+        for (int i = nextRoot++; i < rootMoves.size(); i = nextRoot++) {
+            local.makeMove(rootMoves[i]);
+            counts[i] = perft(local, depth - 1);
+            local.unmakeMove();
+        }
+    };
+    if (threads < 1) threads = 1;
+    if (threads > rootMoves.size()) threads = rootMoves.size() > 0 ? rootMoves.size() : 1; // No point in idle threads
+    vector<thread> pool; // Helper threads; the calling thread works as well
+    for (int t = 1; t < threads; t++) pool.emplace_back(worker);
+    worker();
+    for (thread& t : pool) t.join();
+
+    uint64_t total = 0;
+    for (int i = 0; i < rootMoves.size(); i++) { // Divide output in generation order, whatever order the threads finished in
+        if (printDivide) cout << moveToString(rootMoves[i]) << ": " << counts[i] << "\n";
+        total += counts[i];
+    }
+    return total;
+}
+
+// Running one divide and printing the totals with the speed.
+static uint64_t timedPerft(const ChessBoard& board, int depth, int threads, bool printDivide) {
+    auto start = chrono::steady_clock::now();
+    uint64_t nodes = perftDivide(board, depth, threads, printDivide);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Depth " << depth << "  nodes " << nodes << "  time " << fixed << setprecision(3) << seconds << "s  nps "
+         << (uint64_t)(seconds > 0 ? nodes / seconds : 0) << "\n";
+    cout.unsetf(ios::fixed);
+    return nodes;
+}
+
+// Checking the move picker on every position up to 'depth' plies below 'board': the noisy and quiet stages together give
+// exactly the legal moves, the picker hands out each legal move once, and mayGiveCheck lets through every move that
+// checks (a false negative would let the search miss the last check of the N-check rule). Returns the failure count.
+static int checkPicker(ChessBoard& board, int depth, const HistoryTable& history) {
+    const Position& pos = board.position();
+    MoveList all, staged;
+    generateLegalMoves(pos, all);
+    generateLegalMoves(pos, staged, GEN_NOISY);
+    generateLegalMoves(pos, staged, GEN_QUIETS);
+    int failures = 0;
+    bool stagesMatch = staged.size() == all.size();
+    for (Move m : all) if (!staged.contains(m)) stagesMatch = false;
+    if (!stagesMatch) {
+        cout << "   FAILED: staged generation differs from the legal moves in " << board.toFen() << "\n";
+        failures++;
+    }
+
+    MovePicker picker;
+    const Move noKillers[2] = {MOVE_NONE, MOVE_NONE};
+    picker.start(pos, MOVE_NONE, noKillers, history);
+    MoveList picked;
+    bool pickedOnce = true;
+    for (Move m = picker.next(); m != MOVE_NONE; m = picker.next()) {
+        if (!all.contains(m) || picked.contains(m)) { // Illegal or repeated
+            pickedOnce = false;
+            break;
+        }
+        picked.add(m);
+    }
+    if (!pickedOnce || picked.size() != all.size()) {
+        cout << "   FAILED: the move picker does not yield each legal move once in " << board.toFen() << "\n";
+        failures++;
+    }
+
+    int king = pos.kingSquare(pos.sideToMove ^ 1);
+    for (Move m : all) {
+        board.makeMove(m);
+        bool givesCheck = pos.inCheck(pos.sideToMove);
+        if (depth > 1) failures += checkPicker(board, depth - 1, history);
+        board.unmakeMove();
+        if (givesCheck && !mayGiveCheck(pos, m, king)) {
+            cout << "   FAILED: mayGiveCheck misses the check " << moveToString(m) << " in " << board.toFen() << "\n";
+            failures++;
+        }
+    }
+    return failures;
+}
+
+bool runPerftSuite(int maxDepth, int threads) {
+    bool allPassed = true;
+    uint64_t totalNodes = 0;
+    static const HistoryTable history; // Empty: ordering is not what is checked, only that nothing is lost or repeated
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < PERFT_SUITE_SIZE; i++) {
+        const PerftCase& test = PERFT_SUITE[i];
+        ChessBoard board;
+        board.loadFen(test.fen);
+        cout << "== " << test.name << " (" << test.fen << ")\n";
+        for (int depth = 1; depth <= maxDepth && depth <= 6 && test.counts[depth - 1]; depth++) {
+            uint64_t nodes = timedPerft(board, depth, threads, false);
+            totalNodes += nodes;
+            if (nodes != test.counts[depth - 1]) { // A wrong count means the generator or make/unmake is broken
+                cout << "   FAILED: expected " << test.counts[depth - 1] << "\n";
+                allPassed = false;
+            }
+        }
+        if (checkPicker(board, maxDepth < 3 ? maxDepth : 3, history) != 0) allPassed = false; // Move ordering and check filter
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << (allPassed ? "All perft counts match" : "Perft MISMATCH") << "  (" << totalNodes << " nodes, "
+         << (uint64_t)(seconds > 0 ? totalNodes / seconds : 0) << " nps)\n";
+    return allPassed;
+}
+
+// Usage:
+//   ChessGame --perft <depth> [--fen <FEN>] [--file <save>] [--threads N]
+//   ChessGame --perft-suite [maxDepth] [--threads N]
+int perftMain(int argc, char* argv[]) {
+    string mode = argv[1]; // --perft or --perft-suite
+    int depth = mode == "--perft-suite" ? 5 : 0; // The suite defaults to depth 5 (a few hundred million nodes)
+    int threads = (int)thread::hardware_concurrency(); // All cores by default
+    if (threads < 1) threads = 1;
+    string fen = START_FEN, file; // Start position unless told otherwise
+
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (arg == "--file" && i + 1 < argc) file = argv[++i];
+        else if (arg == "--fen") { // The FEN may come as one quoted argument or as its six space-separated fields
+            fen.clear();
+            while (i + 1 < argc && string(argv[i + 1]).compare(0, 2, "--") != 0) fen += string(fen.empty() ? "" : " ") + argv[++i];
+        }
+        else if (arg == "startpos") fen = START_FEN;
+        else if (isdigit((unsigned char)arg[0])) depth = atoi(arg.c_str());
+        else {
+            cerr << "Unknown perft option: " << arg << "\n";
+            return 2;
+        }
+    }
+    if (depth < 1 || depth > MAX_SEARCH_PLY) {
+        cerr << "Usage: --perft <depth> [--fen <FEN> | --file <save>] [--threads N]\n"
+                "       --perft-suite [maxDepth] [--threads N]\n";
+        return 2;
+    }
+    if (mode == "--perft-suite") return runPerftSuite(depth, threads) ? 0 : 1;
+
+    ChessBoard board;
+    if (!file.empty()) { // Position from one of the game's own save files
+        if (!board.loadGame(file)) {
+            cerr << "Cannot load " << file << "\n";
+            return 2;
+        }
+    } else if (!board.loadFen(fen)) {
+        cerr << "Invalid FEN: " << fen << "\n";
+        return 2;
+    }
+    timedPerft(board, depth, threads, true);
+    return 0;
+}
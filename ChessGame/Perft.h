@@ -0,0 +1,24 @@
+// Perft.h
+// Move generator checks: perft leaf counts, divide output per root move, and the reference positions with their known counts.
+#ifndef PERFT_H
+#define PERFT_H
+
+#include <cstdint> // Include cstdint for 64-bit node counters
+#include "ChessGame.h" // Include the board (makeMove / unmakeMove / generateMoves)
+
+// A reference position with its published leaf counts for depth 1, 2, 3, ...
+struct PerftCase {
+    const char* name; // Short label printed in the report
+    const char* fen; // Position in Forsyth-Edwards Notation
+    uint64_t counts[6]; // Known leaf counts by depth (0 marks the end)
+};
+
+extern const PerftCase PERFT_SUITE[]; // Start position, "Kiwipete", en passant, promotion and castling edge cases
+extern const int PERFT_SUITE_SIZE; // Number of reference positions
+
+uint64_t perft(ChessBoard& board, int depth); // Counting the leaf nodes of the legal move tree 'depth' plies deep
+uint64_t perftDivide(const ChessBoard& board, int depth, int threads, bool printDivide); // Splitting the root moves over threads
+bool runPerftSuite(int maxDepth, int threads); // Checking every reference position up to 'maxDepth' (true if all counts match)
+int perftMain(int argc, char* argv[]); // Command-line entry for --perft and --perft-suite, returning the process exit code
+
+#endif
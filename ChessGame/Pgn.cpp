@@ -0,0 +1,338 @@
+// Pgn.cpp
+// Implementation of the PGN reader, the SAN parser and the game replay used by --pgn.
+#include <chrono> // Include chrono for timing the replay
+#include <cstring> // Include cstring for memchr
+#include <iomanip> // Include iomanip for formatting the report
+#include "Pgn.h" // PGN declarations
+using namespace std;
+
+const size_t PGN_BLOCK_SIZE = 1 << 20; // Bytes read from the file at a time
+
+void PgnGame::clear() {
+    tagCount = 0;
+    moveText.clear();
+    offset = 0;
+}
+
+void PgnGame::addTag(const string& name, const string& value) {
+    if (tagCount == tags.size()) tags.push_back(make_pair(string(), string())); // Growing only past the largest game so far
+    tags[tagCount].first.assign(name);
+    tags[tagCount].second.assign(value);
+    tagCount++;
+}
+
+string PgnGame::tag(const string& name) const {
+    for (size_t i = 0; i < tagCount; i++) if (tags[i].first == name) return tags[i].second;
+    return "";
+}
+
+PgnReader::PgnReader(const string& filename, bool moveList)
+    : file(nullptr), ownsFile(true), oneGamePerLine(moveList), buffer(PGN_BLOCK_SIZE), bufferPos(0), bufferEnd(0), fileOffset(0), haveLine(false),
+      lineOffset(0) {
+    if (filename == "-") {
+        file = stdin;
+        ownsFile = false;
+    } else {
+        file = fopen(filename.c_str(), "rb");
+    }
+}
+
+PgnReader::~PgnReader() {
+    if (file && ownsFile) fclose(file);
+}
+
+bool PgnReader::readLine() {
+    line.clear();
+    lineOffset = fileOffset;
+    bool gotAny = false; // Whether the last line of a file without a final newline has some text
+    while (true) {
+        if (bufferPos == bufferEnd) { // Buffer used up: read the next block
+            bufferEnd = file ? fread(buffer.data(), 1, buffer.size(), file) : 0;
+            bufferPos = 0;
+            if (bufferEnd == 0) return gotAny;
+        }
+        const char* start = buffer.data() + bufferPos;
+        const char* newline = static_cast<const char*>(memchr(start, '\n', bufferEnd - bufferPos));
+        size_t length = newline ? size_t(newline - start) : bufferEnd - bufferPos; // Up to the newline or the end of the block
+        line.append(start, length);
+        bufferPos += length;
+        fileOffset += length;
+        gotAny = true;
+        if (newline) {
+            bufferPos++; // Step over the newline
+            fileOffset++;
+            if (!line.empty() && line[line.size() - 1] == '\r') line.resize(line.size() - 1); // Files written on Windows
+            return true;
+        }
+    }
+}
+
+// A game is its tag lines followed by its move text; it ends where the next game's first tag line starts (or at the
+// end of the file). A '[' inside a comment that spans lines does not start a game.
+bool PgnReader::nextGame(PgnGame& game) {
+    game.clear();
+    bool started = false, inMoves = false; // Whether the game has any lines yet, and whether the tags are over
+    int commentDepth = 0; // Inside a {...} comment at the start of the next line
+    while (haveLine || readLine()) {
+        haveLine = false;
+        size_t first = line.find_first_not_of(" \t");
+        if (oneGamePerLine) { // Move-list mode: the line is the game
+            if (first == string::npos) continue;
+            game.offset = lineOffset;
+            game.moveText.assign(line);
+            return true;
+        }
+        if (first == string::npos || (line[0] == '%' && commentDepth == 0)) continue; // Blank or escaped line
+        if (line[first] == '[' && commentDepth == 0) { // Tag pair such as [White "Carlsen"]
+            if (inMoves) { // Start of the next game: keep the line for the next call
+                haveLine = true;
+                return true;
+            }
+            if (!started) game.offset = lineOffset;
+            started = true;
+            size_t nameEnd = line.find_first_of(" \t\"", first + 1);
+            size_t quote = line.find('"', first);
+            size_t closing = line.rfind('"');
+            if (nameEnd == string::npos || quote == string::npos || closing <= quote) continue; // Malformed tag: skipped
+            game.addTag(line.substr(first + 1, nameEnd - first - 1), line.substr(quote + 1, closing - quote - 1));
+            continue;
+        }
+        if (!started) game.offset = lineOffset;
+        started = inMoves = true;
+        game.moveText.append(line);
+        game.moveText.push_back('\n'); // Keeps ';' comments from running into the next line
+        for (char c : line) { // Following comment nesting so a '[' in a comment is not taken as a tag
+            if (c == '{') commentDepth++;
+            else if (c == '}' && commentDepth > 0) commentDepth--;
+        }
+    }
+    return started;
+}
+
+static bool isResultToken(const char* t, int n) {
+    return (n == 3 && (memcmp(t, "1-0", 3) == 0 || memcmp(t, "0-1", 3) == 0)) || (n == 7 && memcmp(t, "1/2-1/2", 7) == 0) ||
+           (n == 1 && t[0] == '*');
+}
+
+// The token is taken apart from both ends: piece letter in front; marks, promotion and destination at the back;
+// whatever is left in between is the disambiguation.
+Move parseSan(const Position& pos, const char* text, int length) {
+    while (length > 0 && (text[length - 1] == '+' || text[length - 1] == '#' || text[length - 1] == '!' || text[length - 1] == '?')) length--;
+    if (length < 2) return MOVE_NONE;
+
+    if (text[0] == 'O' || text[0] == '0') { // Castling: "O-O" king's side, "O-O-O" queen's side (zeros are also seen)
+        bool kingSide;
+        if (length == 3 && text[1] == '-' && text[2] == text[0]) kingSide = true;
+        else if (length == 5 && text[1] == '-' && text[2] == text[0] && text[3] == '-' && text[4] == text[0]) kingSide = false;
+        else return MOVE_NONE;
+        MoveList moves; // Castling has the most conditions, the generator already checks them all
+        generateLegalMoves(pos, moves);
+        for (Move m : moves) {
+            if (moveKind(m) == CASTLING && (moveTo(m) > moveFrom(m)) == kingSide) return m;
+        }
+        return MOVE_NONE;
+    }
+
+    int type = PAWN; // Piece letter first, pawn moves have none
+    if (text[0] == 'N' || text[0] == 'B' || text[0] == 'R' || text[0] == 'Q' || text[0] == 'K') {
+        type = pieceTypeOf(text[0]);
+        text++;
+        length--;
+    }
+    int promotion = NO_PIECE_TYPE; // "=Q" or a bare "Q" after the destination
+    if (type == PAWN && length >= 3) {
+        char last = text[length - 1];
+        if (last == 'N' || last == 'B' || last == 'R' || last == 'Q' || (text[length - 2] == '=' && last >= 'a' && last <= 'z')) {
+            promotion = pieceTypeOf(last);
+            length -= text[length - 2] == '=' ? 2 : 1;
+            if (promotion == NO_PIECE_TYPE || promotion == PAWN || promotion == KING) return MOVE_NONE;
+        }
+    }
+    if (length < 2) return MOVE_NONE;
+    char toFile = text[length - 2], toRank = text[length - 1]; // Destination is always the last two characters
+    if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8') return MOVE_NONE;
+    int to = squareOf('8' - toRank, toFile - 'a');
+    length -= 2;
+    if (length > 0 && (text[length - 1] == 'x' || text[length - 1] == ':')) length--; // Capture mark
+    int fromCol = -1, fromRow = -1; // Optional disambiguation: file, rank or both
+    for (int i = 0; i < length; i++) {
+        if (text[i] >= 'a' && text[i] <= 'h') fromCol = text[i] - 'a';
+        else if (text[i] >= '1' && text[i] <= '8') fromRow = '8' - text[i];
+        else if (text[i] != '-') return MOVE_NONE; // "e2-e4" style separators are tolerated
+    }
+
+    // Instead of generating every legal move, only the pieces that could reach the destination are looked at: for
+    // pieces the attack tables run backwards from the destination, for pawns the squares behind it.
+    int us = pos.sideToMove, them = us ^ 1;
+    if (pos.byColor[us] & squareBit(to)) return MOVE_NONE; // Own piece on the destination
+    int kind = NORMAL_MOVE;
+    Bitboard candidates; // Pieces of the right type that could make the move
+    if (type == PAWN) {
+        int back = us == WHITE ? 8 : -8; // Square step back towards the pawn's own side (row 0 is rank 8)
+        if (fromCol >= 0 && fromCol != colOf(to)) { // Capture, the file is always written
+            candidates = PAWN_ATTACKS[them][to] & pos.pieces(us, PAWN); // Where one of our pawns would attack 'to' from
+            if (to == pos.enPassantSquare) kind = EN_PASSANT;
+            else if (!(pos.byColor[them] & squareBit(to))) return MOVE_NONE; // Nothing to capture
+        } else { // Push of one square, or two from the pawn's first row
+            if (pos.occupied & squareBit(to)) return MOVE_NONE;
+            int from = to + back;
+            if (from < 0 || from >= SQUARE_NB) return MOVE_NONE;
+            if (!(pos.occupied & squareBit(from)) && rowOf(to) == (us == WHITE ? 4 : 3)) from += back; // Double step
+            candidates = pos.pieces(us, PAWN) & squareBit(from);
+        }
+        if (rowOf(to) == (us == WHITE ? 0 : 7)) { // Reaching the last row: the token must say what the pawn becomes
+            if (promotion == NO_PIECE_TYPE) return MOVE_NONE;
+            kind = PROMOTION;
+        } else if (promotion != NO_PIECE_TYPE) {
+            return MOVE_NONE;
+        }
+    } else {
+        candidates = pos.attacksFrom(type, us, to) & pos.pieces(us, type); // Every piece move is symmetric
+    }
+    if (fromCol >= 0) candidates &= FILE_A_BB << fromCol;
+    if (fromRow >= 0) candidates &= rowBB(fromRow);
+
+    Move found = MOVE_NONE;
+    while (candidates) {
+        Move m = encodeMove(popLsb(candidates), to, kind, kind == PROMOTION ? promotion : KNIGHT);
+        if (!isLegalMove(pos, m)) continue; // Pinned, or leaves the king in check
+        if (found != MOVE_NONE) return MOVE_NONE; // Two pieces fit: the token is ambiguous
+        found = m;
+    }
+    return found;
+}
+
+bool replayGame(const PgnGame& game, ChessBoard& board, ReplayResult& result) {
+    result.plies = 0;
+    result.checks[WHITE] = result.checks[BLACK] = 0;
+    result.checkLimitPly = 0;
+    result.checkLimitWinner = COLOR_NB;
+    result.result.clear();
+    result.error.clear();
+    result.moves.clear();
+
+    string fen = game.tag("FEN");
+    if (fen.empty()) {
+        board.resetBoard();
+    } else if (!board.loadFen(fen)) {
+        result.error = "bad FEN tag \"" + fen + "\"";
+        return false;
+    }
+    result.start = board.position();
+
+    const char* p = game.moveText.c_str();
+    while (*p) {
+        char c = *p;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '.') { p++; continue; }
+        if (c == '{') { // Comment up to the closing brace
+            const char* close = strchr(p, '}');
+            p = close ? close + 1 : p + strlen(p);
+            continue;
+        }
+        if (c == ';') { // Comment up to the end of the line
+            const char* newline = strchr(p, '\n');
+            p = newline ? newline + 1 : p + strlen(p);
+            continue;
+        }
+        if (c == '(') { // Variation, possibly with variations and comments inside
+            int depth = 0;
+            for (; *p; p++) {
+                if (*p == '{') { const char* close = strchr(p, '}'); if (!close) break; p = close; }
+                else if (*p == '(') depth++;
+                else if (*p == ')' && --depth == 0) { p++; break; }
+            }
+            continue;
+        }
+        if (c == '$' || c == ')') { // Numeric annotation glyph, or a stray closing bracket
+            p++;
+            while (*p >= '0' && *p <= '9') p++;
+            continue;
+        }
+
+        const char* token = p; // Anything else runs up to the next separator
+        while (*p && !strchr(" \t\n\r{};()$", *p)) p++;
+        int length = int(p - token);
+        if (isResultToken(token, length)) { // Game termination marker ends the move text
+            result.result.assign(token, length);
+            break;
+        }
+        if (token[0] >= '1' && token[0] <= '9') { // Move number, "12." or "12..." or glued to its move as "12.e4"
+            while (length > 0 && *token >= '0' && *token <= '9') { token++; length--; }
+            while (length > 0 && *token == '.') { token++; length--; }
+            if (length == 0) continue;
+        }
+        Move m = parseSan(board.position(), token, length);
+        if (m == MOVE_NONE && length >= 4 && length <= 5) m = board.parseMove(string(token, length)); // Long algebraic
+        if (m == MOVE_NONE) {
+            const Position& pos = board.position();
+            result.error = "illegal or ambiguous move " + to_string(pos.fullMoveNumber) + (pos.sideToMove == WHITE ? ". " : "... ") +
+                           string(token, length);
+            return false;
+        }
+        int mover = board.isWhiteToMove() ? WHITE : BLACK;
+        board.playMove(m);
+        result.moves.push_back(m);
+        result.plies++;
+        if (board.isKingInCheck(mover == BLACK)) { // The move gave check
+            result.checks[mover]++;
+            if (!result.checkLimitPly && result.checks[WHITE] + result.checks[BLACK] >= CHECK_LIMIT) {
+                result.checkLimitPly = result.plies;
+                result.checkLimitWinner = mover;
+            }
+        }
+    }
+    return true;
+}
+
+// Usage:
+//   ChessGame --pgn <file.pgn | -> [--moves] [--list]
+// Replays every game, reports the illegal ones, and prints the throughput. With --list every game gets a line with
+// its result, length, checks and final position. --moves reads a move list (one game per line) instead of PGN.
+int pgnMain(int argc, char* argv[]) {
+    string filename;
+    bool list = false, moveList = false;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--list") list = true;
+        else if (arg == "--moves") moveList = true;
+        else if (filename.empty()) filename = arg;
+        else {
+            cerr << "Unknown pgn option: " << arg << "\n";
+            return 2;
+        }
+    }
+    if (filename.empty()) {
+        cerr << "Usage: --pgn <file.pgn | -> [--moves] [--list]\n";
+        return 2;
+    }
+    PgnReader reader(filename, moveList);
+    if (!reader.isOpen()) {
+        cerr << "Cannot open " << filename << "\n";
+        return 2;
+    }
+
+    ChessBoard board; // One board for the whole file, set up again for each game
+    PgnGame game; // Reused so the strings keep their memory
+    ReplayResult replay;
+    uint64_t games = 0, moves = 0, bad = 0;
+    auto start = chrono::steady_clock::now();
+    while (reader.nextGame(game)) {
+        games++;
+        bool ok = replayGame(game, board, replay);
+        moves += replay.plies;
+        if (!ok) {
+            bad++;
+            cout << "Game " << games << " (" << game.tag("White") << " - " << game.tag("Black") << ", offset " << game.offset
+                 << "): " << replay.error << "\n";
+        } else if (list) {
+            cout << games << " " << (replay.result.empty() ? "?" : replay.result) << " plies " << replay.plies << " checks "
+                 << replay.checks[WHITE] << "/" << replay.checks[BLACK] << " " << board.toFen() << "\n";
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << games << " games, " << moves << " moves, " << bad << " with errors  time " << fixed << setprecision(3) << seconds
+         << "s  " << (uint64_t)(seconds > 0 ? moves / seconds : 0) << " moves/s  " << setprecision(1)
+         << (seconds > 0 ? reader.bytesRead() / seconds / (1024 * 1024) : 0) << " MB/s\n";
+    cout.unsetf(ios::fixed);
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,75 @@
+// Pgn.h
+// Portable Game Notation: a streaming reader that hands out one game at a time, a Standard Algebraic Notation
+// move parser, and the replay that plays a game's moves through the board to check them.
+#ifndef PGN_H
+#define PGN_H
+
+#include <cstdio> // Include cstdio for the buffered file reads
+#include <string> // Include string for tags and move text
+#include <utility> // Include utility for the tag pairs
+#include <vector> // Include vector for the tag list and the read buffer
+#include "ChessGame.h" // Include the board the moves are replayed on
+
+// One game as it appears in the file. The strings keep their capacity between games, so a reader that is handed
+// the same PgnGame over and over stops allocating after the first few games.
+struct PgnGame {
+    std::vector<std::pair<std::string, std::string> > tags; // Tag pairs in file order, e.g. ("White", "Carlsen")
+    size_t tagCount; // Tags in use (entries past this are spare capacity)
+    std::string moveText; // Everything after the tags: move numbers, SAN moves, comments, variations and the result
+    uint64_t offset; // Byte offset of the game's first line in the file
+
+    PgnGame() : tagCount(0), offset(0) {}
+    void clear(); // Emptying the game but keeping the memory
+    void addTag(const std::string& name, const std::string& value); // Appending a tag pair
+    std::string tag(const std::string& name) const; // Value of a tag, or "" if the game does not have it
+};
+
+// Reads a PGN file of any size in fixed-size blocks; only the block and the current game are held in memory.
+// In move-list mode every non-blank line is a whole game: its moves (SAN or long algebraic) and maybe a result, no tags.
+class PgnReader {
+private:
+    FILE* file; // Open file, or nullptr
+    bool ownsFile; // False when reading standard input
+    bool oneGamePerLine; // Move-list mode instead of PGN
+    std::vector<char> buffer; // Block of the file read ahead
+    size_t bufferPos; // Next unread byte in the buffer
+    size_t bufferEnd; // Bytes of the buffer holding data
+    uint64_t fileOffset; // Offset of buffer[bufferPos] in the file
+    std::string line; // Current line (reused between calls)
+    bool haveLine; // 'line' was read ahead and not used yet (the first tag line of the next game)
+    uint64_t lineOffset; // Offset of 'line' in the file
+
+    bool readLine(); // Reading the next line into 'line' (false at the end of the file)
+
+public:
+    explicit PgnReader(const std::string& filename, bool moveList = false); // "-" reads standard input
+    ~PgnReader();
+    bool isOpen() const { return file != nullptr; }
+    bool nextGame(PgnGame& game); // Reading the next game (false when the file has no more games)
+    uint64_t bytesRead() const { return fileOffset; } // Bytes consumed so far
+};
+
+// Legal move named by a SAN token such as "e4", "Nbd7", "exd6", "R1e2+", "e8=Q#", "O-O-O" or "0-0" (trailing check,
+// mate and annotation marks are ignored). Returns MOVE_NONE if the token is malformed, illegal or ambiguous.
+Move parseSan(const Position& pos, const char* text, int length);
+
+// What replaying one game found.
+struct ReplayResult {
+    int plies; // Moves played (up to the first bad one)
+    int checks[COLOR_NB]; // Checks given by White and by Black
+    int checkLimitPly; // Ply on which the N-check rule would have ended the game, or 0 if it never came up
+    int checkLimitWinner; // Side that gave that check, or COLOR_NB
+    std::string result; // Result token at the end of the move text ("1-0", "0-1", "1/2-1/2", "*"), or "" if missing
+    std::string error; // Empty if every move was legal, otherwise what went wrong and where
+    Position start; // Position the game started from
+    std::vector<Move> moves; // Moves played, in order (kept between calls so it stops allocating)
+};
+
+// Plays the game's main line (comments, variations and annotations skipped) on 'board', starting from the "FEN" tag
+// if there is one and from the normal start otherwise. Moves may be SAN or long algebraic ("g1f3", "e7e8q").
+// Returns true if every move was legal.
+bool replayGame(const PgnGame& game, ChessBoard& board, ReplayResult& result);
+
+int pgnMain(int argc, char* argv[]); // Command-line entry for --pgn, returning the process exit code
+
+#endif
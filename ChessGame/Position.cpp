@@ -0,0 +1,243 @@
+// Position.cpp
+// Implementation of the bitboard position core.
+#include <mutex> // Include mutex for call_once
+#include <sstream> // Include stringstream for splitting FEN fields
+#include "Position.h" // Position struct and piece constants
+#include "Eval.h" // Piece-square values and phase weights kept up to date by the piece changes
+#include "Profile.h" // Optional timing of the attack tests
+#include "Simd.h" // Mailbox of the whole board for writing FEN
+
+static_assert(sizeof(Position) <= 128, "Position must fit in two cache lines"); // Keeping copies cheap
+
+uint64_t ZOBRIST_PIECE[COLOR_NB][PIECE_TYPE_NB][SQUARE_NB]; // A piece of one color and type on one square
+uint64_t ZOBRIST_CASTLING[ALL_CASTLING + 1]; // Each combination of castling rights
+uint64_t ZOBRIST_EN_PASSANT[BOARD_SIZE]; // En passant target on each file
+uint64_t ZOBRIST_SIDE; // Black to move
+
+static void fillZobristKeys() {
+    uint64_t seed = 1070372; // Fixed seed: keys (and anything stored with them on disk) stay the same between runs
+    for (int color = 0; color < COLOR_NB; color++)
+        for (int type = 0; type < PIECE_TYPE_NB; type++)
+            for (int sq = 0; sq < SQUARE_NB; sq++) ZOBRIST_PIECE[color][type][sq] = nextRandom(seed);
+    ZOBRIST_CASTLING[0] = 0; // No rights: nothing to add to the key
+    for (int rights = 1; rights <= ALL_CASTLING; rights++) ZOBRIST_CASTLING[rights] = nextRandom(seed);
+    for (int col = 0; col < BOARD_SIZE; col++) ZOBRIST_EN_PASSANT[col] = nextRandom(seed);
+    ZOBRIST_SIDE = nextRandom(seed);
+}
+
+void initZobristKeys() {
+    static std::once_flag filled; // Refilling would race with make/unmake reading the keys on other threads
+    std::call_once(filled, fillZobristKeys);
+}
+
+PieceType pieceTypeOf(char symbol) {
+    switch (symbol) { // Matching both colors, the case only decides the color
+        case WHITE_PAWN: case BLACK_PAWN: return PAWN;
+        case WHITE_KNIGHT: case BLACK_KNIGHT: return KNIGHT;
+        case WHITE_BISHOP: case BLACK_BISHOP: return BISHOP;
+        case WHITE_ROOK: case BLACK_ROOK: return ROOK;
+        case WHITE_QUEEN: case BLACK_QUEEN: return QUEEN;
+        case WHITE_KING: case BLACK_KING: return KING;
+        default: return NO_PIECE_TYPE; // EMPTY or an unknown character
+    }
+}
+
+void Position::clear() {
+    for (int type = 0; type < PIECE_TYPE_NB; type++) byType[type] = 0; // No pieces of any type
+    byColor[WHITE] = byColor[BLACK] = occupied = 0; // No pieces of any color
+    key = pawnKey = 0; // Empty board, White to move, no rights and no en passant: nothing in the keys
+    psqScore[MIDDLEGAME] = psqScore[ENDGAME] = 0; // No material
+    phase = 0;
+    castlingRights = 0; // No castling rights on an empty board
+    enPassantSquare = NO_SQUARE; // No en passant target
+    sideToMove = WHITE; // White moves first by default
+    halfMoveClock = 0; // Fresh 50-move counter
+    fullMoveNumber = 1; // Games start at move 1
+}
+
+void Position::putPiece(int sq, int color, int type) {
+    Bitboard b = squareBit(sq); // Bit of the target square
+    byType[type] |= b; // Adding the piece to its type set
+    byColor[color] |= b; // Adding the piece to its color set
+    occupied |= b; // Marking the square as occupied
+    key ^= ZOBRIST_PIECE[color][type][sq]; // Adding the piece to the key
+    if (type == PAWN) pawnKey ^= ZOBRIST_PIECE[color][PAWN][sq];
+    psqScore[MIDDLEGAME] += PIECE_SQUARE[MIDDLEGAME][color][type][sq]; // Adding its value on this square
+    psqScore[ENDGAME] += PIECE_SQUARE[ENDGAME][color][type][sq];
+    phase += PHASE_WEIGHTS[type];
+}
+
+void Position::removePiece(int sq, int color, int type) {
+    Bitboard b = squareBit(sq); // Bit of the square being cleared
+    byType[type] ^= b; // Removing the piece from its type set
+    byColor[color] ^= b; // Removing the piece from its color set
+    occupied ^= b; // Marking the square as empty
+    key ^= ZOBRIST_PIECE[color][type][sq]; // Taking the piece out of the key
+    if (type == PAWN) pawnKey ^= ZOBRIST_PIECE[color][PAWN][sq];
+    psqScore[MIDDLEGAME] -= PIECE_SQUARE[MIDDLEGAME][color][type][sq]; // Taking its value out of the sums
+    psqScore[ENDGAME] -= PIECE_SQUARE[ENDGAME][color][type][sq];
+    phase -= PHASE_WEIGHTS[type];
+}
+
+void Position::relocatePiece(int from, int to, int color, int type) {
+    Bitboard b = squareBit(from) | squareBit(to); // Both squares flip at once
+    byType[type] ^= b; // The piece leaves 'from' and arrives on 'to'
+    byColor[color] ^= b;
+    occupied ^= b;
+    key ^= ZOBRIST_PIECE[color][type][from] ^ ZOBRIST_PIECE[color][type][to];
+    if (type == PAWN) pawnKey ^= ZOBRIST_PIECE[color][PAWN][from] ^ ZOBRIST_PIECE[color][PAWN][to];
+    psqScore[MIDDLEGAME] += PIECE_SQUARE[MIDDLEGAME][color][type][to] - PIECE_SQUARE[MIDDLEGAME][color][type][from];
+    psqScore[ENDGAME] += PIECE_SQUARE[ENDGAME][color][type][to] - PIECE_SQUARE[ENDGAME][color][type][from];
+}
+
+void Position::setSquare(int sq, char symbol) {
+    int oldType = pieceTypeOn(sq); // Whatever currently stands on the square
+    if (oldType != NO_PIECE_TYPE) removePiece(sq, colorOn(sq), oldType); // Clearing the square first
+    int newType = pieceTypeOf(symbol); // Type of the new piece, if any
+    if (newType != NO_PIECE_TYPE) putPiece(sq, symbol >= 'A' && symbol <= 'Z' ? WHITE : BLACK, newType); // Upper case is white
+}
+
+int Position::pieceTypeOn(int sq) const {
+    Bitboard b = squareBit(sq); // Bit of the square being looked up
+    if (!(occupied & b)) return NO_PIECE_TYPE; // Fast exit for empty squares
+    for (int type = PAWN; type < PIECE_TYPE_NB; type++) { // Testing each type set, pawns are the most common
+        if (byType[type] & b) return type;
+    }
+    return NO_PIECE_TYPE; // Not reachable while the sets are consistent
+}
+
+char Position::symbolOn(int sq) const {
+    int type = pieceTypeOn(sq); // Type of the piece on the square
+    return type == NO_PIECE_TYPE ? EMPTY : PIECE_SYMBOLS[colorOn(sq)][type]; // EMPTY or the colored symbol
+}
+
+int Position::kingSquare(int color) const {
+    Bitboard king = pieces(color, KING); // The king set holds at most one bit per color
+    return king ? lsb(king) : NO_SQUARE; // NO_SQUARE if the king is missing (should not happen in a valid game)
+}
+
+Bitboard Position::attacksFrom(int type, int color, int sq) const {
+    switch (type) { // Picking the lookup table for the piece type
+        case PAWN: return PAWN_ATTACKS[color][sq];
+        case KNIGHT: return KNIGHT_ATTACKS[sq];
+        case BISHOP: return bishopAttacks(sq, occupied);
+        case ROOK: return rookAttacks(sq, occupied);
+        case QUEEN: return queenAttacks(sq, occupied); // A queen is a rook plus a bishop
+        case KING: return KING_ATTACKS[sq];
+        default: return 0; // An empty square attacks nothing
+    }
+}
+
+Bitboard Position::attackersTo(int sq, Bitboard occ) const {
+    PROFILE_SCOPE(PROFILE_ATTACKERS);
+    // Looking from the target square outwards: a piece attacks 'sq' if the same piece on 'sq' would attack it back.
+    Bitboard queens = byType[QUEEN]; // Queens slide both ways
+    return (PAWN_ATTACKS[WHITE][sq] & pieces(BLACK, PAWN)) // Black pawns sit where a white pawn on 'sq' would capture
+         | (PAWN_ATTACKS[BLACK][sq] & pieces(WHITE, PAWN)) // White pawns sit where a black pawn on 'sq' would capture
+         | (KNIGHT_ATTACKS[sq] & byType[KNIGHT]) // Knights a knight's jump away
+         | (KING_ATTACKS[sq] & byType[KING]) // Kings next to the square
+         | (rookAttacks(sq, occ) & (byType[ROOK] | queens)) // Rooks and queens on an open line
+         | (bishopAttacks(sq, occ) & (byType[BISHOP] | queens)); // Bishops and queens on an open diagonal
+}
+
+bool Position::isSquareAttacked(int sq, int attackerColor) const {
+    return (attackersTo(sq, occupied) & byColor[attackerColor]) != 0; // Any attacker of the requested color
+}
+
+bool Position::inCheck(int color) const {
+    PROFILE_SCOPE(PROFILE_IN_CHECK);
+    int king = kingSquare(color); // Square of the king to test
+    return king != NO_SQUARE && isSquareAttacked(king, color ^ 1); // Attacked by the opposite color
+}
+
+bool Position::setFromFen(const std::string& fen) {
+    std::istringstream fields(fen); // FEN fields are separated by spaces
+    std::string placement, side, castling = "-", enPassant = "-"; // Castling and en passant default to "none"
+    int halfMoves = 0, fullMoves = 1; // The clocks are optional in shortened FENs
+    if (!(fields >> placement >> side)) return false; // Piece placement and side to move are required
+    fields >> castling >> enPassant >> halfMoves >> fullMoves;
+
+    Position parsed; // Filling a copy so a malformed FEN leaves this position untouched
+    parsed.clear();
+    int row = 0, col = 0; // Placement starts at a8 and runs along each row towards h
+    for (char c : placement) {
+        if (c == '/') { // Next row
+            if (col != BOARD_SIZE || ++row >= BOARD_SIZE) return false;
+            col = 0;
+        } else if (c >= '1' && c <= '8') { // A run of empty squares
+            col += c - '0';
+            if (col > BOARD_SIZE) return false;
+        } else { // A piece symbol
+            int type = pieceTypeOf(c);
+            if (type == NO_PIECE_TYPE || col >= BOARD_SIZE) return false;
+            parsed.putPiece(squareOf(row, col++), c >= 'A' && c <= 'Z' ? WHITE : BLACK, type);
+        }
+    }
+    if (row != BOARD_SIZE - 1 || col != BOARD_SIZE) return false; // All eight rows must be complete
+
+    if (side != "w" && side != "b") return false;
+    parsed.sideToMove = side == "w" ? WHITE : BLACK;
+    for (char c : castling) { // Any combination of KQkq, or "-"
+        if (c == 'K') parsed.castlingRights |= WHITE_KINGSIDE;
+        else if (c == 'Q') parsed.castlingRights |= WHITE_QUEENSIDE;
+        else if (c == 'k') parsed.castlingRights |= BLACK_KINGSIDE;
+        else if (c == 'q') parsed.castlingRights |= BLACK_QUEENSIDE;
+        else if (c != '-') return false;
+    }
+    if (enPassant != "-") { // Target square such as "e3"
+        if (enPassant.length() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h' || enPassant[1] < '1' || enPassant[1] > '8') return false;
+        int target = squareOf('8' - enPassant[1], enPassant[0] - 'a');
+        int them = parsed.sideToMove ^ 1; // Side whose pawn just made the double step
+        if (rowOf(target) != (them == WHITE ? 5 : 2)) return false; // Only the square behind a double step can be a target
+        // Kept only when a pawn can really capture there, the same rule makeMove follows, so the key matches the
+        // one the position gets when it is reached by playing the moves.
+        if (PAWN_ATTACKS[them][target] & parsed.pieces(parsed.sideToMove, PAWN)) parsed.enPassantSquare = target;
+    }
+    parsed.halfMoveClock = halfMoves;
+    parsed.fullMoveNumber = fullMoves;
+    parsed.key = parsed.computeKey(); // State fields were set directly, so the key is built once at the end
+    *this = parsed; // Accepting the parsed position
+    return true;
+}
+
+std::string Position::toFen() const {
+    std::string fen;
+    uint8_t codes[SQUARE_NB]; // Piece code of every square, written in one pass
+    bitboardsToMailbox(*this, codes);
+    for (int row = 0; row < BOARD_SIZE; row++) { // Placement from a8 along each row, rows separated by '/'
+        int empty = 0; // Length of the current run of empty squares
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            int code = codes[squareOf(row, col)];
+            char symbol = code == NO_PIECE_CODE ? EMPTY : PIECE_SYMBOLS[code / PIECE_TYPE_NB][code % PIECE_TYPE_NB];
+            if (symbol == EMPTY) { empty++; continue; }
+            if (empty) fen += char('0' + empty);
+            empty = 0;
+            fen += symbol;
+        }
+        if (empty) fen += char('0' + empty);
+        if (row < BOARD_SIZE - 1) fen += '/';
+    }
+    fen += sideToMove == WHITE ? " w " : " b ";
+    if (castlingRights & WHITE_KINGSIDE) fen += 'K';
+    if (castlingRights & WHITE_QUEENSIDE) fen += 'Q';
+    if (castlingRights & BLACK_KINGSIDE) fen += 'k';
+    if (castlingRights & BLACK_QUEENSIDE) fen += 'q';
+    if (!castlingRights) fen += '-';
+    fen += ' ';
+    fen += enPassantSquare == NO_SQUARE ? std::string("-") : std::string(1, char('a' + colOf(enPassantSquare))) + char('8' - rowOf(enPassantSquare));
+    return fen + " " + std::to_string(halfMoveClock) + " " + std::to_string(fullMoveNumber);
+}
+
+uint64_t Position::computeKey() const {
+    uint64_t k = 0;
+    for (int color = 0; color < COLOR_NB; color++) {
+        for (int type = 0; type < PIECE_TYPE_NB; type++) {
+            Bitboard b = pieces(color, type);
+            while (b) k ^= ZOBRIST_PIECE[color][type][popLsb(b)]; // Every piece on its square
+        }
+    }
+    k ^= ZOBRIST_CASTLING[castlingRights];
+    if (enPassantSquare != NO_SQUARE) k ^= ZOBRIST_EN_PASSANT[colOf(enPassantSquare)];
+    if (sideToMove == BLACK) k ^= ZOBRIST_SIDE;
+    return k;
+}
@@ -0,0 +1,90 @@
+// Position.h
+// Compact bitboard position: piece placement, castling rights, en passant square and move clocks in one POD struct.
+#ifndef POSITION_H
+#define POSITION_H
+
+#include <string> // Include string for FEN text
+#include "Bitboard.h" // Bitboard type, colors, piece types and attack generators
+
+const int BOARD_SIZE = 8;  // Setting the board size to 8x8 for a standard chess game
+const char EMPTY = '.'; // Constants for representing an empty square on the chessboard
+
+// Constants for representing white chess pieces(which is used to define the constant value: once the value is assigned it cannot be changed during the execution)
+const char WHITE_KING = 'K';  // 'K' stands for the white king
+const char WHITE_QUEEN = 'Q'; // 'Q' stands for the white queen
+const char WHITE_ROOK = 'R'; // 'R' stands for the white rook
+const char WHITE_BISHOP = 'B'; // 'B' stands for the white bishop
+const char WHITE_KNIGHT = 'N';// 'N' stands for the white knight
+const char WHITE_PAWN = 'P'; // 'P' stands for the white pawn
+
+// Constants for representing black chess pieces
+const char BLACK_KING = 'k'; // 'k' stands for the black king
+const char BLACK_QUEEN = 'q'; // 'q' stands for the black queen
+const char BLACK_ROOK = 'r'; // 'r' stands for the black rook
+const char BLACK_BISHOP = 'b'; // 'b' stands for the black bishop
+const char BLACK_KNIGHT = 'n'; // 'n' stands for the black knight
+const char BLACK_PAWN = 'p'; // 'p' stands for the black pawn
+
+// Symbols indexed by [color][piece type], matching the constants above
+const char PIECE_SYMBOLS[COLOR_NB][PIECE_TYPE_NB] = {
+    {WHITE_PAWN, WHITE_KNIGHT, WHITE_BISHOP, WHITE_ROOK, WHITE_QUEEN, WHITE_KING},
+    {BLACK_PAWN, BLACK_KNIGHT, BLACK_BISHOP, BLACK_ROOK, BLACK_QUEEN, BLACK_KING}};
+
+// Castling right flags stored together in Position::castlingRights
+const int WHITE_KINGSIDE = 1; // White may still castle on the king's side
+const int WHITE_QUEENSIDE = 2; // White may still castle on the queen's side
+const int BLACK_KINGSIDE = 4; // Black may still castle on the king's side
+const int BLACK_QUEENSIDE = 8; // Black may still castle on the queen's side
+const int ALL_CASTLING = 15; // All four castling rights
+
+const char START_FEN[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"; // Standard starting position
+
+// Zobrist keys: one random number per feature of a position. A position's key is the XOR of the numbers of everything
+// in it, so a move only has to XOR out what it removes and XOR in what it adds. Filled once by initZobristKeys().
+extern uint64_t ZOBRIST_PIECE[COLOR_NB][PIECE_TYPE_NB][SQUARE_NB]; // A piece of one color and type on one square
+extern uint64_t ZOBRIST_CASTLING[ALL_CASTLING + 1]; // Each combination of castling rights
+extern uint64_t ZOBRIST_EN_PASSANT[BOARD_SIZE]; // En passant target on each file
+extern uint64_t ZOBRIST_SIDE; // Black to move
+
+void initZobristKeys(); // Filling the key tables (safe to call more than once and from any thread, only the first call fills them)
+
+PieceType pieceTypeOf(char symbol); // Converting a piece symbol to its type (NO_PIECE_TYPE for EMPTY or unknown symbols)
+
+// The whole game state that is needed to continue play from a position.
+// It is a plain struct (no pointers, no heap memory) so copying it is a couple of cache-line moves.
+struct Position {
+    Bitboard byType[PIECE_TYPE_NB]; // Squares holding each piece type, both colors together
+    Bitboard byColor[COLOR_NB]; // Squares holding white pieces and black pieces
+    Bitboard occupied; // All occupied squares
+    uint64_t key; // Zobrist key, kept up to date by every piece and state change
+    uint64_t pawnKey; // Zobrist key of the pawns alone (pawn-structure cache in Eval.h)
+    int16_t psqScore[2]; // Material plus piece-square sums for the middlegame and the endgame, White minus Black
+    uint8_t castlingRights; // Combination of the castling flags above
+    int8_t enPassantSquare; // Square a pawn can capture onto en passant, or NO_SQUARE
+    uint8_t sideToMove; // WHITE or BLACK
+    uint8_t phase; // Sum of the PHASE_WEIGHTS of the pieces on the board (how far from the endgame)
+    uint16_t halfMoveClock; // Half-moves since the last capture or pawn move (50-move rule)
+    uint16_t fullMoveNumber; // Move counter, incremented after Black's move
+
+    void clear(); // Emptying the board and resetting the state fields
+    void putPiece(int sq, int color, int type); // Placing a piece on an empty square
+    void removePiece(int sq, int color, int type); // Removing a known piece from a square
+    void relocatePiece(int from, int to, int color, int type); // Moving a known piece to an empty square
+    void setSquare(int sq, char symbol); // Replacing whatever is on a square with the given symbol (EMPTY clears it)
+    bool setFromFen(const std::string& fen); // Setting up the position from Forsyth-Edwards Notation (false if malformed)
+    std::string toFen() const; // Position in Forsyth-Edwards Notation (round-trips through setFromFen)
+    uint64_t computeKey() const; // Zobrist key built from scratch (for setting up positions; moves update 'key' instead)
+
+    Bitboard pieces(int color, int type) const { return byType[type] & byColor[color]; } // Pieces of one type and color
+    int pieceTypeOn(int sq) const; // Piece type on a square, or NO_PIECE_TYPE when empty
+    int colorOn(int sq) const { return (byColor[BLACK] & squareBit(sq)) ? BLACK : WHITE; } // Color of the piece on an occupied square
+    char symbolOn(int sq) const; // Symbol of the piece on a square, or EMPTY
+    int kingSquare(int color) const; // Square of the king of the given color, or NO_SQUARE
+
+    Bitboard attacksFrom(int type, int color, int sq) const; // Squares a piece of the given kind on 'sq' attacks
+    Bitboard attackersTo(int sq, Bitboard occ) const; // Pieces of both colors attacking a square with the given occupancy
+    bool isSquareAttacked(int sq, int attackerColor) const; // Checking if any piece of 'attackerColor' attacks a square
+    bool inCheck(int color) const; // Checking if the king of the given color is attacked
+};
+
+#endif
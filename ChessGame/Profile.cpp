@@ -0,0 +1,161 @@
+// Profile.cpp
+// Per-thread counter registry, the merged totals and the stats reports.
+#include <cstdlib> // Include cstdlib for atexit
+#include <fstream> // Include fstream for the JSON file
+#include <iomanip> // Include iomanip for the stats table
+#include <mutex> // Include mutex for the registry
+#include <vector> // Include vector for the list of live threads
+#include "Profile.h" // Profiling declarations
+using namespace std;
+
+thread_local ProfileCounters* PROFILE_COUNTERS = nullptr;
+
+static const char* const POINT_NAMES[PROFILE_POINT_NB] = {
+    "generateLegalMoves", "isLegalMove", "inCheck", "attackersTo", "makeMove", "unmakeMove", "evaluate", "ttProbe",
+    "parseMove", "movePiece", "hasLegalMoves"};
+
+static mutex REGISTRY_LOCK; // Guards the two below
+static vector<ProfileCounters*> LIVE_THREADS; // Counters of threads that are still running
+static ProfileCounters FINISHED; // Sum over threads that have ended (zero-initialized as a static)
+
+// Owned by its thread; registering and retiring happen once per thread, so the lock is never on the hot path.
+struct ProfileThread {
+    ProfileCounters counters;
+
+    ProfileThread() : counters() {
+        lock_guard<mutex> lock(REGISTRY_LOCK);
+        LIVE_THREADS.push_back(&counters);
+    }
+
+    ~ProfileThread() {
+        lock_guard<mutex> lock(REGISTRY_LOCK);
+        for (int p = 0; p < PROFILE_POINT_NB; p++) { // Keeping what the thread measured
+            ProfileCounter& from = counters.points[p];
+            ProfileCounter& to = FINISHED.points[p];
+            to.calls.fetch_add(from.calls.load(memory_order_relaxed), memory_order_relaxed);
+            to.timedCalls.fetch_add(from.timedCalls.load(memory_order_relaxed), memory_order_relaxed);
+            to.ticks.fetch_add(from.ticks.load(memory_order_relaxed), memory_order_relaxed);
+            for (int b = 0; b < PROFILE_BUCKETS; b++) to.histogram[b].fetch_add(from.histogram[b].load(memory_order_relaxed), memory_order_relaxed);
+        }
+        for (size_t i = 0; i < LIVE_THREADS.size(); i++) {
+            if (LIVE_THREADS[i] == &counters) {
+                LIVE_THREADS[i] = LIVE_THREADS.back();
+                LIVE_THREADS.pop_back();
+                break;
+            }
+        }
+    }
+};
+
+ProfileCounters* profileRegisterThread() {
+    static thread_local ProfileThread thread; // Built on the first call in each thread, retired when the thread ends
+    PROFILE_COUNTERS = &thread.counters;
+    return PROFILE_COUNTERS;
+}
+
+bool profileCompiledIn() {
+#ifdef CHESS_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char* profilePointName(ProfilePoint point) {
+    return POINT_NAMES[point];
+}
+
+const char* profileClockName() {
+#if defined(__x86_64__) || defined(__i386__)
+    return "tsc";
+#else
+    return "ns";
+#endif
+}
+
+static void addCounter(ProfileTotals& total, const ProfileCounter& counter) {
+    total.calls += counter.calls.load(memory_order_relaxed);
+    total.timedCalls += counter.timedCalls.load(memory_order_relaxed);
+    total.ticks += counter.ticks.load(memory_order_relaxed);
+    for (int b = 0; b < PROFILE_BUCKETS; b++) total.histogram[b] += counter.histogram[b].load(memory_order_relaxed);
+}
+
+void profileTotals(ProfileTotals totals[PROFILE_POINT_NB]) {
+    for (int p = 0; p < PROFILE_POINT_NB; p++) totals[p] = ProfileTotals();
+    lock_guard<mutex> lock(REGISTRY_LOCK); // Threads cannot end while their counters are read
+    for (int p = 0; p < PROFILE_POINT_NB; p++) {
+        addCounter(totals[p], FINISHED.points[p]);
+        for (ProfileCounters* counters : LIVE_THREADS) addCounter(totals[p], counters->points[p]);
+    }
+}
+
+static uint64_t bucketLimit(int bucket) { // Upper end of a histogram bucket (0 for the open last one)
+    return bucket == PROFILE_BUCKETS - 1 ? 0 : uint64_t(1) << (bucket + 5);
+}
+
+static uint64_t medianLimit(const ProfileTotals& total) { // Upper end of the bucket holding the middle call
+    uint64_t seen = 0;
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        seen += total.histogram[b];
+        if (seen * 2 >= total.timedCalls) return bucketLimit(b);
+    }
+    return 0;
+}
+
+void printProfile(ostream& out) {
+    if (!profileCompiledIn()) {
+        out << "Profiling is not compiled in (build with -DCHESS_PROFILE)\n";
+        return;
+    }
+    ProfileTotals totals[PROFILE_POINT_NB];
+    profileTotals(totals);
+    double estimated[PROFILE_POINT_NB], allTicks = 0; // Time of all calls, scaled up from the timed ones
+    for (int p = 0; p < PROFILE_POINT_NB; p++) {
+        estimated[p] = totals[p].timedCalls ? (double)totals[p].ticks * totals[p].calls / totals[p].timedCalls : 0;
+        allTicks += estimated[p]; // Shares are of the summed time, which counts nested calls twice (attackersTo inside inCheck...)
+    }
+    out << "function                   calls     share   avg " << profileClockName() << "  median <=\n";
+    for (int p = 0; p < PROFILE_POINT_NB; p++) {
+        const ProfileTotals& t = totals[p];
+        out << left << setw(20) << POINT_NAMES[p] << right << setw(14) << t.calls << setw(9) << fixed << setprecision(1)
+            << (allTicks > 0 ? 100.0 * estimated[p] / allTicks : 0.0) << "%" << setw(10) << (t.timedCalls ? t.ticks / t.timedCalls : 0);
+        uint64_t median = medianLimit(t);
+        if (!t.timedCalls) out << setw(11) << "-";
+        else if (median) out << setw(11) << median;
+        else out << setw(11) << "more";
+        out << "\n";
+        out.unsetf(ios::fixed);
+    }
+}
+
+void writeProfileJson(ostream& out) {
+    ProfileTotals totals[PROFILE_POINT_NB];
+    profileTotals(totals);
+    out << "{\n  \"enabled\": " << (profileCompiledIn() ? "true" : "false") << ",\n  \"clock\": \"" << profileClockName() << "\",\n";
+    out << "  \"sampleEvery\": " << CHESS_PROFILE_SAMPLE << ",\n";
+    out << "  \"bucketLimits\": [";
+    for (int b = 0; b < PROFILE_BUCKETS; b++) out << (b ? ", " : "") << bucketLimit(b); // 0 marks the open last bucket
+    out << "],\n  \"functions\": {\n";
+    for (int p = 0; p < PROFILE_POINT_NB; p++) {
+        const ProfileTotals& t = totals[p];
+        out << "    \"" << POINT_NAMES[p] << "\": {\"calls\": " << t.calls << ", \"timedCalls\": " << t.timedCalls << ", \"ticks\": " << t.ticks
+            << ", \"histogram\": [";
+        for (int b = 0; b < PROFILE_BUCKETS; b++) out << (b ? ", " : "") << t.histogram[b];
+        out << "]}" << (p + 1 < PROFILE_POINT_NB ? "," : "") << "\n";
+    }
+    out << "  }\n}\n";
+}
+
+static string JSON_FILE; // Where profileJsonAtExit writes
+
+static void writeJsonFile() {
+    ofstream file(JSON_FILE.c_str());
+    if (file) writeProfileJson(file);
+}
+
+void profileJsonAtExit(const string& filename) {
+    if (!profileCompiledIn()) return; // Nothing was measured
+    bool first = JSON_FILE.empty();
+    JSON_FILE = filename;
+    if (first) atexit(writeJsonFile);
+}
@@ -0,0 +1,126 @@
+// Profile.h
+// Optional instrumentation of the hot functions: call counts, time spent (CPU time-stamp counter cycles on x86,
+// nanoseconds elsewhere) and a histogram of the time per call. Compiled in only with -DCHESS_PROFILE; otherwise
+// PROFILE_SCOPE expands to nothing and the functions cost exactly what they did before. Every call is counted but
+// only one in CHESS_PROFILE_SAMPLE is timed, because reading the clock costs as much as the shortest functions
+// (-DCHESS_PROFILE_SAMPLE=1 times them all). Each thread writes its own counters, so recording takes no lock and
+// shares no cache line; the totals are added up when someone asks (the "stats" command in a game and in UCI mode,
+// and the JSON file written at exit).
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <atomic> // Include atomic for counters read by other threads
+#include <cstdint> // Include cstdint for the counters
+#include <ostream> // Include ostream for the reports
+#include <string> // Include string for the JSON file name
+
+enum ProfilePoint {
+    PROFILE_LEGAL_MOVES, // generateLegalMoves: the legal-move filter (the old isValidMove over every square pair)
+    PROFILE_IS_LEGAL_MOVE, // isLegalMove: one pseudo-legal move against pins and checks
+    PROFILE_IN_CHECK, // Position::inCheck, behind ChessBoard::isKingInCheck
+    PROFILE_ATTACKERS, // Position::attackersTo: every piece attacking a square (the old canPieceAttack)
+    PROFILE_MAKE_MOVE, // ChessBoard::makeMove
+    PROFILE_UNMAKE_MOVE, // ChessBoard::unmakeMove
+    PROFILE_EVALUATE, // evaluate: the static evaluation
+    PROFILE_TT_PROBE, // TranspositionTable::probe
+    PROFILE_PARSE_MOVE, // ChessBoard::parseMove: move text to a legal move
+    PROFILE_MOVE_PIECE, // ChessBoard::movePiece: a typed move played in the game
+    PROFILE_HAS_LEGAL_MOVES, // ChessBoard::hasLegalMoves: the checkmate and stalemate test
+    PROFILE_POINT_NB
+};
+
+#ifndef CHESS_PROFILE_SAMPLE
+#define CHESS_PROFILE_SAMPLE 64 // Timing one call in this many (a power of two)
+#endif
+const uint64_t PROFILE_SAMPLE_MASK = CHESS_PROFILE_SAMPLE - 1;
+static_assert((CHESS_PROFILE_SAMPLE & PROFILE_SAMPLE_MASK) == 0, "CHESS_PROFILE_SAMPLE must be a power of two");
+
+const int PROFILE_BUCKETS = 16; // Histogram bucket 0: under 32 ticks; bucket i: 2^(i+4) to 2^(i+5); the last one is open
+const char* const PROFILE_DEFAULT_FILE = "ChessProfile.json"; // Written at exit unless --profile-json names another file
+
+// Counters of one function in one thread. Only the owning thread writes them (a relaxed load and store, which is a
+// plain add), so other threads can read them at any time without a data race.
+struct ProfileCounter {
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> timedCalls; // The sampled ones
+    std::atomic<uint64_t> ticks; // Cycles or nanoseconds spent inside the timed calls, callees included
+    std::atomic<uint64_t> histogram[PROFILE_BUCKETS]; // Timed calls by time per call
+};
+
+struct ProfileCounters {
+    ProfileCounter points[PROFILE_POINT_NB];
+};
+
+// Totals over all threads, alive and finished.
+struct ProfileTotals {
+    uint64_t calls;
+    uint64_t timedCalls;
+    uint64_t ticks;
+    uint64_t histogram[PROFILE_BUCKETS];
+};
+
+extern thread_local ProfileCounters* PROFILE_COUNTERS; // This thread's counters (null until it records something)
+ProfileCounters* profileRegisterThread(); // Creating them; they are added to the finished totals when the thread ends
+
+bool profileCompiledIn(); // Whether this build was made with -DCHESS_PROFILE
+const char* profilePointName(ProfilePoint point);
+const char* profileClockName(); // "tsc" (cycles) or "ns"
+void profileTotals(ProfileTotals totals[PROFILE_POINT_NB]); // Adding up every thread's counters
+void printProfile(std::ostream& out); // Table for people: calls, share of the time, average and median per call
+void writeProfileJson(std::ostream& out); // The same totals with full histograms, for scripts
+void profileJsonAtExit(const std::string& filename); // Writing the JSON file when the program ends (profiling builds only)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // Include x86intrin for __rdtsc
+inline uint64_t profileClock() { return __rdtsc(); } // Cycle counter: tens of cycles to read, no system call
+#else
+#include <chrono> // Include chrono for the fallback clock
+inline uint64_t profileClock() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+inline void profileAdd(std::atomic<uint64_t>& counter, uint64_t amount) { // Owner-only update: no locked instruction
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+inline ProfileCounter& profileCounter(ProfilePoint point) { // This thread's counter of a function
+    ProfileCounters* counters = PROFILE_COUNTERS;
+    if (!counters) counters = profileRegisterThread(); // First record of this thread
+    return counters->points[point];
+}
+
+inline void profileRecord(ProfileCounter& counter, uint64_t ticks) {
+    int bits = 64 - __builtin_clzll(ticks | 1); // Bit length of the time
+    int bucket = bits <= 5 ? 0 : bits - 5 < PROFILE_BUCKETS ? bits - 5 : PROFILE_BUCKETS - 1;
+    profileAdd(counter.timedCalls, 1);
+    profileAdd(counter.ticks, ticks);
+    profileAdd(counter.histogram[bucket], 1);
+}
+
+// Counts the call and, for every CHESS_PROFILE_SAMPLE-th one, times the rest of the enclosing block.
+class ProfileScope {
+private:
+    ProfileCounter* timed; // Set when this call is timed
+    uint64_t start;
+
+public:
+    explicit ProfileScope(ProfilePoint point) : timed(nullptr), start(0) {
+        ProfileCounter& counter = profileCounter(point);
+        uint64_t calls = counter.calls.load(std::memory_order_relaxed);
+        counter.calls.store(calls + 1, std::memory_order_relaxed);
+        if ((calls & PROFILE_SAMPLE_MASK) == 0) {
+            timed = &counter;
+            start = profileClock();
+        }
+    }
+    ~ProfileScope() { if (timed) profileRecord(*timed, profileClock() - start); }
+};
+
+#ifdef CHESS_PROFILE
+#define PROFILE_SCOPE(point) ProfileScope profileScope(point)
+#else
+#define PROFILE_SCOPE(point) ((void)0)
+#endif
+
+#endif
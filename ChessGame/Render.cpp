@@ -0,0 +1,216 @@
+// Render.cpp
+// Implementation of the terminal renderer. Screen layout (rows from 1):
+//
+//   1-3    column labels between borders          4-11   ranks 8 to 1 ("8| r n b q k b n r |8")
+//   12-14  column labels between borders          16     move counters
+//   17-18  pieces captured by White and Black     20     status line (last move, check, invalid input)
+//   21-    prompt area
+//
+// The piece on (row, col) sits at screen row 4 + row, column 4 + 2 * col, so a changed square is one cursor move
+// and one character.
+#include <cerrno> // Include cerrno for EINTR and EAGAIN
+#include <cstdio> // Include cstdio for fflush and snprintf
+#include <cstring> // Include cstring for strlen, strcmp and memcpy
+#include <iostream> // Include iostream for flushing what the game printed before a frame
+#include "Render.h" // Renderer declarations
+#include "ChessGame.h" // Capture lists
+#include "Simd.h" // Mailbox of the position
+using namespace std;
+
+#ifdef _WIN32
+#include <io.h> // Include io.h for _write and _isatty
+
+static long writeSome(int fd, const char* data, size_t count) { return _write(fd, data, (unsigned)count); }
+static bool isTerminal(int fd) { return _isatty(fd) != 0; }
+static int openSpectator(const string&) { return -1; } // Mirroring to other consoles is not supported on Windows
+static void closeSpectator(int fd) { _close(fd); }
+#else
+#include <fcntl.h> // Include fcntl.h for opening spectator terminals
+#include <unistd.h> // Include unistd.h for write, isatty and close
+
+static long writeSome(int fd, const char* data, size_t count) { return (long)write(fd, data, count); }
+static bool isTerminal(int fd) { return isatty(fd) != 0; }
+static int openSpectator(const string& path) { // Non-blocking: a slow spectator misses frames instead of stalling the game
+    return open(path.c_str(), O_WRONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+}
+static void closeSpectator(int fd) { close(fd); }
+#endif
+
+const int RANK_ROW = 4; // Screen row of rank 8
+const int FILE_COLUMN = 4; // Screen column of the a-file
+static const int LINE_ROWS[] = {16, 17, 18, RENDER_STATUS_ROW}; // Screen rows of the text lines, in TextLine order
+
+static const char* const TOP_BORDER = "\033[38;5;117m+-----------------+\033[0m\n\033[38;5;117m|  a b c d e f g h|\033[0m\n"
+                                      "\033[38;5;117m+-----------------+\033[0m\n";
+static const char* const BOTTOM_BORDER = "\033[38;5;216m+-----------------+\033[0m\n\033[38;5;216m|  a b c d e f g h|\033[0m\n"
+                                         "\033[38;5;216m+-----------------+\033[0m\n";
+
+static char symbolOf(uint8_t code) {
+    return code == NO_PIECE_CODE ? EMPTY : PIECE_SYMBOLS[code / PIECE_TYPE_NB][code % PIECE_TYPE_NB];
+}
+
+static void captureLine(char line[RENDER_LINE_BYTES], const char* label, const CaptureList& captures) {
+    int used = snprintf(line, RENDER_LINE_BYTES, "%s", label);
+    if (captures.empty()) snprintf(line + used, RENDER_LINE_BYTES - used, "None");
+    for (char piece : captures) used += snprintf(line + used, RENDER_LINE_BYTES - used, "%c ", piece); // At most 15 pieces: always fits
+}
+
+BoardRenderer::BoardRenderer() : length(0), drawn(false) {
+    Output player = {1, isTerminal(1), false, false};
+    outputs.push_back(player);
+}
+
+BoardRenderer::~BoardRenderer() {
+    for (const Output& output : outputs) if (output.owned) closeSpectator(output.fd);
+}
+
+bool BoardRenderer::addSpectator(const string& path) {
+    int fd = openSpectator(path);
+    if (fd < 0) return false;
+    Output spectator = {fd, isTerminal(fd), false, true}; // Its first frame is a full one
+    outputs.push_back(spectator);
+    return true;
+}
+
+void BoardRenderer::invalidate() {
+    for (Output& output : outputs) output.current = false;
+}
+
+void BoardRenderer::append(const char* text, size_t count) {
+    if (count > RENDER_FRAME_BYTES - length) count = RENDER_FRAME_BYTES - length; // Cannot happen with the line limits
+    memcpy(frame + length, text, count);
+    length += count;
+}
+
+void BoardRenderer::append(const char* text) {
+    append(text, strlen(text));
+}
+
+void BoardRenderer::appendNumber(int value) {
+    char digits[12];
+    append(digits, (size_t)snprintf(digits, sizeof(digits), "%d", value));
+}
+
+void BoardRenderer::moveCursor(int row, int col) {
+    append("\033[");
+    appendNumber(row);
+    append(";");
+    appendNumber(col);
+    append("H");
+}
+
+// The whole screen: cleared and drawn from the top for a terminal, or simply appended for a pipe or file.
+void BoardRenderer::fullFrame(bool addressing, const uint8_t codes[SQUARE_NB], char lines[LINE_NB][RENDER_LINE_BYTES]) {
+    length = 0;
+    if (addressing) append("\033[H\033[2J"); // Home and clear
+    append(TOP_BORDER);
+    for (int row = 0; row < BOARD_SIZE; row++) {
+        char rank[] = {char('8' - row), '|'};
+        append(rank, 2);
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            char square[] = {' ', symbolOf(codes[squareOf(row, col)])};
+            append(square, 2);
+        }
+        char end[] = {' ', '|', char('8' - row), '\n'};
+        append(end, 4);
+    }
+    append(BOTTOM_BORDER);
+    append("\n");
+    for (int line = LINE_COUNTERS; line <= LINE_BLACK_CAPTURES; line++) {
+        append(lines[line]);
+        append("\033[0m\n");
+    }
+    append("\n");
+    if (addressing || lines[LINE_STATUS][0]) { // The status row is always there on a terminal, so the prompt area starts on row 21
+        append(lines[LINE_STATUS]);
+        append("\033[0m\n");
+    }
+}
+
+// Only what differs from the frame on screen. False if there is nothing to write.
+bool BoardRenderer::differenceFrame(const uint8_t codes[SQUARE_NB], char lines[LINE_NB][RENDER_LINE_BYTES], bool clearPrompt) {
+    length = 0;
+    if (!clearPrompt) append("\0337"); // Save the cursor: the player's last output stays where it is
+    for (int sq = 0; sq < SQUARE_NB; sq++) {
+        if (codes[sq] == shownCodes[sq]) continue;
+        moveCursor(RANK_ROW + sq / 8, FILE_COLUMN + 2 * (sq % 8));
+        char symbol = symbolOf(codes[sq]);
+        append(&symbol, 1);
+    }
+    for (int line = 0; line < LINE_NB; line++) {
+        if (strcmp(lines[line], shownLines[line]) == 0) continue;
+        moveCursor(LINE_ROWS[line], 1);
+        append(lines[line]);
+        append("\033[0m\033[K"); // Clearing the rest of the old, maybe longer, line
+    }
+    if (clearPrompt) {
+        moveCursor(RENDER_PROMPT_ROW, 1);
+        append("\033[J");
+    } else if (length == 2) {
+        return false; // Nothing changed
+    } else {
+        append("\0338");
+    }
+    return true;
+}
+
+bool BoardRenderer::send(Output& output) {
+    size_t done = 0;
+    while (done < length) {
+        long wrote = writeSome(output.fd, frame + done, length - done);
+        if (wrote < 0 && errno == EINTR) continue;
+        if (wrote < 0 && output.owned && errno != EAGAIN) { // The spectator went away: stop mirroring to it
+            closeSpectator(output.fd);
+            output.fd = -1;
+        }
+        if (wrote <= 0 || output.owned) { // A spectator that took part of a frame is redrawn in full next time
+            output.current = wrote > 0 && done + size_t(wrote) == length;
+            return output.current;
+        }
+        done += size_t(wrote);
+    }
+    output.current = true;
+    return true;
+}
+
+void BoardRenderer::draw(const Position& pos, const CaptureList& whiteCaptures, const CaptureList& blackCaptures, const char* status,
+                         bool clearPrompt) {
+    uint8_t codes[SQUARE_NB];
+    bitboardsToMailbox(pos, codes);
+    char lines[LINE_NB][RENDER_LINE_BYTES];
+    snprintf(lines[LINE_COUNTERS], RENDER_LINE_BYTES, "Half-moves: %d Full moves: %d", pos.halfMoveClock, pos.fullMoveNumber);
+    captureLine(lines[LINE_WHITE_CAPTURES], "\033[38;5;216mWhite captured: \033[0m", whiteCaptures);
+    captureLine(lines[LINE_BLACK_CAPTURES], "\033[38;5;117mBlack captured: \033[0m", blackCaptures);
+    snprintf(lines[LINE_STATUS], RENDER_LINE_BYTES, "%s", status);
+
+    cout.flush(); // What the game printed so far goes out before the frame
+    fflush(stdout);
+    bool differences = false, fullFrames = false, plainFrames = false; // Kinds of frame some output needs
+    for (const Output& output : outputs) {
+        if (!output.terminal) plainFrames = true;
+        else if (output.current && drawn) differences = true;
+        else fullFrames = true;
+    }
+    if (differences && differenceFrame(codes, lines, clearPrompt)) {
+        for (Output& output : outputs) if (output.terminal && output.current) send(output);
+    }
+    if (fullFrames) {
+        fullFrame(true, codes, lines);
+        for (Output& output : outputs) if (output.terminal && !output.current) send(output);
+    }
+    if (plainFrames) {
+        fullFrame(false, codes, lines);
+        for (Output& output : outputs) if (!output.terminal) send(output);
+    }
+    for (size_t i = 1; i < outputs.size();) { // Dropping spectators that closed
+        if (outputs[i].fd < 0) {
+            outputs[i] = outputs.back();
+            outputs.pop_back();
+        } else {
+            i++;
+        }
+    }
+    memcpy(shownCodes, codes, sizeof(shownCodes));
+    memcpy(shownLines, lines, sizeof(shownLines));
+    drawn = true;
+}
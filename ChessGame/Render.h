@@ -0,0 +1,68 @@
+// Render.h
+// Drawing the game in a terminal. Every frame is built in one fixed buffer and written with a single system call,
+// and once the board is on screen only what changed is drawn again: the squares whose piece changed, the move
+// counters, the captured pieces and the status line, each reached with cursor addressing. Below the board is the
+// prompt area, cleared by each frame, so the screen never scrolls and the board stays where it was drawn.
+//
+// The same frame can also go to spectator terminals (one game on many screens). Each output remembers whether it
+// shows the last frame; one that does not (it was just added, or could not take the last write) gets a full frame.
+// Output that is not a terminal (a pipe or a file) gets the full board every time, without cursor addressing.
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <cstddef> // Include cstddef for size_t
+#include <cstdint> // Include cstdint for the piece codes
+#include <string> // Include string for spectator paths
+#include <vector> // Include vector for the outputs
+#include "Position.h" // Include the position being drawn
+
+struct CaptureList; // Captured pieces (ChessGame.h)
+
+const int RENDER_FRAME_BYTES = 4096; // A full frame with colors is about 1 KB
+const int RENDER_LINE_BYTES = 160; // Longest text line kept for comparison (status text beyond this is cut)
+const int RENDER_STATUS_ROW = 20; // Screen row of the status line (rows count from 1)
+const int RENDER_PROMPT_ROW = 21; // First row of the prompt area
+
+class BoardRenderer {
+private:
+    enum TextLine { LINE_COUNTERS, LINE_WHITE_CAPTURES, LINE_BLACK_CAPTURES, LINE_STATUS, LINE_NB };
+
+    struct Output {
+        int fd;
+        bool terminal; // Cursor addressing works (false: full frames appended one after another)
+        bool current; // Shows the last frame drawn, so the next one may be a difference
+        bool owned; // Opened by addSpectator and closed by the renderer
+    };
+
+    char frame[RENDER_FRAME_BYTES]; // The frame being built
+    size_t length;
+    std::vector<Output> outputs; // The player's terminal first, then the spectators
+    bool drawn; // The fields below describe a frame that was drawn
+    uint8_t shownCodes[SQUARE_NB]; // Piece code of every square on screen
+    char shownLines[LINE_NB][RENDER_LINE_BYTES]; // Text lines on screen
+
+    BoardRenderer(const BoardRenderer&); // Owns file descriptors: not copyable
+    BoardRenderer& operator=(const BoardRenderer&);
+
+    void append(const char* text);
+    void append(const char* text, size_t count);
+    void appendNumber(int value);
+    void moveCursor(int row, int col); // Absolute cursor position (rows and columns count from 1)
+    void fullFrame(bool addressing, const uint8_t codes[SQUARE_NB], char lines[LINE_NB][RENDER_LINE_BYTES]);
+    bool differenceFrame(const uint8_t codes[SQUARE_NB], char lines[LINE_NB][RENDER_LINE_BYTES], bool clearPrompt);
+    bool send(Output& output); // Writing the frame to one output in one call (false if it did not all go out)
+
+public:
+    BoardRenderer();
+    ~BoardRenderer();
+    bool addSpectator(const std::string& path); // Mirroring frames to a terminal device or FIFO (false if it cannot be opened)
+    size_t spectators() const { return outputs.size() - 1; }
+    void invalidate(); // Something else was printed: the next frame is drawn in full
+    // Drawing the position with the captured pieces and a status line (which may hold color escapes). With
+    // 'clearPrompt' the prompt area is emptied and the cursor left at its start; without it the cursor stays where
+    // it is, so output printed since the last frame remains visible.
+    void draw(const Position& pos, const CaptureList& whiteCaptures, const CaptureList& blackCaptures, const char* status = "",
+              bool clearPrompt = true);
+};
+
+#endif
@@ -0,0 +1,438 @@
+// Search.cpp
+// Implementation of the engine: iterative deepening over a negamax alpha-beta search on a private copy of the board.
+#include <cctype> // Include cctype for isdigit
+#include <cstdlib> // Include cstdlib for atoi and abs
+#include <cstring> // Include cstring for strcmp
+#include <iomanip> // Include iomanip for the scaling table
+#include <sstream> // Include sstream for building info lines
+#include "Search.h" // Search declarations and limits
+#include "Book.h" // Opening book tried before searching
+#include "Tablebase.h" // Exact results for endings with few pieces
+#include "Perft.h" // Reference positions reused by --bench
+#include "Uci.h" // Locked output of the info lines
+using namespace std;
+
+SearchPool ENGINE; // The engine's search threads
+
+Search::Search(const ChessBoard& start, int checksGiven, Arena& arena, TranspositionTable& table, int id,
+               atomic<bool>* stopSignal, atomic<uint64_t>* nodeCounter)
+    : board(start), tt(table), rootChecks(checksGiven), threadId(id), sharedStop(stopSignal), sharedNodes(nodeCounter),
+      unpublishedNodes(0), nodes(0), stopped(false), stack(arena.createArray<SearchPly>(MAX_SEARCH_PLY)), rootBest(MOVE_NONE) {}
+
+size_t Search::arenaBytes() {
+    return sizeof(Search) + alignof(Search) + sizeof(SearchPly) * MAX_SEARCH_PLY + alignof(SearchPly);
+}
+
+void Search::publishNodes() {
+    if (sharedNodes) sharedNodes->fetch_add(nodes - unpublishedNodes, memory_order_relaxed);
+    unpublishedNodes = nodes;
+}
+
+// The same board with a different number of checks already given is a different game state, so the check count is
+// mixed into the table key (multiplying by an odd constant spreads it over all the bits).
+static uint64_t searchKey(const Position& pos, int checks) {
+    return pos.key ^ (uint64_t(checks) * 0x9E3779B97F4A7C15ULL);
+}
+
+// Mate scores count plies from the root; in the table they are stored relative to the node, so they stay correct
+// when the same position is reached at another ply.
+static int scoreToTT(int score, int ply) {
+    return score >= MATE_BOUND ? score + ply : score <= -MATE_BOUND ? score - ply : score;
+}
+static int scoreFromTT(int score, int ply) {
+    return score >= MATE_BOUND ? score - ply : score <= -MATE_BOUND ? score + ply : score;
+}
+
+// Table results on the search's mate scale: plies to the end of the game counted from the root.
+static int tablebaseScore(const TablebaseHit& hit, int ply) {
+    if (hit.result == 0) return DRAW_SCORE;
+    return hit.result > 0 ? MATE_SCORE - (ply + hit.plies) : -MATE_SCORE + ply + hit.plies;
+}
+
+int Search::elapsedMs() const {
+    return (int)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count();
+}
+
+bool Search::checkLimits() {
+    if (stopped) return true;
+    if (limits.nodes && nodes >= limits.nodes) stopped = true; // Node budget used up
+    if ((nodes & 1023) == 0) { // Reading the clock and the shared state every 1024 nodes
+        if (limits.moveTimeMs && elapsedMs() >= limits.moveTimeMs) stopped = true;
+        if (sharedStop && sharedStop->load(memory_order_relaxed)) stopped = true; // Another thread (or the caller) ended the search
+        publishNodes();
+    }
+    return stopped;
+}
+
+// Tapered material, piece-square and pawn-structure score from the point of view of the side to move (Eval.h).
+int Search::evaluate() {
+    return ::evaluate(board.position(), pawnTable);
+}
+
+// 'checks' counts the checks given in the game plus along the current line; the move that gives check number
+// CHECK_LIMIT wins immediately, so it is scored like a mate and not searched any further.
+int Search::alphaBeta(int alpha, int beta, int depth, int ply, int checks, bool allowNull) {
+    SearchPly& here = stack[ply];
+    here.pvLength = ply;
+    const Position& pos = board.position(); // Always the current position (the board is changed in place)
+    if (ply > 0 && (pos.halfMoveClock >= FIFTY_MOVE_PLIES || board.repetitionCount() > 0)) return DRAW_SCORE; // One repetition is enough inside the tree
+    if (ply >= MAX_SEARCH_PLY - 1) return evaluate();
+    TablebaseHit tableHit; // Endings the tables cover need no search
+    if (ply > 0 && TABLEBASES.probe(pos, checks, tableHit)) return tablebaseScore(tableHit, ply);
+    bool inCheck = pos.inCheck(pos.sideToMove);
+    if (inCheck) depth++; // Check extension (the N-check rule keeps the number of extensions small)
+    if (depth <= 0) return quiescence(alpha, beta, ply, checks);
+    if (checkLimits()) return 0;
+    nodes++;
+    bool pvNode = beta - alpha > 1; // Full-window node on the principal variation
+
+    // A deep enough earlier result with a usable bound answers the node without searching it again.
+    uint64_t key = searchKey(pos, checks);
+    TTHit hit;
+    Move ttMove = MOVE_NONE;
+    if (tt.probe(key, hit)) {
+        ttMove = hit.move;
+        int ttScore = scoreFromTT(hit.score, ply);
+        if (!pvNode && ply > 0 && hit.depth >= depth &&
+            (hit.bound == BOUND_EXACT || (hit.bound == BOUND_LOWER && ttScore >= beta) || (hit.bound == BOUND_UPPER && ttScore <= alpha))) {
+            return ttScore;
+        }
+    }
+    int alphaStart = alpha; // To tell an exact score from an upper bound when storing
+
+    // Null move: if passing still holds beta at reduced depth, a real move almost surely does too.
+    // Skipped with only pawns left, where passing can be the best move (zugzwang).
+    int us = pos.sideToMove;
+    if (allowNull && !pvNode && !inCheck && depth >= 3 && (pos.byColor[us] & ~pos.byType[PAWN] & ~pos.byType[KING]) && evaluate() >= beta) {
+        board.makeNullMove();
+        int score = -alphaBeta(-beta, -beta + 1, depth - 3 - (depth > 6), ply + 1, checks, false);
+        board.unmakeNullMove();
+        if (stopped) return 0;
+        if (score >= beta) return score >= MATE_BOUND ? beta : score; // Unproven mates from a null move are not trusted
+    }
+
+    if (ply > 0 && checks + 1 >= CHECK_LIMIT) { // Any check wins now: the one case that needs every move at once
+        MoveList& moves = here.moves; // Reused from the last node at this ply: emptied first (generating appends)
+        moves.count = 0;
+        board.generateMoves(moves);
+        if (moves.size() == 0) return inCheck ? -MATE_SCORE + ply : DRAW_SCORE; // Checkmate or stalemate
+        if (findWinningCheck(moves) != MOVE_NONE) return MATE_SCORE - (ply + 1);
+    }
+
+    MovePicker& picker = here.picker; // Hash move, good captures, killers, quiet moves by history, losing captures
+    picker.start(pos, ply == 0 && rootBest != MOVE_NONE ? rootBest : ttMove, here.killers, history);
+    int best = -INFINITE_SCORE, quietCount = 0;
+    Move bestMove = MOVE_NONE;
+    int i = 0;
+    for (Move m = picker.next(); m != MOVE_NONE; m = picker.next(), i++) {
+        bool quiet = !(pos.occupied & squareBit(moveTo(m))) && moveKind(m) != EN_PASSANT && moveKind(m) != PROMOTION;
+        board.makeMove(m);
+        bool givesCheck = pos.inCheck(pos.sideToMove);
+        int score;
+        if (givesCheck && checks + 1 >= CHECK_LIMIT) {
+            score = MATE_SCORE - (ply + 1); // The last check ends the game in the mover's favour
+        } else if (i == 0) {
+            score = -alphaBeta(-beta, -alpha, depth - 1, ply + 1, checks + givesCheck, true); // First move: full window
+        } else { // Principal variation search: prove the move is worse with a null window, re-search if it is not
+            // Late move reduction: quiet moves sorted towards the end are searched shallower first.
+            int reduction = 0;
+            if (depth >= 3 && i >= 3 && quiet && !inCheck && !givesCheck && m != here.killers[0] && m != here.killers[1]) {
+                reduction = (i >= 6 && depth >= 6) ? 2 : 1;
+            }
+            score = -alphaBeta(-alpha - 1, -alpha, depth - 1 - reduction, ply + 1, checks + givesCheck, true);
+            if (reduction && score > alpha) score = -alphaBeta(-alpha - 1, -alpha, depth - 1, ply + 1, checks + givesCheck, true);
+            if (score > alpha && score < beta) score = -alphaBeta(-beta, -alpha, depth - 1, ply + 1, checks + givesCheck, true);
+        }
+        board.unmakeMove();
+        if (stopped) return 0;
+
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                bestMove = m;
+                const SearchPly& child = stack[ply + 1];
+                here.pv[ply] = m; // This move followed by the child's principal variation
+                for (int j = ply + 1; j < child.pvLength; j++) here.pv[j] = child.pv[j];
+                here.pvLength = child.pvLength > ply + 1 ? child.pvLength : ply + 1;
+                if (alpha >= beta) { // Beta cut-off
+                    if (quiet) { // Remembering the quiet refutation for sibling nodes and for later in the search
+                        if (m != here.killers[0]) {
+                            here.killers[1] = here.killers[0];
+                            here.killers[0] = m;
+                        }
+                        int bonus = depth * depth;
+                        history.update(us, m, bonus);
+                        for (int j = 0; j < quietCount; j++) history.update(us, here.quietsTried[j], -bonus); // They did not cut off
+                    }
+                    break;
+                }
+            }
+        }
+        if (quiet) here.quietsTried[quietCount++] = m;
+    }
+    if (best == -INFINITE_SCORE) return inCheck ? -MATE_SCORE + ply : DRAW_SCORE; // No legal move: checkmate or stalemate
+    int bound = best >= beta ? BOUND_LOWER : best > alphaStart ? BOUND_EXACT : BOUND_UPPER;
+    tt.store(key, bestMove, scoreToTT(best, ply), depth, bound);
+    return best;
+}
+
+// Looking for a move that gives check, tried only with one check left before the N-check rule ends the game.
+Move Search::findWinningCheck(const MoveList& moves) {
+    const Position& pos = board.position();
+    int king = pos.kingSquare(pos.sideToMove ^ 1);
+    for (Move m : moves) {
+        if (!mayGiveCheck(pos, m, king)) continue;
+        board.makeMove(m);
+        bool check = pos.inCheck(pos.sideToMove);
+        board.unmakeMove();
+        if (check) return m;
+    }
+    return MOVE_NONE;
+}
+
+// Searches captures and promotions until nothing is hanging, so the static score is taken in a quiet position.
+// Captures that lose material by SEE are skipped unless they may give check. In check every evasion is searched; with one check left to give,
+// any checking move wins on the spot. Stalemate is not detected here (that would need the quiet moves too): the
+// stand-pat score stands in for it.
+int Search::quiescence(int alpha, int beta, int ply, int checks) {
+    SearchPly& here = stack[ply];
+    here.pvLength = ply;
+    if (checkLimits()) return 0;
+    nodes++;
+    const Position& pos = board.position();
+    if (ply >= MAX_SEARCH_PLY - 1) return evaluate();
+    TablebaseHit tableHit; // A capture into a covered ending ends the quiescence search as well
+    if (TABLEBASES.probe(pos, checks, tableHit)) return tablebaseScore(tableHit, ply);
+    bool inCheck = pos.inCheck(pos.sideToMove);
+    int best = -INFINITE_SCORE;
+    if (!inCheck) { // Stand pat: the side to move may decline every capture
+        best = evaluate();
+        if (best >= beta) return best;
+        if (best > alpha) alpha = best;
+    }
+
+    if (checks + 1 >= CHECK_LIMIT) { // Any check wins now
+        MoveList& all = here.moves;
+        all.count = 0;
+        board.generateMoves(all);
+        if (all.size() == 0) return inCheck ? -MATE_SCORE + ply : DRAW_SCORE;
+        if (findWinningCheck(all) != MOVE_NONE) return MATE_SCORE - (ply + 1);
+    }
+
+    MovePicker& picker = here.picker;
+    picker.startQuiescence(pos, inCheck);
+    for (Move m = picker.next(); m != MOVE_NONE; m = picker.next()) {
+        board.makeMove(m);
+        bool givesCheck = pos.inCheck(pos.sideToMove);
+        int score = givesCheck && checks + 1 >= CHECK_LIMIT ? MATE_SCORE - (ply + 1) // Normally found above; made sure of here
+                                                            : -quiescence(-beta, -alpha, ply + 1, checks + givesCheck);
+        board.unmakeMove();
+        if (stopped) return 0;
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) break;
+            }
+        }
+    }
+    if (inCheck && best == -INFINITE_SCORE) return -MATE_SCORE + ply; // No evasion: checkmate
+    return best;
+}
+
+// Writes a score the way chess GUIs expect it: centipawns, or "mate N" in moves (negative when being mated).
+static void printScore(ostream& out, int score) {
+    if (score >= MATE_BOUND) out << "mate " << (MATE_SCORE - score + 1) / 2;
+    else if (score <= -MATE_BOUND) out << "mate " << -(MATE_SCORE + score) / 2;
+    else out << "cp " << score;
+}
+
+SearchResult Search::run(const SearchLimits& searchLimits, bool printInfo) {
+    limits = searchLimits;
+    startTime = chrono::steady_clock::now();
+    nodes = 0;
+    stopped = false;
+    unpublishedNodes = 0;
+    rootBest = MOVE_NONE;
+    for (int ply = 0; ply < MAX_SEARCH_PLY; ply++) stack[ply].killers[0] = stack[ply].killers[1] = MOVE_NONE;
+    history.clear();
+
+    SearchResult result;
+    result.bestMove = MOVE_NONE;
+    result.score = 0;
+    result.depth = 0;
+    result.pvLength = 0;
+    MoveList rootMoves;
+    board.generateMoves(rootMoves);
+    if (rootChecks >= CHECK_LIMIT) rootMoves.count = 0; // The game is already over
+    if (rootMoves.size() > 0) { // Something to play even if the first iteration is cut short
+        result.bestMove = result.pv[0] = rootMoves[0];
+        result.pvLength = 1;
+    }
+
+    int maxDepth = limits.depth > 0 && limits.depth < MAX_SEARCH_DEPTH ? limits.depth : MAX_SEARCH_DEPTH;
+    for (int depth = 1 + (threadId & 1); depth <= maxDepth && rootMoves.size() > 0; depth++) { // Odd helpers start a ply deeper
+        int score = alphaBeta(-INFINITE_SCORE, INFINITE_SCORE, depth, 0, rootChecks, false);
+        if (stopped) break; // Unfinished iteration: keep the result of the previous one
+
+        result.score = score;
+        result.depth = depth;
+        result.pvLength = stack[0].pvLength;
+        for (int i = 0; i < stack[0].pvLength; i++) result.pv[i] = stack[0].pv[i];
+        result.bestMove = rootBest = stack[0].pv[0];
+
+        if (printInfo) { // One line per iteration, in the UCI "info" format
+            int ms = elapsedMs();
+            publishNodes();
+            uint64_t total = sharedNodes ? sharedNodes->load(memory_order_relaxed) : nodes; // All threads together
+            ostringstream line; // Sent in one piece: the UCI loop may be answering "isready" at the same time
+            line << "info depth " << depth << " score ";
+            printScore(line, score);
+            line << " nodes " << total << " nps " << (ms > 0 ? total * 1000 / ms : total) << " time " << ms << " hashfull " << tt.hashfull() << " pv";
+            for (int i = 0; i < result.pvLength; i++) line << " " << moveToString(result.pv[i]);
+            line << "\n";
+            uciWrite(line.str());
+        }
+        if (abs(score) >= MATE_BOUND && MATE_SCORE - abs(score) <= depth) break; // A forced result inside the horizon will not change
+        if (limits.moveTimeMs && elapsedMs() * 2 > limits.moveTimeMs) break; // The next iteration would not finish in time
+    }
+    publishNodes();
+    result.nodes = nodes;
+    result.timeMs = elapsedMs();
+    return result;
+}
+
+SearchPool::SearchPool() : threadCount(1), stopFlag(false), nodeCounter(0) {
+    setThreads((int)thread::hardware_concurrency()); // All cores unless told otherwise
+}
+
+void SearchPool::setThreads(int count) {
+    threadCount = count < 1 ? 1 : count;
+}
+
+void SearchPool::stop() {
+    stopFlag.store(true, memory_order_relaxed);
+}
+
+void SearchPool::clearStop() {
+    stopFlag.store(false, memory_order_relaxed);
+}
+
+SearchResult SearchPool::search(const ChessBoard& board, int checksGiven, const SearchLimits& limits, bool printInfo) {
+    nodeCounter.store(0, memory_order_relaxed); // The stop signal is not lowered here: a stop() sent before now still counts
+    TT.newSearch(); // Results from earlier moves stay usable but are replaced first
+
+    // Each thread gets its own Search (a board copy, pawn table and per-ply stack of a few hundred kilobytes), built in
+    // that thread's arena: the arenas and result slots are only allocated when the thread count grows.
+    while ((int)arenas.size() < threadCount) arenas.emplace_back(new Arena(Search::arenaBytes()));
+    if ((int)searches.size() < threadCount) {
+        searches.resize(threadCount);
+        results.resize(threadCount);
+    }
+    for (int id = 0; id < threadCount; id++) {
+        Arena& arena = *arenas[id];
+        arena.reset();
+        void* place = arena.allocate(sizeof(Search), alignof(Search));
+        searches[id] = new (place) Search(board, checksGiven, arena, TT, id, &stopFlag, &nodeCounter);
+    }
+    vector<thread> helpers; // Starting a thread allocates anyway, so only multi-threaded searches allocate at all
+    for (int id = 1; id < threadCount; id++) {
+        SearchLimits helperLimits = limits; // Helpers run until the main thread stops them
+        helperLimits.moveTimeMs = 0;
+        helperLimits.nodes = 0;
+        helpers.emplace_back([&, id, helperLimits]() { results[id] = searches[id]->run(helperLimits, false); });
+    }
+    results[0] = searches[0]->run(limits, printInfo); // The calling thread is the main search
+    stop(); // Main search done: the helpers' unfinished iterations are no longer needed
+    for (thread& t : helpers) t.join();
+    clearStop(); // Ready for the next search
+
+    // A helper that completed a deeper iteration than the main thread has the better answer.
+    SearchResult best = results[0];
+    uint64_t total = 0;
+    for (int id = 0; id < threadCount; id++) {
+        if (results[id].depth > best.depth && results[id].bestMove != MOVE_NONE) best = results[id];
+        total += results[id].nodes;
+        searches[id]->~Search(); // The memory stays in the arena for the next search
+    }
+    best.nodes = total;
+    best.timeMs = results[0].timeMs;
+    return best;
+}
+
+Move ChessBoard::bestMove(const SearchLimits& limits, int checkCount) const {
+    Move bookMove = BOOK.pick(pos); // Known openings are played from the book without thinking
+    if (bookMove != MOVE_NONE) return bookMove;
+    Move tableMove = TABLEBASES.bestMove(pos, checkCount); // Covered endings are played perfectly, also without thinking
+    if (tableMove != MOVE_NONE) return tableMove;
+    return ENGINE.search(*this, checkCount, limits, false).bestMove;
+}
+
+// Usage: ChessGame --bench [depth] [--threads N]
+// Searches every reference position to a fixed depth and reports the total nodes and speed, so changes to the
+// search can be compared by node count (the same on every machine) and by nodes/second. One thread unless
+// --threads is given, because only the single-threaded search is deterministic.
+int benchMain(int argc, char* argv[]) {
+    int depth = 8; // Default depth used for comparisons
+    int threads = 1;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (isdigit((unsigned char)argv[i][0])) depth = atoi(argv[i]);
+    }
+    ENGINE.setThreads(threads);
+    uint64_t totalNodes = 0;
+    int totalMs = 0;
+    for (int i = 0; i < PERFT_SUITE_SIZE; i++) {
+        ChessBoard board;
+        board.loadFen(PERFT_SUITE[i].fen);
+        TT.clear(); // Every position starts from an empty table so the node counts are repeatable
+        SearchLimits limits;
+        limits.depth = depth;
+        SearchResult result = ENGINE.search(board, 0, limits, false);
+        cout << PERFT_SUITE[i].name << ": bestmove " << moveToString(result.bestMove) << " score ";
+        printScore(cout, result.score);
+        cout << " nodes " << result.nodes << " time " << result.timeMs << "ms\n";
+        totalNodes += result.nodes;
+        totalMs += result.timeMs;
+    }
+    cout << "Total nodes " << totalNodes << "  time " << totalMs << "ms  nps " << (totalMs > 0 ? totalNodes * 1000 / totalMs : totalNodes) << "\n";
+    return 0;
+}
+
+// Usage: ChessGame --bench-smp [maxThreads] [moveTimeMs]
+// Gives every reference position the same wall-clock time with 1, 2, 4, ... maxThreads threads and prints the
+// nodes/second and average depth reached, to check that more threads really buy depth per second.
+int smpBenchMain(int argc, char* argv[]) {
+    int maxThreads = (int)thread::hardware_concurrency(); // All cores by default
+    int moveTimeMs = 1000;
+    if (argc > 2) maxThreads = atoi(argv[2]);
+    if (argc > 3) moveTimeMs = atoi(argv[3]);
+    if (maxThreads < 1) maxThreads = 1;
+    cout << "threads       nps   speedup  avg depth\n";
+    double baseNps = 0;
+    for (int threads = 1; ; threads = threads * 2 > maxThreads && threads < maxThreads ? maxThreads : threads * 2) {
+        if (threads > maxThreads) break;
+        ENGINE.setThreads(threads);
+        uint64_t nodes = 0;
+        int ms = 0, depthSum = 0;
+        for (int i = 0; i < PERFT_SUITE_SIZE; i++) {
+            ChessBoard board;
+            board.loadFen(PERFT_SUITE[i].fen);
+            TT.clear();
+            SearchLimits limits;
+            limits.moveTimeMs = moveTimeMs;
+            SearchResult result = ENGINE.search(board, 0, limits, false);
+            nodes += result.nodes;
+            ms += result.timeMs;
+            depthSum += result.depth;
+        }
+        double nps = ms > 0 ? nodes * 1000.0 / ms : 0;
+        if (threads == 1) baseNps = nps;
+        cout << setw(7) << threads << setw(10) << (uint64_t)nps << setw(10) << fixed << setprecision(2)
+             << (baseNps > 0 ? nps / baseNps : 0) << setw(11) << (double)depthSum / PERFT_SUITE_SIZE << "\n";
+        cout.unsetf(ios::fixed);
+        if (threads == maxThreads) break;
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Search.h
+// Computer player: negamax alpha-beta with iterative deepening, principal variation search, null-move pruning and
+// quiescence search over captures. Moves come from a staged picker (MovePicker.h) ordered by the hash move, SEE and
+// MVV-LVA, killers and history. Checkmate, stalemate, draws and the custom N-check rule are all terminal.
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic> // Include atomic for the stop signal and node counters shared between threads
+#include <chrono> // Include chrono for the time limit
+#include <cstdint> // Include cstdint for node counters
+#include <memory> // Include memory for the pool's arenas
+#include "Arena.h" // Include the per-thread memory the search lives in
+#include "ChessGame.h" // Include the board (moves, make/unmake, repetition) and CHECK_LIMIT
+#include "Eval.h" // Include the static evaluation and its pawn-structure cache
+#include "MovePicker.h" // Include the staged move ordering
+#include "TT.h" // Include the shared transposition table
+
+const int MAX_SEARCH_DEPTH = 64; // Deepest iteration the engine will start
+const int MATE_SCORE = 32000; // Score of delivering mate (or the last check) right now; shorter wins score higher
+const int MATE_BOUND = MATE_SCORE - MAX_SEARCH_PLY; // Scores beyond this are forced wins or losses
+const int INFINITE_SCORE = 32500; // Wider than any real score
+const int DRAW_SCORE = 0; // Repetition, 50-move rule and stalemate
+
+// What the caller allows the search to spend. A zero field means "no limit" of that kind.
+struct SearchLimits {
+    int depth; // Maximum iteration depth in plies
+    int moveTimeMs; // Wall-clock budget in milliseconds
+    uint64_t nodes; // Node budget
+    SearchLimits() : depth(MAX_SEARCH_DEPTH), moveTimeMs(0), nodes(0) {}
+};
+
+// Outcome of the last completed iteration.
+struct SearchResult {
+    Move bestMove; // Move to play (MOVE_NONE if the game is already over)
+    int score; // Centipawns from the mover's point of view, or a mate/N-check score
+    int depth; // Depth of the last completed iteration
+    uint64_t nodes; // Nodes visited in total
+    int timeMs; // Wall-clock time used
+    Move pv[MAX_SEARCH_PLY]; // Principal variation, starting with bestMove
+    int pvLength; // Number of moves in the principal variation
+};
+
+// Everything the search keeps per ply. One array of these per thread is taken from the thread's arena, so a node
+// writes its moves and principal variation into memory reserved before the search started.
+struct SearchPly {
+    MovePicker picker; // Moves of the node at this ply, produced in order
+    MoveList moves; // Every legal move, generated only when one more check would win
+    Move quietsTried[MAX_MOVES]; // Quiet moves searched without a cut-off (their history is lowered on a later one)
+    Move pv[MAX_SEARCH_PLY]; // Principal variation from this ply on (indexed by ply, as a row of a triangular table)
+    int pvLength; // End of the principal variation in 'pv'
+    Move killers[2]; // Two quiet moves that recently caused a beta cut-off at this ply
+};
+
+class Search {
+private:
+    ChessBoard board; // Private copy that the search plays its moves on
+    TranspositionTable& tt; // Table of earlier results, shared with other searches
+    int rootChecks; // Checks already given in the game (ChessGame::checkCount)
+    int threadId; // 0 for the main search, 1.. for Lazy SMP helpers
+    std::atomic<bool>* sharedStop; // Stop signal shared by all threads of one search (may be null)
+    std::atomic<uint64_t>* sharedNodes; // Node total of all threads, updated in batches (may be null)
+    uint64_t unpublishedNodes; // Nodes not yet added to sharedNodes
+    SearchLimits limits; // Budget of the current run
+    std::chrono::steady_clock::time_point startTime; // When the run started
+    uint64_t nodes; // Nodes visited so far
+    bool stopped; // Set when a limit runs out; unfinished iterations are thrown away
+    SearchPly* stack; // MAX_SEARCH_PLY entries in the arena the search was created with
+    Move rootBest; // Best move of the previous iteration, searched first at the root
+    PawnTable pawnTable; // Pawn-structure scores of this thread
+    HistoryTable history; // Quiet-move cut-off statistics of this thread, cleared every run
+
+    int alphaBeta(int alpha, int beta, int depth, int ply, int checks, bool allowNull); // Main search
+    int quiescence(int alpha, int beta, int ply, int checks); // Captures only, until the position is quiet
+    int evaluate(); // Static score for the side to move
+    Move findWinningCheck(const MoveList& moves); // A move giving the last check allowed by CHECK_LIMIT, or MOVE_NONE
+    bool checkLimits(); // Checking the time and node budget (sets 'stopped')
+    int elapsedMs() const; // Milliseconds since the run started
+    void publishNodes(); // Adding the nodes counted since the last call to sharedNodes
+
+public:
+    // Searching from a copy of 'start' with 'checksGiven' checks already played, taking the per-ply stack from 'arena'
+    // (which needs arenaBytes() free). Helpers of a parallel search pass their thread number and the shared stop
+    // signal and node counter.
+    Search(const ChessBoard& start, int checksGiven, Arena& arena, TranspositionTable& table = TT, int id = 0,
+           std::atomic<bool>* stopSignal = nullptr, std::atomic<uint64_t>* nodeCounter = nullptr);
+    static size_t arenaBytes(); // Arena size that holds a Search placed in it plus its per-ply stack
+    SearchResult run(const SearchLimits& searchLimits, bool printInfo); // Iterative deepening (printInfo writes one line per iteration)
+};
+
+// Lazy SMP: every thread runs its own iterative deepening on the same root, sharing only the transposition table.
+// Helpers start one ply deeper on every other thread, so the threads fill the table with different depths; the
+// main thread (id 0) keeps the time and node budget and stops the helpers when it is done.
+class SearchPool {
+private:
+    int threadCount; // Threads used per search (1 = plain single-threaded, deterministic search)
+    std::atomic<bool> stopFlag; // Raised to end the current search early
+    std::atomic<uint64_t> nodeCounter; // Nodes of all threads in the current search
+    std::vector<std::unique_ptr<Arena>> arenas; // One per thread, kept from search to search so searching allocates nothing
+    std::vector<Search*> searches; // The current search of each thread, placed in its arena
+    std::vector<SearchResult> results; // Their results
+
+public:
+    SearchPool();
+    void setThreads(int count); // Changing the number of search threads (at least 1)
+    int threads() const { return threadCount; } // Current number of search threads
+    SearchResult search(const ChessBoard& board, int checksGiven, const SearchLimits& limits, bool printInfo); // Running one search
+    void stop(); // Asking a running search to finish as soon as possible (safe from another thread)
+    // Lowering the stop signal before a search is started on another thread, so a stop() sent right after that is not
+    // lost. search() leaves the signal lowered when it returns.
+    void clearStop();
+};
+
+extern SearchPool ENGINE; // The engine's search threads, used by ChessBoard::bestMove
+
+int benchMain(int argc, char* argv[]); // Command-line entry for --bench: fixed-depth searches over the reference positions
+int smpBenchMain(int argc, char* argv[]); // Command-line entry for --bench-smp: nodes/second and depth from 1 to N threads
+
+#endif
@@ -0,0 +1,970 @@
+// Server.cpp
+// Implementation of the game server and its load generator:
+//
+//   event loop (accepts, reads requests, owns the slab) --(job queue per worker)--> workers (check and play moves)
+//   workers --(reply list + eventfd wake-up)--> event loop (writes the replies)
+//
+// A session always goes to the same worker (slot number modulo the worker count), so its game is only ever touched
+// by one thread and its replies keep their order without any lock on the session. The loop does no chess at all:
+// parsing a move, checking it against the legal moves and playing it all happen on the workers.
+#include <algorithm> // Include algorithm for nth_element over the latencies
+#include <atomic> // Include atomic for the worker counters and the stop flag
+#include <chrono> // Include chrono for the load generator's clock
+#include <cerrno> // Include cerrno for EAGAIN
+#include <cstdio> // Include cstdio for snprintf and sscanf
+#include <cstdlib> // Include cstdlib for atoi and strtoul
+#include <cstring> // Include cstring for strcmp and memcpy
+#include <iomanip> // Include iomanip for the load report
+#include <iostream> // Include iostream for messages and the report
+#include <memory> // Include memory for the slab chunks and workers
+#include <mutex> // Include mutex for the reply list
+#include <string> // Include string for connection buffers
+#include <thread> // Include thread for the workers
+#include <unordered_map> // Include unordered_map for the load generator's session ids
+#include <vector> // Include vector for connections, slots and replies
+#include "Server.h" // Server declarations
+#include "BoundedQueue.h" // Job queues of the workers
+#include "ChessGame.h" // Boards for checking and playing moves
+using namespace std;
+
+#ifdef __linux__
+#include <arpa/inet.h> // Include arpa/inet.h for the loopback address
+#include <fcntl.h> // Include fcntl.h for non-blocking sockets
+#include <netinet/in.h> // Include netinet/in.h for TCP addresses
+#include <netinet/tcp.h> // Include netinet/tcp.h for TCP_NODELAY
+#include <pthread.h> // Include pthread.h for the workers' CPU clocks
+#include <sys/epoll.h> // Include sys/epoll.h for the event loop
+#include <sys/eventfd.h> // Include sys/eventfd.h for waking the loop from the workers
+#include <sys/socket.h> // Include sys/socket.h for the sockets
+#include <sys/un.h> // Include sys/un.h for Unix socket addresses
+#include <time.h> // Include time.h for thread CPU clocks
+#include <unistd.h> // Include unistd.h for read, write and close
+
+// How a game stands after the last move. The first two go on; the others have ended it.
+enum SessionState { GAME_PLAYING, GAME_CHECK, GAME_MATE, GAME_STALEMATE, GAME_REPETITION, GAME_FIFTY, GAME_CHECKS, GAME_STATE_NB };
+static const char* const STATE_NAMES[GAME_STATE_NB] = {"play", "check", "mate", "stalemate", "repetition", "fifty", "checks"};
+
+// The game of one session, touched only by its worker.
+struct SessionGame {
+    Position pos; // Current position
+    uint64_t history[FIFTY_MOVE_PLIES]; // Keys since the last capture or pawn move (older ones cannot repeat)
+    uint16_t historyCount;
+    uint8_t checks; // Checks given by both sides together (CHECK_LIMIT ends the game)
+    uint8_t state; // SessionState after the last move
+};
+
+// Bookkeeping of one slab slot, touched only by the event loop.
+struct SessionSlot {
+    uint32_t generation; // Reuse count, so an old id cannot reach the slot's next game
+    uint32_t owner; // Connection that created the session
+    uint32_t ownerGeneration;
+    uint32_t pending; // Jobs sent to the worker and not answered yet
+    uint32_t prevOwned, nextOwned; // Neighbours in the owner's list of open sessions (NO_SLOT at either end)
+    bool used;
+    bool released; // Resigned, refused or its connection closed: freed once nothing is pending
+};
+
+const uint32_t NO_SLOT = ~uint32_t(0); // End of a connection's session list
+
+const uint32_t SLAB_CHUNK = 1024; // Games per slab chunk; chunks are never moved, so workers keep plain pointers
+
+class SessionSlab {
+private:
+    vector<unique_ptr<SessionGame[]>> chunks;
+    vector<SessionSlot> slots;
+    vector<uint32_t> freeSlots;
+    uint32_t limit; // Most slots ever handed out
+    uint32_t active; // Slots in use
+
+public:
+    explicit SessionSlab(uint32_t maxSessions) : limit(maxSessions), active(0) {}
+
+    bool allocate(uint32_t& index) { // A free slot, growing the slab by a chunk if needed (false when full)
+        if (freeSlots.empty()) {
+            if (slots.size() >= limit) return false;
+            chunks.emplace_back(new SessionGame[SLAB_CHUNK]);
+            uint32_t first = uint32_t(slots.size());
+            uint32_t end = first + SLAB_CHUNK < limit ? first + SLAB_CHUNK : limit;
+            slots.resize(end, SessionSlot());
+            for (uint32_t i = end; i > first; i--) freeSlots.push_back(i - 1); // Lowest slots handed out first
+        }
+        index = freeSlots.back();
+        freeSlots.pop_back();
+        SessionSlot& slot = slots[index];
+        slot.used = true;
+        slot.released = false;
+        slot.pending = 0;
+        active++;
+        return true;
+    }
+
+    void release(uint32_t index) {
+        SessionSlot& slot = slots[index];
+        slot.used = false;
+        slot.generation++;
+        freeSlots.push_back(index);
+        active--;
+    }
+
+    uint32_t size() const { return uint32_t(slots.size()); }
+    uint32_t activeCount() const { return active; }
+    SessionSlot& slot(uint32_t index) { return slots[index]; }
+    SessionGame* game(uint32_t index) { return &chunks[index / SLAB_CHUNK][index % SLAB_CHUNK]; }
+};
+
+static uint32_t sessionId(uint32_t index, uint32_t generation) {
+    return (generation << SERVER_SESSION_BITS) | index;
+}
+
+enum JobKind { JOB_NEW, JOB_MOVE, JOB_STATE, JOB_RESIGN };
+
+struct ServerJob {
+    uint32_t connection, connectionGeneration; // Where the reply goes
+    uint32_t session; // Session id
+    int kind; // JobKind
+    SessionGame* game;
+    char text[SERVER_MAX_LINE]; // Move text or FEN
+};
+
+struct ServerReply {
+    uint32_t connection, connectionGeneration;
+    uint32_t slot; // Slab slot of the session
+    bool release; // The session ends with this reply
+    char line[SERVER_MAX_LINE]; // Reply without the newline
+};
+
+struct ServerStats {
+    atomic<uint64_t> moves; // Moves played
+    atomic<uint64_t> illegal; // Moves refused
+    ServerStats() : moves(0), illegal(0) {}
+};
+
+class ServerWorker {
+public:
+    BoundedQueue<ServerJob> jobs;
+    ServerStats stats;
+    ChessBoard board; // Scratch board a session's position is loaded into
+    thread worker;
+
+    ServerWorker() : jobs(4096) {}
+    void handle(const ServerJob& job, ServerReply& reply);
+};
+
+// The state after a move (or of a new position), from the position and the session's history.
+static int gameState(const SessionGame& game, const ChessBoard& board) {
+    if (game.checks >= CHECK_LIMIT) return GAME_CHECKS; // The last check ends the game before anything else
+    const Position& pos = board.position();
+    bool inCheck = pos.inCheck(pos.sideToMove);
+    MoveList moves;
+    board.generateMoves(moves);
+    if (moves.size() == 0) return inCheck ? GAME_MATE : GAME_STALEMATE;
+    if (pos.halfMoveClock >= FIFTY_MOVE_PLIES) return GAME_FIFTY;
+    int repetitions = 0;
+    for (int i = 0; i < game.historyCount; i++) repetitions += game.history[i] == pos.key;
+    if (repetitions >= 2) return GAME_REPETITION; // Third occurrence
+    return inCheck ? GAME_CHECK : GAME_PLAYING;
+}
+
+void ServerWorker::handle(const ServerJob& job, ServerReply& reply) {
+    SessionGame& game = *job.game;
+    reply.connection = job.connection;
+    reply.connectionGeneration = job.connectionGeneration;
+    reply.slot = job.session & (SERVER_MAX_SESSIONS - 1);
+    reply.release = false;
+    unsigned id = job.session;
+    switch (job.kind) {
+        case JOB_NEW:
+            if (job.text[0] == '\0') board.resetBoard();
+            else if (!board.loadFen(job.text)) {
+                snprintf(reply.line, sizeof(reply.line), "error invalid fen");
+                reply.release = true;
+                return;
+            }
+            game.pos = board.position();
+            game.historyCount = 0;
+            game.checks = 0;
+            game.state = uint8_t(gameState(game, board));
+            snprintf(reply.line, sizeof(reply.line), "new %u", id);
+            return;
+        case JOB_MOVE: {
+            if (game.state >= GAME_MATE) {
+                snprintf(reply.line, sizeof(reply.line), "over %u %s", id, STATE_NAMES[game.state]);
+                return;
+            }
+            board.setPosition(game.pos);
+            Move move = board.parseMove(job.text);
+            if (move == MOVE_NONE) {
+                stats.illegal.fetch_add(1, memory_order_relaxed);
+                snprintf(reply.line, sizeof(reply.line), "illegal %u %.64s", id, job.text); // Echo bounded: the request may be any word
+                return;
+            }
+            uint64_t before = game.pos.key;
+            board.playMove(move);
+            const Position& pos = board.position();
+            if (pos.halfMoveClock == 0) game.historyCount = 0; // Nothing before a capture or pawn move can repeat
+            else if (game.historyCount < FIFTY_MOVE_PLIES) game.history[game.historyCount++] = before;
+            if (pos.inCheck(pos.sideToMove)) game.checks++;
+            game.pos = pos;
+            game.state = uint8_t(gameState(game, board));
+            stats.moves.fetch_add(1, memory_order_relaxed);
+            snprintf(reply.line, sizeof(reply.line), "move %u %s %s %d", id, moveToString(move).c_str(), STATE_NAMES[game.state], game.checks);
+            return;
+        }
+        case JOB_STATE:
+            snprintf(reply.line, sizeof(reply.line), "state %u %s %d %s", id, STATE_NAMES[game.state], game.checks, game.pos.toFen().c_str());
+            return;
+        default: // JOB_RESIGN: answered after every earlier job of the session
+            snprintf(reply.line, sizeof(reply.line), "resign %u", id);
+            reply.release = true;
+            return;
+    }
+}
+
+struct ServerConnection {
+    int fd; // -1 when the slot is free
+    uint32_t generation; // Reuse count, so late replies for a closed connection are dropped
+    string input; // Bytes read but not yet a full line
+    string output; // Replies not yet written
+    bool writing; // Waiting for the socket to take more output (EPOLLOUT registered)
+    uint32_t sessions; // First of the open sessions it created (NO_SLOT if none), so closing it never scans the slab
+};
+
+struct ServerOptions {
+    int port; // TCP port on 127.0.0.1 (used when no socket path is given)
+    string socketPath; // Unix socket to listen on
+    int workers; // Worker threads
+    uint32_t maxSessions;
+    ServerOptions() : port(SERVER_DEFAULT_PORT), workers(0), maxSessions(SERVER_MAX_SESSIONS) {
+        int cores = (int)thread::hardware_concurrency();
+        workers = cores > 1 ? cores - 1 : 1; // One core for the event loop, the rest check moves
+    }
+};
+
+const uint64_t LISTEN_TAG = ~uint64_t(0); // epoll tags of the two descriptors that are not connections
+const uint64_t WAKE_TAG = ~uint64_t(0) - 1;
+
+class GameServer {
+private:
+    ServerOptions options;
+    int listenFd, epollFd, wakeFd;
+    atomic<bool> stopping;
+    SessionSlab slab;
+    vector<ServerConnection> connections;
+    vector<uint32_t> freeConnections;
+    vector<unique_ptr<ServerWorker>> workers;
+    mutex replyLock; // Guards 'replies'
+    vector<ServerReply> replies; // Filled by the workers
+    vector<ServerReply> delivering; // Swapped with 'replies' by the loop (both keep their capacity)
+    vector<uint32_t> dirty; // Connections with new output since the last flush
+
+    void accept();
+    void closeConnection(uint32_t index);
+    void ownSession(uint32_t index, uint32_t slot);
+    void releaseSession(uint32_t slot);
+    void readConnection(uint32_t index);
+    void handleLine(uint32_t index, char* line);
+    void send(uint32_t index, const char* line);
+    void flush(uint32_t index);
+    bool dispatch(uint32_t index, uint32_t slot, int kind, const char* text);
+    void deliverReplies();
+    void workerLoop(ServerWorker& worker);
+    uint64_t cpuMicroseconds() const;
+    bool findSession(uint32_t connection, const char* text, uint32_t& slot, uint32_t& id);
+
+public:
+    explicit GameServer(const ServerOptions& serverOptions);
+    ~GameServer();
+    bool listen(string& error); // Opening the socket and starting the workers
+    void run(); // Serving until stop() is called
+    void stop(); // Safe from any thread
+};
+
+GameServer::GameServer(const ServerOptions& serverOptions)
+    : options(serverOptions), listenFd(-1), epollFd(-1), wakeFd(-1), stopping(false), slab(serverOptions.maxSessions) {}
+
+GameServer::~GameServer() {
+    for (unique_ptr<ServerWorker>& worker : workers) worker->jobs.close();
+    for (unique_ptr<ServerWorker>& worker : workers) if (worker->worker.joinable()) worker->worker.join();
+    for (ServerConnection& connection : connections) if (connection.fd >= 0) ::close(connection.fd);
+    if (listenFd >= 0) ::close(listenFd);
+    if (epollFd >= 0) ::close(epollFd);
+    if (wakeFd >= 0) ::close(wakeFd);
+    if (!options.socketPath.empty()) unlink(options.socketPath.c_str());
+}
+
+bool GameServer::listen(string& error) {
+    if (options.socketPath.empty()) {
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int yes = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in address = sockaddr_in();
+        address.sin_family = AF_INET;
+        address.sin_port = htons(uint16_t(options.port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Local clients only
+        if (listenFd < 0 || bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0) {
+            error = "cannot listen on 127.0.0.1:" + to_string(options.port);
+            return false;
+        }
+    } else {
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        sockaddr_un address = sockaddr_un();
+        address.sun_family = AF_UNIX;
+        if (options.socketPath.size() >= sizeof(address.sun_path)) {
+            error = "socket path too long";
+            return false;
+        }
+        strcpy(address.sun_path, options.socketPath.c_str());
+        unlink(address.sun_path); // A socket file left by an earlier run
+        if (listenFd < 0 || bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0) {
+            error = "cannot listen on " + options.socketPath;
+            return false;
+        }
+    }
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (::listen(listenFd, 1024) != 0 || epollFd < 0 || wakeFd < 0) {
+        error = "cannot set up the event loop";
+        return false;
+    }
+    epoll_event event = epoll_event();
+    event.events = EPOLLIN;
+    event.data.u64 = LISTEN_TAG;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.u64 = WAKE_TAG;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+    for (int i = 0; i < options.workers; i++) {
+        workers.emplace_back(new ServerWorker());
+        ServerWorker& worker = *workers.back();
+        worker.worker = thread([this, &worker]() { workerLoop(worker); });
+    }
+    return true;
+}
+
+void GameServer::workerLoop(ServerWorker& worker) {
+    ServerJob job;
+    ServerReply reply;
+    while (worker.jobs.pop(job)) {
+        worker.handle(job, reply);
+        bool wake;
+        {
+            lock_guard<mutex> guard(replyLock);
+            wake = replies.empty(); // The loop has seen everything before: it needs one wake-up for this batch
+            replies.push_back(reply);
+        }
+        if (wake) {
+            uint64_t one = 1;
+            if (write(wakeFd, &one, sizeof(one)) < 0) {} // A full counter still wakes the loop
+        }
+    }
+}
+
+void GameServer::stop() {
+    stopping.store(true);
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0) {}
+}
+
+void GameServer::run() {
+    epoll_event events[256];
+    while (!stopping.load()) {
+        int count = epoll_wait(epollFd, events, 256, -1);
+        for (int i = 0; i < count; i++) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == LISTEN_TAG) accept();
+            else if (tag == WAKE_TAG) {
+                uint64_t value;
+                if (read(wakeFd, &value, sizeof(value)) < 0) {} // Resetting the counter
+                deliverReplies();
+            } else {
+                uint32_t index = uint32_t(tag);
+                ServerConnection& connection = connections[index];
+                if (connection.fd < 0 || connection.generation != uint32_t(tag >> 32)) continue; // Closed earlier in this batch
+                if (events[i].events & EPOLLOUT) flush(index);
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) readConnection(index);
+            }
+        }
+        for (uint32_t index : dirty) flush(index); // One write per connection for everything this round produced
+        dirty.clear();
+    }
+}
+
+void GameServer::accept() {
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return; // No more waiting connections (or out of descriptors: the rest wait in the backlog)
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes)); // Fails harmlessly on Unix sockets
+        uint32_t index;
+        if (!freeConnections.empty()) {
+            index = freeConnections.back();
+            freeConnections.pop_back();
+        } else {
+            index = uint32_t(connections.size());
+            connections.push_back(ServerConnection());
+            connections.back().generation = 0;
+        }
+        ServerConnection& connection = connections[index];
+        connection.fd = fd;
+        connection.input.clear();
+        connection.output.clear();
+        connection.writing = false;
+        connection.sessions = NO_SLOT;
+        epoll_event event = epoll_event();
+        event.events = EPOLLIN;
+        event.data.u64 = (uint64_t(connection.generation) << 32) | index;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+// Ends a connection and every session it created (each freed as soon as its worker has answered its last job).
+void GameServer::closeConnection(uint32_t index) {
+    ServerConnection& connection = connections[index];
+    ::close(connection.fd); // Also takes it out of the epoll set
+    connection.fd = -1;
+    while (connection.sessions != NO_SLOT) {
+        uint32_t slot = connection.sessions;
+        releaseSession(slot); // Takes it off the list
+        if (slab.slot(slot).pending == 0) slab.release(slot);
+    }
+    connection.generation++;
+    freeConnections.push_back(index);
+}
+
+// Puts a new session at the front of its connection's list.
+void GameServer::ownSession(uint32_t index, uint32_t slot) {
+    ServerConnection& connection = connections[index];
+    SessionSlot& session = slab.slot(slot);
+    session.owner = index;
+    session.ownerGeneration = connection.generation;
+    session.prevOwned = NO_SLOT;
+    session.nextOwned = connection.sessions;
+    if (connection.sessions != NO_SLOT) slab.slot(connection.sessions).prevOwned = slot;
+    connection.sessions = slot;
+}
+
+// No more requests are taken for the session, which leaves its connection's list. The caller frees the slot once no
+// job is pending.
+void GameServer::releaseSession(uint32_t slot) {
+    SessionSlot& session = slab.slot(slot);
+    if (session.released) return; // Already off the list
+    session.released = true;
+    if (session.prevOwned != NO_SLOT) slab.slot(session.prevOwned).nextOwned = session.nextOwned;
+    else connections[session.owner].sessions = session.nextOwned;
+    if (session.nextOwned != NO_SLOT) slab.slot(session.nextOwned).prevOwned = session.prevOwned;
+}
+
+void GameServer::readConnection(uint32_t index) {
+    char buffer[65536];
+    ssize_t got = read(connections[index].fd, buffer, sizeof(buffer));
+    if (got <= 0) {
+        if (got < 0 && errno == EAGAIN) return;
+        closeConnection(index);
+        return;
+    }
+    string& input = connections[index].input;
+    input.append(buffer, size_t(got));
+    size_t start = 0, end;
+    char line[SERVER_MAX_LINE + 1];
+    while ((end = input.find('\n', start)) != string::npos) {
+        size_t length = end - start;
+        if (length > 0 && input[end - 1] == '\r') length--;
+        if (length > SERVER_MAX_LINE) {
+            closeConnection(index);
+            return;
+        }
+        memcpy(line, input.data() + start, length);
+        line[length] = '\0';
+        start = end + 1;
+        handleLine(index, line);
+        if (connections[index].fd < 0) return; // "quit"
+    }
+    input.erase(0, start);
+    if (input.size() > SERVER_MAX_LINE) closeConnection(index); // No newline in sight
+}
+
+// Splits a request in place into at most 'max' words; the last one keeps the rest of the line (a FEN has spaces).
+static int splitWords(char* line, char* words[], int max) {
+    int count = 0;
+    while (count < max) {
+        while (*line == ' ' || *line == '\t') line++;
+        if (!*line) break;
+        words[count++] = line;
+        if (count == max) break;
+        while (*line && *line != ' ' && *line != '\t') line++;
+        if (*line) *line++ = '\0';
+    }
+    return count;
+}
+
+bool GameServer::findSession(uint32_t connection, const char* text, uint32_t& slot, uint32_t& id) {
+    char* end;
+    unsigned long value = strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || value > 0xFFFFFFFFul) return false;
+    id = uint32_t(value);
+    slot = id & (SERVER_MAX_SESSIONS - 1);
+    if (slot >= slab.size()) return false;
+    const SessionSlot& session = slab.slot(slot);
+    return session.used && !session.released && sessionId(slot, session.generation) == id && session.owner == connection &&
+           session.ownerGeneration == connections[connection].generation;
+}
+
+void GameServer::handleLine(uint32_t index, char* line) {
+    char* words[3];
+    int count = splitWords(line, words, 3);
+    if (count == 0) return;
+    char reply[SERVER_MAX_LINE];
+    uint32_t slot, id;
+    if (strcmp(words[0], "new") == 0) {
+        const char* fen = "";
+        if (count == 3 && strcmp(words[1], "fen") == 0) fen = words[2];
+        else if (count != 1) return send(index, "error usage: new [fen <FEN>]");
+        if (!slab.allocate(slot)) return send(index, "error server full");
+        ownSession(index, slot);
+        if (!dispatch(index, slot, JOB_NEW, fen)) {
+            releaseSession(slot);
+            slab.release(slot);
+            return send(index, "error busy");
+        }
+    } else if (strcmp(words[0], "move") == 0 || strcmp(words[0], "state") == 0 || strcmp(words[0], "resign") == 0) {
+        int kind = words[0][0] == 'm' ? JOB_MOVE : words[0][0] == 's' ? JOB_STATE : JOB_RESIGN;
+        if (count != (kind == JOB_MOVE ? 3 : 2)) return send(index, kind == JOB_MOVE ? "error usage: move <id> <move>" : "error usage: state|resign <id>");
+        if (!findSession(index, words[1], slot, id)) {
+            snprintf(reply, sizeof(reply), "error unknown session %s", words[1]);
+            return send(index, reply);
+        }
+        if (!dispatch(index, slot, kind, kind == JOB_MOVE ? words[2] : "")) return send(index, "error busy");
+        if (kind == JOB_RESIGN) releaseSession(slot); // No more requests accepted; freed after the reply
+    } else if (strcmp(words[0], "stats") == 0) {
+        uint64_t moves = 0, illegal = 0;
+        for (unique_ptr<ServerWorker>& worker : workers) {
+            moves += worker->stats.moves.load(memory_order_relaxed);
+            illegal += worker->stats.illegal.load(memory_order_relaxed);
+        }
+        snprintf(reply, sizeof(reply), "stats sessions %u moves %llu illegal %llu cpu_us %llu workers %d session_bytes %u",
+                 slab.activeCount(), (unsigned long long)moves, (unsigned long long)illegal, (unsigned long long)cpuMicroseconds(),
+                 (int)workers.size(), unsigned(sizeof(SessionGame) + sizeof(SessionSlot)));
+        send(index, reply);
+    } else if (strcmp(words[0], "quit") == 0) {
+        closeConnection(index);
+    } else {
+        send(index, "error unknown command");
+    }
+}
+
+// Queues a job for the session's worker without waiting: the loop must not stall every other connection behind one
+// busy worker. False (nothing queued) if that worker's queue is full.
+bool GameServer::dispatch(uint32_t index, uint32_t slot, int kind, const char* text) {
+    SessionSlot& session = slab.slot(slot);
+    ServerJob job;
+    job.connection = index;
+    job.connectionGeneration = connections[index].generation;
+    job.session = sessionId(slot, session.generation);
+    job.kind = kind;
+    job.game = slab.game(slot);
+    size_t length = strlen(text);
+    if (length >= sizeof(job.text)) length = sizeof(job.text) - 1;
+    memcpy(job.text, text, length);
+    job.text[length] = '\0';
+    if (!workers[slot % workers.size()]->jobs.tryPush(job)) return false; // Same worker for every job of the session
+    session.pending++;
+    return true;
+}
+
+void GameServer::deliverReplies() {
+    {
+        lock_guard<mutex> guard(replyLock);
+        delivering.swap(replies);
+    }
+    for (const ServerReply& reply : delivering) {
+        SessionSlot& session = slab.slot(reply.slot);
+        session.pending--;
+        if (reply.release) releaseSession(reply.slot);
+        if (session.released && session.pending == 0) slab.release(reply.slot);
+        if (reply.connection < connections.size() && connections[reply.connection].fd >= 0 &&
+            connections[reply.connection].generation == reply.connectionGeneration) {
+            send(reply.connection, reply.line);
+        }
+    }
+    delivering.clear();
+}
+
+void GameServer::send(uint32_t index, const char* line) {
+    ServerConnection& connection = connections[index];
+    if (connection.output.empty() && !connection.writing) dirty.push_back(index); // Written at the end of the round
+    connection.output += line;
+    connection.output += '\n';
+}
+
+void GameServer::flush(uint32_t index) {
+    ServerConnection& connection = connections[index];
+    if (connection.fd < 0) return;
+    size_t done = 0;
+    while (done < connection.output.size()) {
+        ssize_t sent = ::send(connection.fd, connection.output.data() + done, connection.output.size() - done, MSG_NOSIGNAL);
+        if (sent <= 0) break; // Socket buffer full (or the peer is gone, which the next read reports)
+        done += size_t(sent);
+    }
+    connection.output.erase(0, done);
+    bool waiting = !connection.output.empty(); // The rest goes when the socket has room again
+    if (waiting != connection.writing) {
+        connection.writing = waiting;
+        epoll_event event = epoll_event();
+        event.events = waiting ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.u64 = (uint64_t(connection.generation) << 32) | index;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+    }
+}
+
+// CPU time of the loop and every worker (read from the workers' clocks, so it is current while they run).
+uint64_t GameServer::cpuMicroseconds() const {
+    uint64_t total = 0;
+    timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0) total += uint64_t(time.tv_sec) * 1000000 + uint64_t(time.tv_nsec) / 1000;
+    for (const unique_ptr<ServerWorker>& worker : workers) {
+        clockid_t clock;
+        if (pthread_getcpuclockid(const_cast<thread&>(worker->worker).native_handle(), &clock) == 0 && clock_gettime(clock, &time) == 0) {
+            total += uint64_t(time.tv_sec) * 1000000 + uint64_t(time.tv_nsec) / 1000;
+        }
+    }
+    return total;
+}
+
+// Options shared by --serve and --load-gen.
+static void parseServerOptions(int argc, char* argv[], ServerOptions& options) {
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) options.port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) options.socketPath = argv[++i];
+        else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) options.workers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-sessions") == 0 && i + 1 < argc) options.maxSessions = uint32_t(atoi(argv[++i]));
+    }
+    if (options.workers < 1) options.workers = 1;
+    if (options.maxSessions < 1 || options.maxSessions > SERVER_MAX_SESSIONS) options.maxSessions = SERVER_MAX_SESSIONS;
+}
+
+// Usage: ChessGame --serve [--port N | --socket PATH] [--workers N] [--max-sessions N]
+int serverMain(int argc, char* argv[]) {
+    ServerOptions options;
+    parseServerOptions(argc, argv, options);
+    GameServer server(options);
+    string error;
+    if (!server.listen(error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    cout << "Serving games on " << (options.socketPath.empty() ? "127.0.0.1:" + to_string(options.port) : options.socketPath)
+         << " with " << options.workers << " worker(s)" << endl;
+    server.run();
+    return 0;
+}
+
+// ---- Load generator ----
+
+static int connectTo(const ServerOptions& options) { // Blocking client socket, or -1
+    int fd;
+    if (options.socketPath.empty()) {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in address = sockaddr_in();
+        address.sin_family = AF_INET;
+        address.sin_port = htons(uint16_t(options.port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd >= 0 && connect(fd, (sockaddr*)&address, sizeof(address)) != 0) { ::close(fd); return -1; }
+        int yes = 1;
+        if (fd >= 0) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    } else {
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un address = sockaddr_un();
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, options.socketPath.c_str(), sizeof(address.sun_path) - 1);
+        if (fd >= 0 && connect(fd, (sockaddr*)&address, sizeof(address)) != 0) { ::close(fd); return -1; }
+    }
+    return fd;
+}
+
+static bool writeAll(int fd, const string& text) {
+    size_t done = 0;
+    while (done < text.size()) {
+        ssize_t sent = ::send(fd, text.data() + done, text.size() - done, MSG_NOSIGNAL);
+        if (sent <= 0) return false;
+        done += size_t(sent);
+    }
+    return true;
+}
+
+static bool serverStats(int fd, uint64_t& moves, uint64_t& cpuUs, unsigned& sessionBytes, int& workerCount) { // One "stats" round trip
+    if (!writeAll(fd, "stats\n")) return false;
+    string line;
+    char c;
+    while (read(fd, &c, 1) == 1 && c != '\n') line += c;
+    unsigned long long m = 0, illegal = 0, cpu = 0;
+    unsigned sessions = 0;
+    if (sscanf(line.c_str(), "stats sessions %u moves %llu illegal %llu cpu_us %llu workers %d session_bytes %u",
+               &sessions, &m, &illegal, &cpu, &workerCount, &sessionBytes) != 6) return false;
+    moves = m + illegal; // Refused moves are checked as well
+    cpuUs = cpu;
+    return true;
+}
+
+// One game played by the load generator. It keeps only the position: the server's replies say when the game ended.
+struct LoadSession {
+    uint32_t id;
+    int connection;
+    Position pos;
+    Move sent; // Move waiting for its reply (MOVE_NONE for the deliberately illegal one)
+    chrono::steady_clock::time_point sentAt;
+    int requests; // Moves sent in this game
+};
+
+struct LoadConnection {
+    int fd;
+    string input;
+    string output;
+    vector<int> waitingNew; // Local sessions whose "new" has not been answered, oldest first
+    size_t nextNew; // First unanswered entry of waitingNew
+};
+
+const int LOAD_ILLEGAL_EVERY = 16; // Every 16th move of a game is one the server must refuse
+
+// Usage: ChessGame --load-gen [--port N | --socket PATH] [--sessions N] [--connections N] [--moves N] [--workers N]
+// Plays random games on many sessions at once and reports the time from sending a move to its reply, the server CPU
+// per move and how many sessions one core could hold. Without --port or --socket a server is started in this process
+// on a temporary Unix socket, with --workers worker threads.
+int loadGenMain(int argc, char* argv[]) {
+    ServerOptions options;
+    parseServerOptions(argc, argv, options);
+    int sessionCount = 1000, connectionCount = 16;
+    uint64_t moveTarget = 200000;
+    int paceSeconds = 10; // Assumed time between moves of one game for the sessions-per-core estimate
+    bool external = false;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) sessionCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--connections") == 0 && i + 1 < argc) connectionCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--moves") == 0 && i + 1 < argc) moveTarget = uint64_t(atoll(argv[++i]));
+        else if (strcmp(argv[i], "--pace") == 0 && i + 1 < argc) paceSeconds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--port") == 0 || strcmp(argv[i], "--socket") == 0) external = true;
+    }
+    if (sessionCount < 1) sessionCount = 1;
+    if (connectionCount < 1) connectionCount = 1;
+    if (connectionCount > sessionCount) connectionCount = sessionCount;
+    if (paceSeconds < 1) paceSeconds = 1;
+
+    unique_ptr<GameServer> local; // In-process server unless one was named
+    thread localThread;
+    if (!external) {
+        options.socketPath = "/tmp/chessgame-load-" + to_string(getpid()) + ".sock";
+        local.reset(new GameServer(options));
+        string error;
+        if (!local->listen(error)) {
+            cerr << error << "\n";
+            return 1;
+        }
+        localThread = thread([&]() { local->run(); });
+    }
+
+    int control = connectTo(options); // Separate connection for the stats requests
+    uint64_t movesBefore = 0, cpuBefore = 0, movesAfter = 0, cpuAfter = 0;
+    unsigned sessionBytes = 0;
+    int workerCount = 0;
+    if (control < 0 || !serverStats(control, movesBefore, cpuBefore, sessionBytes, workerCount)) {
+        cerr << "Cannot reach the server\n";
+        if (control >= 0) ::close(control);
+        if (local) { local->stop(); localThread.join(); }
+        return 1;
+    }
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    vector<LoadConnection> connections(connectionCount);
+    vector<LoadSession> sessions(sessionCount);
+    unordered_map<uint32_t, int> byId; // Server id to local session
+    byId.reserve(size_t(sessionCount) * 2);
+    for (int c = 0; c < connectionCount; c++) {
+        LoadConnection& connection = connections[c];
+        connection.fd = connectTo(options);
+        connection.nextNew = 0;
+        if (connection.fd < 0) {
+            cerr << "Cannot open connection " << c + 1 << "\n";
+            for (int open = 0; open < c; open++) ::close(connections[open].fd);
+            ::close(control);
+            ::close(epollFd);
+            if (local) { local->stop(); localThread.join(); } // A joinable thread must not be destroyed
+            return 1;
+        }
+        epoll_event event = epoll_event();
+        event.events = EPOLLIN;
+        event.data.u32 = uint32_t(c);
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, connection.fd, &event);
+    }
+
+    ChessBoard board; // Scratch board for picking and playing moves
+    uint64_t seed = 2024, sent = 0, answered = 0, illegalSent = 0, games = 0, errors = 0;
+    vector<uint32_t> latencies; // Microseconds from sending a move to its reply
+    latencies.reserve(size_t(moveTarget));
+
+    auto startGame = [&](int s) {
+        LoadSession& session = sessions[s];
+        LoadConnection& connection = connections[session.connection];
+        connection.waitingNew.push_back(s);
+        connection.output += "new\n";
+    };
+    auto sendMove = [&](int s) {
+        if (sent >= moveTarget) return; // Enough moves in flight or done
+        LoadSession& session = sessions[s];
+        LoadConnection& connection = connections[session.connection];
+        string text;
+        if (++session.requests % LOAD_ILLEGAL_EVERY == 0) { // Moving the opponent's king: never legal
+            int king = session.pos.kingSquare(session.pos.sideToMove ^ 1);
+            text = squareName(king) + squareName((king + 1) & 63);
+            session.sent = MOVE_NONE;
+            illegalSent++;
+        } else {
+            board.setPosition(session.pos);
+            MoveList moves;
+            board.generateMoves(moves);
+            session.sent = moves[int(nextRandom(seed) % moves.size())]; // The server said the game goes on, so there is one
+            text = moveToString(session.sent);
+        }
+        connection.output += "move " + to_string(session.id) + " " + text + "\n";
+        session.sentAt = chrono::steady_clock::now();
+        sent++;
+    };
+
+    auto start = chrono::steady_clock::now();
+    for (int s = 0; s < sessionCount; s++) {
+        sessions[s].connection = s % connectionCount;
+        startGame(s);
+    }
+    for (LoadConnection& connection : connections) {
+        writeAll(connection.fd, connection.output);
+        connection.output.clear();
+    }
+
+    epoll_event events[64];
+    char buffer[65536];
+    while (answered < moveTarget && errors == 0) {
+        int count = epoll_wait(epollFd, events, 64, 10000);
+        if (count <= 0) {
+            cerr << "No reply from the server for 10 s\n";
+            errors++;
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            LoadConnection& connection = connections[events[i].data.u32];
+            ssize_t got = read(connection.fd, buffer, sizeof(buffer));
+            if (got <= 0) {
+                cerr << "The server closed a connection\n";
+                errors++;
+                break;
+            }
+            connection.input.append(buffer, size_t(got));
+            size_t begin = 0, end;
+            while ((end = connection.input.find('\n', begin)) != string::npos) {
+                string line = connection.input.substr(begin, end - begin);
+                begin = end + 1;
+                char kind[16] = "";
+                unsigned id = 0;
+                sscanf(line.c_str(), "%15s %u", kind, &id);
+                if (strcmp(kind, "new") == 0 && connection.nextNew < connection.waitingNew.size()) {
+                    int s = connection.waitingNew[connection.nextNew++];
+                    if (connection.nextNew == connection.waitingNew.size()) { connection.waitingNew.clear(); connection.nextNew = 0; }
+                    LoadSession& session = sessions[s];
+                    session.id = id;
+                    session.requests = 0;
+                    board.resetBoard();
+                    session.pos = board.position();
+                    byId[id] = s;
+                    sendMove(s);
+                    continue;
+                }
+                unordered_map<uint32_t, int>::iterator found = byId.find(id);
+                if (strcmp(kind, "resign") == 0 && found != byId.end()) {
+                    byId.erase(found);
+                    continue;
+                }
+                if ((strcmp(kind, "move") != 0 && strcmp(kind, "illegal") != 0) || found == byId.end()) {
+                    cerr << "Unexpected reply: " << line << "\n";
+                    errors++;
+                    continue;
+                }
+                LoadSession& session = sessions[found->second];
+                latencies.push_back(uint32_t(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - session.sentAt).count()));
+                answered++;
+                bool refused = kind[0] == 'i';
+                if (refused != (session.sent == MOVE_NONE)) { // A legal move refused, or the illegal one accepted
+                    cerr << "Wrong verdict: " << line << "\n";
+                    errors++;
+                    continue;
+                }
+                if (refused) {
+                    sendMove(found->second);
+                    continue;
+                }
+                board.setPosition(session.pos);
+                board.playMove(session.sent);
+                session.pos = board.position();
+                char state[16] = "";
+                sscanf(line.c_str(), "%*s %*u %*s %15s", state);
+                if (strcmp(state, "play") == 0 || strcmp(state, "check") == 0) {
+                    sendMove(found->second);
+                } else { // Game over: the session is given up and a new game starts in its place
+                    games++;
+                    if (sent < moveTarget) {
+                        connection.output += "resign " + to_string(id) + "\n";
+                        startGame(found->second);
+                    }
+                }
+            }
+            connection.input.erase(0, begin);
+            if (!connection.output.empty()) {
+                writeAll(connection.fd, connection.output);
+                connection.output.clear();
+            }
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    serverStats(control, movesAfter, cpuAfter, sessionBytes, workerCount);
+
+    for (LoadConnection& connection : connections) ::close(connection.fd);
+    ::close(control);
+    ::close(epollFd);
+    if (local) {
+        local->stop();
+        localThread.join();
+    }
+
+    size_t n = latencies.size();
+    uint32_t p50 = 0, p99 = 0, worst = 0;
+    if (n > 0) {
+        nth_element(latencies.begin(), latencies.begin() + n / 2, latencies.end());
+        p50 = latencies[n / 2];
+        nth_element(latencies.begin(), latencies.begin() + n * 99 / 100, latencies.end());
+        p99 = latencies[n * 99 / 100];
+        worst = *max_element(latencies.begin(), latencies.end());
+    }
+    uint64_t checked = movesAfter - movesBefore;
+    double cpuPerMove = checked ? double(cpuAfter - cpuBefore) / checked : 0; // Microseconds, loop included
+    cout << sessionCount << " sessions on " << connectionCount << " connections, " << answered << " moves (" << illegalSent
+         << " illegal on purpose), " << games << " games finished in " << fixed << setprecision(2) << seconds << " s: "
+         << uint64_t(seconds > 0 ? answered / seconds : 0) << " moves/s\n";
+    cout << "Move latency (request to reply): p50 " << p50 << " us  p99 " << p99 << " us  max " << worst << " us\n";
+    cout << "Server CPU: " << setprecision(2) << cpuPerMove << " us per move (" << workerCount << " worker(s) plus the event loop)\n";
+    if (cpuPerMove > 0) {
+        cout << "At one move every " << paceSeconds << " s per game: about " << uint64_t(paceSeconds * 1e6 / cpuPerMove)
+             << " sessions per core, " << sessionBytes << " bytes per session\n";
+    }
+    cout << "Errors: " << errors << "\n";
+    cout.unsetf(ios::fixed);
+    return errors == 0 ? 0 : 1;
+}
+
+#else // Sockets and epoll as used here are Linux only
+
+int serverMain(int, char*[]) {
+    cerr << "The game server needs Linux (epoll)\n";
+    return 1;
+}
+
+int loadGenMain(int, char*[]) {
+    cerr << "The load generator needs Linux (epoll)\n";
+    return 1;
+}
+
+#endif
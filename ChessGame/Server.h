@@ -0,0 +1,30 @@
+// Server.h
+// Many games in one process: an epoll event loop accepts connections on a local TCP port or Unix socket and reads a
+// line protocol, and a small pool of worker threads checks and plays the moves. Each game is a session of about a
+// kilobyte (position, repetition keys, checks given) in a slab, so thousands of games cost megabytes, not processes.
+//
+// Requests, one per line:            Replies:
+//   new [fen <FEN>]                    new <id>                            (or error invalid fen)
+//   move <id> <move>                   move <id> <move> <state> <checks>   (or illegal <id> <move>, over <id> <state>)
+//   state <id>                         state <id> <state> <checks> <FEN>
+//   resign <id>                        resign <id>                         (the session is gone afterwards)
+//   stats                              stats sessions N moves N illegal N cpu_us N workers N session_bytes N
+//   quit                               (the connection closes; so do its sessions)
+// <state> is play, check, mate, stalemate, repetition, fifty or checks (the N-check rule ended the game); <checks>
+// counts the checks given so far by both sides. Moves use the same notations as the game ("e2e4", "e7e8q").
+// Replies about one session come in the order of its requests; replies about different sessions may overtake each other.
+// A request for a session whose worker has a full queue is answered at once with "error busy" and not carried out.
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <cstdint> // Include cstdint for session ids
+
+const int SERVER_DEFAULT_PORT = 7878; // TCP port on 127.0.0.1 when no Unix socket is named
+const int SERVER_SESSION_BITS = 20; // A session id is its slab slot in the low bits and the slot's reuse count above
+const uint32_t SERVER_MAX_SESSIONS = 1u << SERVER_SESSION_BITS; // Most sessions one server holds at once
+const int SERVER_MAX_LINE = 256; // Longest request line; a longer one closes the connection
+
+int serverMain(int argc, char* argv[]); // Command-line entry for --serve: running the server until killed
+int loadGenMain(int argc, char* argv[]); // Command-line entry for --load-gen: many games against a server, with latency
+
+#endif
@@ -0,0 +1,319 @@
+// Simd.cpp
+// Scalar, SSE2 and AVX2 versions of the mailbox kernels, the run-time dispatch between them and --bench-simd.
+// The vector versions are compiled with per-function target attributes, so the program needs no special compiler
+// flags and still runs on CPUs without AVX2.
+#include <chrono> // Include chrono for timing the kernels
+#include <cstdlib> // Include cstdlib for atoi
+#include <cstring> // Include cstring for memset and memcmp
+#include <iomanip> // Include iomanip for the benchmark table
+#include <iostream> // Include iostream for the benchmark
+#include <vector> // Include vector for the benchmark positions
+#include "Simd.h" // Kernel declarations
+#include "ChessGame.h" // ChessBoard for playing out benchmark positions
+#include "Eval.h" // Piece-square tables summed by pieceSquareBatch
+using namespace std;
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h> // SSE2 and AVX2 intrinsics
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_X86 0 // Other compilers and CPUs use the scalar kernels only
+#endif
+
+SimdLevel detectSimdLevel() {
+#if SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+    return SIMD_SCALAR;
+}
+
+static SimdLevel& currentLevel() {
+    static SimdLevel level = detectSimdLevel(); // Detected on first use
+    return level;
+}
+
+SimdLevel simdLevel() { return currentLevel(); }
+
+void setSimdLevel(SimdLevel level) {
+    SimdLevel best = detectSimdLevel();
+    currentLevel() = level < best ? level : best;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    static const char* const NAMES[SIMD_LEVEL_NB] = {"scalar", "SSE2", "AVX2"};
+    return NAMES[level];
+}
+
+// Material plus piece-square value of each piece code on each square, middlegame in the low 16 bits and endgame in
+// the high 16 bits, so one 32-bit add sums both (the low half never leaves the int16 range for a real position).
+struct PackedPieceSquare {
+    int32_t values[PIECE_CODE_NB * SQUARE_NB]; // Index code * 64 + square; empty squares are 0
+    PackedPieceSquare() {
+        initEvalTables();
+        for (int code = 0; code < PIECE_CODE_NB; code++)
+            for (int sq = 0; sq < SQUARE_NB; sq++) {
+                int mg = 0, eg = 0;
+                if (code != NO_PIECE_CODE) {
+                    mg = PIECE_SQUARE[MIDDLEGAME][code / PIECE_TYPE_NB][code % PIECE_TYPE_NB][sq];
+                    eg = PIECE_SQUARE[ENDGAME][code / PIECE_TYPE_NB][code % PIECE_TYPE_NB][sq];
+                }
+                values[code * SQUARE_NB + sq] = int32_t(uint32_t(mg) + (uint32_t(eg) << 16));
+            }
+    }
+};
+
+static const PackedPieceSquare& packedTable() {
+    static const PackedPieceSquare table; // Built once, on first use
+    return table;
+}
+
+static void unpackSum(int32_t sum, int32_t& middlegame, int32_t& endgame) {
+    middlegame = int16_t(uint32_t(sum) & 0xFFFF);
+    endgame = (sum - middlegame) / 65536; // Exact: the low half has been taken out
+}
+
+// Scalar kernels
+
+static Bitboard squaresMatchingScalar(const uint8_t board[SQUARE_NB], uint8_t value) {
+    Bitboard b = 0;
+    for (int sq = 0; sq < SQUARE_NB; sq++) b |= Bitboard(board[sq] == value) << sq; // No branch per square
+    return b;
+}
+
+static void mailboxToBitboardsScalar(const uint8_t codes[SQUARE_NB], Bitboard sets[PIECE_CODE_NB]) {
+    for (int code = 0; code < PIECE_CODE_NB; code++) sets[code] = 0;
+    for (int sq = 0; sq < SQUARE_NB; sq++) {
+        if (codes[sq] < PIECE_CODE_NB) sets[codes[sq]] |= squareBit(sq); // Bytes that are no piece code are left out
+    }
+}
+
+static void bitboardsToMailboxScalar(const Position& pos, uint8_t codes[SQUARE_NB]) {
+    memset(codes, NO_PIECE_CODE, SQUARE_NB);
+    for (int color = 0; color < COLOR_NB; color++)
+        for (int type = 0; type < PIECE_TYPE_NB; type++)
+            for (Bitboard b = pos.pieces(color, type); b; ) codes[popLsb(b)] = uint8_t(color * PIECE_TYPE_NB + type);
+}
+
+static void pieceSquareBatchScalar(const uint8_t (*codes)[SQUARE_NB], size_t count, int32_t* middlegame, int32_t* endgame) {
+    const int32_t* table = packedTable().values;
+    for (size_t i = 0; i < count; i++) {
+        int32_t sum = 0;
+        for (int sq = 0; sq < SQUARE_NB; sq++) sum += table[codes[i][sq] * SQUARE_NB + sq];
+        unpackSum(sum, middlegame[i], endgame[i]);
+    }
+}
+
+#if SIMD_X86
+// SSE2 kernels: 16 squares per register
+
+TARGET_SSE2 static Bitboard squaresMatchingSse2(const uint8_t board[SQUARE_NB], uint8_t value) {
+    __m128i v = _mm_set1_epi8(char(value));
+    Bitboard b = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(board + 16 * i));
+        b |= Bitboard(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, v)))) << (16 * i);
+    }
+    return b;
+}
+
+TARGET_SSE2 static void mailboxToBitboardsSse2(const uint8_t codes[SQUARE_NB], Bitboard sets[PIECE_CODE_NB]) {
+    __m128i bytes[4]; // The mailbox is loaded once and compared with every code
+    for (int i = 0; i < 4; i++) bytes[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + 16 * i));
+    for (int code = 0; code < PIECE_CODE_NB; code++) {
+        __m128i v = _mm_set1_epi8(char(code));
+        Bitboard b = 0;
+        for (int i = 0; i < 4; i++) b |= Bitboard(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes[i], v)))) << (16 * i);
+        sets[code] = b;
+    }
+}
+
+// AVX2 kernels: 32 squares per register, and gathers for the table lookups
+
+TARGET_AVX2 static Bitboard squaresMatchingAvx2(const uint8_t board[SQUARE_NB], uint8_t value) {
+    __m256i v = _mm256_set1_epi8(char(value));
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(board));
+    __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(board + 32));
+    return Bitboard(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, v)))) |
+           (Bitboard(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, v)))) << 32);
+}
+
+TARGET_AVX2 static void mailboxToBitboardsAvx2(const uint8_t codes[SQUARE_NB], Bitboard sets[PIECE_CODE_NB]) {
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes));
+    __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes + 32));
+    for (int code = 0; code < PIECE_CODE_NB; code++) {
+        __m256i v = _mm256_set1_epi8(char(code));
+        sets[code] = Bitboard(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, v)))) |
+                     (Bitboard(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, v)))) << 32);
+    }
+}
+
+// 32 bits of a bitboard as 32 bytes, 0xFF where the bit is set: each byte picks the source byte holding its bit
+// (the broadcast puts all four in both 128-bit lanes) and tests that bit.
+TARGET_AVX2 static __m256i spreadBits(uint32_t bits) {
+    const __m256i pick = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                          2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i bit = _mm256_set1_epi64x(int64_t(0x8040201008040201ULL));
+    __m256i bytes = _mm256_shuffle_epi8(_mm256_set1_epi32(int32_t(bits)), pick);
+    return _mm256_cmpeq_epi8(_mm256_and_si256(bytes, bit), bit);
+}
+
+TARGET_AVX2 static void bitboardsToMailboxAvx2(const Position& pos, uint8_t codes[SQUARE_NB]) {
+    __m256i low = _mm256_set1_epi8(char(NO_PIECE_CODE)), high = low;
+    for (int color = 0; color < COLOR_NB; color++)
+        for (int type = 0; type < PIECE_TYPE_NB; type++) {
+            Bitboard b = pos.pieces(color, type);
+            if (!b) continue;
+            __m256i code = _mm256_set1_epi8(char(color * PIECE_TYPE_NB + type));
+            low = _mm256_blendv_epi8(low, code, spreadBits(uint32_t(b)));
+            high = _mm256_blendv_epi8(high, code, spreadBits(uint32_t(b >> 32)));
+        }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(codes), low);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(codes + 32), high);
+}
+
+TARGET_AVX2 static void pieceSquareBatchAvx2(const uint8_t (*codes)[SQUARE_NB], size_t count, int32_t* middlegame, int32_t* endgame) {
+    const int32_t* table = packedTable().values;
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (size_t i = 0; i < count; i++) {
+        __m256i sum = _mm256_setzero_si256();
+        for (int sq = 0; sq < SQUARE_NB; sq += 8) { // Eight squares per gather: index = code * 64 + square
+            __m256i code = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes[i] + sq)));
+            __m256i index = _mm256_add_epi32(_mm256_slli_epi32(code, 6), _mm256_add_epi32(lanes, _mm256_set1_epi32(sq)));
+            sum = _mm256_add_epi32(sum, _mm256_i32gather_epi32(table, index, 4));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)); // Horizontal sum
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+        unpackSum(_mm_cvtsi128_si32(half), middlegame[i], endgame[i]);
+    }
+}
+#endif
+
+// Dispatch
+
+Bitboard squaresMatching(const uint8_t board[SQUARE_NB], uint8_t value) {
+#if SIMD_X86
+    if (currentLevel() == SIMD_AVX2) return squaresMatchingAvx2(board, value);
+    if (currentLevel() == SIMD_SSE2) return squaresMatchingSse2(board, value);
+#endif
+    return squaresMatchingScalar(board, value);
+}
+
+void mailboxToBitboards(const uint8_t codes[SQUARE_NB], Bitboard sets[PIECE_CODE_NB]) {
+#if SIMD_X86
+    if (currentLevel() == SIMD_AVX2) return mailboxToBitboardsAvx2(codes, sets);
+    if (currentLevel() == SIMD_SSE2) return mailboxToBitboardsSse2(codes, sets);
+#endif
+    mailboxToBitboardsScalar(codes, sets);
+}
+
+void bitboardsToMailbox(const Position& pos, uint8_t codes[SQUARE_NB]) {
+#if SIMD_X86
+    if (currentLevel() == SIMD_AVX2) return bitboardsToMailboxAvx2(pos, codes);
+#endif
+    bitboardsToMailboxScalar(pos, codes); // Without a byte shuffle, spreading bits to bytes costs more than the stores it saves
+}
+
+void pieceSquareBatch(const uint8_t (*codes)[SQUARE_NB], size_t count, int32_t* middlegame, int32_t* endgame) {
+#if SIMD_X86
+    if (currentLevel() == SIMD_AVX2) return pieceSquareBatchAvx2(codes, count, middlegame, endgame);
+#endif
+    pieceSquareBatchScalar(codes, count, middlegame, endgame); // SSE2 has no gather, so it uses the scalar loop
+}
+
+// Runs 'kernel' over every benchmark position 'repeats' times and returns nanoseconds per position.
+template <typename Kernel>
+static double timeKernel(size_t positions, int repeats, Kernel kernel) {
+    kernel(); // Warming the caches and building any tables first
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) kernel();
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (double(positions) * repeats);
+}
+
+// Usage: ChessGame --bench-simd [positions]
+// Plays random games to collect positions, then times each kernel at every level the CPU supports and checks that
+// all levels give the same results as the scalar one.
+int simdBenchMain(int argc, char* argv[]) {
+    size_t count = argc > 2 ? size_t(atoi(argv[2])) : 10000;
+    if (count < 1) count = 1;
+    ChessBoard board;
+    vector<Position> positions;
+    uint64_t seed = 2024;
+    while (positions.size() < count) { // Up to 120 random plies per game, every position kept
+        board.resetBoard();
+        for (int ply = 0; ply < 120 && positions.size() < count; ply++) {
+            MoveList moves;
+            board.generateMoves(moves);
+            if (moves.size() == 0) break;
+            board.playMove(moves[int(nextRandom(seed) % moves.size())]);
+            positions.push_back(board.position());
+        }
+    }
+    vector<uint8_t> mailboxes(count * SQUARE_NB), check(count * SQUARE_NB);
+    typedef uint8_t Mailbox[SQUARE_NB];
+    const Mailbox* boxes = reinterpret_cast<const Mailbox*>(mailboxes.data());
+    vector<int32_t> mg(count), eg(count), mgScalar(count), egScalar(count);
+    vector<Bitboard> sets(count * PIECE_CODE_NB), setsScalar(count * PIECE_CODE_NB);
+    volatile Bitboard sink = 0; // Keeps the results of the timed loops alive
+
+    SimdLevel best = detectSimdLevel();
+    cout << "Detected: " << simdLevelName(best) << ", " << count << " positions\n\n";
+    cout << left << setw(26) << "Kernel" << setw(8) << "Level" << right << setw(12) << "ns/position" << setw(10) << "speedup" << "  result\n";
+    setSimdLevel(SIMD_SCALAR); // Mailboxes the other kernels read
+    for (size_t i = 0; i < count; i++) bitboardsToMailbox(positions[i], &mailboxes[i * SQUARE_NB]);
+    bool allMatch = true;
+    const int REPEATS = 50;
+    for (int kernel = 0; kernel < 4; kernel++) {
+        static const char* const NAMES[4] = {"find pieces by byte", "mailbox to bitboards", "bitboards to mailbox", "piece-square batch"};
+        double scalarNs = 0;
+        for (int level = SIMD_SCALAR; level <= best; level++) {
+            setSimdLevel(SimdLevel(level));
+            double ns = 0;
+            bool match = true;
+            if (kernel == 0) { // The bitboard of white pawns, found by their code in each mailbox
+                vector<Bitboard> found(count);
+                ns = timeKernel(count, REPEATS, [&]() {
+                    for (size_t i = 0; i < count; i++) found[i] = squaresMatching(boxes[i], PAWN);
+                    sink = found[count - 1];
+                });
+                for (size_t i = 0; i < count; i++) match = match && found[i] == positions[i].pieces(WHITE, PAWN);
+            } else if (kernel == 1) {
+                ns = timeKernel(count, REPEATS, [&]() {
+                    for (size_t i = 0; i < count; i++) mailboxToBitboards(boxes[i], &sets[i * PIECE_CODE_NB]);
+                    sink = sets[0];
+                });
+                if (level == SIMD_SCALAR) setsScalar = sets;
+                match = sets == setsScalar;
+                for (size_t i = 0; i < count; i++) match = match && sets[i * PIECE_CODE_NB + NO_PIECE_CODE] == ~positions[i].occupied;
+            } else if (kernel == 2) {
+                ns = timeKernel(count, REPEATS, [&]() {
+                    for (size_t i = 0; i < count; i++) bitboardsToMailbox(positions[i], &mailboxes[i * SQUARE_NB]);
+                    sink = mailboxes[0];
+                });
+                if (level == SIMD_SCALAR) check = mailboxes;
+                match = mailboxes == check;
+            } else {
+                ns = timeKernel(count, REPEATS, [&]() {
+                    pieceSquareBatch(boxes, count, mg.data(), eg.data());
+                    sink = Bitboard(mg[0]);
+                });
+                if (level == SIMD_SCALAR) { mgScalar = mg; egScalar = eg; }
+                match = mg == mgScalar && eg == egScalar;
+                for (size_t i = 0; i < count; i++) match = match && mg[i] == positions[i].psqScore[MIDDLEGAME] && eg[i] == positions[i].psqScore[ENDGAME];
+            }
+            if (kernel == 2) mailboxes = check; // The scalar mailboxes again for the next kernel
+            if (level == SIMD_SCALAR) scalarNs = ns;
+            allMatch = allMatch && match;
+            cout << left << setw(26) << (level == SIMD_SCALAR ? NAMES[kernel] : "") << setw(8) << simdLevelName(SimdLevel(level)) << right
+                 << fixed << setprecision(2) << setw(12) << ns << setw(9) << scalarNs / ns << "x  " << (match ? "ok" : "MISMATCH") << "\n";
+            cout.unsetf(ios::fixed);
+        }
+    }
+    setSimdLevel(best);
+    if (!allMatch) cout << "\nSome results differ from the scalar kernels\n";
+    return allMatch ? 0 : 1;
+}
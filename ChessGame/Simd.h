@@ -0,0 +1,32 @@
+// Simd.h
+// Vector kernels for the 64-byte mailbox form of a board (one byte per square, a8 first): finding the squares that
+// hold a given byte, splitting a mailbox into piece bitboards, writing a mailbox from bitboards, and summing the
+// piece-square values of many positions at once (for tuning and data generation). Each kernel has a scalar
+// version that works everywhere and SSE2/AVX2 versions on x86; the best one the CPU supports is picked at run time.
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstddef> // Include cstddef for size_t
+#include <cstdint> // Include cstdint for the mailbox bytes and sums
+#include "Position.h" // Include bitboards, piece types and the position
+
+enum SimdLevel { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_LEVEL_NB };
+
+const uint8_t NO_PIECE_CODE = COLOR_NB * PIECE_TYPE_NB; // Mailbox code of an empty square (pieces are color * 6 + type)
+const int PIECE_CODE_NB = NO_PIECE_CODE + 1;
+
+SimdLevel detectSimdLevel(); // Best level this CPU supports
+SimdLevel simdLevel(); // Level the kernels use (the detected one unless changed)
+void setSimdLevel(SimdLevel level); // Forcing a lower level (for benchmarks and checks; higher than detected is ignored)
+const char* simdLevelName(SimdLevel level);
+
+Bitboard squaresMatching(const uint8_t board[SQUARE_NB], uint8_t value); // Squares whose byte equals 'value'
+void mailboxToBitboards(const uint8_t codes[SQUARE_NB], Bitboard sets[PIECE_CODE_NB]); // One set per piece code, empty squares last
+void bitboardsToMailbox(const Position& pos, uint8_t codes[SQUARE_NB]); // Piece code of every square
+// Material plus piece-square sums (White minus Black, as Position::psqScore) of 'count' mailboxes. Uses the tables
+// of Eval.h, so initEvalTables() must have run.
+void pieceSquareBatch(const uint8_t (*codes)[SQUARE_NB], size_t count, int32_t* middlegame, int32_t* endgame);
+
+int simdBenchMain(int argc, char* argv[]); // Command-line entry for --bench-simd: every kernel against its scalar version
+
+#endif
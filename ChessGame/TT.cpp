@@ -0,0 +1,139 @@
+// TT.cpp
+// Implementation of the lock-free transposition table.
+#include <climits> // Include climits for INT_MAX
+#include <cstdlib> // Include cstdlib for the aligned allocation
+#include "TT.h" // Table declarations
+#include "Profile.h" // Optional timing of probes
+#ifdef _WIN32
+#include <malloc.h> // Include malloc.h for _aligned_malloc on Windows
+#else
+#include <sys/mman.h> // Include sys/mman.h for madvise (huge pages)
+#endif
+
+TranspositionTable TT; // The table shared by all searches
+
+static_assert(sizeof(TTEntry) == 16, "A table entry must be 16 bytes");
+static_assert(sizeof(TTBucket) == 64, "A bucket must fill exactly one cache line");
+
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024; // Size of a transparent huge page on x86-64
+
+// Packing one entry's data word.
+static uint64_t packData(Move move, int score, int depth, int bound, int age) {
+    return uint64_t(move) | (uint64_t(uint16_t(int16_t(score))) << 16) | (uint64_t(uint8_t(depth)) << 32) |
+           (uint64_t(bound) << 40) | (uint64_t(age & 63) << 42);
+}
+static Move dataMove(uint64_t d) { return Move(d & 0xFFFF); }
+static int dataScore(uint64_t d) { return int16_t(uint16_t(d >> 16)); } // Signed score
+static int dataDepth(uint64_t d) { return int((d >> 32) & 0xFF); }
+static int dataBound(uint64_t d) { return int((d >> 40) & 3); }
+static int dataAge(uint64_t d) { return int((d >> 42) & 63); }
+
+static void* allocateAligned(size_t bytes, size_t alignment) {
+#ifdef _WIN32
+    return _aligned_malloc(bytes, alignment);
+#else
+    void* mem = nullptr;
+    return posix_memalign(&mem, alignment, bytes) == 0 ? mem : nullptr;
+#endif
+}
+
+static void freeAligned(void* mem) {
+#ifdef _WIN32
+    _aligned_free(mem);
+#else
+    free(mem);
+#endif
+}
+
+TranspositionTable::TranspositionTable() : buckets(nullptr), bucketMask(0), sizeMb(0), hugePages(false), age(0) {
+    resize(TT_DEFAULT_MB, false);
+}
+
+TranspositionTable::~TranspositionTable() {
+    freeAligned(buckets);
+}
+
+bool TranspositionTable::resize(size_t megabytes, bool useHugePages) {
+    size_t count = 1; // Bucket count: largest power of two that fits in the requested size
+    while (count * 2 * sizeof(TTBucket) <= megabytes * 1024 * 1024) count *= 2;
+    size_t bytes = count * sizeof(TTBucket);
+    // Huge pages need the block aligned to the page size; the kernel is only asked, it may still use small pages.
+    void* mem = allocateAligned(bytes, useHugePages && bytes >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : sizeof(TTBucket));
+    if (!mem) return false; // Keeping the old table if there is not enough memory
+#if defined(MADV_HUGEPAGE)
+    if (useHugePages) madvise(mem, bytes, MADV_HUGEPAGE);
+#endif
+    freeAligned(buckets);
+    buckets = static_cast<TTBucket*>(mem);
+    bucketMask = count - 1;
+    sizeMb = bytes / (1024 * 1024);
+    hugePages = useHugePages;
+    clear();
+    return true;
+}
+
+void TranspositionTable::clear() {
+    for (uint64_t i = 0; i <= bucketMask; i++) {
+        for (TTEntry& e : buckets[i].entries) { // Relaxed stores: nobody searches while the table is cleared
+            e.check.store(0, std::memory_order_relaxed);
+            e.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    age = 0;
+}
+
+void TranspositionTable::newSearch() {
+    age = (age + 1) & 63; // Six bits of age, wrapping around
+}
+
+bool TranspositionTable::probe(uint64_t key, TTHit& hit) const {
+    PROFILE_SCOPE(PROFILE_TT_PROBE);
+    const TTBucket& b = bucketFor(key);
+    for (const TTEntry& e : b.entries) {
+        uint64_t d = e.data.load(std::memory_order_relaxed);
+        if ((e.check.load(std::memory_order_relaxed) ^ d) != key || dataBound(d) == BOUND_NONE) continue; // Other position, torn or empty
+        hit.move = dataMove(d);
+        hit.score = dataScore(d);
+        hit.depth = dataDepth(d);
+        hit.bound = dataBound(d);
+        return true;
+    }
+    return false;
+}
+
+// Replacement: the same position is always updated; otherwise the entry with the lowest depth, counting each search
+// generation of age as eight plies of depth, is overwritten, so stale results from earlier moves go first.
+void TranspositionTable::store(uint64_t key, Move move, int score, int depth, int bound) {
+    TTBucket& b = bucketFor(key);
+    TTEntry* replace = &b.entries[0];
+    int worst = INT_MAX;
+    for (TTEntry& e : b.entries) {
+        uint64_t d = e.data.load(std::memory_order_relaxed);
+        if ((e.check.load(std::memory_order_relaxed) ^ d) == key) { // Same position
+            if (move == MOVE_NONE) move = dataMove(d); // A fail-low search finds no move; keep the old one for ordering
+            if (bound != BOUND_EXACT && dataAge(d) == age && depth + 2 < dataDepth(d)) return; // Keep a much deeper result
+            replace = &e;
+            break;
+        }
+        int value = dataDepth(d) - 8 * ((age - dataAge(d)) & 63);
+        if (value < worst) {
+            worst = value;
+            replace = &e;
+        }
+    }
+    uint64_t d = packData(move, score, depth, bound, age);
+    replace->data.store(d, std::memory_order_relaxed);
+    replace->check.store(key ^ d, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    int used = 0, sampled = 0;
+    for (uint64_t i = 0; i <= bucketMask && sampled < 1000; i++) { // The first 250 buckets are a fair sample
+        for (const TTEntry& e : buckets[i].entries) {
+            uint64_t d = e.data.load(std::memory_order_relaxed);
+            if (dataBound(d) != BOUND_NONE && dataAge(d) == age) used++;
+            sampled++;
+        }
+    }
+    return sampled ? used * 1000 / sampled : 0;
+}
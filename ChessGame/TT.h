@@ -0,0 +1,65 @@
+// TT.h
+// Transposition table: a fixed-size hash table of search results shared by every search thread without locks.
+#ifndef TT_H
+#define TT_H
+
+#include <atomic> // Include atomic for the lock-free entry words
+#include <cstddef> // Include cstddef for size_t
+#include <cstdint> // Include cstdint for the 64-bit entry words
+#include "Move.h" // Include the 16-bit move type
+
+const int BOUND_NONE = 0; // Empty entry
+const int BOUND_UPPER = 1; // Score is at most the stored value (no move beat alpha)
+const int BOUND_LOWER = 2; // Score is at least the stored value (beta cut-off)
+const int BOUND_EXACT = 3; // Exact score (principal variation node)
+
+const int TT_DEFAULT_MB = 16; // Table size used until the player or command line picks another one
+
+// One 16-byte entry. The data word packs move, score, depth, bound and age; the other word holds key ^ data.
+// A reader accepts the entry only if the two words XOR back to its key, so an entry torn by two threads writing
+// at the same time is simply treated as a miss instead of needing a lock.
+struct TTEntry {
+    std::atomic<uint64_t> check; // Position key XOR data
+    std::atomic<uint64_t> data; // bits 0-15 move, 16-31 score, 32-39 depth, 40-41 bound, 42-47 age
+};
+
+const int TT_BUCKET_SIZE = 4; // Four entries fill one 64-byte cache line, so a probe touches a single line
+
+struct TTBucket {
+    TTEntry entries[TT_BUCKET_SIZE];
+};
+
+// What a probe found, unpacked.
+struct TTHit {
+    Move move; // Best (or refuting) move found last time, MOVE_NONE if none
+    int score; // Stored score (mate scores relative to the stored node)
+    int depth; // Remaining depth the score was searched with
+    int bound; // BOUND_UPPER, BOUND_LOWER or BOUND_EXACT
+};
+
+class TranspositionTable {
+private:
+    TTBucket* buckets; // Cache-line aligned bucket array
+    uint64_t bucketMask; // Bucket count minus one (the count is a power of two)
+    size_t sizeMb; // Size actually allocated, in megabytes
+    bool hugePages; // Whether huge pages were requested for the allocation
+    uint8_t age; // Search generation, bumped by newSearch() so old entries lose replacement priority
+
+    TTBucket& bucketFor(uint64_t key) const { return buckets[key & bucketMask]; } // Low key bits choose the bucket
+
+public:
+    TranspositionTable();
+    ~TranspositionTable();
+    bool resize(size_t megabytes, bool useHugePages); // Reallocating (rounded down to a power of two) and clearing
+    void clear(); // Emptying every entry
+    void newSearch(); // Starting a new search generation
+    bool probe(uint64_t key, TTHit& hit) const; // Looking up a position (true if found)
+    void store(uint64_t key, Move move, int score, int depth, int bound); // Saving a search result
+    int hashfull() const; // Entries of the current generation per thousand (sampled)
+    size_t sizeInMb() const { return sizeMb; } // Current size in megabytes
+    bool usesHugePages() const { return hugePages; } // Current huge page setting
+};
+
+extern TranspositionTable TT; // The table shared by all searches
+
+#endif
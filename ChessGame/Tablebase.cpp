@@ -0,0 +1,691 @@
+// Tablebase.cpp
+// Implementation of the endgame tablebases: position numbering with symmetry, retrograde generation on several
+// threads, the compressed file format, lookups, and the --tb-gen / --tb-probe tools.
+#include <algorithm> // Include algorithm for min and swap
+#include <atomic> // Include atomic for the counters shared by the generator threads
+#include <chrono> // Include chrono for timing the generation
+#include <climits> // Include climits for INT_MIN
+#include <cstdlib> // Include cstdlib for atoi
+#include <cstring> // Include cstring for strchr, strncmp and memset
+#include <iomanip> // Include iomanip for formatting the report
+#include <set> // Include set for collecting the smaller tables
+#include <thread> // Include thread for the generator threads
+#include <vector> // Include vector for the values and the solved lists
+#include "Tablebase.h" // Tablebase declarations
+#include "ChessGame.h" // Board for --tb-probe, CHECK_LIMIT
+#ifdef _WIN32
+#include <direct.h> // Include direct.h for _mkdir
+#else
+#include <sys/stat.h> // Include sys/stat.h for mkdir
+#endif
+using namespace std;
+
+static_assert(sizeof(TablebaseHeader) == 48, "The tablebase header must be 48 bytes");
+
+Tablebases TABLEBASES; // Tables consulted by the search and the game
+
+// Values stored per position: distance + 1 (an odd distance means the side to move wins, an even one that it loses,
+// 0 plies being checkmate), TB_DRAW, and two markers used only while generating.
+const uint8_t TB_UNKNOWN = 0; // Not solved yet
+const uint8_t TB_DRAW = 254; // Neither side can force the end of the game
+const uint8_t TB_INVALID = 255; // Impossible placement, or a mirror image numbered elsewhere
+const int TB_MAX_DISTANCE = 250; // Longest distance a value can hold
+const int TB_BLOCK_SIZE = 256; // Positions per compressed block
+
+static const char TB_ORDER[] = "QRBNP"; // Piece letters from strongest to weakest, the order inside a table name
+static const int TB_ORDER_TYPES[] = {QUEEN, ROOK, BISHOP, KNIGHT, PAWN}; // Piece types in the same order
+static const int TRIANGLE[10] = {0, 8, 9, 16, 17, 18, 24, 25, 26, 27}; // White king squares without pawns: a8-a5-d5
+
+// One side's pieces as a name: "K" followed by the other pieces, strongest first.
+static string sideName(const int counts[PIECE_TYPE_NB]) {
+    string name = "K";
+    for (int i = 0; i < 5; i++) name.append(counts[TB_ORDER_TYPES[i]], TB_ORDER[i]);
+    return name;
+}
+
+// True if side 'a' is stronger than side 'b': more pieces, or the stronger piece at the first difference.
+static bool strongerSide(const string& a, const string& b) {
+    if (a.size() != b.size()) return a.size() > b.size();
+    for (size_t i = 1; i < a.size(); i++) {
+        if (a[i] != b[i]) return strchr(TB_ORDER, a[i]) < strchr(TB_ORDER, b[i]);
+    }
+    return false;
+}
+
+// Name of the table holding a material balance; 'flip' is set if Black has the stronger side.
+static string materialName(const int counts[COLOR_NB][PIECE_TYPE_NB], bool& flip) {
+    string white = sideName(counts[WHITE]), black = sideName(counts[BLACK]);
+    flip = strongerSide(black, white);
+    return flip ? black + white : white + black;
+}
+
+static bool parseLayout(const string& name, TablebaseLayout& t) {
+    size_t second = name.find('K', 1);
+    if (name.size() < 3 || name.size() > size_t(TB_MAX_PIECES) || name[0] != 'K' || second == string::npos) return false;
+    int counts[COLOR_NB][PIECE_TYPE_NB] = {};
+    t.name = name;
+    t.pieceCount = 0;
+    t.pawns = false;
+    for (size_t i = 1; i < name.size(); i++) {
+        if (i == second) continue;
+        const char* letter = strchr(TB_ORDER, name[i]);
+        if (!letter || !*letter) return false;
+        t.colors[t.pieceCount] = i < second ? WHITE : BLACK;
+        t.types[t.pieceCount] = TB_ORDER_TYPES[letter - TB_ORDER];
+        t.pawns |= t.types[t.pieceCount] == PAWN;
+        counts[t.colors[t.pieceCount]][t.types[t.pieceCount]]++;
+        t.pieceCount++;
+    }
+    bool flip;
+    if (materialName(counts, flip) != name) return false; // Only the stronger-side-first spelling names a table
+    t.boards = 2 * (t.pawns ? 32 : 10) * 64;
+    for (int i = 0; i < t.pieceCount; i++) t.boards *= t.types[i] == PAWN ? 48 : 64;
+    return true;
+}
+
+// Symmetry 'sym' applied to a square: bit 0 mirrors the files, bit 1 the ranks, bit 2 swaps files and ranks.
+static int transformSquare(int sq, int sym) {
+    if (sym & 1) sq ^= 7;
+    if (sym & 2) sq ^= 56;
+    if (sym & 4) sq = (colOf(sq) << 3) | rowOf(sq);
+    return sq;
+}
+
+// Number of the white king's square, or -1 outside the squares used for numbering (files a-d with pawns, the
+// a8-a5-d5 triangle without).
+static int kingIndex(const TablebaseLayout& t, int sq) {
+    int row = rowOf(sq), col = colOf(sq);
+    if (t.pawns) return col < 4 ? row * 4 + col : -1;
+    return col <= row && row < 4 ? row * (row + 1) / 2 + col : -1;
+}
+
+// Number of a placement: side to move, white king, black king, then the other pieces in table order (pawns only use
+// rows 1-6). Of all mirror images of a position the lowest number is taken, so each position has exactly one, and
+// identical pieces are numbered in square order so swapping them changes nothing.
+static uint64_t boardIndex(const TablebaseLayout& t, int side, const int squares[]) {
+    uint64_t best = UINT64_MAX;
+    int n = t.pieceCount + 2;
+    for (int sym = 0; sym < (t.pawns ? 2 : 8); sym++) {
+        int sq[TB_MAX_PIECES];
+        for (int i = 0; i < n; i++) sq[i] = transformSquare(squares[i], sym);
+        int king = kingIndex(t, sq[0]);
+        if (king < 0) continue;
+        for (int i = 3; i < n; i++) { // Sorting runs of identical pieces (at most two here)
+            for (int j = i; j > 2 && t.types[j - 2] == t.types[j - 3] && t.colors[j - 2] == t.colors[j - 3] && sq[j - 1] > sq[j]; j--) swap(sq[j - 1], sq[j]);
+        }
+        uint64_t index = (uint64_t(side) * (t.pawns ? 32 : 10) + king) * 64 + sq[1];
+        for (int i = 0; i < t.pieceCount; i++) index = index * (t.types[i] == PAWN ? 48 : 64) + (t.types[i] == PAWN ? sq[i + 2] - 8 : sq[i + 2]);
+        if (index < best) best = index;
+    }
+    return best;
+}
+
+static void decodeBoard(const TablebaseLayout& t, uint64_t index, int& side, int squares[]) {
+    for (int i = t.pieceCount - 1; i >= 0; i--) {
+        int size = t.types[i] == PAWN ? 48 : 64;
+        squares[i + 2] = int(index % size) + (t.types[i] == PAWN ? 8 : 0);
+        index /= size;
+    }
+    squares[1] = int(index % 64);
+    index /= 64;
+    int kings = t.pawns ? 32 : 10;
+    int king = int(index % kings);
+    squares[0] = t.pawns ? (king / 4) * 8 + king % 4 : TRIANGLE[king];
+    side = int(index / kings);
+}
+
+// Placing the pieces of a placement (false if two share a square or the side not to move is in check). Keys are not
+// kept up to date: nothing here looks at them.
+static bool setupPosition(const TablebaseLayout& t, int side, const int squares[], Position& pos) {
+    pos.clear();
+    for (int i = 0; i < t.pieceCount + 2; i++) {
+        if (pos.occupied & squareBit(squares[i])) return false;
+        pos.putPiece(squares[i], i < 2 ? i : t.colors[i - 2], i < 2 ? KING : t.types[i - 2]); // Square 0 is White's king, 1 Black's
+    }
+    pos.sideToMove = side;
+    return !pos.inCheck(side ^ 1);
+}
+
+// Squares of a real position in table order; with 'flip' the colors are swapped and the board turned upside down.
+static void tableSquares(const TablebaseLayout& t, const Position& pos, bool flip, int& side, int squares[]) {
+    int turn = flip ? 56 : 0;
+    squares[0] = pos.kingSquare(WHITE ^ flip) ^ turn;
+    squares[1] = pos.kingSquare(BLACK ^ flip) ^ turn;
+    Bitboard taken = 0; // Pieces already placed (for identical pieces)
+    for (int i = 0; i < t.pieceCount; i++) {
+        int sq = lsb(pos.pieces(t.colors[i] ^ flip, t.types[i]) & ~taken);
+        taken |= squareBit(sq);
+        squares[i + 2] = sq ^ turn;
+    }
+    side = pos.sideToMove ^ flip;
+}
+
+// Playing a move on a bare position (tables have no castling or en passant rights). Returns the captured type.
+static int applyMove(Position& pos, Move m) {
+    int us = pos.sideToMove, from = moveFrom(m), to = moveTo(m);
+    int captured = (pos.occupied & squareBit(to)) ? pos.pieceTypeOn(to) : NO_PIECE_TYPE;
+    if (captured != NO_PIECE_TYPE) pos.removePiece(to, us ^ 1, captured);
+    if (moveKind(m) == PROMOTION) {
+        pos.removePiece(from, us, PAWN);
+        pos.putPiece(to, us, promotionType(m));
+    } else {
+        pos.relocatePiece(from, to, us, pos.pieceTypeOn(from));
+    }
+    pos.sideToMove = us ^ 1;
+    pos.enPassantSquare = NO_SQUARE;
+    return captured;
+}
+
+static void hitFromValue(uint8_t value, TablebaseHit& hit) {
+    if (value == TB_UNKNOWN || value >= TB_DRAW) {
+        hit.result = hit.plies = 0;
+        return;
+    }
+    hit.plies = value - 1;
+    hit.result = hit.plies & 1 ? 1 : -1;
+}
+
+bool TablebaseFile::open(const string& filename, const string& name) {
+    header = nullptr;
+    if (!parseLayout(name, layout) || !map.open(filename) || map.size() < sizeof(TablebaseHeader)) return false;
+    const TablebaseHeader* h = reinterpret_cast<const TablebaseHeader*>(map.data());
+    uint64_t size = map.size();
+    if (memcmp(h->magic, TB_MAGIC, sizeof(h->magic)) != 0 || h->version != TB_VERSION || h->checkLimit != uint32_t(CHECK_LIMIT) ||
+        strncmp(h->material, name.c_str(), sizeof(h->material)) != 0 || h->entryCount != layout.boards * CHECK_LIMIT ||
+        h->blockSize == 0 || h->blockCount != (h->entryCount + h->blockSize - 1) / h->blockSize ||
+        h->dataOffset != sizeof(TablebaseHeader) + (uint64_t(h->blockCount) + 1) * sizeof(uint32_t) || h->dataOffset > size) {
+        map.close();
+        return false;
+    }
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(map.data() + sizeof(TablebaseHeader));
+    for (uint32_t i = 0; i < h->blockCount; i++) { // Blocks must lie inside the file, in order
+        if (offsets[i] > offsets[i + 1]) {
+            map.close();
+            return false;
+        }
+    }
+    if (offsets[h->blockCount] > size - h->dataOffset) {
+        map.close();
+        return false;
+    }
+    header = h;
+    blockOffsets = offsets;
+    data = map.data() + h->dataOffset;
+    return true;
+}
+
+uint8_t TablebaseFile::value(uint64_t index) const {
+    if (!header || index >= header->entryCount) return TB_DRAW;
+    uint64_t block = index / header->blockSize;
+    uint32_t left = uint32_t(index % header->blockSize); // Position inside the block
+    const uint8_t* end = data + blockOffsets[block + 1];
+    for (const uint8_t* run = data + blockOffsets[block]; run + 1 < end; run += 2) { // (length - 1, value) pairs
+        if (left <= run[0]) return run[1];
+        left -= run[0] + 1;
+    }
+    return TB_DRAW; // Damaged block
+}
+
+// Every table this program can build: three pieces, two pieces on one side, and one piece against one.
+static vector<string> allTableNames() {
+    vector<string> names;
+    for (int i = 0; i < 5; i++) names.push_back(string("K") + TB_ORDER[i] + "K");
+    for (int i = 0; i < 5; i++) {
+        for (int j = i; j < 5; j++) names.push_back(string("K") + TB_ORDER[i] + TB_ORDER[j] + "K");
+    }
+    for (int i = 0; i < 5; i++) {
+        for (int j = i; j < 5; j++) names.push_back(string("K") + TB_ORDER[i] + "K" + TB_ORDER[j]);
+    }
+    return names;
+}
+
+bool Tablebases::add(const string& directory, const string& name) {
+    unique_ptr<TablebaseFile> table(new TablebaseFile);
+    if (!table->open(directory + "/" + name + TB_EXTENSION, name)) return false;
+    tables[name] = move(table);
+    dir = directory;
+    return true;
+}
+
+int Tablebases::open(const string& directory) {
+    close();
+    vector<string> names = allTableNames();
+    for (const string& name : names) add(directory, name);
+    dir = directory;
+    return size();
+}
+
+bool Tablebases::probe(const Position& pos, int checks, TablebaseHit& hit) const {
+    if (tables.empty() || popCount(pos.occupied) > TB_MAX_PIECES) return false; // The usual case, answered first
+    if (checks < 0 || checks >= CHECK_LIMIT || pos.castlingRights || pos.enPassantSquare != NO_SQUARE) return false;
+    if (popCount(pos.occupied) == 2) { // Bare kings: nobody can mate or give check
+        hit.result = hit.plies = 0;
+        return true;
+    }
+    int counts[COLOR_NB][PIECE_TYPE_NB];
+    for (int color = 0; color < COLOR_NB; color++) {
+        for (int type = 0; type < PIECE_TYPE_NB; type++) counts[color][type] = popCount(pos.pieces(color, type));
+    }
+    bool flip;
+    auto found = tables.find(materialName(counts, flip));
+    if (found == tables.end()) return false;
+    const TablebaseFile& table = *found->second;
+    int side, squares[TB_MAX_PIECES];
+    tableSquares(table.layout, pos, flip != 0, side, squares);
+    hitFromValue(table.value(uint64_t(checks) * table.layout.boards + boardIndex(table.layout, side, squares)), hit);
+    return true;
+}
+
+Move Tablebases::bestMove(const Position& pos, int checks, TablebaseHit* hit) const {
+    TablebaseHit here;
+    if (!probe(pos, checks, here)) return MOVE_NONE;
+    MoveList moves;
+    generateLegalMoves(pos, moves);
+    Move best = MOVE_NONE;
+    int bestScore = INT_MIN;
+    for (Move m : moves) {
+        Position child = pos;
+        applyMove(child, m);
+        bool givesCheck = child.inCheck(child.sideToMove);
+        TablebaseHit reply; // The opponent's result after the move
+        if (givesCheck && checks + 1 >= CHECK_LIMIT) reply.result = -1, reply.plies = 0; // The last check: lost on the spot
+        else if (!probe(child, checks + givesCheck, reply)) return MOVE_NONE; // A table the move leads to is missing
+        int score = reply.result < 0 ? 1000 - reply.plies : reply.result > 0 ? reply.plies - 1000 : 0; // Quick wins, slow losses
+        if (score > bestScore) {
+            bestScore = score;
+            best = m;
+            here.result = -reply.result;
+            here.plies = reply.result ? reply.plies + 1 : 0;
+        }
+    }
+    if (hit) *hit = here;
+    return best;
+}
+
+// State shared by the generator threads. For an unsolved position 'counter' holds the moves that might still save it
+// (plus one for each move to a drawn position, so it never reaches zero) and 'pending' the best distance known: odd
+// for the quickest win found, even for the longest loss so far.
+struct TablebaseWork {
+    TablebaseLayout layout; // Table being built
+    uint64_t size; // Positions: boards times check counts (check count is the highest digit)
+    vector<uint8_t> value; // Solved values (TB_UNKNOWN until then)
+    unique_ptr<atomic<uint8_t>[]> counter; // Moves not yet known to lose
+    unique_ptr<atomic<uint8_t>[]> pending; // Best distance found so far
+    atomic<int> maxPending; // Largest distance offered, so the loop knows when nothing is left to come
+};
+
+static void raisePending(TablebaseWork& w, int distance) {
+    int now = w.maxPending.load(memory_order_relaxed);
+    while (distance > now && !w.maxPending.compare_exchange_weak(now, distance, memory_order_relaxed)) {}
+}
+
+// A move to a position lost for the opponent: won in 'distance' unless a quicker win is known.
+static void offerWin(TablebaseWork& w, uint64_t index, int distance) {
+    if (distance > TB_MAX_DISTANCE) return;
+    uint8_t now = w.pending[index].load(memory_order_relaxed);
+    while ((now % 2 == 0 || distance < now) && !w.pending[index].compare_exchange_weak(now, uint8_t(distance), memory_order_relaxed)) {}
+    raisePending(w, distance);
+}
+
+// A move to a position won for the opponent: if all moves are like this, lost in the longest such 'distance'.
+static void offerLoss(TablebaseWork& w, uint64_t index, int distance) {
+    if (distance > TB_MAX_DISTANCE) return;
+    uint8_t now = w.pending[index].load(memory_order_relaxed);
+    while (now % 2 == 0 && distance > now && !w.pending[index].compare_exchange_weak(now, uint8_t(distance), memory_order_relaxed)) {}
+    raisePending(w, distance);
+}
+
+// Running body(begin, end, thread) over [0, count) in one slice per thread.
+template <class Body>
+static void parallelFor(uint64_t count, int threads, const Body& body) {
+    if (threads <= 1) {
+        body(0, count, 0);
+        return;
+    }
+    vector<thread> workers;
+    for (int id = 0; id < threads; id++) {
+        uint64_t begin = count * id / threads, end = count * (id + 1) / threads;
+        workers.emplace_back([&body, begin, end, id]() { body(begin, end, id); });
+    }
+    for (thread& worker : workers) worker.join();
+}
+
+// First pass over every placement: impossible ones are marked, checkmates, stalemates and last checks solved, moves
+// into smaller tables looked up, and the distinct moves that stay in this table counted.
+static void initBoards(TablebaseWork& w, uint64_t begin, uint64_t end) {
+    const TablebaseLayout& t = w.layout;
+    for (uint64_t board = begin; board < end; board++) {
+        int side, squares[TB_MAX_PIECES];
+        Position pos;
+        decodeBoard(t, board, side, squares);
+        if (!setupPosition(t, side, squares, pos) || boardIndex(t, side, squares) != board) {
+            for (int c = 0; c < CHECK_LIMIT; c++) w.value[c * t.boards + board] = TB_INVALID;
+            continue;
+        }
+        MoveList moves;
+        generateLegalMoves(pos, moves);
+        if (moves.size() == 0) { // Checkmate (lost now) or stalemate, whatever the check count
+            for (int c = 0; c < CHECK_LIMIT; c++) w.value[c * t.boards + board] = pos.inCheck(side) ? 1 : TB_DRAW;
+            continue;
+        }
+        int counter[CHECK_LIMIT] = {};
+        bool lastCheck[CHECK_LIMIT] = {}; // A check that ends the game is available
+        uint64_t quiet[MAX_MOVES]; // Distinct placements reached by moves that stay in this table
+        bool quietChecks[MAX_MOVES];
+        int quietCount = 0;
+        for (Move m : moves) {
+            Position child = pos;
+            int captured = applyMove(child, m);
+            bool givesCheck = child.inCheck(child.sideToMove);
+            if (captured == NO_PIECE_TYPE && moveKind(m) != PROMOTION) {
+                int childSquares[TB_MAX_PIECES];
+                for (int i = 0; i < t.pieceCount + 2; i++) childSquares[i] = squares[i] == moveFrom(m) ? moveTo(m) : squares[i];
+                uint64_t childBoard = boardIndex(t, side ^ 1, childSquares);
+                if (find(quiet, quiet + quietCount, childBoard) == quiet + quietCount) { // Mirror images count once
+                    quietChecks[quietCount] = givesCheck;
+                    quiet[quietCount++] = childBoard;
+                }
+                continue;
+            }
+            for (int c = 0; c < CHECK_LIMIT; c++) { // Into a smaller table, generated before this one
+                uint64_t index = c * t.boards + board;
+                TablebaseHit reply;
+                if (givesCheck && c + 1 >= CHECK_LIMIT) lastCheck[c] = true;
+                else if (!TABLEBASES.probe(child, c + givesCheck, reply) || reply.result == 0) counter[c]++; // A draw: never lost
+                else if (reply.result < 0) offerWin(w, index, reply.plies + 1);
+                else offerLoss(w, index, reply.plies + 1);
+            }
+        }
+        for (int i = 0; i < quietCount; i++) {
+            for (int c = 0; c < CHECK_LIMIT; c++) {
+                if (quietChecks[i] && c + 1 >= CHECK_LIMIT) lastCheck[c] = true;
+                else counter[c]++;
+            }
+        }
+        for (int c = 0; c < CHECK_LIMIT; c++) {
+            uint64_t index = c * t.boards + board;
+            w.value[index] = lastCheck[c] ? 2 : TB_UNKNOWN; // Won in one ply
+            w.counter[index].store(uint8_t(counter[c]), memory_order_relaxed);
+        }
+    }
+}
+
+// Passing a newly solved position to every position one move earlier in this table (the retrograde step): a lost
+// position makes its predecessors won, a won one takes away one of their saving moves.
+static void pushPredecessors(TablebaseWork& w, uint64_t index, int distance) {
+    const TablebaseLayout& t = w.layout;
+    int checks = int(index / t.boards), side, squares[TB_MAX_PIECES];
+    Position pos;
+    decodeBoard(t, index % t.boards, side, squares);
+    setupPosition(t, side, squares, pos);
+    bool inCheck = pos.inCheck(side);
+    if (inCheck && checks == 0) return; // The move that gave this check would have been counted
+    int checksBefore = checks - inCheck, mover = side ^ 1;
+    uint64_t previous[256]; // Distinct placements before the move
+    int previousCount = 0;
+    for (int i = 0; i < t.pieceCount + 2; i++) {
+        int color = i < 2 ? i : t.colors[i - 2], type = i < 2 ? KING : t.types[i - 2], to = squares[i];
+        if (color != mover) continue;
+        Bitboard from = 0;
+        if (type == PAWN) { // One step back, or two back to the starting row; moves that promoted or captured left other tables
+            int back = mover == WHITE ? 8 : -8, one = to + back;
+            if (rowOf(one) >= 1 && rowOf(one) <= 6 && !(pos.occupied & squareBit(one))) {
+                from |= squareBit(one);
+                if (rowOf(one + back) == (mover == WHITE ? 6 : 1) && !(pos.occupied & squareBit(one + back))) from |= squareBit(one + back);
+            }
+        } else {
+            from = pos.attacksFrom(type, mover, to) & ~pos.occupied;
+        }
+        while (from) {
+            int sq = popLsb(from);
+            Position before = pos;
+            before.relocatePiece(to, sq, mover, type);
+            before.sideToMove = mover;
+            if (before.inCheck(side)) continue; // The side that did not move cannot have been left in check
+            int beforeSquares[TB_MAX_PIECES];
+            for (int j = 0; j < t.pieceCount + 2; j++) beforeSquares[j] = j == i ? sq : squares[j];
+            uint64_t board = boardIndex(t, mover, beforeSquares);
+            if (find(previous, previous + previousCount, board) == previous + previousCount && previousCount < 256) previous[previousCount++] = board;
+        }
+    }
+    bool won = distance & 1; // The side to move here wins
+    for (int i = 0; i < previousCount; i++) {
+        uint64_t before = uint64_t(checksBefore) * t.boards + previous[i];
+        if (w.value[before] != TB_UNKNOWN) continue;
+        if (won) {
+            w.counter[before].fetch_sub(1, memory_order_relaxed);
+            offerLoss(w, before, distance + 1);
+        } else {
+            offerWin(w, before, distance + 1);
+        }
+    }
+}
+
+// Header, block index and run-length encoded values. Impossible placements take the value before them.
+static bool writeTable(const string& filename, const TablebaseWork& w, uint64_t& bytes) {
+    vector<uint32_t> offsets;
+    vector<uint8_t> data;
+    uint8_t last = TB_DRAW;
+    for (uint64_t start = 0; start < w.size; start += TB_BLOCK_SIZE) {
+        offsets.push_back(uint32_t(data.size()));
+        uint64_t end = min(start + uint64_t(TB_BLOCK_SIZE), w.size);
+        for (uint64_t i = start; i < end;) {
+            uint8_t v = w.value[i] == TB_INVALID ? last : w.value[i];
+            uint64_t run = 1;
+            while (i + run < end && run < 256 && (w.value[i + run] == v || w.value[i + run] == TB_INVALID)) run++;
+            data.push_back(uint8_t(run - 1));
+            data.push_back(v);
+            last = v;
+            i += run;
+        }
+    }
+    offsets.push_back(uint32_t(data.size()));
+
+    TablebaseHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TB_MAGIC, sizeof(header.magic));
+    header.version = TB_VERSION;
+    header.checkLimit = CHECK_LIMIT;
+    memcpy(header.material, w.layout.name.c_str(), w.layout.name.size()); // At most four letters, zero padded
+    header.entryCount = w.size;
+    header.blockSize = TB_BLOCK_SIZE;
+    header.blockCount = uint32_t(offsets.size() - 1);
+    header.dataOffset = sizeof(header) + offsets.size() * sizeof(uint32_t);
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(offsets.data(), sizeof(uint32_t), offsets.size(), file) == offsets.size() &&
+              fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) remove(filename.c_str());
+    bytes = header.dataOffset + data.size();
+    return ok;
+}
+
+// Tables a capture or a promotion leads to from this one (bare kings need no table).
+static set<string> smallerTables(const TablebaseLayout& t) {
+    int counts[COLOR_NB][PIECE_TYPE_NB] = {};
+    for (int i = 0; i < t.pieceCount; i++) counts[t.colors[i]][t.types[i]]++;
+    set<string> names;
+    bool flip;
+    for (int i = 0; i < t.pieceCount; i++) {
+        int color = t.colors[i], type = t.types[i];
+        counts[color][type]--; // Piece i captured
+        if (t.pieceCount > 1) names.insert(materialName(counts, flip));
+        counts[color][type]++;
+        if (type != PAWN) continue;
+        for (int promoted = KNIGHT; promoted <= QUEEN; promoted++) { // Pawn i promoted, with or without a capture
+            counts[color][PAWN]--;
+            counts[color][promoted]++;
+            names.insert(materialName(counts, flip));
+            for (int j = 0; j < t.pieceCount; j++) {
+                if (t.colors[j] == color) continue;
+                counts[t.colors[j]][t.types[j]]--;
+                names.insert(materialName(counts, flip));
+                counts[t.colors[j]][t.types[j]]++;
+            }
+            counts[color][promoted]--;
+            counts[color][PAWN]++;
+        }
+    }
+    return names;
+}
+
+bool generateTablebase(const string& directory, const string& name, int threads, ostream& out) {
+    TablebaseWork w;
+    if (!parseLayout(name, w.layout)) return false;
+    if (TABLEBASES.has(name)) return true;
+    if (TABLEBASES.add(directory, name)) {
+        out << name << ": already in " << directory << "\n";
+        return true;
+    }
+    set<string> children = smallerTables(w.layout);
+    for (const string& child : children) {
+        if (!generateTablebase(directory, child, threads, out)) return false;
+    }
+
+    auto start = chrono::steady_clock::now();
+    const TablebaseLayout& t = w.layout;
+    w.size = t.boards * CHECK_LIMIT;
+    w.value.assign(w.size, TB_UNKNOWN);
+    w.counter.reset(new atomic<uint8_t>[w.size]);
+    w.pending.reset(new atomic<uint8_t>[w.size]);
+    for (uint64_t i = 0; i < w.size; i++) w.pending[i].store(0, memory_order_relaxed);
+    w.maxPending = 0;
+    parallelFor(t.boards, threads, [&](uint64_t begin, uint64_t end, int) { initBoards(w, begin, end); });
+
+    // Distance by distance: a scan solves every position whose result is now known, then their predecessors are told.
+    // Wins and losses alternate with the parity of the distance, so each result is final the moment it is found.
+    vector<vector<uint64_t> > solved(threads);
+    for (int distance = 0; distance <= TB_MAX_DISTANCE; distance++) {
+        parallelFor(w.size, threads, [&](uint64_t begin, uint64_t end, int id) {
+            solved[id].clear();
+            for (uint64_t i = begin; i < end; i++) {
+                uint8_t v = w.value[i];
+                if (v == TB_UNKNOWN) {
+                    int best = w.pending[i].load(memory_order_relaxed);
+                    if (distance == 0 || best != distance || (distance % 2 == 0 && w.counter[i].load(memory_order_relaxed) != 0)) continue;
+                    w.value[i] = uint8_t(distance + 1);
+                } else if (v != distance + 1 || distance > 1) {
+                    continue; // Only the results of the first pass are picked up here
+                }
+                solved[id].push_back(i);
+            }
+        });
+        uint64_t count = 0;
+        for (const vector<uint64_t>& list : solved) count += list.size();
+        if (count == 0 && distance > 1 && distance >= w.maxPending.load()) break; // Past the first pass's results and every offer
+        parallelFor(threads, threads, [&](uint64_t begin, uint64_t, int) {
+            for (uint64_t i : solved[begin]) pushPredecessors(w, i, distance);
+        });
+    }
+
+    uint64_t wins = 0, losses = 0, draws = 0;
+    int longest = 0;
+    for (uint64_t i = 0; i < w.size; i++) {
+        uint8_t& v = w.value[i];
+        if (v == TB_UNKNOWN) v = TB_DRAW; // Never forced either way
+        if (v == TB_INVALID) continue;
+        if (v == TB_DRAW) draws++;
+        else if ((v - 1) & 1) wins++;
+        else losses++;
+        if (v != TB_DRAW && v - 1 > longest) longest = v - 1;
+    }
+    w.counter.reset();
+    w.pending.reset();
+    uint64_t bytes = 0;
+    string filename = directory + "/" + name + TB_EXTENSION;
+    if (!writeTable(filename, w, bytes) || !TABLEBASES.add(directory, name)) {
+        out << name << ": cannot write " << filename << "\n";
+        return false;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    out << name << ": " << wins + losses + draws << " positions (" << wins << " won, " << draws << " drawn, " << losses
+        << " lost for the side to move), longest " << longest << " plies, " << fixed << setprecision(2) << seconds << "s, "
+        << setprecision(1) << bytes / 1024.0 << " KB (" << setprecision(2) << double(bytes) / w.size << " bytes/position)\n";
+    out.unsetf(ios::fixed);
+    return true;
+}
+
+// Usage:
+//   ChessGame --tb-gen <dir> [all | KQK KRK ...] [--threads N]   (default: every three-piece table)
+//   ChessGame --tb-probe <dir> [--fen <FEN>] [--checks N]
+int tablebaseMain(int argc, char* argv[]) {
+    string mode = argv[1], dir, fen = START_FEN;
+    vector<string> names;
+    int threads = (int)thread::hardware_concurrency(), checks = 0;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (arg == "--checks" && i + 1 < argc) checks = atoi(argv[++i]);
+        else if (arg == "--fen") { // One quoted argument or the six fields
+            fen.clear();
+            while (i + 1 < argc && string(argv[i + 1]).compare(0, 2, "--") != 0) fen += string(fen.empty() ? "" : " ") + argv[++i];
+        }
+        else if (dir.empty()) dir = arg;
+        else names.push_back(arg);
+    }
+    if (dir.empty()) {
+        cerr << "Usage: --tb-gen <dir> [all | KQK KRK ...] [--threads N]\n       --tb-probe <dir> [--fen <FEN>] [--checks N]\n";
+        return 2;
+    }
+    ChessBoard board; // Builds the move tables
+    if (mode == "--tb-gen") {
+#ifdef _WIN32
+        _mkdir(dir.c_str());
+#else
+        mkdir(dir.c_str(), 0755); // Fails harmlessly if it exists
+#endif
+        vector<string> all = allTableNames();
+        if (names.empty()) names.assign(all.begin(), all.begin() + 5); // The three-piece tables
+        else if (names[0] == "all") names = all;
+        TABLEBASES.open(dir); // Tables already there are reused
+        auto start = chrono::steady_clock::now();
+        for (const string& name : names) {
+            if (!generateTablebase(dir, name, threads < 1 ? 1 : threads, cout)) {
+                cerr << "Cannot generate " << name << " (unknown table or write error)\n";
+                return 2;
+            }
+        }
+        cout << TABLEBASES.size() << " tables in " << dir << ", " << fixed << setprecision(2)
+             << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s\n";
+        cout.unsetf(ios::fixed);
+        return 0;
+    }
+    if (TABLEBASES.open(dir) == 0) {
+        cerr << "No tables in " << dir << "\n";
+        return 2;
+    }
+    if (!board.loadFen(fen)) {
+        cerr << "Invalid FEN: " << fen << "\n";
+        return 2;
+    }
+    Position pos = board.position();
+    TablebaseHit hit;
+    auto start = chrono::steady_clock::now();
+    bool found = TABLEBASES.probe(pos, checks, hit);
+    double us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    if (!found) {
+        cout << "Not covered (more than " << TB_MAX_PIECES << " pieces, castling or en passant rights, or a missing table)\n";
+        return 0;
+    }
+    cout << (hit.result > 0 ? "Win" : hit.result < 0 ? "Loss" : "Draw") << " for the side to move";
+    if (hit.result) cout << " in " << hit.plies << " plies";
+    cout << " (lookup " << fixed << setprecision(1) << us << " us)\n";
+    cout.unsetf(ios::fixed);
+    if (hit.result == 0) return 0;
+    cout << "Line:"; // Both sides playing the table's best moves to the end
+    for (int ply = 0; ply < TB_MAX_DISTANCE; ply++) {
+        Move m = TABLEBASES.bestMove(pos, checks);
+        if (m == MOVE_NONE) break;
+        cout << " " << moveToString(m);
+        applyMove(pos, m);
+        if (pos.inCheck(pos.sideToMove) && ++checks >= CHECK_LIMIT) {
+            cout << " (check number " << CHECK_LIMIT << ")";
+            break;
+        }
+    }
+    MoveList left;
+    generateLegalMoves(pos, left);
+    cout << (left.size() == 0 && pos.inCheck(pos.sideToMove) ? " (checkmate)" : "") << "\n";
+    return 0;
+}
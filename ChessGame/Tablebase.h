@@ -0,0 +1,98 @@
+// Tablebase.h
+// Endgame tablebases: the exact result and distance to the end of the game for every position with up to four
+// pieces (kings included), built by retrograde analysis. The N-check rule can end these endings too (a lone bishop
+// or knight wins by giving enough checks), so a table stores one result per number of checks already given. Results
+// count plies until checkmate or the last allowed check; the 50-move rule and repetitions are not part of them.
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <cstdint> // Include cstdint for the fixed-width file fields
+#include <iostream> // Include iostream for the generation report
+#include <map> // Include map for the open tables
+#include <memory> // Include memory for owning the tables
+#include <string> // Include string for table and file names
+#include "Archive.h" // Include MappedFile
+#include "Move.h" // Include the move type and the position core
+
+const int TB_MAX_PIECES = 4; // Largest endings covered, both kings included
+const char TB_DEFAULT_DIR[] = "tablebases"; // Directory opened at start-up if it exists
+const char TB_EXTENSION[] = ".ctb"; // File name ending of a table ("KQKR.ctb")
+
+// One table file: header, block index, then run-length encoded values (one byte per position, TB_BLOCK_SIZE positions
+// per block, so a lookup decodes at most one block). Unused index slots repeat the previous value to keep runs long.
+struct TablebaseHeader {
+    char magic[8]; // TB_MAGIC
+    uint32_t version; // TB_VERSION
+    uint32_t checkLimit; // CHECK_LIMIT the table was built for (a different rule needs different tables)
+    char material[8]; // Table name, e.g. "KQKR", zero padded
+    uint64_t entryCount; // Positions indexed (boards times check counts)
+    uint32_t blockSize; // Positions per block
+    uint32_t blockCount; // Blocks; the index holds blockCount + 1 offsets
+    uint64_t dataOffset; // File offset of the first block (offsets in the index are relative to it)
+};
+
+const char TB_MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'C', 'T', 'B'}; // First bytes of every table
+const uint32_t TB_VERSION = 1; // Format version written by this program
+
+// Result of a lookup, from the point of view of the side to move.
+struct TablebaseHit {
+    int result; // 1 win, 0 draw, -1 loss
+    int plies; // Half-moves until the game ends with best play (0 for a draw or when already mated)
+};
+
+// Which pieces a table holds and how its positions are numbered. The stronger side is always "white" in the table;
+// positions where Black is stronger are looked up with the colors swapped.
+struct TablebaseLayout {
+    std::string name; // e.g. "KQKR": White's pieces from the first K, then Black's from the second
+    int pieceCount; // Pieces other than the kings
+    int colors[TB_MAX_PIECES - 2]; // Color and type of each, White's first, strongest first
+    int types[TB_MAX_PIECES - 2];
+    bool pawns; // With pawns only the left-right mirror is a symmetry, without them all eight are
+    uint64_t boards; // Numbered piece placements times the two sides to move
+};
+
+class TablebaseFile {
+private:
+    MappedFile map; // The whole file
+    const TablebaseHeader* header; // Start of the map
+    const uint32_t* blockOffsets; // blockCount + 1 offsets into the data
+    const uint8_t* data; // Run-length encoded values
+
+    TablebaseFile(const TablebaseFile&); // Not copyable: the mapping has one owner
+    TablebaseFile& operator=(const TablebaseFile&);
+
+public:
+    TablebaseLayout layout; // Pieces and numbering of the table
+
+    TablebaseFile() : header(nullptr), blockOffsets(nullptr), data(nullptr) {}
+    bool open(const std::string& filename, const std::string& name); // Mapping and checking a table (false if missing or damaged)
+    uint8_t value(uint64_t index) const; // Stored value of one position
+};
+
+// The open tables. Opening happens before searching starts; lookups only read, so any number of search threads may
+// probe at once.
+class Tablebases {
+private:
+    std::map<std::string, std::unique_ptr<TablebaseFile> > tables; // Open tables by name
+    std::string dir; // Directory they came from
+
+public:
+    int open(const std::string& directory); // Opening every table in a directory (returns how many were found)
+    bool add(const std::string& directory, const std::string& name); // Opening one table (after generating it)
+    void close() { tables.clear(); dir.clear(); }
+    int size() const { return (int)tables.size(); }
+    const std::string& directory() const { return dir; }
+    bool has(const std::string& name) const { return tables.count(name) != 0; }
+    // Looking up a position with 'checks' checks already given in the game. False if the position is not covered:
+    // too many pieces, castling or en passant rights, or the table is missing.
+    bool probe(const Position& pos, int checks, TablebaseHit& hit) const;
+    Move bestMove(const Position& pos, int checks, TablebaseHit* hit = nullptr) const; // Quickest win, a draw, or the longest loss
+};
+
+extern Tablebases TABLEBASES; // Tables consulted by the search and the game
+
+// Building one table, and first every smaller table it leads to through captures and promotions, into 'directory'.
+bool generateTablebase(const std::string& directory, const std::string& name, int threads, std::ostream& out);
+int tablebaseMain(int argc, char* argv[]); // Command-line entry for --tb-gen and --tb-probe
+
+#endif
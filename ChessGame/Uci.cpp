@@ -0,0 +1,181 @@
+// Uci.cpp
+// Implementation of the UCI command loop.
+#include <condition_variable> // Include condition_variable for holding back an infinite search's bestmove
+#include <mutex> // Include mutex for the stop request and the output lock
+#include <sstream> // Include stringstream for splitting command lines
+#include <thread> // Include thread for the background search
+#include "Uci.h" // UCI entry point
+#include "Book.h" // Opening book (OwnBook and BookFile options)
+#include "Profile.h" // Hot-path counters (stats command)
+#include "Tablebase.h" // Endgame tables (TablebaseDir option)
+#include "Search.h" // Engine (ENGINE pool and search limits)
+#include "TT.h" // Transposition table (Hash option, ucinewgame)
+using namespace std;
+
+static mutex outputLock; // Guards standard output while the search thread and the command loop both write to it
+
+void uciWrite(const string& lines) {
+    lock_guard<mutex> guard(outputLock);
+    cout.write(lines.data(), streamsize(lines.size()));
+    cout.flush();
+}
+
+// Game state the GUI has set up with "position": the board and the checks given on the way (custom N-check rule).
+struct UciGame {
+    ChessBoard board; // Position after the listed moves
+    int checks; // Checks given by the listed moves
+    UciGame() : checks(0) {}
+};
+
+// "position startpos [moves ...]" or "position fen <FEN> [moves ...]". Returns false on a bad FEN or illegal move,
+// leaving the board at the last good position.
+static bool setPosition(UciGame& game, istringstream& in) {
+    string token, fen;
+    in >> token;
+    if (token == "startpos") {
+        fen = START_FEN;
+        in >> token; // "moves" or nothing
+    } else if (token == "fen") {
+        while (in >> token && token != "moves") fen += (fen.empty() ? "" : " ") + token; // FEN runs up to "moves"
+    } else {
+        return false;
+    }
+    if (!game.board.loadFen(fen)) return false;
+    game.checks = 0;
+
+    while (in >> token) {
+        Move m = game.board.parseMove(token);
+        if (m == MOVE_NONE) return false;
+        game.board.playMove(m); // Keeps the repetition history like a real game
+        if (game.board.isKingInCheck(game.board.isWhiteToMove())) game.checks++; // The move gave check
+    }
+    return true;
+}
+
+// "go ..." options turned into search limits. With a clock and no fixed time, a share of the remaining time is used.
+static SearchLimits parseGo(istringstream& in, bool whiteToMove) {
+    SearchLimits limits;
+    string token;
+    int time[2] = {0, 0}, inc[2] = {0, 0}, movesToGo = 0; // Clock state for white and black
+    while (in >> token) {
+        if (token == "depth") in >> limits.depth;
+        else if (token == "movetime") in >> limits.moveTimeMs;
+        else if (token == "nodes") in >> limits.nodes;
+        else if (token == "wtime") in >> time[WHITE];
+        else if (token == "btime") in >> time[BLACK];
+        else if (token == "winc") in >> inc[WHITE];
+        else if (token == "binc") in >> inc[BLACK];
+        else if (token == "movestogo") in >> movesToGo;
+        // "infinite" needs nothing: no limit is set, the search runs until "stop"
+    }
+    int us = whiteToMove ? WHITE : BLACK;
+    if (!limits.moveTimeMs && time[us] > 0) {
+        int budget = time[us] / (movesToGo > 0 ? movesToGo : 30) + inc[us] * 3 / 4; // Spread the clock over the game
+        int safe = time[us] - 50; // Never plan to use the last 50 ms (pipe and process overhead)
+        limits.moveTimeMs = budget < safe ? budget : (safe > 10 ? safe : 10);
+    }
+    return limits;
+}
+
+int uciMain(istream& in) {
+    UciGame game;
+    bool ownBook = true; // Playing book moves without searching (the GUI may use its own book instead)
+    thread searchThread; // Running search, if any
+    mutex stopLock; // Guards 'stopRequested'
+    condition_variable stopSignal; // Wakes an infinite search waiting to send its bestmove
+    bool stopRequested = false; // "stop" or "quit" seen since the last "go"
+    auto requestStop = [&]() {
+        {
+            lock_guard<mutex> guard(stopLock);
+            stopRequested = true;
+        }
+        stopSignal.notify_all();
+        ENGINE.stop();
+    };
+    auto waitForSearch = [&]() { // Commands that change the position or options wait for the search to finish
+        if (searchThread.joinable()) searchThread.join();
+    };
+
+    string line;
+    while (getline(in, line)) {
+        istringstream command(line);
+        string token;
+        command >> token;
+        if (token == "uci") {
+            ostringstream out;
+            out << "id name Chess Master\n";
+            out << "id author Chess Master team\n";
+            out << "option name Hash type spin default " << TT_DEFAULT_MB << " min 1 max 65536\n";
+            out << "option name Threads type spin default " << ENGINE.threads() << " min 1 max 1024\n";
+            out << "option name OwnBook type check default true\n";
+            out << "option name BookFile type string default " << (BOOK.isOpen() ? BOOK.fileName() : string(BOOK_DEFAULT_FILE)) << "\n";
+            out << "option name TablebaseDir type string default " << (TABLEBASES.size() ? TABLEBASES.directory() : string(TB_DEFAULT_DIR)) << "\n";
+            out << "uciok\n";
+            uciWrite(out.str());
+        } else if (token == "isready") {
+            uciWrite("readyok\n");
+        } else if (token == "ucinewgame") {
+            waitForSearch();
+            TT.clear();
+            game = UciGame();
+        } else if (token == "setoption") { // setoption name <Hash|Threads|OwnBook|BookFile|TablebaseDir> value <value>
+            waitForSearch();
+            string name, value;
+            command >> token >> name >> token;
+            getline(command >> ws, value); // The rest of the line: file names may contain spaces
+            if (name == "Hash") TT.resize(atoi(value.c_str()) > 0 ? atoi(value.c_str()) : 1, TT.usesHugePages());
+            else if (name == "Threads") ENGINE.setThreads(atoi(value.c_str()));
+            else if (name == "OwnBook") ownBook = value == "true";
+            else if (name == "BookFile" && !BOOK.open(value)) uciWrite("info string cannot open book " + value + "\n");
+            else if (name == "TablebaseDir") uciWrite("info string " + to_string(TABLEBASES.open(value)) + " tablebases in " + value + "\n");
+        } else if (token == "position") {
+            waitForSearch();
+            if (!setPosition(game, command)) uciWrite("info string invalid position or move in: " + line + "\n");
+        } else if (token == "go") {
+            waitForSearch();
+            SearchLimits limits = parseGo(command, game.board.isWhiteToMove());
+            bool infinite = limits.depth == MAX_SEARCH_DEPTH && !limits.moveTimeMs && !limits.nodes; // Analysis: always search
+            Move bookMove = ownBook && !infinite ? BOOK.pick(game.board.position()) : MOVE_NONE;
+            if (bookMove != MOVE_NONE) { // Answered at once, no search thread
+                uciWrite("info string book move\nbestmove " + moveToString(bookMove) + "\n");
+                continue;
+            }
+            TablebaseHit tableHit;
+            Move tableMove = infinite ? MOVE_NONE : TABLEBASES.bestMove(game.board.position(), game.checks, &tableHit);
+            if (tableMove != MOVE_NONE) { // A covered ending: the table's move, also at once
+                ostringstream out;
+                out << "info string tablebase " << (tableHit.result > 0 ? "win" : tableHit.result < 0 ? "loss" : "draw");
+                if (tableHit.result) out << " in " << tableHit.plies << " plies";
+                out << "\nbestmove " << moveToString(tableMove) << "\n";
+                uciWrite(out.str());
+                continue;
+            }
+            UciGame snapshot = game; // The search works on its own copy; "position" may change 'game' meanwhile
+            stopRequested = false; // No search is running: nothing else reads it now
+            ENGINE.clearStop(); // Here, not on the search thread: a "stop" right after "go" must reach the search
+            searchThread = thread([&, snapshot, limits, infinite]() {
+                SearchResult result = ENGINE.search(snapshot.board, snapshot.checks, limits, true);
+                if (infinite) { // UCI: even a finished analysis (mate found, deepest iteration done) waits for "stop"
+                    unique_lock<mutex> guard(stopLock);
+                    stopSignal.wait(guard, [&]() { return stopRequested; });
+                }
+                uciWrite("bestmove " + moveToString(result.bestMove) + "\n");
+            });
+        } else if (token == "stop") {
+            requestStop();
+            waitForSearch();
+        } else if (token == "stats") { // Not UCI: the hot-path counters ("stats json" for the machine-readable form)
+            string format;
+            command >> format;
+            ostringstream out; // The whole table in one write, so an info line cannot land in the middle of it
+            if (format == "json") writeProfileJson(out);
+            else printProfile(out);
+            uciWrite(out.str());
+        } else if (token == "quit") {
+            break;
+        }
+    }
+    requestStop(); // End of input or "quit": finish any running search before leaving
+    waitForSearch();
+    return 0;
+}
@@ -0,0 +1,19 @@
+// Uci.h
+// Headless Universal Chess Interface mode: commands on standard input, replies on standard output, no board drawing.
+#ifndef UCI_H
+#define UCI_H
+
+#include <iostream> // Include iostream for the default streams
+#include <string> // Include string for protocol lines
+
+// Reads UCI commands until "quit" or end of input. Supported: uci, isready, ucinewgame, setoption (Hash, Threads,
+// OwnBook, BookFile, TablebaseDir), position startpos|fen <FEN> [moves ...], go [depth N] [movetime ms] [nodes N] [wtime/btime/winc/binc/movestogo]
+// [infinite], stop and quit. The search runs on its own thread so "stop" and "isready" are answered while it thinks;
+// an infinite search holds back its bestmove until "stop" even if it ends sooner. Positions in the opening book or the
+// endgame tables are answered at once.
+int uciMain(std::istream& in = std::cin);
+// Writing whole protocol lines ('lines' ends with a newline) to standard output in one write under a lock, so lines
+// from the search thread and the command loop never run into each other.
+void uciWrite(const std::string& lines);
+
+#endif
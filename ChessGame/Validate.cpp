@@ -0,0 +1,201 @@
+// Validate.cpp
+// Implementation of the validation pipeline:
+//
+//   reader thread --(work queue)--> validator threads --(done queue)--> writer (calling thread) --(free queue)--> reader
+//
+// Games travel in batches so the queues are locked once per batch, not once per game. The batches are allocated up
+// front and recycled through the free queue, which caps the memory in flight: when the writer falls behind, the
+// reader runs out of batches and waits (backpressure), and when the reader is ahead, the workers never wait for it.
+#include <atomic> // Include atomic for counting finished workers
+#include <chrono> // Include chrono for timing the run
+#include <cstdlib> // Include cstdlib for atoi
+#include <fstream> // Include fstream for the --out report file
+#include <iomanip> // Include iomanip for formatting the report
+#include <map> // Include map for batches that finished out of order
+#include <memory> // Include memory for owning the batches
+#include <thread> // Include thread for the reader and the workers
+#include <vector> // Include vector for the batches and threads
+#include "BoundedQueue.h" // Queues between the pipeline stages
+#include "Pgn.h" // Reader and replay
+#include "Validate.h" // Validation declarations
+using namespace std;
+
+const int VALIDATE_BATCH_SIZE = 64; // Games per batch
+const int BATCHES_PER_WORKER = 4; // Batches in flight per worker: enough to keep everyone busy, little memory
+
+// What happened to one game, beyond the replay itself.
+const int ENDING_NONE = 0; // The moves stop in a position with legal moves left
+const int ENDING_CHECKMATE = 1; // The last move mated
+const int ENDING_STALEMATE = 2; // The last move stalemated
+
+struct ValidationBatch {
+    uint64_t sequence; // Position of the batch in the file (writer order)
+    uint64_t firstGame; // Number of the batch's first game, counting from 1
+    int count; // Games in use
+    PgnGame games[VALIDATE_BATCH_SIZE]; // Filled by the reader
+    ReplayResult replays[VALIDATE_BATCH_SIZE]; // Filled by a worker
+    bool valid[VALIDATE_BATCH_SIZE]; // Every move of the game was legal
+    int endings[VALIDATE_BATCH_SIZE]; // ENDING_* of the final position
+};
+
+static int resultIndex(const string& result) {
+    if (result == "1-0") return 0;
+    if (result == "0-1") return 1;
+    if (result == "1/2-1/2") return 2;
+    return 3;
+}
+
+static void validateBatch(ValidationBatch& batch, ChessBoard& board) {
+    for (int i = 0; i < batch.count; i++) {
+        batch.valid[i] = replayGame(batch.games[i], board, batch.replays[i]);
+        batch.endings[i] = ENDING_NONE;
+        if (batch.valid[i]) {
+            MoveList moves; // Any legal move left in the final position?
+            board.generateMoves(moves);
+            if (moves.size() == 0) batch.endings[i] = board.isKingInCheck(board.isWhiteToMove()) ? ENDING_CHECKMATE : ENDING_STALEMATE;
+        }
+    }
+}
+
+// The writer's part: counting a finished batch and printing its report lines.
+static void reportBatch(const ValidationBatch& batch, bool reportAll, ostream& out, ValidationSummary& summary) {
+    for (int i = 0; i < batch.count; i++) {
+        const ReplayResult& r = batch.replays[i];
+        uint64_t number = batch.firstGame + i;
+        summary.games++;
+        summary.moves += r.plies;
+        summary.results[resultIndex(r.result)]++;
+        if (r.checkLimitWinner != COLOR_NB) summary.checkLimitGames[r.checkLimitWinner]++;
+        if (!batch.valid[i]) {
+            summary.badGames++;
+            out << "game " << number << " offset " << batch.games[i].offset << ": ERROR " << r.error << "\n";
+        } else if (reportAll) {
+            out << "game " << number << ": " << (r.result.empty() ? "?" : r.result) << " plies " << r.plies << " checks "
+                << r.checks[WHITE] << "/" << r.checks[BLACK];
+            if (r.checkLimitWinner != COLOR_NB) {
+                out << ", " << (r.checkLimitWinner == WHITE ? "White" : "Black") << " wins by check " << CHECK_LIMIT << " at ply " << r.checkLimitPly;
+            }
+            if (batch.endings[i] == ENDING_CHECKMATE) out << ", checkmate";
+            if (batch.endings[i] == ENDING_STALEMATE) out << ", stalemate";
+            out << "\n";
+        }
+    }
+}
+
+bool validateArchive(const string& filename, bool moveList, int threads, bool reportAll, ostream& out, ValidationSummary& summary) {
+    summary = ValidationSummary();
+    PgnReader reader(filename, moveList);
+    if (!reader.isOpen()) return false;
+    if (threads < 1) threads = 1;
+
+    int batchCount = threads * BATCHES_PER_WORKER + 2; // The reader and the writer each hold one as well
+    vector<unique_ptr<ValidationBatch> > batches; // Owner of every batch
+    BoundedQueue<ValidationBatch*> freeQueue(batchCount), workQueue(batchCount), doneQueue(batchCount);
+    for (int i = 0; i < batchCount; i++) {
+        batches.push_back(unique_ptr<ValidationBatch>(new ValidationBatch()));
+        freeQueue.push(batches.back().get());
+    }
+    auto start = chrono::steady_clock::now();
+
+    thread readerThread([&]() { // Reading and splitting the file into games, in order
+        uint64_t sequence = 0, games = 0;
+        ValidationBatch* batch;
+        bool more = true;
+        while (more && freeQueue.pop(batch)) {
+            batch->count = 0;
+            while (batch->count < VALIDATE_BATCH_SIZE && (more = reader.nextGame(batch->games[batch->count]))) batch->count++;
+            if (batch->count == 0) break; // End of file exactly at a batch boundary
+            batch->sequence = sequence++;
+            batch->firstGame = games + 1;
+            games += batch->count;
+            workQueue.push(batch);
+        }
+        workQueue.close(); // The workers drain what is queued and stop
+    });
+
+    // Each worker replays on its own board. They are built here because the first ChessBoard fills the shared
+    // lookup tables, which must not happen on several threads at once.
+    vector<unique_ptr<ChessBoard> > boards;
+    for (int t = 0; t < threads; t++) boards.push_back(unique_ptr<ChessBoard>(new ChessBoard()));
+    atomic<int> running(threads); // The last worker to finish closes the done queue
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            ValidationBatch* batch;
+            while (workQueue.pop(batch)) {
+                validateBatch(*batch, *boards[t]);
+                doneQueue.push(batch);
+            }
+            if (--running == 0) doneQueue.close();
+        });
+    }
+
+    // Writer: batches finish in any order; each one waits in 'pending' until all earlier ones have been reported.
+    map<uint64_t, ValidationBatch*> pending;
+    uint64_t nextSequence = 0;
+    ValidationBatch* batch;
+    while (doneQueue.pop(batch)) {
+        pending[batch->sequence] = batch;
+        while (!pending.empty() && pending.begin()->first == nextSequence) {
+            ValidationBatch* ready = pending.begin()->second;
+            pending.erase(pending.begin());
+            reportBatch(*ready, reportAll, out, summary);
+            nextSequence++;
+            freeQueue.push(ready); // Back to the reader
+        }
+    }
+    freeQueue.close(); // Unblocks the reader if it stopped early
+    readerThread.join();
+    for (thread& t : workers) t.join();
+    summary.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    out.flush();
+    return true;
+}
+
+// Usage:
+//   ChessGame --validate <file.pgn | -> [--moves] [--threads N] [--all] [--out report.txt]
+// --moves reads a move list (one game per line) instead of PGN, --all reports every game instead of only the bad ones.
+int validateMain(int argc, char* argv[]) {
+    string filename, outName;
+    bool moveList = false, reportAll = false;
+    int threads = (int)thread::hardware_concurrency(); // All cores by default
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--moves") moveList = true;
+        else if (arg == "--all") reportAll = true;
+        else if (arg == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc) outName = argv[++i];
+        else if (filename.empty()) filename = arg;
+        else {
+            cerr << "Unknown validate option: " << arg << "\n";
+            return 2;
+        }
+    }
+    if (filename.empty()) {
+        cerr << "Usage: --validate <file.pgn | -> [--moves] [--threads N] [--all] [--out report.txt]\n";
+        return 2;
+    }
+    ofstream outFile;
+    if (!outName.empty()) {
+        outFile.open(outName);
+        if (!outFile) {
+            cerr << "Cannot write " << outName << "\n";
+            return 2;
+        }
+    }
+    ostream& out = outName.empty() ? cout : outFile;
+
+    ValidationSummary s;
+    if (!validateArchive(filename, moveList, threads, reportAll, out, s)) {
+        cerr << "Cannot open " << filename << "\n";
+        return 2;
+    }
+    cout << s.games << " games, " << s.moves << " moves, " << s.badGames << " with errors\n";
+    cout << "Results: 1-0 " << s.results[0] << ", 0-1 " << s.results[1] << ", 1/2-1/2 " << s.results[2] << ", other " << s.results[3] << "\n";
+    cout << "Decided by the " << CHECK_LIMIT << "-check rule: White " << s.checkLimitGames[WHITE] << ", Black " << s.checkLimitGames[BLACK] << "\n";
+    cout << "Threads " << (threads < 1 ? 1 : threads) << "  time " << fixed << setprecision(3) << s.seconds << "s  "
+         << (uint64_t)(s.seconds > 0 ? s.games / s.seconds : 0) << " games/s  " << (uint64_t)(s.seconds > 0 ? s.moves / s.seconds : 0)
+         << " moves/s\n";
+    cout.unsetf(ios::fixed);
+    return s.badGames ? 1 : 0;
+}
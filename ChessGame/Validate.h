@@ -0,0 +1,29 @@
+// Validate.h
+// Batch validation of game archives: games are read in order, checked on a pool of worker threads and reported in
+// the original order.
+#ifndef VALIDATE_H
+#define VALIDATE_H
+
+#include <cstdint> // Include cstdint for the counters
+#include <iostream> // Include iostream for the report stream
+#include <string> // Include string for the file name
+
+// Totals of one validation run.
+struct ValidationSummary {
+    uint64_t games; // Games read
+    uint64_t moves; // Moves replayed
+    uint64_t badGames; // Games with an illegal move or a bad FEN tag
+    uint64_t checkLimitGames[2]; // Games the N-check rule would have ended, by the side giving the last check
+    uint64_t results[4]; // Result tokens: 1-0, 0-1, 1/2-1/2 and anything else (* or missing)
+    double seconds; // Wall-clock time of the run
+};
+
+// Validates every game of a PGN file (or a move list with one game per line) with 'threads' worker threads.
+// Each game gets one report line on 'out' if it has an error or if 'reportAll' is set; the lines come out in file
+// order whatever order the workers finish in. Returns false if the file cannot be opened.
+bool validateArchive(const std::string& filename, bool moveList, int threads, bool reportAll, std::ostream& out,
+                     ValidationSummary& summary);
+
+int validateMain(int argc, char* argv[]); // Command-line entry for --validate, returning the process exit code
+
+#endif